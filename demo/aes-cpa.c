@@ -0,0 +1,300 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file demonstrates the correlation analysis engine: it captures
+ * Prime+Probe samples of T-table AES encryptions of random plaintexts to a
+ * binary trace file and then analyses the trace offline. For every key byte
+ * and key guess, the leakage model predicts whether the first-round lookup
+ * hits the first line of the byte's table; the correlations of all 16 x 256
+ * hypotheses are computed in a single pass over the trace and each guess is
+ * scored on the set of that line. Like in the online attack, only the upper
+ * nibble of each key byte is determined by the first round.
+ * The capture is checkpointed periodically and on Ctrl+C. Running the demo
+ * again with the same trace continues an interrupted capture.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure side-channel attack
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// Cache line offset of the T-tables from a page
+#define VICTIM_LINE_OFFSET 0
+
+#define TARGET_CACHE L1
+
+// Stop the capture early once the best set carries this many bits about the
+// upper nibble of the first plaintext byte (0 to disable). The estimate is a
+// lower bound, hence a multiple of the 4 bits of the nibble.
+#define STOP_BITS (8 * 4)
+#define QUALITY_CHECK_INTERVAL 1024
+
+// Samples between checkpoints, a multiple of TRACE_BLOCK_SAMPLES
+#define CHECKPOINT_INTERVAL (1 << 16)
+
+// local functions and global variables
+static volatile int user_abort = 0;
+
+void abortHandler(int unused);
+void usage(const char *prog);
+void first_line_model(const uint8_t *inputs, uint32_t cnt, uint32_t input_len,
+    uint32_t hyp, float *out, void *arg);
+
+int main(int argc, char **argv) {
+    int sample_cnt = -1;
+    uint32_t i, b, h, best, target_set, correct, threads = 0;
+    struct timespec start, stop;
+
+    if (argc == 3 || argc == 4)
+        sample_cnt = atoi(argv[1]);
+    if (sample_cnt <= 0)
+        usage(argv[0]);
+    if (argc == 4)
+        threads = atoi(argv[3]);
+
+
+    /*
+     * Initial preparation
+     */
+    PRINT_LINE("Initial attacker preparation\n");
+    PRINT_LINE("Number of samples: %d\n", sample_cnt);
+
+    set_seed();
+
+    cache_ctx *ctx      = get_cache_ctx(TARGET_CACHE);
+    cacheline *cache_ds = prepare_cache_ds(ctx);
+
+    time_type *res = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(res);
+
+    // Victim with a random key
+    leaky_victim *v = prepare_leaky_victim(LEAKY_AES_TTABLE, 0, VICTIM_LINE_OFFSET);
+    assert(v);
+
+    uint8_t key[AES_KEY_LEN], pt[AES_KEY_LEN], ct[AES_KEY_LEN];
+    gen_rand_bytes(key, AES_KEY_LEN);
+    set_leaky_victim_secret(v, key);
+
+    // The table locations are assumed to be known (see cachesc-tablemap)
+    void *tables[AES_TTABLES];
+    for (i = 0; i < AES_TTABLES; ++i)
+        tables[i] = get_leaky_aes_table(v, i);
+
+    aes_ttable_map map;
+    get_aes_ttable_map(ctx, tables, &map);
+
+    // With a fixed key, the plaintext nibble partitions the samples like the
+    // accessed table line
+    signal_quality *quality = prepare_signal_quality(16, ctx->sets);
+
+    // The state of the capture: next sample, key and accumulators (the
+    // plaintexts are drawn from rand(), which is always checkpointed)
+    i = 0;
+    char ckpt_path[BUFSIZ];
+    snprintf(ckpt_path, sizeof(ckpt_path), "%s.ckpt", argv[2]);
+    checkpoint *cp = prepare_checkpoint(ckpt_path);
+    add_checkpoint_region(cp, &i, sizeof(i));
+    add_checkpoint_region(cp, key, AES_KEY_LEN);
+    add_signal_quality_checkpoint(cp, quality);
+
+    trace_file *tf;
+    if (!load_checkpoint(cp)) {
+        set_leaky_victim_secret(v, key);
+        tf = resume_trace(argv[2], cp->trace_samples);
+        PRINT_LINE("Resuming capture at sample %u\n", i);
+    }
+    else {
+        #ifdef COMPRESS_TRACE
+        tf = create_compressed_trace(argv[2], ctx->sets, AES_KEY_LEN);
+        #else
+        tf = create_trace(argv[2], ctx->sets, AES_KEY_LEN);
+        #endif
+    }
+    if (!tf) {
+        fprintf(stderr, "Failed to create trace %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    // Register handler to catch CTRL+C and checkpoint the capture
+    signal(SIGINT, abortHandler);
+
+    pin_to_cpu(CPU_NUMBER);
+
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+
+
+    /*
+     * Capture the trace
+     */
+    print_banner("Start cache attack(s)");
+
+    prepare_measurement();
+
+    for (; i < sample_cnt; ++i) {
+        if (i % TRACE_BLOCK_SAMPLES == 0
+            && (user_abort || (i && i % CHECKPOINT_INTERVAL == 0)))
+        {
+            if (save_checkpoint(cp, tf))
+                fprintf(stderr, "Failed to write checkpoint %s\n", ckpt_path);
+            if (user_abort) {
+                PRINT_LINE("Interrupted after %u samples, checkpoint saved\n", i);
+                return EXIT_FAILURE;
+            }
+        }
+
+        gen_rand_bytes(pt, AES_KEY_LEN);
+
+        curr_head = prime(curr_head);
+        run_leaky_victim(v, pt, ct);
+        next_head = probe(TARGET_CACHE, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        write_trace_samples(tf, pt, res, 1);
+        update_signal_quality(quality, pt[0] >> 4, res);
+
+        if (STOP_BITS && (i + 1) % QUALITY_CHECK_INTERVAL == 0
+            && is_signal_quality_sufficient(quality, STOP_BITS))
+        {
+            PRINT_LINE("Stopped after %u samples, enough information\n", i + 1);
+            break;
+        }
+    }
+
+    print_banner("Stop cache attack(s)");
+
+    if (close_trace(tf)) {
+        fprintf(stderr, "Failed to write trace %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    remove_checkpoint(cp);
+    release_checkpoint(cp);
+
+    char quality_path[BUFSIZ];
+    snprintf(quality_path, sizeof(quality_path), "%s.quality", argv[2]);
+    compute_signal_quality(quality);
+    if (save_signal_quality(quality_path, quality))
+        fprintf(stderr, "Failed to write %s\n", quality_path);
+
+    PRINT_LINE("Signal quality of the first plaintext nibble:\n");
+    print_signal_quality(quality);
+
+
+    /*
+     * Analyse the trace: hypothesis b * 256 + k is key guess k for byte b
+     */
+    cpa_engine *cpa = prepare_cpa(AES_KEY_LEN * 256, ctx->sets, AES_KEY_LEN,
+                                  first_line_model, NULL, threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (update_cpa_from_trace(cpa, argv[2])) {
+        fprintf(stderr, "Failed to read trace %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    double *corr = (double *) malloc(cpa->hyps * ctx->sets * sizeof(double));
+    assert(corr);
+    get_cpa_correlations(cpa, corr);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+
+    /*
+     * Print output
+     */
+    correct = 0;
+    PRINT_LINE("Key upper nibbles:       ");
+    for (b = 0; b < AES_KEY_LEN; ++b)
+        printf("%x ", key[b] >> 4);
+    putchar('\n');
+
+    PRINT_LINE("Recovered upper nibbles: ");
+    for (b = 0; b < AES_KEY_LEN; ++b) {
+        target_set  = map.sets[b % AES_TTABLES][0];
+        best        = b * 256;
+        for (h = b * 256; h < (b + 1) * 256; ++h) {
+            if (fabs(corr[h * ctx->sets + target_set])
+                > fabs(corr[best * ctx->sets + target_set]))
+            {
+                best = h;
+            }
+        }
+        printf("%x ", (best % 256) >> 4);
+        correct += (best % 256) >> 4 == key[b] >> 4;
+    }
+    putchar('\n');
+
+    PRINT_LINE("Correct upper nibbles: %u/%u\n", correct, AES_KEY_LEN);
+    PRINT_LINE("Analysed %lu samples with %u threads in %.3f s\n", cpa->samples,
+               cpa->thread_cnt, get_elapsed_sec(&start, &stop));
+
+
+    /*
+     * Cleanup
+     */
+    free(corr);
+    release_cpa(cpa);
+    release_signal_quality(quality);
+    release_leaky_victim(v);
+    free(res);
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * 1 if the first-round lookup of byte hyp / 256 with key guess hyp % 256 is in
+ * the first line of its table
+ */
+void first_line_model(const uint8_t *inputs, uint32_t cnt, uint32_t input_len,
+    uint32_t hyp, float *out, void *arg)
+{
+    uint32_t n;
+    uint32_t byte   = hyp / 256;
+    uint8_t guess   = hyp % 256;
+
+    for (n = 0; n < cnt; ++n)
+        out[n] = ((inputs[n * input_len + byte] ^ guess) >> 4) == 0;
+}
+
+void abortHandler(int unused) {
+    user_abort = 1;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <samples> <trace file> [threads]\n", prog);
+    exit(EXIT_FAILURE);
+}
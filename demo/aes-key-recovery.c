@@ -0,0 +1,203 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file demonstrates the online key nibble recovery for T-table AES-128:
+ * it runs Prime+Probe around encryptions of random plaintexts (every byte
+ * varies) and feeds each sample to the attack engine, which recovers the
+ * upper nibble of all 16 key bytes at once and stops as soon as every byte
+ * reached the confidence target. Afterwards, the second-round stage chooses
+ * plaintexts adaptively to recover the lower nibbles, i.e. the full key.
+ * The victim is the synthetic T-table AES of leaky_victim.h, so the tables'
+ * cache sets and the key are known to validate the result. Optionally, the
+ * table sets are loaded from a map found by cachesc-tablemap instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure side-channel attack
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// Cache line offset of the T-tables from a page
+#define VICTIM_LINE_OFFSET 0
+
+#define TARGET_CACHE L1
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    int max_samples = -1;
+    uint32_t i, b, correct;
+    struct timespec start, stop, round2_stop;
+
+    if (argc == 2 || argc == 3)
+        max_samples = atoi(argv[1]);
+    if (max_samples <= 0)
+        usage(argv[0]);
+
+
+    /*
+     * Initial preparation
+     */
+    PRINT_LINE("Initial attacker preparation\n");
+    PRINT_LINE("Maximal number of samples per round: %d\n", max_samples);
+
+    set_seed();
+
+    cache_ctx *ctx      = get_cache_ctx(TARGET_CACHE);
+    cacheline *cache_ds = prepare_cache_ds(ctx);
+
+    time_type *res = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(res);
+
+    // Victim with a random key
+    leaky_victim *v = prepare_leaky_victim(LEAKY_AES_TTABLE, 0, VICTIM_LINE_OFFSET);
+    assert(v);
+
+    uint8_t key[AES_KEY_LEN], pt[AES_KEY_LEN], ct[AES_KEY_LEN];
+    gen_rand_bytes(key, AES_KEY_LEN);
+    set_leaky_victim_secret(v, key);
+
+    // The table locations are either discovered beforehand or assumed to be
+    // known
+    aes_ttable_map map;
+    if (argc == 3) {
+        if (load_aes_ttable_map(argv[2], ctx, &map)) {
+            fprintf(stderr, "Failed to load table map %s\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        void *tables[AES_TTABLES];
+        for (i = 0; i < AES_TTABLES; ++i)
+            tables[i] = get_leaky_aes_table(v, i);
+
+        get_aes_ttable_map(ctx, tables, &map);
+    }
+    aes_attack *attack = prepare_aes_attack(&map);
+
+    pin_to_cpu(CPU_NUMBER);
+
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+
+
+    /*
+     * First round: attack until all upper key nibbles are recovered or for
+     * "max_samples" rounds
+     */
+    print_banner("Start AES key recovery");
+
+    prepare_measurement();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < max_samples && !is_aes_attack_done(attack); ++i) {
+        gen_rand_bytes(pt, AES_KEY_LEN);
+
+        curr_head = prime(curr_head);
+        run_leaky_victim(v, pt, ct);
+        next_head = probe(TARGET_CACHE, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        update_aes_attack(attack, pt, res);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+
+    /*
+     * Second round: attack the lower nibbles with adaptive plaintexts
+     */
+    rank_aes_key_nibbles(attack);
+    aes_round2_attack *round2 = prepare_aes_round2_attack(attack);
+
+    for (i = 0; i < max_samples && !is_aes_round2_attack_done(round2); ++i) {
+        get_aes_round2_plaintext(round2, pt);
+
+        curr_head = prime(curr_head);
+        run_leaky_victim(v, pt, ct);
+        next_head = probe(TARGET_CACHE, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        update_aes_round2_attack(round2, pt, res);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &round2_stop);
+
+    print_banner("Stop AES key recovery");
+
+
+    /*
+     * Print output
+     */
+    print_aes_attack(attack);
+    print_aes_round2_attack(round2);
+
+    uint8_t recovered_key[AES_KEY_LEN];
+    get_aes_round2_key(round2, recovered_key);
+
+    correct = 0;
+    PRINT_LINE("Key: ");
+    for (b = 0; b < AES_KEY_LEN; ++b) {
+        printf("%02x", key[b]);
+        correct += (key[b] >> 4) == attack->key_hi[b];
+    }
+    putchar('\n');
+
+    PRINT_LINE("Correct upper nibbles: %u/%u\n", correct, AES_KEY_LEN);
+    PRINT_LINE("First round encryptions: %lu, time: %.3f s\n", attack->samples,
+               get_elapsed_sec(&start, &stop));
+    PRINT_LINE("Full key %s, second round encryptions: %lu, time: %.3f s\n",
+               memcmp(key, recovered_key, AES_KEY_LEN) ? "wrong" : "correct",
+               round2->samples, get_elapsed_sec(&stop, &round2_stop));
+
+
+    /*
+     * Cleanup
+     */
+    release_aes_round2_attack(round2);
+    release_aes_attack(attack);
+    release_leaky_victim(v);
+    free(res);
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <max samples per round> [table map]\n", prog);
+    exit(EXIT_FAILURE);
+}
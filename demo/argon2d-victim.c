@@ -25,12 +25,15 @@
  * point for an asynchronous attack to observe cache access patterns of
  * passwords hashed with Argon2d.
  * This file implements a victim performing some password hashes with Argon2d.
+ * It prints the timestamps of the start and end of every hash as markers for
+ * the analysis with cachesc-argon2.
  */
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <x86intrin.h>
 
 #include <argon2.h>
 #include <cachesc.h>
@@ -69,7 +72,7 @@ int main(int argc, char **argv)
     memset( salt, 0x00, SALT_LEN );
 
     uint8_t pwd[PWD_LEN];
-    uint8_t hash[PWD_LEN];
+    uint8_t hash[HASH_LEN];
     gen_rand_bytes(pwd, PWD_LEN);
 
     // 1-pass computation, 64 mebibytes memory usage
@@ -85,8 +88,10 @@ int main(int argc, char **argv)
     prepare_measurement();
 
     for (i = 0; i < sample_cnt; ++i) {
+        printf("hash start: %llu\n", __rdtsc());
         argon2d_hash_raw(t_cost, m_cost, parallelism, pwd, PWD_LEN,
                          salt, SALT_LEN, hash, HASH_LEN);
+        printf("hash done: %llu\n", __rdtsc());
     }
 
     print_banner("Stop Argon2d hashing");
@@ -0,0 +1,216 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file demonstrates the synthetic leaky victims of CacheSC: it runs
+ * Prime+Probe around a victim with a random secret and a fixed input and
+ * prints the ground truth of the secret-dependent cache sets next to the
+ * measurements.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure side-channel attack
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// One of LEAKY_AES_TTABLE, LEAKY_MODEXP, LEAKY_LOOKUP, LEAKY_MEMHARD
+#define VICTIM_TYPE LEAKY_LOOKUP
+// Type specific parameter (0 for the default), see leaky_victim.h
+#define VICTIM_PARAM 0
+// Cache line offset of the victim's secret-dependent memory from a page
+#define VICTIM_LINE_OFFSET 0
+
+#define TARGET_CACHE L1
+#define MSRMTS_PER_SAMPLE L1_SETS
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    int sample_cnt = -1;
+    uint32_t i;
+
+    if (argc == 2)
+        sample_cnt = atoi(argv[1]);
+    if (sample_cnt < 0)
+        usage(argv[0]);
+
+
+    /*
+     * Initial preparation
+     */
+    PRINT_LINE("Initial attacker preparation\n");
+    PRINT_LINE("Number of samples: %d\n", sample_cnt);
+    PRINT_LINE("Measurements per sample: %d\n", MSRMTS_PER_SAMPLE);
+
+    set_seed();
+
+    cache_ctx *ctx      = get_cache_ctx(TARGET_CACHE);
+    cacheline *cache_ds = prepare_cache_ds(ctx);
+
+    size_t res_size = sample_cnt * MSRMTS_PER_SAMPLE * sizeof(time_type);
+    time_type *res  = (time_type *) malloc(res_size);
+    assert(res);
+    memset(res, 0, res_size);
+
+    // Prepare the victim with a random secret and a fixed random input
+    leaky_victim *v = prepare_leaky_victim(VICTIM_TYPE, VICTIM_PARAM,
+                                           VICTIM_LINE_OFFSET);
+    assert(v);
+
+    uint8_t *secret = (uint8_t *) malloc(v->secret_len);
+    uint8_t *input  = (uint8_t *) malloc(v->input_len);
+    uint8_t *output = (uint8_t *) malloc(v->output_len);
+    assert(secret && input && output);
+
+    gen_rand_bytes(secret, v->secret_len);
+    gen_rand_bytes(input, v->input_len);
+    set_leaky_victim_secret(v, secret);
+
+    // Ground truth
+    uint32_t *set_hits = (uint32_t *) calloc(ctx->sets, sizeof(uint32_t));
+    assert(set_hits);
+    get_leaky_victim_sets(ctx, v, input, set_hits);
+
+    PRINT_LINE("Legend: %s victim, secret-dependent sets:",
+               get_leaky_victim_name(VICTIM_TYPE));
+    for (i = 0; i < ctx->sets; ++i) {
+        if (set_hits[i])
+            printf(" %u", i);
+    }
+    PRINT_FLUSH("\n");
+
+    pin_to_cpu(CPU_NUMBER);
+
+    // Profile the attacker's own footprint with a null victim, then skip the
+    // sets it perturbs and subtract the bias of the other sets (optional)
+    #ifdef EXCLUDE_SELF_NOISE
+    noise_profile *noise_prof = get_noise_profile(ctx);
+    profile_self_footprint(ctx, NULL, cache_ds, FOOTPRINT_SAMPLES, noise_prof);
+
+    uint32_t *included_sets = (uint32_t *) malloc(ctx->sets * sizeof(uint32_t));
+    assert(included_sets);
+    uint32_t included_sets_len = get_included_sets(noise_prof, included_sets);
+    assert(included_sets_len > 0);
+
+    PRINT_LINE("Excluded %u sets perturbed by the attacker\n",
+               noise_prof->excluded_cnt);
+
+    release_cache_ds(ctx, cache_ds);
+    cache_ds = prepare_cache_set_ds(ctx, included_sets, included_sets_len);
+    #endif
+
+    uint32_t *curr_res      = res;
+    cacheline *curr_head    = cache_ds;
+    cacheline *next_head;
+
+
+    /*
+     * Make baseline measurements for normalisation (optional)
+     */
+    #ifdef NORMALIZE
+    prepare_measurement();
+
+    for (i = 0; i < sample_cnt; ++i) {
+        curr_head = prime(curr_head);
+        next_head = probe(TARGET_CACHE, curr_head);
+
+        get_msrmts_for_all_set(curr_head, curr_res);
+        #ifdef EXCLUDE_SELF_NOISE
+        apply_noise_profile(noise_prof, curr_res);
+        #endif
+        curr_head = next_head;
+        curr_res += MSRMTS_PER_SAMPLE;
+    }
+
+    PRINT_LINE("Output cache set access baseline data\n");
+    print_results(res, sample_cnt, MSRMTS_PER_SAMPLE);
+
+    // reset changes
+    memset(res, 0, res_size);
+    curr_res    = res;
+    curr_head   = cache_ds;
+    #endif
+
+
+    /*
+     * Start attacking for "sample_cnt" rounds
+     */
+    print_banner("Start cache attack(s)");
+
+    prepare_measurement();
+
+    for (i = 0; i < sample_cnt; ++i) {
+        curr_head = prime(curr_head);
+        run_leaky_victim(v, input, output);
+        next_head = probe(TARGET_CACHE, curr_head);
+
+        get_msrmts_for_all_set(curr_head, curr_res);
+        #ifdef EXCLUDE_SELF_NOISE
+        apply_noise_profile(noise_prof, curr_res);
+        #endif
+        curr_head = next_head;
+        curr_res += MSRMTS_PER_SAMPLE;
+    }
+
+    print_banner("Stop cache attack(s)");
+
+
+    /*
+     * Print output
+     */
+    PRINT_LINE("Output cache attack data\n");
+    print_results(res, sample_cnt, MSRMTS_PER_SAMPLE);
+
+
+    /*
+     * Cleanup
+     */
+    free(set_hits);
+    free(secret);
+    free(input);
+    free(output);
+    free(res);
+    release_leaky_victim(v);
+    #ifdef EXCLUDE_SELF_NOISE
+    free(included_sets);
+    release_noise_profile(noise_prof);
+    release_cache_set_ds(ctx, cache_ds);
+    #else
+    release_cache_ds(ctx, cache_ds);
+    #endif
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <samples>\n", prog);
+    exit(EXIT_FAILURE);
+}
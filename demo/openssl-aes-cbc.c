@@ -97,29 +97,30 @@ int main(int argc, char **argv) {
     // Initialize AES-CBC
     EVP_CIPHER_CTX aes_ctx;
     EVP_CIPHER_CTX_init(&aes_ctx);
-    int ctx_cache_set = get_cache_set(cache_ctx, &aes_ctx);
     int ct_len;
 
-    // Initialize arrays for plaintexts, ciphertexts, and keys and place them
-    // in memory to avoid collisions as much as possible.
-
-    // Place ctx, ct, pt, and key in different cache sets (if possible).
-    // `sets * CACHELINE_SIZE` is the size that covers all cache sets
-    // which is added to be able to choose any cache set offset we want.
-    uint16_t pt_spanned_cls = get_spanned_cache_lines(cache_ctx, PT_LEN);
-    uint64_t data_len       = (2 * pt_spanned_cls
-                               + get_spanned_cache_lines(cache_ctx, KEY_LEN)
-                               + cache_ctx->sets) * CACHELINE_SIZE;
-
-    unsigned char *data = (unsigned char *) aligned_alloc(PAGE_SIZE, data_len);
-    assert(data);
-
-    // Place ct in the cache set after ctx
-    unsigned char *ct   = data + CACHELINE_SIZE * ((ctx_cache_set
-                          + get_spanned_cache_lines(cache_ctx, sizeof(EVP_CIPHER_CTX)))
-                          % cache_ctx->sets);
-    unsigned char *pt   = ct + pt_spanned_cls * CACHELINE_SIZE;
-    unsigned char *key  = pt + pt_spanned_cls * CACHELINE_SIZE;
+    // Place ct, pt, and key in cache sets that are not used by the ctx or by
+    // each other (if possible), using the cache set coloring allocator.
+    uint32_t *used_sets     = (uint32_t *) malloc(cache_ctx->sets * sizeof(uint32_t));
+    assert(used_sets);
+    uint32_t used_sets_len  = get_spanned_cache_sets(cache_ctx, &aes_ctx,
+                                                     sizeof(EVP_CIPHER_CTX), used_sets);
+
+    unsigned char *ct = (unsigned char *) cachesc_alloc_avoiding_sets(cache_ctx,
+                        PT_LEN, used_sets, used_sets_len);
+    assert(ct);
+    used_sets_len += get_spanned_cache_sets(cache_ctx, ct, PT_LEN,
+                                            used_sets + used_sets_len);
+
+    unsigned char *pt = (unsigned char *) cachesc_alloc_avoiding_sets(cache_ctx,
+                        PT_LEN, used_sets, used_sets_len);
+    assert(pt);
+    used_sets_len += get_spanned_cache_sets(cache_ctx, pt, PT_LEN,
+                                            used_sets + used_sets_len);
+
+    unsigned char *key = (unsigned char *) cachesc_alloc_avoiding_sets(cache_ctx,
+                         KEY_LEN, used_sets, used_sets_len);
+    assert(key);
 
     unsigned char *pt_arr = (unsigned char *) malloc(PT_LEN * sample_cnt);
     assert(pt_arr);
@@ -233,7 +234,10 @@ int main(int argc, char **argv) {
     /*
      * Cleanup
      */
-    free(data);
+    cachesc_free(cache_ctx, ct);
+    cachesc_free(cache_ctx, pt);
+    cachesc_free(cache_ctx, key);
+    free(used_sets);
     free(pt_arr);
     free(key_arr);
     free(res);
@@ -0,0 +1,87 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Example target for cachesc-scan, built as a shared library. It exports a
+ * leaky table lookup indexed by the input xored with a secret and a constant
+ * time variant that reads every line of the table, following the adapter ABI
+ * of scan.h.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <scan.h>
+
+#define TABLE_ENTRIES 256
+#define ENTRY_SIZE 16
+#define SECRET_LEN 16
+#define CACHELINE_SIZE 64
+
+static uint8_t table[TABLE_ENTRIES * ENTRY_SIZE] __attribute__ ((aligned (CACHELINE_SIZE)));
+static uint8_t secret[SECRET_LEN];
+static volatile uint8_t sink;
+
+int leaky_lookup_init(uint32_t input_len) {
+    uint32_t i;
+
+    for (i = 0; i < SECRET_LEN; ++i)
+        secret[i] = rand();
+    for (i = 0; i < sizeof(table); ++i)
+        table[i] = i;
+
+    return 0;
+}
+
+/*
+ * One lookup per input byte, the accessed line depends on the input
+ */
+void leaky_lookup(const uint8_t *input, uint32_t input_len) {
+    uint32_t i;
+    uint8_t acc = 0;
+
+    for (i = 0; i < input_len; ++i)
+        acc ^= table[(input[i] ^ secret[i % SECRET_LEN]) * ENTRY_SIZE];
+
+    sink = acc;
+}
+
+int const_lookup_init(uint32_t input_len) {
+    return leaky_lookup_init(input_len);
+}
+
+/*
+ * Same result, but every line of the table is read for every input byte
+ */
+void const_lookup(const uint8_t *input, uint32_t input_len) {
+    uint32_t i, j, idx;
+    uint8_t acc = 0, v;
+
+    for (i = 0; i < input_len; ++i) {
+        idx = input[i] ^ secret[i % SECRET_LEN];
+        for (j = 0; j < TABLE_ENTRIES; ++j) {
+            v = table[j * ENTRY_SIZE];
+            acc ^= v & -(uint8_t) (j == idx);
+        }
+    }
+
+    sink = acc;
+}
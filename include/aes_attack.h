@@ -0,0 +1,147 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Online key recovery for T-table AES-128 with Prime+Probe. In the first
+ * round, plaintext byte b indexes table Te(b % 4) with pt[b] ^ key[b], so the
+ * accessed table line reveals the upper nibble of each key byte (a line holds
+ * 16 entries). The engine accumulates the probe times of the table sets per
+ * (byte, plaintext nibble) while sampling, ranks the key nibble candidates of
+ * all 16 bytes at once and reports when each byte reached a confidence target.
+ *
+ * The second-round stage recovers the lower nibbles. The upper nibble of the
+ * second-round state byte x2[t] (t = 2, 5, 8, 15, one per column) only depends
+ * on one diagonal of plaintext and key bytes and a key dependent constant:
+ *   x2[t] = c_0 * s(pt[i_0] ^ k[i_0]) ^ ... ^ c_3 * s(pt[i_3] ^ k[i_3]) ^ C
+ * If only pt[i] varies, the accessed block of Te(t % 4) is determined by the
+ * lower nibble of k[i] and the upper nibble of the (unknown) remaining
+ * constant, i.e. by one of 256 hypotheses. The four diagonals are attacked in
+ * parallel, one byte at a time, and plaintexts are chosen adaptively such that
+ * the leading hypotheses predict different blocks.
+ */
+
+#ifndef HEADER_AES_ATTACK_H
+#define HEADER_AES_ATTACK_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_types.h"
+
+#define AES_KEY_LEN 16
+// Tables Te0, ..., Te3 that are used in rounds 1 to 9
+#define AES_TTABLES 4
+// Blocks of 16 table entries, i.e. one block per upper index nibble
+#define AES_TTABLE_BLOCKS 16
+#define AES_NIBBLES 16
+
+// Required distance of the best to the second best candidate, in standard
+// deviations of their score difference
+#define AES_ATTACK_CONFIDENCE 5.0
+// Samples before the first ranking, such that the variances are meaningful
+#define AES_ATTACK_MIN_SAMPLES 1024
+// Samples between two rankings
+#define AES_ATTACK_CHECK_INTERVAL 256
+
+// Second-round hypotheses per key byte: lower key nibble and upper nibble of
+// the constant
+#define AES_ROUND2_HYPOTHESES 256
+// Second-round state bytes that are targeted, one per diagonal
+#define AES_ROUND2_TARGETS 4
+// Random plaintexts per key byte before plaintexts are chosen adaptively
+#define AES_ROUND2_RANDOM_SAMPLES 256
+// Leading hypotheses that adaptive plaintexts should separate
+#define AES_ROUND2_LEADERS 16
+
+typedef struct aes_ttable_map aes_ttable_map;
+typedef struct aes_attack aes_attack;
+typedef struct aes_round2_attack aes_round2_attack;
+
+// Cache set of every block of 16 entries of the tables Te0, ..., Te3
+struct aes_ttable_map {
+    uint32_t sets[AES_TTABLES][AES_TTABLE_BLOCKS];
+};
+
+struct aes_attack {
+    aes_ttable_map map;
+    uint64_t samples;
+
+    // Probe time sums of the table blocks per (byte, plaintext nibble, block)
+    double sum[AES_KEY_LEN][AES_NIBBLES][AES_TTABLE_BLOCKS];
+    double sum_sq[AES_KEY_LEN][AES_NIBBLES][AES_TTABLE_BLOCKS];
+    uint64_t cnt[AES_KEY_LEN][AES_NIBBLES];
+
+    // Result of the last ranking: best upper key nibble per byte, its score
+    // for every candidate and the confidence of the best candidate
+    uint8_t key_hi[AES_KEY_LEN];
+    double score[AES_KEY_LEN][AES_NIBBLES];
+    double confidence[AES_KEY_LEN];
+};
+
+struct aes_round2_attack {
+    aes_ttable_map map;
+    uint8_t key_hi[AES_KEY_LEN];
+    uint64_t samples;
+
+    // Plaintext bytes that are not varied
+    uint8_t base_pt[AES_KEY_LEN];
+
+    // Per diagonal: index of the attacked byte in the diagonal (all done if
+    // AES_TTABLES), probe time sums of the target table's blocks per value
+    // of the attacked plaintext byte and the leading hypotheses
+    uint32_t step[AES_ROUND2_TARGETS];
+    uint64_t cnt[AES_ROUND2_TARGETS];
+    uint32_t x_cnt[AES_ROUND2_TARGETS][256];
+    double sum[AES_ROUND2_TARGETS][256][AES_TTABLE_BLOCKS];
+    double sum_sq[AES_ROUND2_TARGETS][256][AES_TTABLE_BLOCKS];
+    uint8_t leaders[AES_ROUND2_TARGETS][AES_ROUND2_LEADERS];
+
+    uint8_t key_lo[AES_KEY_LEN];
+    double confidence[AES_KEY_LEN];
+};
+
+void get_aes_ttable_map(cache_ctx *ctx, void **tables, aes_ttable_map *map);
+int save_aes_ttable_map(const char *path, cache_ctx *ctx, aes_ttable_map *map);
+int load_aes_ttable_map(const char *path, cache_ctx *ctx, aes_ttable_map *map);
+aes_attack *prepare_aes_attack(aes_ttable_map *map);
+void release_aes_attack(aes_attack *a);
+void update_aes_attack(aes_attack *a, const uint8_t *pt, time_type *res);
+uint32_t rank_aes_key_nibbles(aes_attack *a);
+bool is_aes_attack_done(aes_attack *a);
+void get_aes_key_nibble_ranking(aes_attack *a, uint32_t byte, uint8_t *ranking);
+void print_aes_attack(aes_attack *a);
+
+aes_round2_attack *prepare_aes_round2_attack(aes_attack *first_round);
+void release_aes_round2_attack(aes_round2_attack *a);
+void get_aes_round2_plaintext(aes_round2_attack *a, uint8_t *pt);
+void update_aes_round2_attack(aes_round2_attack *a, const uint8_t *pt,
+    time_type *res);
+bool is_aes_round2_attack_done(aes_round2_attack *a);
+void get_aes_round2_key(aes_round2_attack *a, uint8_t *key);
+void print_aes_round2_attack(aes_round2_attack *a);
+
+#endif // HEADER_AES_ATTACK_H
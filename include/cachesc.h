@@ -0,0 +1,58 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Header file to include to use all functions of the CacheSC library
+ */
+
+#ifndef HEADER_CACHESC_H
+#define HEADER_CACHESC_H
+
+#include "aes_attack.h"
+#include "argon2_analysis.h"
+#include "autotune.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "color_alloc.h"
+#include "covert.h"
+#include "cpa.h"
+#include "fft.h"
+#include "footprint.h"
+#include "io.h"
+#include "leaky_victim.h"
+#include "prefetch.h"
+#include "probe_kernel.h"
+#include "quality.h"
+#include "query_sched.h"
+#include "scan.h"
+#include "segment.h"
+#include "set_index.h"
+#include "table_discovery.h"
+#include "template.h"
+#include "trace.h"
+#include "trace_merge.h"
+#include "trace_query.h"
+#include "tvla.h"
+#include "util.h"
+#include "victim.h"
+
+#endif // HEADER_CACHESC_H
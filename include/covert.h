@@ -0,0 +1,77 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Framing and error correction for a cache covert channel. Every monitored
+ * cache set is an independent channel that transmits one bit per symbol.
+ * Sender and receiver agree on symbol slots through the time stamp counter,
+ * so frames are aligned without any handshake.
+ */
+
+#ifndef HEADER_COVERT_H
+#define HEADER_COVERT_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#include "cache.h"
+
+/*
+ * Frame layout per set:
+ *   | preamble: 1 0 1 0 | COVERT_CODEWORDS Hamming(7,4) codewords |
+ * The preamble is used by the receiver to calibrate the per-set threshold.
+ */
+#define COVERT_PREAMBLE_LEN 4
+#define COVERT_CODEWORDS 4
+#define COVERT_DATA_BITS (4 * COVERT_CODEWORDS)
+#define COVERT_CODE_BITS (7 * COVERT_CODEWORDS)
+#define COVERT_FRAME_LEN (COVERT_PREAMBLE_LEN + COVERT_CODE_BITS)
+
+// Seed of the payload that both sides generate (the receiver to compute the
+// bit error rate)
+#define COVERT_DEFAULT_SEED 0xcacec
+
+void get_covert_sets(cache_ctx *ctx, uint32_t *sets, uint32_t sets_len);
+void gen_covert_payload(uint32_t seed, uint64_t frame, uint32_t set_idx,
+    uint8_t *data_bits);
+void encode_covert_frame(uint8_t *data_bits, uint8_t *symbols);
+uint32_t decode_covert_frame(uint8_t *symbols, uint8_t *data_bits);
+uint8_t hamming74_encode(uint8_t nibble);
+uint8_t hamming74_decode(uint8_t codeword, bool *corrected);
+
+__attribute__((always_inline))
+static inline uint64_t get_covert_slot(uint64_t symbol_cycles);
+
+/*
+ * Index of the current symbol slot, shared by all processes on the machine
+ * (assumes an invariant TSC).
+ */
+static inline uint64_t get_covert_slot(uint64_t symbol_cycles) {
+    return __rdtsc() / symbol_cycles;
+}
+
+#endif // HEADER_COVERT_H
@@ -0,0 +1,93 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Self-contained radix-2 FFT for trace alignment and periodicity detection.
+ * Traces of the same length are aligned to a reference by the peak of their
+ * cross-correlation, computed in the frequency domain with zero padding to
+ * at least twice the trace length. Two real traces share one complex FFT.
+ * Dominant periods are the strongest peaks of (accumulated) power spectra
+ * of Hann windowed signals, refined by parabolic interpolation. This module
+ * only depends on the C library, it is also built as the shared library
+ * libcachesc-fft.so for the Python wrapper in scripts/cachesc_fft.py.
+ */
+
+#ifndef HEADER_FFT_H
+#define HEADER_FFT_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Shortest period that is reported, in samples
+#define FFT_MIN_PERIOD 2.0
+
+typedef struct fft_plan fft_plan;
+typedef struct fft_aligner fft_aligner;
+
+struct fft_plan {
+    uint32_t len;
+    uint32_t log_len;
+    uint32_t *bitrev;
+    // exp(-2 pi i k / len) for k < len / 2
+    double complex *twiddle;
+    // Scratch buffer of len entries for spectra, a plan is not thread-safe
+    double complex *buf;
+};
+
+struct fft_aligner {
+    uint32_t len;
+    uint32_t max_shift;
+    fft_plan *plan;
+
+    // Conjugate spectrum and norm of the centred reference
+    double complex *ref_spec;
+    double ref_norm;
+    double complex *buf;
+};
+
+uint32_t get_fft_len(uint32_t min_len);
+fft_plan *prepare_fft(uint32_t len);
+void release_fft(fft_plan *plan);
+void run_fft(fft_plan *plan, double complex *data, bool inverse);
+
+fft_aligner *prepare_fft_aligner(const float *ref, uint32_t len,
+    uint32_t max_shift);
+void release_fft_aligner(fft_aligner *a);
+int32_t get_fft_shift(fft_aligner *a, const float *trace, float *corr);
+void align_fft_traces(fft_aligner *a, const float *traces, uint32_t cnt,
+    float *aligned, int32_t *shifts, float *corrs);
+void shift_fft_trace(const float *trace, uint32_t len, int32_t shift,
+    float *out);
+
+void get_fft_power_spectrum(fft_plan *plan, const float *signal, uint32_t len,
+    double *power);
+uint32_t find_fft_periods(const double *power, uint32_t fft_len,
+    uint32_t max_periods, double *periods, double *strengths);
+
+#endif // HEADER_FFT_H
@@ -0,0 +1,92 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Profiling of the attacker's own cache footprint. The sampling loop is run
+ * with a null victim, so every set that still shows accesses is perturbed by
+ * the attacker itself (stack, loop code, result writes, library globals).
+ * The resulting per-set noise profile is used to exclude these sets from the
+ * data structure or to subtract their bias from the measurements online.
+ */
+
+#ifndef HEADER_FOOTPRINT_H
+#define HEADER_FOOTPRINT_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "autotune.h"
+#include "cache.h"
+#include "cache_types.h"
+
+// Default number of null victim samples for profiling
+#define FOOTPRINT_SAMPLES 4096
+// Sets whose mean or standard deviation is more than this many (robust)
+// standard deviations above the median of all sets are excluded
+#define FOOTPRINT_THRESHOLD 3.0
+
+typedef struct noise_profile noise_profile;
+
+struct noise_profile {
+    cache_level cache_level;
+    uint32_t sets;
+
+    // Probe time statistics per set with a null victim
+    double *mean;
+    double *std;
+    // Bias of each set w.r.t. the median set, subtracted online
+    time_type *offset;
+
+    bool *exclude;
+    uint32_t excluded_cnt;
+};
+
+noise_profile *get_noise_profile(cache_ctx *ctx);
+void release_noise_profile(noise_profile *prof);
+void profile_self_footprint(cache_ctx *ctx, pp_conf *conf, cacheline *cache_ds,
+    uint32_t samples, noise_profile *prof);
+uint32_t get_included_sets(noise_profile *prof, uint32_t *sets);
+int save_noise_profile(const char *path, noise_profile *prof);
+int load_noise_profile(const char *path, cache_ctx *ctx, noise_profile *prof);
+void print_noise_profile(noise_profile *prof);
+
+__attribute__((always_inline))
+static inline void apply_noise_profile(noise_profile *prof, time_type *res);
+
+/*
+ * Subtract the self-footprint bias from the measurements of one sample and
+ * zero excluded sets.
+ */
+static inline void apply_noise_profile(noise_profile *prof, time_type *res) {
+    for (uint32_t i = 0; i < prof->sets; ++i) {
+        if (prof->exclude[i])
+            res[i] = 0;
+        else
+            res[i] = (res[i] > prof->offset[i]) ? res[i] - prof->offset[i] : 0;
+    }
+}
+
+#endif // HEADER_FOOTPRINT_H
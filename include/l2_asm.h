@@ -0,0 +1,139 @@
+/*
+ * This file is generated by gen_cache_asm_files.py.
+ * MODIFICATIONS WILL THUS BE OVERWRITTEN.
+ */
+
+#ifndef HEADER_L2_ASM_H
+#define HEADER_L2_ASM_H
+
+#include "asm.h"
+#include "cache.h"
+#include "device_conf.h"
+
+#ifndef PROBE_KERNEL_PARTIAL_UNROLL
+    #define PROBE_KERNEL_PARTIAL_UNROLL 4
+#endif
+
+
+// Traverse cache sets in reverse order for minimal cache impact
+static inline cacheline *asm_l2_probe_cacheset(cacheline *curr_cl) {
+    cacheline *next_cl;
+
+    start_timer();
+    asm volatile(
+        "mov 8(%[curr_cl]), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %[curr_cl_out] \n\t"
+        "mov 8(%[curr_cl_out]), %[next_cl_out] \n\t"
+        : [next_cl_out] "=rm" (next_cl), [curr_cl_out] "=rm" (curr_cl)
+        : [curr_cl] "r" (curr_cl)
+        : "%rax", "%rcx"
+    );
+    stop_timer(&(curr_cl->time_msrmt));
+
+    return next_cl;
+}
+
+// Traverse cache sets in reverse order for minimal cache impact
+static inline cacheline *asm_l2_probe_cacheset_lfence(cacheline *curr_cl) {
+    cacheline *next_cl;
+
+    start_timer_lfence();
+    asm volatile(
+        "mov 8(%[curr_cl]), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %[curr_cl_out] \n\t"
+        "mov 8(%[curr_cl_out]), %[next_cl_out] \n\t"
+        : [next_cl_out] "=rm" (next_cl), [curr_cl_out] "=rm" (curr_cl)
+        : [curr_cl] "r" (curr_cl)
+        : "%rax", "%rcx"
+    );
+    stop_timer_lfence(&(curr_cl->time_msrmt));
+
+    return next_cl;
+}
+
+// Traverse cache sets in reverse order for minimal cache impact
+static inline cacheline *asm_l2_probe_cacheset_rolled(cacheline *curr_cl) {
+    cacheline *next_cl;
+
+    start_timer();
+    asm volatile(
+        "mov %[curr_cl], %%rax \n\t"
+        "mov $7, %%ecx \n\t"
+        "1: \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "dec %%ecx \n\t"
+        "jnz 1b \n\t"
+        "mov %%rax, %[curr_cl_out] \n\t"
+        "mov 8(%%rax), %[next_cl_out] \n\t"
+        : [next_cl_out] "=r" (next_cl), [curr_cl_out] "=r" (curr_cl)
+        : [curr_cl] "r" (curr_cl)
+        : "%rax", "%rcx", "cc"
+    );
+    stop_timer(&(curr_cl->time_msrmt));
+
+    return next_cl;
+}
+
+// Traverse cache sets in reverse order for minimal cache impact
+static inline cacheline *asm_l2_probe_cacheset_partial(cacheline *curr_cl) {
+    cacheline *next_cl;
+
+    start_timer();
+    asm volatile(
+        "mov %[curr_cl], %%rax \n\t"
+        "mov $1, %%ecx \n\t"
+        "1: \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "dec %%ecx \n\t"
+        "jnz 1b \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "mov 8(%%rax), %%rax \n\t"
+        "mov %%rax, %[curr_cl_out] \n\t"
+        "mov 8(%%rax), %[next_cl_out] \n\t"
+        : [next_cl_out] "=r" (next_cl), [curr_cl_out] "=r" (curr_cl)
+        : [curr_cl] "r" (curr_cl)
+        : "%rax", "%rcx", "cc"
+    );
+    stop_timer(&(curr_cl->time_msrmt));
+
+    return next_cl;
+}
+
+// Traverse cache sets in reverse order for minimal cache impact
+static inline cacheline *asm_l2_probe_cacheset_unrolled(cacheline *curr_cl) {
+    cacheline *next_cl;
+
+    start_timer();
+    asm volatile(
+        "mov 8(%[curr_cl]), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %%rax \n\t"
+        "mov 8(%%rax), %%rcx \n\t"
+        "mov 8(%%rcx), %[curr_cl_out] \n\t"
+        "mov 8(%[curr_cl_out]), %[next_cl_out] \n\t"
+        : [next_cl_out] "=rm" (next_cl), [curr_cl_out] "=rm" (curr_cl)
+        : [curr_cl] "r" (curr_cl)
+        : "%rax", "%rcx"
+    );
+    stop_timer(&(curr_cl->time_msrmt));
+
+    return next_cl;
+}
+
+#endif // HEADER_L2_ASM_H
\ No newline at end of file
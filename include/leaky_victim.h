@@ -0,0 +1,111 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Synthetic victims with known, secret-dependent memory accesses. In contrast
+ * to the basic victims in victim.h, they mimic real leaky implementations
+ * (T-table AES, square-and-multiply, secret-indexed lookups and memory-hard
+ * hashing), but the ground truth of their leakage can be queried, such that
+ * attacks can be validated and benchmarked without external libraries.
+ */
+
+#ifndef HEADER_LEAKY_VICTIM_H
+#define HEADER_LEAKY_VICTIM_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+// AES-128 with the T-tables Te0, ..., Te4 of OpenSSL's C implementation
+#define LEAKY_AES_KEY_LEN 16
+#define LEAKY_AES_BLOCK_LEN 16
+#define LEAKY_AES_TABLE_SIZE (256 * sizeof(uint32_t))
+#define LEAKY_AES_TABLES 5
+
+// Modular exponentiation with a 64 bit exponent
+#define LEAKY_MODEXP_LEN 8
+
+// Secret-indexed lookups, one per secret byte
+#define LEAKY_LOOKUP_LEN 16
+#define LEAKY_LOOKUP_DEFAULT_FOOTPRINT 1024
+
+// Memory-hard hashing with data-dependent block references (like Argon2d)
+#define LEAKY_MEMHARD_LEN 16
+#define LEAKY_MEMHARD_BLOCK_SIZE 1024
+#define LEAKY_MEMHARD_DEFAULT_BLOCKS 64
+
+typedef enum leaky_victim_type leaky_victim_type;
+typedef struct leaky_victim leaky_victim;
+typedef struct leak_recorder leak_recorder;
+
+enum leaky_victim_type {LEAKY_AES_TTABLE, LEAKY_MODEXP, LEAKY_LOOKUP, LEAKY_MEMHARD};
+
+struct leaky_victim {
+    leaky_victim_type type;
+
+    uint32_t secret_len;
+    uint32_t input_len;
+    uint32_t output_len;
+    uint8_t *secret;
+
+    // Memory that is accessed depending on the secret (tables, blocks, ...),
+    // placed `line_offset` cache lines after a page boundary.
+    uint8_t *mem;
+    uint8_t *mem_base;
+    uint64_t mem_size;
+    uint32_t line_offset;
+
+    // Type specific parameter (lookup: footprint in bytes, memhard: blocks)
+    uint32_t param;
+    // AES round keys
+    uint32_t rk[44];
+};
+
+// Records the secret-dependent accesses of a victim run
+struct leak_recorder {
+    uintptr_t *addrs;
+    uint32_t len;
+    uint32_t max_len;
+};
+
+leaky_victim *prepare_leaky_victim(leaky_victim_type type, uint32_t param,
+    uint32_t line_offset);
+void release_leaky_victim(leaky_victim *v);
+void set_leaky_victim_secret(leaky_victim *v, const uint8_t *secret);
+void run_leaky_victim(leaky_victim *v, const uint8_t *input, uint8_t *output);
+uint32_t get_leaky_victim_max_trace_len(leaky_victim *v);
+uint32_t trace_leaky_victim(leaky_victim *v, const uint8_t *input,
+    uintptr_t *addrs, uint32_t max_addrs);
+void get_leaky_victim_sets(cache_ctx *ctx, leaky_victim *v, const uint8_t *input,
+    uint32_t *set_hits);
+void *get_leaky_aes_table(leaky_victim *v, uint32_t table);
+const char *get_leaky_victim_name(leaky_victim_type type);
+
+#endif // HEADER_LEAKY_VICTIM_H
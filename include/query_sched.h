@@ -0,0 +1,105 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Scheduler for multiplexed chosen-input queries. A query fixes some bytes of
+ * the victim's input and is answered by the probe times of the cache sets
+ * that its accesses may touch (its footprint). Queries with disjoint
+ * footprints and compatible input bytes can share one victim invocation, so
+ * a single Prime+Probe round answers several of them. The scheduler keeps a
+ * FIFO of pending queries, packs them first-fit into the next invocation and
+ * decodes the response of each packed query from the shared probe vector.
+ * Queries that always conflict (e.g. two key bytes that index the same
+ * table) are never packed together, so they are answered in FIFO order.
+ */
+
+#ifndef HEADER_QUERY_SCHED_H
+#define HEADER_QUERY_SCHED_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "cache_types.h"
+
+// Pending queries that are checked per invocation, bounds the packing time if
+// many queries conflict
+#define QUERY_SCHED_LOOKAHEAD 64
+
+typedef struct sched_query sched_query;
+typedef struct query_sched query_sched;
+
+struct sched_query {
+    uint32_t id;
+
+    // Input bytes fixed by the query (input_mask[i] != 0)
+    uint8_t *input;
+    uint8_t *input_mask;
+
+    // Footprint, the response are the probe times of these sets in this order
+    uint32_t *sets;
+    uint32_t sets_len;
+};
+
+struct query_sched {
+    uint32_t sets;
+    uint32_t input_len;
+    uint32_t max_query_sets;
+    uint32_t max_batch;
+
+    // Pool of queries (pending and current batch), the FIFO of pending ones
+    // and the free slots
+    uint32_t max_queries;
+    uint32_t slots;
+    sched_query *queries;
+    uint32_t *pending;
+    uint32_t pending_len;
+    uint32_t *free_slots;
+    uint32_t free_len;
+
+    // Queries packed into the current invocation, their sets and input bytes
+    uint32_t *batch;
+    uint32_t batch_len;
+    uint64_t *used_sets;
+    uint8_t *used_input;
+
+    uint64_t invocations;
+    uint64_t answered;
+};
+
+query_sched *prepare_query_sched(cache_ctx *ctx, uint32_t input_len,
+    uint32_t max_queries, uint32_t max_query_sets, uint32_t max_batch);
+void release_query_sched(query_sched *s);
+bool add_sched_query(query_sched *s, uint32_t id, const uint8_t *input,
+    const uint8_t *input_mask, const uint32_t *sets, uint32_t sets_len);
+uint32_t pack_sched_queries(query_sched *s, uint8_t *input);
+uint32_t decode_sched_query(query_sched *s, uint32_t k, const time_type *res,
+    uint32_t *id, time_type *msrmts);
+void print_query_sched(query_sched *s);
+
+#endif // HEADER_QUERY_SCHED_H
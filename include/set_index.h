@@ -0,0 +1,133 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Index from cache sets to the eviction sets of a built attack data structure.
+ * The lines of a set are consecutive in the ring (from the line flagged first
+ * to the one flagged last), so an eviction set is a view on the ring that can
+ * be primed and probed on its own without relinking it. The index records the
+ * first and last line and the ways of every set once, after which the
+ * eviction set of a set or of an address (e.g. of a victim buffer) is found
+ * in constant time, instead of walking the ring or building a new one with
+ * prepare_cache_set_ds. The ring must not be relinked while the index is used.
+ */
+
+#ifndef HEADER_SET_INDEX_H
+#define HEADER_SET_INDEX_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "color_alloc.h"
+
+typedef struct evset evset;
+typedef struct set_index set_index;
+
+// Eviction set of one cache set, lines in ring order
+struct evset {
+    uint32_t set;
+    cacheline *first;
+    cacheline *last;
+    // `associativity` lines, ways[0] == first
+    cacheline **ways;
+};
+
+struct set_index {
+    cache_ctx *ctx;
+    // Indexed by set, NULL for sets that are not in the ring
+    evset **evsets;
+    evset *evset_arr;
+    cacheline **way_arr;
+    uint32_t sets_len;
+
+    // Addresses can only be mapped to sets if the sets of the ring are the
+    // real ones, i.e. not for physical addressing without privileges
+    bool addr_lookup;
+    uint32_t *spanned_sets;
+};
+
+set_index *prepare_set_index(cache_ctx *ctx, cacheline *cache_ds);
+void release_set_index(set_index *idx);
+evset *get_evset_for_addr(set_index *idx, void *ptr);
+uint32_t get_evsets_for_range(set_index *idx, void *ptr, uint64_t size,
+    evset **evsets);
+
+__attribute__((always_inline))
+static inline evset *get_evset(set_index *idx, uint32_t set);
+__attribute__((always_inline))
+static inline void prime_evset(evset *es);
+__attribute__((always_inline))
+static inline time_type probe_evset(cache_level cl, evset *es);
+__attribute__((always_inline))
+static inline void probe_evsets(cache_level cl, evset **evsets, uint32_t cnt,
+    time_type *res);
+
+/*
+ * Eviction set of the given set, NULL if the set is not in the ring
+ */
+static inline evset *get_evset(set_index *idx, uint32_t set) {
+    return set < idx->ctx->sets ? idx->evsets[set] : NULL;
+}
+
+/*
+ * Same as prime, but only for the lines of one eviction set
+ */
+static inline void prime_evset(evset *es) {
+    cacheline *curr_cl = es->first;
+    cacheline *end = es->last->next;
+
+    cpuid();
+    do {
+        curr_cl = curr_cl->next;
+        mfence();
+    } while (curr_cl != end);
+    cpuid();
+}
+
+/*
+ * Probe a single eviction set with the same unrolled code as probe, which
+ * starts at the last line and stores the time in the first line.
+ */
+static inline time_type probe_evset(cache_level cl, evset *es) {
+    probe_cacheset(cl, es->last);
+    return es->first->time_msrmt;
+}
+
+/*
+ * Probe several eviction sets, in reverse order of priming, and store their
+ * times in `res`
+ */
+static inline void probe_evsets(cache_level cl, evset **evsets, uint32_t cnt,
+    time_type *res)
+{
+    for (uint32_t i = cnt; i-- > 0;)
+        res[i] = probe_evset(cl, evsets[i]);
+}
+
+#endif // HEADER_SET_INDEX_H
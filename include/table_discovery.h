@@ -0,0 +1,95 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Discovery of secret-indexed tables by cache profiling. The victim is run
+ * with random inputs, and the probe times of all sets are accumulated per
+ * (input byte, upper nibble of the byte). Sets of a table indexed by
+ * input ^ secret depend on the input byte, all other sets do not. The
+ * dependence per set is measured with an F-statistic (one-way ANOVA over the
+ * 16 nibble values), and the table is located as the run of consecutive sets
+ * with the highest dependence. A partially used line at either end of the
+ * run reveals a table that is not aligned to cache lines.
+ */
+
+#ifndef HEADER_TABLE_DISCOVERY_H
+#define HEADER_TABLE_DISCOVERY_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aes_attack.h"
+#include "cache.h"
+#include "cache_types.h"
+
+// Default number of victim runs for profiling
+#define TABLE_DISCOVERY_SAMPLES 65536
+#define INPUT_NIBBLES 16
+// A set next to the run is part of the table if its dependence is at least
+// this fraction of the mean dependence in the run and significant, i.e. this
+// many standard deviations above the dependence of independent sets
+#define TABLE_EDGE_FRACTION (1.0 / 16)
+#define TABLE_EDGE_MIN_SIGMA 3
+
+typedef struct table_profile table_profile;
+typedef struct discovered_table discovered_table;
+
+struct table_profile {
+    uint32_t sets;
+    uint32_t input_len;
+    uint64_t samples;
+
+    // Probe time sums per (input byte, upper nibble, set)
+    double *sum;
+    double *sum_sq;
+    // Samples per (input byte, upper nibble)
+    uint64_t *cnt;
+};
+
+struct discovered_table {
+    uint32_t first_set;
+    // Lines of the table (one more than for an aligned table if unaligned)
+    uint32_t lines;
+    // Estimated offset of the table start in its first line
+    uint32_t byte_offset;
+    // Mean F-statistic of the table's sets (about 1 for independent sets)
+    double strength;
+};
+
+table_profile *prepare_table_profile(cache_ctx *ctx, uint32_t input_len);
+void release_table_profile(table_profile *prof);
+void update_table_profile(table_profile *prof, const uint8_t *input,
+    time_type *res);
+void get_input_dependence(table_profile *prof, uint32_t byte, double *dep);
+void discover_table(table_profile *prof, uint32_t *bytes, uint32_t bytes_len,
+    uint32_t table_lines, discovered_table *table);
+uint32_t get_table_block_set(table_profile *prof, discovered_table *table,
+    uint32_t block);
+void discover_aes_ttables(table_profile *prof, aes_ttable_map *map,
+    discovered_table *tables);
+void print_discovered_table(discovered_table *table);
+
+#endif // HEADER_TABLE_DISCOVERY_H
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Template attacks on cache traces. On a profiling device, samples with known
+ * classes (e.g. the accessed table line) are accumulated in two passes: the
+ * first one yields the class means and the signal-to-noise ratio of every
+ * set, which selects the points of interest (POIs), the second one the
+ * pooled covariance of the POIs around the exact class means. The templates
+ * store the class means whitened with the inverse Cholesky factor of the
+ * covariance, such that the log-likelihood of a trace for every class is a
+ * squared distance that is computed for batches of traces with SIMD vectors.
+ */
+
+#ifndef HEADER_TEMPLATE_H
+#define HEADER_TEMPLATE_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "cache_types.h"
+
+// Floats per SIMD vector (SSE, available on every x86-64 CPU)
+#define TEMPLATE_VEC_LEN 4
+#define TEMPLATE_MAX_POIS 64
+// Relative ridge that is added to the covariance diagonal (and increased)
+// until the Cholesky decomposition succeeds
+#define TEMPLATE_RIDGE 1e-9
+
+typedef float template_vec __attribute__ ((vector_size (TEMPLATE_VEC_LEN * sizeof(float))));
+
+typedef struct template_profile template_profile;
+typedef struct templates templates;
+
+struct template_profile {
+    uint32_t classes;
+    uint32_t sets;
+    uint64_t samples;
+
+    // First pass: count, sum and sum of squares per (class, set)
+    uint64_t *cnt;
+    double *sum;
+    double *sum_sq;
+
+    // Selected POIs, their signal-to-noise ratio and the class means
+    uint32_t pois;
+    uint32_t *poi_sets;
+    double *poi_snr;
+    double *poi_mean;
+
+    // Second pass: sum of the products of deviations from the class means
+    // (pois x pois)
+    double *cov_sum;
+    uint64_t cov_cnt;
+};
+
+struct templates {
+    uint32_t classes;
+    uint32_t sets;
+    uint32_t pois;
+    // POIs rounded up to full vectors
+    uint32_t pois_pad;
+    uint32_t *poi_sets;
+
+    // Mean of the POIs over all classes, subtracted before whitening
+    float *offset;
+    // Inverse Cholesky factor of the pooled covariance, by columns
+    // (pois_pad x pois_pad)
+    float *whitening;
+    // Whitened class means (classes x pois_pad)
+    float *means;
+};
+
+template_profile *prepare_template_profile(uint32_t classes, uint32_t sets);
+void release_template_profile(template_profile *prof);
+void update_template_profile(template_profile *prof, uint32_t cls,
+    const time_type *res);
+void get_template_snr(template_profile *prof, double *snr);
+void select_template_pois(template_profile *prof, uint32_t pois);
+void update_template_covariance(template_profile *prof, uint32_t cls,
+    const time_type *res);
+templates *build_templates(template_profile *prof);
+
+void release_templates(templates *t);
+int save_templates(const char *path, templates *t);
+templates *load_templates(const char *path);
+void match_templates(templates *t, const time_type *res, uint32_t cnt,
+    float *loglik);
+uint32_t get_best_template_class(templates *t, const float *loglik);
+
+#endif // HEADER_TEMPLATE_H
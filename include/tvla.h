@@ -0,0 +1,95 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Leakage assessment with Welch's t-test (TVLA). Samples of two classes,
+ * usually a fixed input and random inputs in random order, are accumulated
+ * online per set with central moments up to order 2 * TVLA_MAX_ORDER (Pébay's
+ * update formulas), such that univariate t-tests of order 1 (means), 2
+ * (variances) and higher (standardised moments) can be evaluated at any time.
+ * A set leaks if |t| exceeds TVLA_THRESHOLD; the assessment stops early once
+ * a leak was confirmed by consecutive checks.
+ */
+
+#ifndef HEADER_TVLA_H
+#define HEADER_TVLA_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "cache_types.h"
+
+#define TVLA_CLASSES 2
+#define TVLA_FIXED 0
+#define TVLA_RANDOM 1
+
+#define TVLA_MAX_ORDER 3
+// Common threshold of TVLA, a false positive rate of about 1e-5 per test
+#define TVLA_THRESHOLD 4.5
+// Samples per class before the first check
+#define TVLA_MIN_SAMPLES 256
+// Samples between two checks
+#define TVLA_CHECK_INTERVAL 256
+// Consecutive checks with |t| above the threshold to confirm a leak
+#define TVLA_CONFIRM_CHECKS 2
+
+typedef struct tvla tvla;
+
+struct tvla {
+    uint32_t sets;
+    uint32_t order;
+    uint64_t samples;
+
+    // Per class: sample count, mean per set and sums of the p-th powers of
+    // deviations from the mean (index p * sets + set, 2 <= p <= 2 * order)
+    uint64_t cnt[TVLA_CLASSES];
+    double *mean[TVLA_CLASSES];
+    double *m[TVLA_CLASSES];
+
+    // Result of the last check: t-statistic per (order - 1, set), highest
+    // |t| per order and the set where it occurs
+    double *t;
+    double max_abs_t[TVLA_MAX_ORDER];
+    uint32_t max_set[TVLA_MAX_ORDER];
+    uint32_t leaky_checks;
+};
+
+tvla *prepare_tvla(uint32_t sets, uint32_t order);
+void release_tvla(tvla *a);
+uint32_t get_tvla_class(void);
+void update_tvla(tvla *a, uint32_t cls, const time_type *res);
+void compute_tvla(tvla *a);
+bool is_tvla_done(tvla *a);
+bool is_tvla_leaky(tvla *a);
+uint32_t get_tvla_leaky_sets(tvla *a, uint32_t order, uint32_t *sets);
+double get_tvla_effect_size(tvla *a, uint32_t order, uint32_t set);
+uint32_t rank_tvla_leaky_sets(tvla *a, uint32_t *sets, double *effect_sizes);
+void print_tvla_progress(tvla *a);
+void print_tvla(tvla *a);
+
+#endif // HEADER_TVLA_H
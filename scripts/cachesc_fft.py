@@ -0,0 +1,274 @@
+#!/usr/bin/env python3
+
+#
+# This file is part of the plotting scripts supporting the CacheSC library
+# (https://github.com/Miro-H/CacheSC), which implements Prime+Probe attacks on
+# virtually and physically indexed caches.
+#
+# Copyright (C) 2020  Miro Haller
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Contact: miro.haller@alumni.ethz.ch
+#
+# Short description of this file:
+# Python wrapper of the FFT module of CacheSC (fft.h, built as the shared
+# library libcachesc-fft.so) and a command line interface to align windows of
+# binary trace files and to find dominant periods in their per-set activity.
+#
+
+import argparse
+import ctypes
+import os
+import struct
+import time
+
+from array import array
+
+from logger import Logger
+
+
+# Constants
+LIB_NAME            = "libcachesc-fft.so"
+DEFAULT_LIB_PATH    = os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                                   "..", "lib", LIB_NAME)
+
+# Layout of trace.h: magic, version, flags, msrmts_per_sample, input_len,
+# samples (native byte order)
+TRACE_HEADER        = struct.Struct("=8sIIIIQ")
+TRACE_MAGIC         = b"CSCTRACE"
+TRACE_FLAG_COMPRESSED = 0x1
+TIME_TYPE           = "I"
+
+DEFAULT_PERIODS     = 5
+DEFAULT_MAX_SHIFT   = 64
+
+
+class FFT:
+    def __init__(self, lib_path=DEFAULT_LIB_PATH):
+        self.lib = ctypes.CDLL(lib_path)
+
+        c_float_p   = ctypes.POINTER(ctypes.c_float)
+        c_double_p  = ctypes.POINTER(ctypes.c_double)
+        c_int32_p   = ctypes.POINTER(ctypes.c_int32)
+
+        self.lib.get_fft_len.argtypes = [ctypes.c_uint32]
+        self.lib.get_fft_len.restype  = ctypes.c_uint32
+        self.lib.prepare_fft.argtypes = [ctypes.c_uint32]
+        self.lib.prepare_fft.restype  = ctypes.c_void_p
+        self.lib.release_fft.argtypes = [ctypes.c_void_p]
+        self.lib.release_fft.restype  = None
+
+        self.lib.prepare_fft_aligner.argtypes = [c_float_p, ctypes.c_uint32,
+                                                 ctypes.c_uint32]
+        self.lib.prepare_fft_aligner.restype  = ctypes.c_void_p
+        self.lib.release_fft_aligner.argtypes = [ctypes.c_void_p]
+        self.lib.release_fft_aligner.restype  = None
+        self.lib.align_fft_traces.argtypes    = [ctypes.c_void_p, c_float_p,
+                                                 ctypes.c_uint32, c_float_p,
+                                                 c_int32_p, c_float_p]
+        self.lib.align_fft_traces.restype     = None
+
+        self.lib.get_fft_power_spectrum.argtypes = [ctypes.c_void_p, c_float_p,
+                                                    ctypes.c_uint32, c_double_p]
+        self.lib.get_fft_power_spectrum.restype  = None
+        self.lib.find_fft_periods.argtypes = [c_double_p, ctypes.c_uint32,
+                                              ctypes.c_uint32, c_double_p,
+                                              c_double_p]
+        self.lib.find_fft_periods.restype  = ctypes.c_uint32
+
+    def align(self, traces, reference, max_shift=DEFAULT_MAX_SHIFT):
+        """
+        Align traces (sequences of the length of the reference) to the
+        reference. Returns the aligned traces, the shift of every trace
+        (aligned[i] = trace[i + shift], samples outside of the trace are
+        replaced by its mean) and the correlations at the peaks.
+        """
+        length  = len(reference)
+        cnt     = len(traces)
+        flat    = array("f")
+        for trace in traces:
+            if len(trace) != length:
+                raise ValueError("all traces need the length of the reference")
+            flat.extend(trace)
+
+        ref     = as_c_array(ctypes.c_float, reference)
+        c_flat  = as_c_array(ctypes.c_float, flat)
+        aligned = (ctypes.c_float * (cnt * length))()
+        shifts  = (ctypes.c_int32 * cnt)()
+        corrs   = (ctypes.c_float * cnt)()
+
+        if max_shift < 0:
+            raise ValueError("the maximal shift cannot be negative")
+        aligner = self.lib.prepare_fft_aligner(ref, length, max_shift)
+        if not aligner:
+            raise ValueError("the reference needs more samples than the maximal shift")
+        self.lib.align_fft_traces(aligner, c_flat, cnt, aligned, shifts, corrs)
+        self.lib.release_fft_aligner(aligner)
+
+        aligned = [aligned[i * length:(i + 1) * length] for i in range(cnt)]
+        return aligned, list(shifts), list(corrs)
+
+    def periods(self, signals, max_periods=DEFAULT_PERIODS):
+        """
+        Find the dominant periods (in samples) of the accumulated power spectra
+        of the signals. Returns (period, share of power) tuples, strongest
+        first.
+        """
+        length  = max(len(signal) for signal in signals)
+        fft_len = self.lib.get_fft_len(length)
+        power   = (ctypes.c_double * (fft_len // 2 + 1))()
+
+        plan = self.lib.prepare_fft(fft_len)
+        for signal in signals:
+            self.lib.get_fft_power_spectrum(plan, as_c_array(ctypes.c_float, signal),
+                                            len(signal), power)
+        self.lib.release_fft(plan)
+
+        periods     = (ctypes.c_double * max_periods)()
+        strengths   = (ctypes.c_double * max_periods)()
+        cnt = self.lib.find_fft_periods(power, fft_len, max_periods, periods,
+                                        strengths)
+
+        return list(zip(periods[:cnt], strengths[:cnt]))
+
+
+def as_c_array(c_type, values):
+    if isinstance(values, array) and values.typecode == "f" and c_type == ctypes.c_float:
+        return (c_type * len(values)).from_buffer(values)
+    return (c_type * len(values))(*values)
+
+def read_trace(path):
+    """
+    Read a binary trace file of trace.h. Returns the header fields as
+    dictionary, the inputs (bytes per sample) and the measurements (one array
+    per sample).
+    """
+    with open(path, "rb") as fp:
+        magic, version, flags, msrmts, input_len, samples = \
+            TRACE_HEADER.unpack(fp.read(TRACE_HEADER.size))
+        if magic != TRACE_MAGIC:
+            raise ValueError(f"{path} is no CacheSC trace")
+        if flags & TRACE_FLAG_COMPRESSED:
+            raise ValueError(f"{path} is compressed, unpack it with cachesc-trace")
+
+        inputs  = []
+        res     = []
+        for _ in range(samples):
+            inputs.append(fp.read(input_len))
+            res.append(array(TIME_TYPE, fp.read(msrmts * array(TIME_TYPE).itemsize)))
+
+    header = {"version": version, "flags": flags, "msrmts_per_sample": msrmts,
+              "input_len": input_len, "samples": samples}
+    return header, inputs, res
+
+def write_trace(path, header, inputs, res):
+    with open(path, "wb") as fp:
+        fp.write(TRACE_HEADER.pack(TRACE_MAGIC, header["version"], header["flags"],
+                                   header["msrmts_per_sample"], header["input_len"],
+                                   len(res)))
+        for inp, sample in zip(inputs, res):
+            fp.write(inp)
+            fp.write(sample.tobytes())
+
+
+def run_periods(args, fft, logger):
+    header, _, res = read_trace(args.trace)
+    sets = range(header["msrmts_per_sample"]) if args.set is None else [args.set]
+
+    signals = {s: array("f", (sample[s] for sample in res)) for s in sets}
+
+    logger.line(f"Dominant periods of {len(res)} samples (period: share of power)")
+    for s in sets:
+        periods = fft.periods([signals[s]], args.periods)
+        logger.line(f"set {s:4d}: " + ", ".join(f"{p:.2f}: {w:.4f}" for p, w in periods))
+
+    if len(sets) > 1:
+        periods = fft.periods(list(signals.values()), args.periods)
+        logger.line("all sets: " + ", ".join(f"{p:.2f}: {w:.4f}" for p, w in periods))
+
+def run_align(args, fft, logger):
+    header, inputs, res = read_trace(args.trace)
+    length  = args.length
+    cnt     = len(res) // length
+
+    if cnt == 0 or args.set >= header["msrmts_per_sample"]:
+        logger.error("trace too short or set out of range")
+    if not 0 <= args.max_shift < length:
+        logger.error("maximal shift needs to be below the window length")
+
+    windows = [array("f", (res[w * length + i][args.set] for i in range(length)))
+               for w in range(cnt)]
+
+    start = time.time()
+    _, shifts, corrs = fft.align(windows, windows[0], args.max_shift)
+    duration = time.time() - start
+
+    logger.line(f"Aligned {cnt} windows of {length} samples in {duration:.3f} s")
+    logger.line(f"Shifts: min {min(shifts)}, max {max(shifts)}, "
+                f"mean correlation {sum(corrs) / cnt:.4f}")
+
+    # Like shift_fft_trace, samples shifted in from outside of a window are
+    # replaced by the mean of the window (per set, without input)
+    if args.output:
+        aligned_inputs  = []
+        aligned_res     = []
+        empty_input     = bytes(header["input_len"])
+        for w in range(cnt):
+            window  = res[w * length:(w + 1) * length]
+            mean    = array(TIME_TYPE, (round(sum(sample[s] for sample in window) / length)
+                                        for s in range(header["msrmts_per_sample"])))
+            for i in range(length):
+                src = i + shifts[w]
+                if 0 <= src < length:
+                    aligned_inputs.append(inputs[w * length + src])
+                    aligned_res.append(window[src])
+                else:
+                    aligned_inputs.append(empty_input)
+                    aligned_res.append(mean)
+        write_trace(args.output, header, aligned_inputs, aligned_res)
+        logger.line(f"Aligned trace written to {args.output}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--lib", help=f"path to {LIB_NAME}", default=DEFAULT_LIB_PATH)
+    subparsers = parser.add_subparsers(dest="command", required=True)
+
+    periods_parser = subparsers.add_parser("periods", help="find dominant periods "
+                                           "of the per-set activity")
+    periods_parser.add_argument("trace", help="path to binary trace file")
+    periods_parser.add_argument("-s", "--set", help="only analyse this set", type=int)
+    periods_parser.add_argument("-n", "--periods", help="periods to report",
+                                type=int, default=DEFAULT_PERIODS)
+
+    align_parser = subparsers.add_parser("align", help="align consecutive windows "
+                                         "of a trace to the first one")
+    align_parser.add_argument("trace", help="path to binary trace file")
+    align_parser.add_argument("length", help="samples per window", type=int)
+    align_parser.add_argument("-s", "--set", help="set used for the alignment",
+                              type=int, default=0)
+    align_parser.add_argument("-m", "--max_shift", help="maximal shift in samples",
+                              type=int, default=DEFAULT_MAX_SHIFT)
+    align_parser.add_argument("-o", "--output", help="path to the aligned trace")
+
+    args = parser.parse_args()
+
+    logger = Logger("fft")
+    fft = FFT(args.lib)
+
+    if args.command == "periods":
+        run_periods(args, fft, logger)
+    else:
+        run_align(args, fft, logger)
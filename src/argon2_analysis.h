@@ -0,0 +1,137 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Reconstruction of the data-dependent memory accesses of Argon2d (one lane)
+ * from an asynchronous Prime+Probe trace of every ARGON2_SETS_PER_BLOCK-th L2
+ * set. As a 1 KiB block spans ARGON2_SETS_PER_BLOCK consecutive sets, each
+ * block touches exactly one monitored set, its color. Samples are placed on
+ * the sequence of computed blocks by their timestamps relative to the victim's
+ * hash markers. The block colors are learned from the sequential block
+ * writes (one unknown frame color per page), then every position accumulates
+ * log-likelihood ratios for the color of its reference block. Combined with
+ * the prior of Argon2's index function, this yields the posterior of the
+ * reference color and the most likely reference block indices per position.
+ */
+
+#ifndef HEADER_ARGON2_ANALYSIS_H
+#define HEADER_ARGON2_ANALYSIS_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "cache_types.h"
+
+#define ARGON2_BLOCK_SIZE 1024
+#define ARGON2_SYNC_POINTS 4
+#define ARGON2_SETS_PER_BLOCK (ARGON2_BLOCK_SIZE / CACHELINE_SIZE)
+#define ARGON2_BLOCKS_PER_PAGE (PAGE_SIZE / ARGON2_BLOCK_SIZE)
+// Monitored set within each group of ARGON2_SETS_PER_BLOCK sets
+#define ARGON2_MONITORED_SET 7
+#define ARGON2_MAX_COLORS 64
+
+// Reference block candidates kept per position
+#define ARGON2_CANDIDATES 4
+// Most recent blocks of a reference area whose prior is evaluated exactly,
+// the remaining prior mass is spread evenly over all colors
+#define ARGON2_PRIOR_WINDOW 1024
+// Probability that a block access shows up in a covering sample
+#define ARGON2_DETECT_PROB 0.9
+// Bounds of the estimated rate of active sets without an access
+#define ARGON2_MIN_FALSE_RATE 0.01
+#define ARGON2_MAX_FALSE_RATE 0.5
+// A set is active if its measurement exceeds the median by this many MADs
+#define ARGON2_ACTIVE_MADS 3
+// Posterior of the reference color above which a position counts as
+// reconstructed in the summary
+#define ARGON2_CONFIDENT 0.9
+
+typedef struct argon2_sample argon2_sample;
+typedef struct argon2_recon argon2_recon;
+
+struct argon2_sample {
+    // TSC at the start of the prime and at the end of the probe
+    uint64_t start;
+    uint64_t stop;
+    // Bit c is set if monitored set c was active
+    uint64_t active;
+    // Computed block positions covered by the sample, set by
+    // map_argon2_samples (first > last if none)
+    uint64_t first_pos;
+    uint64_t last_pos;
+};
+
+struct argon2_recon {
+    uint32_t blocks;
+    uint32_t passes;
+    uint32_t seg_len;
+    uint32_t colors;
+    // Computed blocks, passes * blocks (including the first two blocks of
+    // the first pass, which have no reference)
+    uint64_t positions;
+
+    // Monitored set of every memory block. Learned from the trace by
+    // learn_argon2_block_colors or filled in by a privileged attacker.
+    uint8_t *block_color;
+
+    // Rate of active samples per color that are not explained by an access
+    double false_rate[ARGON2_MAX_COLORS];
+
+    // Per position: log-likelihood ratio of a reference to a block of each
+    // color (index pos * colors + color) and the number of covering samples
+    float *llr;
+    uint16_t *coverage;
+
+    // Result per position: most likely reference color and its posterior
+    // probability, and the most likely reference blocks (index
+    // pos * ARGON2_CANDIDATES + i) with their posterior probabilities
+    uint8_t *ref_color;
+    float *confidence;
+    uint32_t *cand;
+    float *cand_prob;
+};
+
+argon2_recon *prepare_argon2_recon(uint32_t blocks, uint32_t passes,
+    uint32_t colors);
+void release_argon2_recon(argon2_recon *r);
+void get_argon2_activity(uint32_t colors, const time_type *res,
+    uint32_t msrmts_per_sample, uint64_t cnt, argon2_sample *samples);
+void map_argon2_samples(argon2_recon *r, argon2_sample *samples, uint64_t cnt,
+    uint64_t hash_start, uint64_t hash_stop);
+void learn_argon2_block_colors(argon2_recon *r, const argon2_sample *samples,
+    uint64_t cnt);
+void reconstruct_argon2_refs(argon2_recon *r, const argon2_sample *samples,
+    uint64_t cnt);
+bool get_argon2_ref_area(argon2_recon *r, uint64_t pos, uint32_t *start,
+    uint32_t *size);
+uint32_t get_argon2_ref_block(argon2_recon *r, uint64_t pos, uint32_t pseudo_rand);
+void print_argon2_recon(argon2_recon *r);
+int save_argon2_recon(const char *path, argon2_recon *r);
+
+#endif // HEADER_ARGON2_ANALYSIS_H
@@ -44,6 +44,8 @@ static inline void prefetcht0(void *p) __attribute__((always_inline));
 static inline void incq(void *p) __attribute__((always_inline));
 static inline void readq(void *p) __attribute__((always_inline));
 static inline void rdtsc(void) __attribute__((always_inline));
+static inline void start_timer_lfence(void) __attribute__((always_inline));
+static inline void stop_timer_lfence(uint32_t *tsc_low) __attribute__((always_inline));
 static inline uint32_t accesstime(void *p) __attribute__((always_inline));
 static inline uint32_t accesstime_overhead() __attribute__((always_inline));
 static inline void nop_slide() __attribute__((always_inline));
@@ -135,6 +137,32 @@ static inline void stop_timer(uint32_t *tsc_low) {
     );
 }
 
+/*
+ * Lighter timer backend: serialise rdtsc with lfence instead of cpuid. This
+ * only orders loads, but has a much smaller and less variable overhead.
+ */
+static inline void start_timer_lfence() {
+    asm volatile(
+        "lfence\n\t"
+        "rdtsc\n\t"
+        "lfence\n\t"
+        "mov %%eax, %%r8d\n\t"
+        ::: RDTSC_AFFECTED_REGS, TRANSFER_REG
+    );
+}
+
+static inline void stop_timer_lfence(uint32_t *tsc_low) {
+    asm volatile(
+        "rdtscp\n\t"
+        "lfence\n\t"
+        "mov %%eax, %%r9d\n\t"
+        "sub %%r8d, %%r9d\n\t"
+        "mov %%r9d, %0\n\t"
+        : "=r" (*tsc_low)
+        :: RDTSCP_AFFECTED_REGS, TRANSFER_REG, "r9"
+    );
+}
+
 /*
  * Measuring time according to Intel's "How to Benchmark
  * Code Execution Times" guide.
@@ -0,0 +1,337 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the evaluation of Prime+Probe configurations against
+ * a known victim and the successive halving search over all configurations.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "autotune.h"
+#include "prefetch.h"
+#include "victim.h"
+
+#define PROFILE_KEY_LEN 64
+
+typedef struct pp_candidate pp_candidate;
+
+struct pp_candidate {
+    pp_conf conf;
+    uint32_t layout_idx;
+    pp_conf_score score;
+};
+
+// local functions
+int cmp_candidates(const void *c1, const void *c2);
+
+
+/*
+ * The configuration used by the demos: forward prime for L1 and reverse
+ * prime for L2, with fences, read accesses and the cpuid timer.
+ */
+void get_default_pp_conf(cache_ctx *ctx, pp_conf *conf) {
+    conf->prime_dir     = (ctx->cache_level == L2) ? PRIME_REV : PRIME_FWD;
+    conf->prime_access  = PRIME_READ;
+    conf->prime_fence   = true;
+    conf->timer         = TIMER_CPUID;
+    conf->reps          = 1;
+    conf->layout_seed   = 0;
+    conf->spread_order  = false;
+}
+
+/*
+ * Build the Prime+Probe data structure with the layout of the configuration
+ */
+cacheline *prepare_cache_ds_conf(cache_ctx *ctx, pp_conf *conf) {
+    cacheline *cache_ds;
+
+    srand(conf->layout_seed);
+    cache_ds = prepare_cache_ds(ctx);
+
+    return conf->spread_order ? spread_cache_ds(ctx, cache_ds) : cache_ds;
+}
+
+/*
+ * Measure the signal of the target set with and without a victim access for
+ * `samples` rounds each (interleaved to cancel out drift) and compute the SNR
+ * and throughput of the configuration.
+ */
+void evaluate_pp_conf(cache_ctx *ctx, pp_conf *conf, cacheline *cache_ds,
+    cacheline *victim_cl, uint32_t target_set, uint32_t samples,
+    pp_conf_score *score)
+{
+    uint32_t i, r, t_min, cls;
+    double delta, noise;
+    double mean[2]  = {0, 0};
+    double m2[2]    = {0, 0};
+    uint32_t cnt[2] = {0, 0};
+
+    struct timespec start, stop;
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+
+    time_type *msrmts = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(msrmts);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < 2 * samples; ++i) {
+        cls     = i & 1;
+        t_min   = UINT32_MAX;
+
+        for (r = 0; r < conf->reps; ++r) {
+            curr_head = prime_conf(conf, curr_head);
+            if (cls)
+                victim(victim_cl);
+            next_head = probe_conf(conf, ctx->cache_level, curr_head);
+
+            get_msrmts_for_all_set(curr_head, msrmts);
+            curr_head = next_head;
+
+            if (msrmts[target_set] < t_min)
+                t_min = msrmts[target_set];
+        }
+
+        // Welford's online mean and variance
+        ++cnt[cls];
+        delta       = t_min - mean[cls];
+        mean[cls]  += delta / cnt[cls];
+        m2[cls]    += delta * (t_min - mean[cls]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    // Timings are integers, so assume at least the quantisation noise of 1/12
+    noise = (m2[0] / cnt[0] + m2[1] / cnt[1]) / 2 + 1.0 / 12;
+    delta = mean[1] - mean[0];
+
+    // A victim access must make the set slower, otherwise there is no signal
+    score->snr              = (delta > 0) ? delta * delta / noise : 0;
+    score->bits_per_sample  = 0.5 * log2(1 + score->snr);
+    score->samples_per_sec  = 2 * samples / get_elapsed_sec(&start, &stop);
+    score->bits_per_sec     = score->bits_per_sample * score->samples_per_sec;
+
+    free(msrmts);
+}
+
+/*
+ * Search the configuration that maximises the bits of signal per second on
+ * this machine. All configurations are evaluated with a small sample budget,
+ * then the better half is kept and evaluated again with twice the budget,
+ * until only one configuration remains (successive halving).
+ */
+void autotune_pp_conf(cache_ctx *ctx, uint32_t target_set, uint32_t layouts,
+    pp_conf *best_conf, pp_conf_score *best_score)
+{
+    uint32_t i, l, dir, access, fence, timer, reps;
+    uint32_t alive, samples;
+    uint32_t nr_of_candidates;
+    pp_candidate *candidates;
+    cacheline **cache_ds_arr;
+    cacheline *victim_cl;
+
+    assert(target_set < ctx->sets);
+    assert(layouts > 0);
+
+    nr_of_candidates = 2 * 2 * 2 * 2 * AUTOTUNE_MAX_REPS * layouts;
+    candidates = (pp_candidate *) malloc(nr_of_candidates * sizeof(pp_candidate));
+    cache_ds_arr = (cacheline **) malloc(layouts * sizeof(cacheline *));
+    assert(candidates);
+    assert(cache_ds_arr);
+
+    // Enumerate the search space
+    i = 0;
+    for (l = 0; l < layouts; ++l) {
+        pp_conf layout_conf;
+        layout_conf.layout_seed     = rand();
+        layout_conf.spread_order    = false;
+        cache_ds_arr[l] = prepare_cache_ds_conf(ctx, &layout_conf);
+
+        for (dir = PRIME_FWD; dir <= PRIME_REV; ++dir) {
+            for (access = PRIME_READ; access <= PRIME_WRITE; ++access) {
+                for (fence = 0; fence <= 1; ++fence) {
+                    for (timer = TIMER_CPUID; timer <= TIMER_LFENCE; ++timer) {
+                        for (reps = 1; reps <= AUTOTUNE_MAX_REPS; ++reps) {
+                            candidates[i].conf.prime_dir    = dir;
+                            candidates[i].conf.prime_access = access;
+                            candidates[i].conf.prime_fence  = fence;
+                            candidates[i].conf.timer        = timer;
+                            candidates[i].conf.reps         = reps;
+                            candidates[i].conf.layout_seed  = layout_conf.layout_seed;
+                            candidates[i].conf.spread_order = false;
+                            candidates[i].layout_idx        = l;
+                            ++i;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    victim_cl = prepare_victim(ctx, target_set);
+
+    prepare_measurement();
+
+    alive   = nr_of_candidates;
+    samples = AUTOTUNE_MIN_SAMPLES;
+
+    do {
+        for (i = 0; i < alive; ++i) {
+            evaluate_pp_conf(ctx, &candidates[i].conf,
+                             cache_ds_arr[candidates[i].layout_idx], victim_cl,
+                             target_set, samples, &candidates[i].score);
+        }
+
+        qsort(candidates, alive, sizeof(pp_candidate), cmp_candidates);
+
+        alive    = (alive + 1) / 2;
+        samples *= 2;
+    } while (alive > 1);
+
+    *best_conf = candidates[0].conf;
+    if (best_score)
+        *best_score = candidates[0].score;
+
+    release_victim(ctx, victim_cl);
+    for (l = 0; l < layouts; ++l)
+        release_cache_ds(ctx, cache_ds_arr[l]);
+
+    free(cache_ds_arr);
+    free(candidates);
+}
+
+/*
+ * Store a configuration as profile, together with the cache dimensions it was
+ * tuned for.
+ * Returns 0 on success, 1 on failure.
+ */
+int save_pp_profile(const char *path, cache_ctx *ctx, pp_conf *conf,
+    pp_conf_score *score)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return 1;
+
+    fprintf(fp, "# CacheSC Prime+Probe profile\n");
+    fprintf(fp, "cache_level = %u\n", ctx->cache_level);
+    fprintf(fp, "sets = %u\n", ctx->sets);
+    fprintf(fp, "associativity = %u\n", ctx->associativity);
+    fprintf(fp, "prime_dir = %u\n", conf->prime_dir);
+    fprintf(fp, "prime_access = %u\n", conf->prime_access);
+    fprintf(fp, "prime_fence = %u\n", conf->prime_fence);
+    fprintf(fp, "timer = %u\n", conf->timer);
+    fprintf(fp, "reps = %u\n", conf->reps);
+    fprintf(fp, "layout_seed = %u\n", conf->layout_seed);
+    fprintf(fp, "spread_order = %u\n", conf->spread_order);
+
+    if (score) {
+        fprintf(fp, "# snr = %.3f\n", score->snr);
+        fprintf(fp, "# bits_per_sec = %.1f\n", score->bits_per_sec);
+    }
+
+    return fclose(fp) != 0;
+}
+
+/*
+ * Load a profile stored by save_pp_profile. Entries that are missing keep
+ * the default configuration.
+ * Returns 0 on success, 1 on failure or if the profile was tuned for another
+ * cache geometry.
+ */
+int load_pp_profile(const char *path, cache_ctx *ctx, pp_conf *conf) {
+    char line[BUFSIZ];
+    char key[PROFILE_KEY_LEN];
+    uint32_t val;
+    int ret = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return 1;
+
+    get_default_pp_conf(ctx, conf);
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || sscanf(line, "%63s = %u", key, &val) != 2)
+            continue;
+
+        if ((!strcmp(key, "cache_level") && val != ctx->cache_level)
+            || (!strcmp(key, "sets") && val != ctx->sets)
+            || (!strcmp(key, "associativity") && val != ctx->associativity))
+        {
+            ret = 1;
+        }
+        else if (!strcmp(key, "prime_dir"))
+            conf->prime_dir = val ? PRIME_REV : PRIME_FWD;
+        else if (!strcmp(key, "prime_access"))
+            conf->prime_access = val ? PRIME_WRITE : PRIME_READ;
+        else if (!strcmp(key, "prime_fence"))
+            conf->prime_fence = val;
+        else if (!strcmp(key, "timer"))
+            conf->timer = val ? TIMER_LFENCE : TIMER_CPUID;
+        else if (!strcmp(key, "reps"))
+            conf->reps = val ? val : 1;
+        else if (!strcmp(key, "layout_seed"))
+            conf->layout_seed = val;
+        else if (!strcmp(key, "spread_order"))
+            conf->spread_order = val;
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+/*
+ * Fancy print a configuration and optionally its score
+ */
+void print_pp_conf(pp_conf *conf, pp_conf_score *score) {
+    printf("pp_conf = {\n\tprime_dir: %s,\n\tprime_access: %s,\n\t"
+           "prime_fence: %d,\n\ttimer: %s,\n\treps: %u,\n\tlayout_seed: %u,\n\t"
+           "spread_order: %d\n}\n",
+           conf->prime_dir == PRIME_REV ? "reverse" : "forward",
+           conf->prime_access == PRIME_WRITE ? "write" : "read",
+           conf->prime_fence, conf->timer == TIMER_LFENCE ? "lfence" : "cpuid",
+           conf->reps, conf->layout_seed, conf->spread_order
+    );
+
+    if (score) {
+        printf("pp_conf_score = {\n\tsnr: %.3f,\n\tbits_per_sample: %.3f,\n\t"
+               "samples_per_sec: %.1f,\n\tbits_per_sec: %.1f\n}\n",
+               score->snr, score->bits_per_sample, score->samples_per_sec,
+               score->bits_per_sec
+        );
+    }
+}
+
+/*
+ * Sort candidates by decreasing bits per second
+ */
+int cmp_candidates(const void *c1, const void *c2) {
+    double b1 = ((const pp_candidate *) c1)->score.bits_per_sec;
+    double b2 = ((const pp_candidate *) c2)->score.bits_per_sec;
+
+    return (b1 < b2) - (b1 > b2);
+}
@@ -0,0 +1,160 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Autotuner for the Prime+Probe configuration. It measures the signal quality
+ * (SNR) and throughput of each configuration against a known victim, selects
+ * the best one with successive halving and stores it in a profile that can be
+ * loaded by attacks on the same machine.
+ */
+
+#ifndef HEADER_AUTOTUNE_H
+#define HEADER_AUTOTUNE_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "asm.h"
+#include "cache.h"
+#include "cache_types.h"
+
+// Samples per configuration and class in the first round of successive halving.
+// The budget doubles in every round.
+#define AUTOTUNE_MIN_SAMPLES 256
+// Default number of differently randomised data structures to try
+#define AUTOTUNE_LAYOUTS 2
+// Prime+Probe repetitions per sample that are tried: 1, 2, ..., MAX_REPS
+#define AUTOTUNE_MAX_REPS 4
+
+typedef enum prime_dir prime_dir;
+typedef enum prime_access prime_access;
+typedef enum timer_type timer_type;
+typedef struct pp_conf pp_conf;
+typedef struct pp_conf_score pp_conf_score;
+
+enum prime_dir {PRIME_FWD, PRIME_REV};
+enum prime_access {PRIME_READ, PRIME_WRITE};
+enum timer_type {TIMER_CPUID, TIMER_LFENCE};
+
+struct pp_conf {
+    prime_dir prime_dir;
+    prime_access prime_access;
+    bool prime_fence;
+    timer_type timer;
+
+    // Prime+Probe rounds per sample, the minimum time per set is kept
+    uint32_t reps;
+    // Seed for the randomised data structure (only reproducible for
+    // virtually indexed caches)
+    uint32_t layout_seed;
+    // Order the sets against the prefetchers (see prefetch.h)
+    bool spread_order;
+};
+
+struct pp_conf_score {
+    double snr;
+    double bits_per_sample;
+    double samples_per_sec;
+    double bits_per_sec;
+};
+
+void get_default_pp_conf(cache_ctx *ctx, pp_conf *conf);
+cacheline *prepare_cache_ds_conf(cache_ctx *ctx, pp_conf *conf);
+void evaluate_pp_conf(cache_ctx *ctx, pp_conf *conf, cacheline *cache_ds,
+    cacheline *victim_cl, uint32_t target_set, uint32_t samples,
+    pp_conf_score *score);
+void autotune_pp_conf(cache_ctx *ctx, uint32_t target_set, uint32_t layouts,
+    pp_conf *best_conf, pp_conf_score *best_score);
+int save_pp_profile(const char *path, cache_ctx *ctx, pp_conf *conf,
+    pp_conf_score *score);
+int load_pp_profile(const char *path, cache_ctx *ctx, pp_conf *conf);
+void print_pp_conf(pp_conf *conf, pp_conf_score *score);
+
+__attribute__((always_inline))
+static inline cacheline *prime_variant(cacheline *head, bool rev, bool fence,
+    bool write);
+__attribute__((always_inline))
+static inline cacheline *prime_conf(pp_conf *conf, cacheline *head);
+__attribute__((always_inline))
+static inline cacheline *probe_conf(pp_conf *conf, cache_level cl, cacheline *head);
+
+/*
+ * Generic prime, all flags are expected to be constants such that the compiler
+ * removes the branches from the loop after inlining.
+ * prime_variant(head, false, true, false) is equivalent to prime(head) and
+ * prime_variant(head, true, true, false) to prime_rev(head).
+ */
+static inline cacheline *prime_variant(cacheline *head, bool rev, bool fence,
+    bool write)
+{
+    cacheline *curr_cl = head;
+
+    cpuid();
+    do {
+        if (write)
+            incq(curr_cl->padding);
+
+        curr_cl = rev ? curr_cl->prev : curr_cl->next;
+
+        if (fence)
+            mfence();
+    } while(curr_cl != head);
+    cpuid();
+
+    return curr_cl->prev;
+}
+
+/*
+ * Prime the data structure as described by the given configuration
+ */
+static inline cacheline *prime_conf(pp_conf *conf, cacheline *head) {
+    uint32_t variant = (conf->prime_dir == PRIME_REV)
+                       | (conf->prime_fence << 1)
+                       | ((conf->prime_access == PRIME_WRITE) << 2);
+
+    switch (variant) {
+        case 0: return prime_variant(head, false, false, false);
+        case 1: return prime_variant(head, true,  false, false);
+        case 2: return prime_variant(head, false, true,  false);
+        case 3: return prime_variant(head, true,  true,  false);
+        case 4: return prime_variant(head, false, false, true);
+        case 5: return prime_variant(head, true,  false, true);
+        case 6: return prime_variant(head, false, true,  true);
+        default: return prime_variant(head, true,  true,  true);
+    }
+}
+
+/*
+ * Probe the data structure with the timer backend of the given configuration
+ */
+static inline cacheline *probe_conf(pp_conf *conf, cache_level cl, cacheline *head) {
+    if (conf->timer == TIMER_LFENCE)
+        return probe_lfence(cl, head);
+    else
+        return probe(cl, head);
+}
+
+#endif // HEADER_AUTOTUNE_H
@@ -82,6 +82,10 @@ static inline cacheline *probe(cache_level cl, cacheline *head);
 __attribute__((always_inline))
 static inline cacheline *probe_cacheset(cache_level cl, cacheline *curr_cl);
 __attribute__((always_inline))
+static inline cacheline *probe_cacheset_lfence(cache_level cl, cacheline *curr_cl);
+__attribute__((always_inline))
+static inline cacheline *probe_lfence(cache_level cl, cacheline *head);
+__attribute__((always_inline))
 static inline cacheline *probe_all_cachelines(cacheline *head);
 __attribute__((always_inline))
 static inline uint32_t probe_full_ds(cacheline *head);
@@ -101,6 +105,10 @@ __attribute__((always_inline))
 static inline cacheline *asm_l1_probe_cacheset(cacheline *curr_cl);
 __attribute__((always_inline))
 static inline cacheline *asm_l2_probe_cacheset(cacheline *curr_cl);
+__attribute__((always_inline))
+static inline cacheline *asm_l1_probe_cacheset_lfence(cacheline *curr_cl);
+__attribute__((always_inline))
+static inline cacheline *asm_l2_probe_cacheset_lfence(cacheline *curr_cl);
 
 static inline uint32_t access_diff(void *p) {
     return accesstime(p) - accesstime_overhead();
@@ -211,6 +219,33 @@ static inline cacheline *probe(cache_level cl, cacheline *head) {
     return curr_cs->next;
 }
 
+/*
+ * Same as probe_cacheset, but timed with the lfence timer backend.
+ */
+static inline cacheline *probe_cacheset_lfence(cache_level cl, cacheline *curr_cl) {
+    if (cl == L1)
+        return asm_l1_probe_cacheset_lfence(curr_cl);
+    else if (cl == L2)
+        return asm_l2_probe_cacheset_lfence(curr_cl);
+    else
+        return NULL;
+}
+
+/*
+ * Same as probe, but timed with the lfence timer backend (see asm.h). Its
+ * measurements have a lower and more stable overhead, but are not directly
+ * comparable to the ones of probe.
+ */
+static inline cacheline *probe_lfence(cache_level cl, cacheline *head) {
+    cacheline *curr_cs = head;
+
+    do {
+        curr_cs = probe_cacheset_lfence(cl, curr_cs);
+    } while(__builtin_expect(curr_cs != head, 1));
+
+    return curr_cs->next;
+}
+
 /*
  * Probe and measure cachelines without grouping them to sets.
  * Has high overhead cost which might hide evictions.
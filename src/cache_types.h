@@ -64,6 +64,7 @@ typedef enum cache_level cache_level;
 typedef enum addressing_type addressing_type;
 typedef struct cacheline cacheline;
 typedef struct cache_ctx cache_ctx;
+typedef struct color_pool color_pool;
 typedef uint32_t time_type;
 
 enum cache_level {L1, L2};
@@ -79,6 +80,9 @@ struct cache_ctx {
     uint32_t nr_of_cachelines;
     uint32_t set_size;
     uint32_t cache_size;
+
+    // Pages of the cache set coloring allocator (see color_alloc.h)
+    color_pool *color_pool;
 };
 
 struct cacheline {
@@ -125,11 +129,15 @@ static cache_ctx *get_cache_ctx(cache_level cache_level) {
     ctx->nr_of_cachelines   = ctx->sets * ctx->associativity;
     ctx->set_size           = CACHELINE_SIZE * ctx->associativity;
     ctx->cache_size         = ctx->sets * ctx->set_size;
+    ctx->color_pool         = NULL;
 
     return ctx;
 }
 
+void release_color_pool(cache_ctx *ctx);
+
 static void release_cache_ctx(cache_ctx *ctx) {
+    release_color_pool(ctx);
     free(ctx);
 }
 
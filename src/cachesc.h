@@ -27,8 +27,31 @@
 #ifndef HEADER_CACHESC_H
 #define HEADER_CACHESC_H
 
+#include "aes_attack.h"
+#include "argon2_analysis.h"
+#include "autotune.h"
 #include "cache.h"
+#include "checkpoint.h"
+#include "color_alloc.h"
+#include "covert.h"
+#include "cpa.h"
+#include "fft.h"
+#include "footprint.h"
 #include "io.h"
+#include "leaky_victim.h"
+#include "prefetch.h"
+#include "probe_kernel.h"
+#include "quality.h"
+#include "query_sched.h"
+#include "scan.h"
+#include "segment.h"
+#include "set_index.h"
+#include "table_discovery.h"
+#include "template.h"
+#include "trace.h"
+#include "trace_merge.h"
+#include "trace_query.h"
+#include "tvla.h"
 #include "util.h"
 #include "victim.h"
 
@@ -0,0 +1,225 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements checkpoints of long-running captures.
+ */
+
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+
+typedef struct checkpoint_header checkpoint_header;
+
+struct checkpoint_header {
+    char magic[CHECKPOINT_MAGIC_LEN];
+    uint32_t version;
+    uint32_t region_cnt;
+    uint64_t trace_samples;
+    uint8_t rand_state[RAND_STATE_LEN];
+};
+
+// local functions
+int sync_checkpoint_dir(const char *path);
+
+
+/*
+ * Prepare checkpoints that are stored at `path`
+ */
+checkpoint *prepare_checkpoint(const char *path) {
+    checkpoint *cp = (checkpoint *) calloc(1, sizeof(checkpoint));
+    assert(cp);
+
+    cp->path        = strdup(path);
+    cp->tmp_path    = (char *) malloc(strlen(path) + sizeof(".tmp"));
+    assert(cp->path && cp->tmp_path);
+    sprintf(cp->tmp_path, "%s.tmp", path);
+
+    return cp;
+}
+
+void release_checkpoint(checkpoint *cp) {
+    free(cp->path);
+    free(cp->tmp_path);
+    free(cp);
+}
+
+/*
+ * Add `size` bytes at `ptr` to the state that is saved and restored. The
+ * regions must be added in the same order and with the same sizes when the
+ * checkpoint is loaded.
+ */
+void add_checkpoint_region(checkpoint *cp, void *ptr, uint64_t size) {
+    assert(cp->region_cnt < CHECKPOINT_MAX_REGIONS);
+
+    cp->regions[cp->region_cnt].ptr     = ptr;
+    cp->regions[cp->region_cnt].size    = size;
+    ++cp->region_cnt;
+}
+
+/*
+ * Flush the trace `tf` (may be NULL) to disk and save the state. Compressed
+ * traces must be checkpointed at a multiple of TRACE_BLOCK_SAMPLES samples,
+ * such that all samples of the state are in the trace. Returns 0 on success,
+ * the previous checkpoint is kept otherwise.
+ */
+int save_checkpoint(checkpoint *cp, trace_file *tf) {
+    uint32_t r;
+    int err;
+    checkpoint_header hdr;
+    FILE *fp;
+
+    memset(&hdr, 0, sizeof(checkpoint_header));
+    memcpy(hdr.magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN);
+    hdr.version     = CHECKPOINT_VERSION;
+    hdr.region_cnt  = cp->region_cnt;
+    get_rand_state(hdr.rand_state);
+
+    if (tf) {
+        assert(tf->blk_cnt == 0);
+        if (sync_trace(tf))
+            return 1;
+        hdr.trace_samples = tf->hdr.samples;
+    }
+
+    fp = fopen(cp->tmp_path, "wb");
+    if (!fp)
+        return 1;
+
+    err = fwrite(&hdr, sizeof(checkpoint_header), 1, fp) != 1;
+    for (r = 0; r < cp->region_cnt && !err; ++r) {
+        err = fwrite(&cp->regions[r].size, sizeof(uint64_t), 1, fp) != 1
+              || fwrite(cp->regions[r].ptr, 1, cp->regions[r].size, fp)
+                 != cp->regions[r].size;
+    }
+    err |= fflush(fp) || fsync(fileno(fp));
+    err |= fclose(fp) != 0;
+
+    // The rename replaces the previous checkpoint atomically
+    if (err || rename(cp->tmp_path, cp->path) || sync_checkpoint_dir(cp->path)) {
+        unlink(cp->tmp_path);
+        return 1;
+    }
+
+    cp->trace_samples = hdr.trace_samples;
+
+    return 0;
+}
+
+/*
+ * Restore the state of the checkpoint, if there is one. The regions are only
+ * modified if the checkpoint matches them. Returns 0 if the state was
+ * restored and 1 if there is no (valid) checkpoint.
+ */
+int load_checkpoint(checkpoint *cp) {
+    uint32_t r;
+    uint64_t len, size;
+    uint8_t *buf, *p;
+    checkpoint_header hdr;
+    FILE *fp = fopen(cp->path, "rb");
+    if (!fp)
+        return 1;
+
+    if (fseeko(fp, 0, SEEK_END) || (len = ftello(fp)) < sizeof(checkpoint_header)
+        || fseeko(fp, 0, SEEK_SET))
+    {
+        fclose(fp);
+        return 1;
+    }
+
+    buf = (uint8_t *) malloc(len);
+    assert(buf);
+    if (fread(buf, 1, len, fp) != len) {
+        free(buf);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+
+    memcpy(&hdr, buf, sizeof(checkpoint_header));
+    if (memcmp(hdr.magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN)
+        || hdr.version != CHECKPOINT_VERSION || hdr.region_cnt != cp->region_cnt)
+    {
+        free(buf);
+        return 1;
+    }
+
+    // Check all regions before modifying any
+    p = buf + sizeof(checkpoint_header);
+    for (r = 0; r < cp->region_cnt; ++r) {
+        if ((uint64_t) (buf + len - p) < sizeof(uint64_t))
+            break;
+        memcpy(&size, p, sizeof(uint64_t));
+        if (size != cp->regions[r].size
+            || (uint64_t) (buf + len - p) - sizeof(uint64_t) < size)
+        {
+            break;
+        }
+        p += sizeof(uint64_t) + size;
+    }
+    if (r < cp->region_cnt || p != buf + len) {
+        free(buf);
+        return 1;
+    }
+
+    p = buf + sizeof(checkpoint_header);
+    for (r = 0; r < cp->region_cnt; ++r) {
+        memcpy(cp->regions[r].ptr, p + sizeof(uint64_t), cp->regions[r].size);
+        p += sizeof(uint64_t) + cp->regions[r].size;
+    }
+    set_rand_state(hdr.rand_state);
+    cp->trace_samples = hdr.trace_samples;
+
+    free(buf);
+
+    return 0;
+}
+
+/*
+ * Remove the checkpoint, e.g. after the capture completed. Returns 0 on
+ * success or if there is no checkpoint.
+ */
+int remove_checkpoint(checkpoint *cp) {
+    return unlink(cp->path) && errno != ENOENT;
+}
+
+/*
+ * Flush the directory entry of a renamed file to disk
+ */
+int sync_checkpoint_dir(const char *path) {
+    int fd, err;
+    char *dir_path = strdup(path);
+    assert(dir_path);
+
+    fd = open(dirname(dir_path), O_RDONLY | O_DIRECTORY);
+    free(dir_path);
+    if (fd < 0)
+        return 1;
+
+    err = fsync(fd);
+    close(fd);
+
+    return err != 0;
+}
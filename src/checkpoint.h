@@ -0,0 +1,81 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Checkpoints of long-running captures. The attack registers the memory
+ * regions that make up its state (e.g. the sample index, the position in the
+ * input schedule and accumulators) and saves a checkpoint periodically. A
+ * checkpoint first flushes the trace to disk and then stores the number of
+ * samples in the trace, the state of rand() and the regions in a new file
+ * that atomically replaces the previous checkpoint. After a crash or an
+ * interruption, the attack loads the checkpoint and resumes the trace after
+ * the checkpointed samples (see resume_trace).
+ */
+
+#ifndef HEADER_CHECKPOINT_H
+#define HEADER_CHECKPOINT_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "util.h"
+
+#define CHECKPOINT_MAGIC "CSCCKPT"
+#define CHECKPOINT_MAGIC_LEN 8
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_MAX_REGIONS 32
+
+typedef struct checkpoint_region checkpoint_region;
+typedef struct checkpoint checkpoint;
+
+struct checkpoint_region {
+    void *ptr;
+    uint64_t size;
+};
+
+struct checkpoint {
+    char *path;
+    char *tmp_path;
+    checkpoint_region regions[CHECKPOINT_MAX_REGIONS];
+    uint32_t region_cnt;
+
+    // Samples of the trace at the last saved or loaded checkpoint
+    uint64_t trace_samples;
+};
+
+checkpoint *prepare_checkpoint(const char *path);
+void release_checkpoint(checkpoint *cp);
+void add_checkpoint_region(checkpoint *cp, void *ptr, uint64_t size);
+int save_checkpoint(checkpoint *cp, trace_file *tf);
+int load_checkpoint(checkpoint *cp);
+int remove_checkpoint(checkpoint *cp);
+
+#endif // HEADER_CHECKPOINT_H
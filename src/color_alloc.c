@@ -0,0 +1,344 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the cache set coloring allocator and its page pool.
+ */
+
+#include "color_alloc.h"
+
+// local functions
+color_pool *get_color_pool(cache_ctx *ctx);
+color_page *add_color_page(cache_ctx *ctx, color_pool *pool);
+uint32_t get_page_color_unpriv(cache_ctx *ctx, color_pool *pool, uint8_t *page);
+uint32_t time_cacheset(cacheline *head);
+bool alloc_in_page(cache_ctx *ctx, color_page *cp, uint64_t lines,
+    uint64_t *allowed_sets, uint32_t *line_idx);
+
+
+/*
+ * Returns an empty bitmap with one bit per cache set of the context
+ */
+uint64_t *get_set_bitmap(cache_ctx *ctx) {
+    uint64_t *bitmap = (uint64_t *) calloc(SET_BITMAP_WORDS(ctx->sets),
+                                           sizeof(uint64_t));
+    assert(bitmap);
+
+    return bitmap;
+}
+
+void add_to_set_bitmap(uint64_t *bitmap, uint32_t set) {
+    bitmap[set / 64] |= 1ULL << (set % 64);
+}
+
+bool is_in_set_bitmap(uint64_t *bitmap, uint32_t set) {
+    return (bitmap[set / 64] >> (set % 64)) & 1;
+}
+
+/*
+ * Store the distinct cache sets spanned by a chunk of memory in `sets`
+ * (which must have space for ctx->sets entries).
+ * Returns the number of sets.
+ */
+uint32_t get_spanned_cache_sets(cache_ctx *ctx, void *ptr, uint64_t size,
+    uint32_t *sets)
+{
+    uint32_t set, sets_len = 0;
+    uintptr_t addr  = ((uintptr_t) ptr) & ~((uintptr_t) CACHELINE_SIZE - 1);
+    uintptr_t end   = ((uintptr_t) ptr) + size;
+
+    for (; addr < end; addr += CACHELINE_SIZE) {
+        set = get_cache_set(ctx, (void *) addr);
+        if (!is_in_arr(set, sets, sets_len)) {
+            sets[sets_len] = set;
+            ++sets_len;
+        }
+    }
+
+    return sets_len;
+}
+
+/*
+ * Use the eviction sets of an attack data structure to color pages of
+ * physically indexed caches without privileges. The data structure must stay
+ * allocated as long as the pool is used.
+ */
+void attach_color_pool_ds(cache_ctx *ctx, cacheline *cache_ds) {
+    color_pool *pool    = get_color_pool(ctx);
+    cacheline *curr_cl  = cache_ds;
+
+    if (!pool->set_heads) {
+        pool->set_heads = (cacheline **) calloc(ctx->sets, sizeof(cacheline *));
+        assert(pool->set_heads);
+    }
+
+    do {
+        if (IS_FIRST(curr_cl->flags))
+            pool->set_heads[curr_cl->cache_set] = curr_cl;
+        curr_cl = curr_cl->next;
+    } while (curr_cl != cache_ds);
+}
+
+/*
+ * Allocate `size` bytes (at most a page, aligned to a cache line) such that
+ * every cache line maps to a set in the bitmap `allowed_sets`.
+ * Returns NULL if no such memory was found.
+ */
+void *cachesc_alloc_in_sets(cache_ctx *ctx, uint64_t size, uint64_t *allowed_sets) {
+    color_pool *pool = get_color_pool(ctx);
+    color_page *cp;
+    color_chunk *chunk;
+    uint32_t line_idx, new_pages;
+    uint64_t lines = (size + CACHELINE_SIZE - 1) / CACHELINE_SIZE;
+
+    if (lines == 0 || lines > CACHE_GROUP_SIZE)
+        return NULL;
+
+    // Recycle pool pages first, then grow the pool
+    cp = pool->pages;
+    new_pages = 0;
+    while (1) {
+        if (!cp) {
+            // For virtually indexed caches with at most CACHE_GROUP_SIZE sets
+            // all pages have the same color, so one new page is enough.
+            if (new_pages == COLOR_ALLOC_MAX_NEW_PAGES
+                || (new_pages && ctx->addressing == VIRTUAL
+                    && ctx->sets <= CACHE_GROUP_SIZE))
+            {
+                return NULL;
+            }
+
+            cp = add_color_page(ctx, pool);
+            ++new_pages;
+        }
+
+        if (alloc_in_page(ctx, cp, lines, allowed_sets, &line_idx))
+            break;
+
+        cp = cp->next;
+    }
+
+    chunk = (color_chunk *) malloc(sizeof(color_chunk));
+    assert(chunk);
+
+    chunk->ptr      = cp->page + line_idx * CACHELINE_SIZE;
+    chunk->page     = cp;
+    chunk->lines    = ((lines == 64) ? UINT64_MAX : ((1ULL << lines) - 1)) << line_idx;
+    chunk->next     = pool->chunks;
+    pool->chunks    = chunk;
+
+    cp->free_lines &= ~chunk->lines;
+
+    return chunk->ptr;
+}
+
+/*
+ * Same as cachesc_alloc_in_sets, but all sets except the given ones are allowed.
+ */
+void *cachesc_alloc_avoiding_sets(cache_ctx *ctx, uint64_t size, uint32_t *sets,
+    uint32_t sets_len)
+{
+    uint32_t i;
+    void *ptr;
+    uint64_t *allowed_sets = get_set_bitmap(ctx);
+
+    for (i = 0; i < ctx->sets; ++i) {
+        if (!is_in_arr(i, sets, sets_len))
+            add_to_set_bitmap(allowed_sets, i);
+    }
+
+    ptr = cachesc_alloc_in_sets(ctx, size, allowed_sets);
+
+    free(allowed_sets);
+    return ptr;
+}
+
+/*
+ * Return memory of the coloring allocator to the pool
+ */
+void cachesc_free(cache_ctx *ctx, void *ptr) {
+    color_pool *pool = ctx->color_pool;
+    color_chunk **chunk_ptr, *chunk;
+
+    if (!ptr || !pool)
+        return;
+
+    for (chunk_ptr = &pool->chunks; *chunk_ptr; chunk_ptr = &(*chunk_ptr)->next) {
+        chunk = *chunk_ptr;
+
+        if (chunk->ptr == ptr) {
+            chunk->page->free_lines |= chunk->lines;
+            *chunk_ptr = chunk->next;
+            free(chunk);
+            return;
+        }
+    }
+
+    assert(0 && "pointer was not allocated by the coloring allocator");
+}
+
+/*
+ * Free the pool including all memory that was allocated from it. Called by
+ * release_cache_ctx.
+ */
+void release_color_pool(cache_ctx *ctx) {
+    color_pool *pool = ctx->color_pool;
+    color_page *cp, *next_cp;
+    color_chunk *chunk, *next_chunk;
+
+    if (!pool)
+        return;
+
+    for (cp = pool->pages; cp; cp = next_cp) {
+        next_cp = cp->next;
+        free(cp->page);
+        free(cp);
+    }
+
+    for (chunk = pool->chunks; chunk; chunk = next_chunk) {
+        next_chunk = chunk->next;
+        free(chunk);
+    }
+
+    free(pool->set_heads);
+    free(pool);
+    ctx->color_pool = NULL;
+}
+
+color_pool *get_color_pool(cache_ctx *ctx) {
+    if (!ctx->color_pool) {
+        ctx->color_pool = (color_pool *) calloc(1, sizeof(color_pool));
+        assert(ctx->color_pool);
+    }
+
+    return ctx->color_pool;
+}
+
+/*
+ * Allocate a new page and determine its color
+ */
+color_page *add_color_page(cache_ctx *ctx, color_pool *pool) {
+    color_page *cp = (color_page *) malloc(sizeof(color_page));
+    assert(cp);
+
+    cp->page = (uint8_t *) aligned_alloc(PAGE_SIZE, PAGE_SIZE);
+    assert(cp->page);
+    // Make sure the page is backed by a physical frame
+    memset(cp->page, 0, PAGE_SIZE);
+
+    if (ctx->addressing == VIRTUAL || can_trans_phys_addrs(ctx)) {
+        cp->first_set = get_cache_set(ctx, cp->page);
+    }
+    else {
+        assert(pool->set_heads && "attach_color_pool_ds is required without "
+                                  "privileges");
+        cp->first_set = get_page_color_unpriv(ctx, pool, cp->page);
+    }
+
+    cp->free_lines  = (CACHE_GROUP_SIZE == 64) ? UINT64_MAX
+                                               : (1ULL << CACHE_GROUP_SIZE) - 1;
+    cp->next        = pool->pages;
+    pool->pages     = cp;
+
+    return cp;
+}
+
+/*
+ * Find the cache group of a page by checking which eviction set for the
+ * page's first line slows down most when the line is accessed in between
+ * priming and timing the set.
+ */
+uint32_t get_page_color_unpriv(cache_ctx *ctx, color_pool *pool, uint8_t *page) {
+    uint32_t g, i, set;
+    uint32_t best_group = 0;
+    double delta, best_delta = -1;
+    uint32_t base_time[COLLISION_REP], cand_time[COLLISION_REP];
+    cacheline *head;
+
+    for (g = 0; g < ctx->sets / CACHE_GROUP_SIZE; ++g) {
+        set  = g * CACHE_GROUP_SIZE + get_virt_cache_set(ctx, page) % CACHE_GROUP_SIZE;
+        head = pool->set_heads[set];
+        if (!head)
+            continue;
+
+        for (i = 0; i < COLLISION_REP; ++i) {
+            time_cacheset(head);
+            base_time[i] = time_cacheset(head);
+
+            time_cacheset(head);
+            readq(page);
+            cand_time[i] = time_cacheset(head);
+        }
+
+        delta = get_avg(cand_time, COLLISION_REP) - get_avg(base_time, COLLISION_REP);
+        if (delta > best_delta) {
+            best_delta = delta;
+            best_group = g;
+        }
+    }
+
+    return best_group * CACHE_GROUP_SIZE
+           + get_virt_cache_set(ctx, page) % CACHE_GROUP_SIZE;
+}
+
+/*
+ * Time the traversal of all lines of the set starting at `head`
+ */
+uint32_t time_cacheset(cacheline *head) {
+    uint32_t time;
+    cacheline *curr_cl = head;
+
+    start_timer();
+    while (!IS_LAST(curr_cl->flags)) {
+        curr_cl = curr_cl->next;
+    }
+    stop_timer(&time);
+
+    return time;
+}
+
+/*
+ * Search `lines` consecutive free lines in a page that all map to allowed
+ * sets and store the index of the first one in `line_idx`.
+ */
+bool alloc_in_page(cache_ctx *ctx, color_page *cp, uint64_t lines,
+    uint64_t *allowed_sets, uint32_t *line_idx)
+{
+    uint32_t start, i;
+
+    for (start = 0; start + lines <= CACHE_GROUP_SIZE; ++start) {
+        for (i = start; i < start + lines; ++i) {
+            if (!((cp->free_lines >> i) & 1)
+                || !is_in_set_bitmap(allowed_sets, (cp->first_set + i) % ctx->sets))
+            {
+                break;
+            }
+        }
+
+        if (i == start + lines) {
+            *line_idx = start;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Cache set coloring allocator. It places data (of the victim or attacker
+ * helpers) such that all its cache lines map to allowed cache sets, e.g. to
+ * keep it out of the monitored sets. Memory is taken from a pool of pages
+ * with known colors (i.e. the cache set of their first line) and recycled.
+ * The color of a page is derived from the virtual address, the pagemap
+ * (privileged) or eviction sets of an attached attack data structure
+ * (unprivileged).
+ */
+
+#ifndef HEADER_COLOR_ALLOC_H
+#define HEADER_COLOR_ALLOC_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+// Maximal number of new pages that are tried for a single allocation
+#define COLOR_ALLOC_MAX_NEW_PAGES 64
+
+#define SET_BITMAP_WORDS(sets) (((sets) + 63) / 64)
+
+typedef struct color_page color_page;
+typedef struct color_chunk color_chunk;
+
+// A page of the pool, CACHE_GROUP_SIZE lines whose cache sets are known
+struct color_page {
+    uint8_t *page;
+    uint32_t first_set;
+    // Bit i is set if line i of the page is free
+    uint64_t free_lines;
+    color_page *next;
+};
+
+// An allocation handed out by the pool
+struct color_chunk {
+    void *ptr;
+    color_page *page;
+    uint64_t lines;
+    color_chunk *next;
+};
+
+struct color_pool {
+    color_page *pages;
+    color_chunk *chunks;
+
+    // First line of each set in an attached attack data structure, used as
+    // eviction sets to color pages without privileges.
+    cacheline **set_heads;
+};
+
+uint64_t *get_set_bitmap(cache_ctx *ctx);
+void add_to_set_bitmap(uint64_t *bitmap, uint32_t set);
+bool is_in_set_bitmap(uint64_t *bitmap, uint32_t set);
+uint32_t get_spanned_cache_sets(cache_ctx *ctx, void *ptr, uint64_t size,
+    uint32_t *sets);
+
+void attach_color_pool_ds(cache_ctx *ctx, cacheline *cache_ds);
+void *cachesc_alloc_in_sets(cache_ctx *ctx, uint64_t size, uint64_t *allowed_sets);
+void *cachesc_alloc_avoiding_sets(cache_ctx *ctx, uint64_t size, uint32_t *sets,
+    uint32_t sets_len);
+void cachesc_free(cache_ctx *ctx, void *ptr);
+
+#endif // HEADER_COLOR_ALLOC_H
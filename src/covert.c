@@ -0,0 +1,153 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the payload generation, framing and Hamming(7,4)
+ * error correction of the cache covert channel.
+ */
+
+#include <assert.h>
+
+#include "covert.h"
+
+
+/*
+ * Spread the channels evenly over the cache sets, away from the first sets
+ * which are often used by the stack and globals of the programs themselves.
+ */
+void get_covert_sets(cache_ctx *ctx, uint32_t *sets, uint32_t sets_len) {
+    assert(sets_len > 0 && sets_len <= ctx->sets);
+
+    uint32_t stride = ctx->sets / sets_len;
+
+    for (uint32_t i = 0; i < sets_len; ++i) {
+        sets[i] = i * stride + stride / 2;
+    }
+}
+
+/*
+ * Deterministic pseudo-random payload of a frame of the given channel, such
+ * that the receiver knows what was sent without a second channel.
+ */
+void gen_covert_payload(uint32_t seed, uint64_t frame, uint32_t set_idx,
+    uint8_t *data_bits)
+{
+    // xorshift64, the constants only decorrelate the frames and channels
+    uint64_t state = (seed ^ (frame * 0x9e3779b97f4a7c15ULL)
+                      ^ ((uint64_t) set_idx << 48)) | 1;
+
+    for (uint32_t i = 0; i < COVERT_DATA_BITS; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        data_bits[i] = state & 1;
+    }
+}
+
+/*
+ * Build the symbols of a frame (one bit per byte) from its payload
+ */
+void encode_covert_frame(uint8_t *data_bits, uint8_t *symbols) {
+    uint32_t i, j;
+    uint8_t nibble, codeword;
+
+    for (i = 0; i < COVERT_PREAMBLE_LEN; ++i) {
+        symbols[i] = !(i & 1);
+    }
+
+    for (i = 0; i < COVERT_CODEWORDS; ++i) {
+        nibble = 0;
+        for (j = 0; j < 4; ++j) {
+            nibble |= data_bits[4 * i + j] << j;
+        }
+
+        codeword = hamming74_encode(nibble);
+        for (j = 0; j < 7; ++j) {
+            symbols[COVERT_PREAMBLE_LEN + 7 * i + j] = (codeword >> j) & 1;
+        }
+    }
+}
+
+/*
+ * Recover the payload from the received symbols of a frame.
+ * Returns the number of codewords in which an error was corrected.
+ */
+uint32_t decode_covert_frame(uint8_t *symbols, uint8_t *data_bits) {
+    uint32_t i, j;
+    uint32_t corrections = 0;
+    uint8_t nibble, codeword;
+    bool corrected;
+
+    for (i = 0; i < COVERT_CODEWORDS; ++i) {
+        codeword = 0;
+        for (j = 0; j < 7; ++j) {
+            codeword |= symbols[COVERT_PREAMBLE_LEN + 7 * i + j] << j;
+        }
+
+        nibble = hamming74_decode(codeword, &corrected);
+        corrections += corrected;
+
+        for (j = 0; j < 4; ++j) {
+            data_bits[4 * i + j] = (nibble >> j) & 1;
+        }
+    }
+
+    return corrections;
+}
+
+/*
+ * Hamming(7,4) encoding. Bit i of the codeword is position i + 1 in the
+ * usual layout: p1 p2 d1 p3 d2 d3 d4.
+ */
+uint8_t hamming74_encode(uint8_t nibble) {
+    uint8_t d1 = nibble & 1;
+    uint8_t d2 = (nibble >> 1) & 1;
+    uint8_t d3 = (nibble >> 2) & 1;
+    uint8_t d4 = (nibble >> 3) & 1;
+
+    uint8_t p1 = d1 ^ d2 ^ d4;
+    uint8_t p2 = d1 ^ d3 ^ d4;
+    uint8_t p3 = d2 ^ d3 ^ d4;
+
+    return p1 | (p2 << 1) | (d1 << 2) | (p3 << 3) | (d2 << 4) | (d3 << 5)
+           | (d4 << 6);
+}
+
+/*
+ * Hamming(7,4) decoding, corrects up to one flipped bit per codeword.
+ */
+uint8_t hamming74_decode(uint8_t codeword, bool *corrected) {
+    uint8_t syndrome = 0;
+
+    // The syndrome is the position of the flipped bit (or 0)
+    for (uint8_t pos = 1; pos <= 7; ++pos) {
+        if ((codeword >> (pos - 1)) & 1)
+            syndrome ^= pos;
+    }
+
+    *corrected = syndrome != 0;
+    if (syndrome)
+        codeword ^= 1 << (syndrome - 1);
+
+    return ((codeword >> 2) & 1) | (((codeword >> 4) & 1) << 1)
+           | (((codeword >> 5) & 1) << 2) | (((codeword >> 6) & 1) << 3);
+}
@@ -0,0 +1,505 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the multithreaded correlation analysis engine.
+ */
+
+#include "cpa.h"
+
+#include <unistd.h>
+
+typedef struct cpa_rank_entry cpa_rank_entry;
+
+struct cpa_rank_entry {
+    double score;
+    uint32_t hyp;
+};
+
+// local functions
+void *cpa_worker_loop(void *arg);
+void process_cpa_chunk_part(cpa_worker *w);
+void compute_cpa_model(cpa_worker *w);
+void accumulate_cpa_tiles(cpa_worker *w);
+void process_cpa_chunk(cpa_engine *cpa);
+void partition_cpa_work(cpa_engine *cpa);
+int cmp_cpa_rank_entries(const void *a, const void *b);
+
+
+/*
+ * Prepare a correlation analysis of `hyps` hypotheses against `sets` probe
+ * times per sample. `thread_cnt` is the number of threads including the
+ * caller, 0 uses all online CPUs.
+ */
+cpa_engine *prepare_cpa(uint32_t hyps, uint32_t sets, uint32_t input_len,
+    cpa_model model, void *model_arg, uint32_t thread_cnt)
+{
+    int err;
+    uint32_t t;
+    cpa_engine *cpa = (cpa_engine *) calloc(1, sizeof(cpa_engine));
+    assert(cpa);
+    assert(hyps > 0 && sets > 0);
+
+    if (thread_cnt == 0)
+        thread_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+
+    cpa->hyps       = hyps;
+    cpa->sets       = sets;
+    cpa->sets_pad   = (sets + CPA_VEC_LEN - 1) / CPA_VEC_LEN * CPA_VEC_LEN;
+    cpa->input_len  = input_len;
+    cpa->model      = model;
+    cpa->model_arg  = model_arg;
+    cpa->thread_cnt = thread_cnt;
+
+    cpa->inputs = (uint8_t *) malloc(CPA_CHUNK_SAMPLES * input_len + 1);
+    cpa->raw    = (time_type *) malloc(CPA_CHUNK_SAMPLES * sets * sizeof(time_type));
+    cpa->y      = (float *) aligned_alloc(sizeof(cpa_vec),
+                      CPA_CHUNK_SAMPLES * cpa->sets_pad * sizeof(float));
+    cpa->x      = (float *) malloc(hyps * CPA_CHUNK_SAMPLES * sizeof(float));
+    assert(cpa->inputs && cpa->raw && cpa->y && cpa->x);
+    // Padding sets stay zero
+    memset(cpa->y, 0, CPA_CHUNK_SAMPLES * cpa->sets_pad * sizeof(float));
+
+    cpa->ref_x  = (double *) calloc(hyps, sizeof(double));
+    cpa->ref_y  = (double *) calloc(sets, sizeof(double));
+    cpa->sum_x  = (double *) calloc(hyps, sizeof(double));
+    cpa->sum_xx = (double *) calloc(hyps, sizeof(double));
+    cpa->sum_y  = (double *) calloc(sets, sizeof(double));
+    cpa->sum_yy = (double *) calloc(sets, sizeof(double));
+    cpa->sum_xy = (double *) calloc((uint64_t) hyps * cpa->sets_pad, sizeof(double));
+    assert(cpa->ref_x && cpa->ref_y && cpa->sum_x && cpa->sum_xx && cpa->sum_y
+           && cpa->sum_yy && cpa->sum_xy);
+
+    cpa->workers = (cpa_worker *) calloc(thread_cnt, sizeof(cpa_worker));
+    assert(cpa->workers);
+    partition_cpa_work(cpa);
+
+    err = pthread_barrier_init(&cpa->start, NULL, thread_cnt)
+          || pthread_barrier_init(&cpa->model_done, NULL, thread_cnt)
+          || pthread_barrier_init(&cpa->done, NULL, thread_cnt);
+    assert(!err);
+
+    // The caller acts as worker 0
+    for (t = 1; t < thread_cnt; ++t) {
+        err = pthread_create(&cpa->workers[t].thread, NULL, cpa_worker_loop,
+                             &cpa->workers[t]);
+        assert(!err);
+    }
+
+    return cpa;
+}
+
+void release_cpa(cpa_engine *cpa) {
+    uint32_t t;
+
+    cpa->stop = true;
+    pthread_barrier_wait(&cpa->start);
+    for (t = 1; t < cpa->thread_cnt; ++t)
+        pthread_join(cpa->workers[t].thread, NULL);
+
+    pthread_barrier_destroy(&cpa->start);
+    pthread_barrier_destroy(&cpa->model_done);
+    pthread_barrier_destroy(&cpa->done);
+
+    free(cpa->workers);
+    free(cpa->inputs);
+    free(cpa->raw);
+    free(cpa->y);
+    free(cpa->x);
+    free(cpa->ref_x);
+    free(cpa->ref_y);
+    free(cpa->sum_x);
+    free(cpa->sum_xx);
+    free(cpa->sum_y);
+    free(cpa->sum_yy);
+    free(cpa->sum_xy);
+    free(cpa);
+}
+
+/*
+ * Add `cnt` samples, each with `input_len` bytes of input and `sets` probe
+ * times.
+ */
+void update_cpa(cpa_engine *cpa, const uint8_t *inputs, const time_type *res,
+    uint32_t cnt)
+{
+    uint32_t n;
+
+    while (cnt > 0) {
+        n = CPA_CHUNK_SAMPLES - cpa->chunk_len;
+        if (n > cnt)
+            n = cnt;
+
+        memcpy(cpa->inputs + cpa->chunk_len * cpa->input_len, inputs,
+               n * cpa->input_len);
+        memcpy(cpa->raw + cpa->chunk_len * cpa->sets, res,
+               n * cpa->sets * sizeof(time_type));
+
+        cpa->chunk_len += n;
+        inputs  += n * cpa->input_len;
+        res     += n * cpa->sets;
+        cnt     -= n;
+
+        if (cpa->chunk_len == CPA_CHUNK_SAMPLES)
+            process_cpa_chunk(cpa);
+    }
+}
+
+/*
+ * Stream all samples of a trace file into the analysis.
+ * Returns 1 if the trace cannot be read or does not match the engine.
+ */
+int update_cpa_from_trace(cpa_engine *cpa, const char *path) {
+    uint32_t cnt;
+    uint8_t *inputs;
+    time_type *res;
+    trace_file *tf = open_trace(path);
+
+    if (!tf)
+        return 1;
+
+    if (tf->hdr.msrmts_per_sample != cpa->sets
+        || tf->hdr.input_len != cpa->input_len)
+    {
+        close_trace(tf);
+        return 1;
+    }
+
+    inputs  = (uint8_t *) malloc(CPA_CHUNK_SAMPLES * cpa->input_len + 1);
+    res     = (time_type *) malloc(CPA_CHUNK_SAMPLES * cpa->sets * sizeof(time_type));
+    assert(inputs && res);
+
+    while ((cnt = read_trace_samples(tf, inputs, res, CPA_CHUNK_SAMPLES)) > 0)
+        update_cpa(cpa, inputs, res, cnt);
+
+    free(inputs);
+    free(res);
+
+    return close_trace(tf);
+}
+
+/*
+ * Store the correlation of every hypothesis with every set in `corr`
+ * (hyps x sets). Uncorrelated or constant data yields 0.
+ */
+void get_cpa_correlations(cpa_engine *cpa, double *corr) {
+    uint32_t h, s;
+    double n, var_x, var_y, cov;
+
+    if (cpa->chunk_len > 0)
+        process_cpa_chunk(cpa);
+
+    n = (double) cpa->samples;
+    for (h = 0; h < cpa->hyps; ++h) {
+        var_x = cpa->sum_xx[h] - cpa->sum_x[h] * cpa->sum_x[h] / n;
+
+        for (s = 0; s < cpa->sets; ++s) {
+            var_y   = cpa->sum_yy[s] - cpa->sum_y[s] * cpa->sum_y[s] / n;
+            cov     = cpa->sum_xy[(uint64_t) h * cpa->sets_pad + s]
+                      - cpa->sum_x[h] * cpa->sum_y[s] / n;
+
+            if (n < 2 || var_x <= 0 || var_y <= 0)
+                corr[(uint64_t) h * cpa->sets + s] = 0;
+            else
+                corr[(uint64_t) h * cpa->sets + s] = cov / sqrt(var_x * var_y);
+        }
+    }
+}
+
+/*
+ * Rank the hypotheses by their highest absolute correlation over the given
+ * sets (all sets if `sets` is NULL). Models that predict accesses to a
+ * specific line should be ranked on the set of that line, since every
+ * hypothesis predicts the accesses of some line.
+ * `ranking` receives the hypotheses from best to worst; `scores` and
+ * `peak_sets` (both optional) the score and the set with the highest
+ * correlation per hypothesis.
+ */
+void rank_cpa_hypotheses(cpa_engine *cpa, const uint32_t *sets, uint32_t sets_len,
+    uint32_t *ranking, double *scores, uint32_t *peak_sets)
+{
+    uint32_t h, i, s, peak;
+    double best, c;
+    double *corr = (double *) malloc((uint64_t) cpa->hyps * cpa->sets * sizeof(double));
+    cpa_rank_entry *entries = (cpa_rank_entry *) malloc(cpa->hyps * sizeof(cpa_rank_entry));
+    assert(corr && entries);
+
+    get_cpa_correlations(cpa, corr);
+
+    for (h = 0; h < cpa->hyps; ++h) {
+        best = -1;
+        peak = 0;
+        for (i = 0; i < (sets ? sets_len : cpa->sets); ++i) {
+            s = sets ? sets[i] : i;
+            assert(s < cpa->sets);
+
+            c = fabs(corr[(uint64_t) h * cpa->sets + s]);
+            if (c > best) {
+                best = c;
+                peak = s;
+            }
+        }
+
+        entries[h].score = best;
+        entries[h].hyp   = h;
+        if (scores)
+            scores[h] = best;
+        if (peak_sets)
+            peak_sets[h] = peak;
+    }
+
+    qsort(entries, cpa->hyps, sizeof(cpa_rank_entry), cmp_cpa_rank_entries);
+    for (h = 0; h < cpa->hyps; ++h)
+        ranking[h] = entries[h].hyp;
+
+    free(entries);
+    free(corr);
+}
+
+/*
+ * Hamming weight of input[byte] ^ hyp
+ */
+void cpa_model_xor_hw(const uint8_t *inputs, uint32_t cnt, uint32_t input_len,
+    uint32_t hyp, float *out, void *arg)
+{
+    uint32_t n;
+    cpa_byte_model *m = (cpa_byte_model *) arg;
+
+    for (n = 0; n < cnt; ++n)
+        out[n] = __builtin_popcount((inputs[n * input_len + m->byte] ^ hyp) & 0xff);
+}
+
+/*
+ * 1 if input[byte] ^ hyp indexes an entry of the target table line, else 0
+ */
+void cpa_model_xor_line(const uint8_t *inputs, uint32_t cnt, uint32_t input_len,
+    uint32_t hyp, float *out, void *arg)
+{
+    uint32_t n;
+    cpa_byte_model *m = (cpa_byte_model *) arg;
+
+    for (n = 0; n < cnt; ++n) {
+        out[n] = ((inputs[n * input_len + m->byte] ^ hyp) & 0xff)
+                 / m->entries_per_line == m->line;
+    }
+}
+
+void *cpa_worker_loop(void *arg) {
+    cpa_worker *w = (cpa_worker *) arg;
+
+    while (1) {
+        pthread_barrier_wait(&w->cpa->start);
+        if (w->cpa->stop)
+            break;
+
+        process_cpa_chunk_part(w);
+    }
+
+    return NULL;
+}
+
+/*
+ * Process the current chunk with all threads, then add it to the sums of
+ * the measurements
+ */
+void process_cpa_chunk(cpa_engine *cpa) {
+    uint32_t n, s;
+    double v;
+
+    if (!cpa->has_ref) {
+        for (n = 0; n < cpa->chunk_len; ++n) {
+            for (s = 0; s < cpa->sets; ++s)
+                cpa->ref_y[s] += cpa->raw[n * cpa->sets + s];
+        }
+        for (s = 0; s < cpa->sets; ++s)
+            cpa->ref_y[s] /= cpa->chunk_len;
+    }
+
+    for (n = 0; n < cpa->chunk_len; ++n) {
+        for (s = 0; s < cpa->sets; ++s) {
+            v = cpa->raw[n * cpa->sets + s] - cpa->ref_y[s];
+            cpa->y[n * cpa->sets_pad + s] = v;
+            cpa->sum_y[s]  += v;
+            cpa->sum_yy[s] += v * v;
+        }
+    }
+
+    // Padding samples of a partial chunk do not contribute
+    memset(cpa->y + cpa->chunk_len * cpa->sets_pad, 0,
+           (CPA_CHUNK_SAMPLES - cpa->chunk_len) * cpa->sets_pad * sizeof(float));
+
+    pthread_barrier_wait(&cpa->start);
+    process_cpa_chunk_part(&cpa->workers[0]);
+
+    cpa->has_ref    = true;
+    cpa->samples   += cpa->chunk_len;
+    cpa->chunk_len  = 0;
+}
+
+void process_cpa_chunk_part(cpa_worker *w) {
+    compute_cpa_model(w);
+    pthread_barrier_wait(&w->cpa->model_done);
+
+    accumulate_cpa_tiles(w);
+    pthread_barrier_wait(&w->cpa->done);
+}
+
+/*
+ * Evaluate the model of the worker's hypotheses for the chunk, centre the
+ * values and add them to the sums of the model values
+ */
+void compute_cpa_model(cpa_worker *w) {
+    uint32_t h, n;
+    float *x;
+    double sum, v;
+    cpa_engine *cpa = w->cpa;
+
+    for (h = w->model_start; h < w->model_end; ++h) {
+        x = cpa->x + h * CPA_CHUNK_SAMPLES;
+        cpa->model(cpa->inputs, cpa->chunk_len, cpa->input_len, h, x,
+                   cpa->model_arg);
+
+        if (!cpa->has_ref) {
+            sum = 0;
+            for (n = 0; n < cpa->chunk_len; ++n)
+                sum += x[n];
+            cpa->ref_x[h] = sum / cpa->chunk_len;
+        }
+
+        for (n = 0; n < cpa->chunk_len; ++n) {
+            v = x[n] - cpa->ref_x[h];
+            x[n] = v;
+            cpa->sum_x[h]  += v;
+            cpa->sum_xx[h] += v * v;
+        }
+    }
+}
+
+/*
+ * Accumulate the products of model values and measurements of the worker's
+ * hypotheses and sets. For every tile of sets, the measurements of the chunk
+ * are reused for all hypotheses and the partial sums of full tiles are kept
+ * in vector registers.
+ */
+void accumulate_cpa_tiles(cpa_worker *w) {
+    uint32_t v0, v1, h, n, j, l;
+    float *x;
+    double *sum_xy;
+    cpa_vec xn, *y_n;
+    cpa_vec acc[CPA_TILE_VECS];
+    cpa_engine *cpa = w->cpa;
+    cpa_vec *y      = (cpa_vec *) cpa->y;
+    uint32_t vecs   = cpa->sets_pad / CPA_VEC_LEN;
+
+    for (v0 = w->vec_start; v0 < w->vec_end; v0 += CPA_TILE_VECS) {
+        v1 = (v0 + CPA_TILE_VECS < w->vec_end) ? v0 + CPA_TILE_VECS : w->vec_end;
+
+        for (h = w->hyp_start; h < w->hyp_end; ++h) {
+            x = cpa->x + h * CPA_CHUNK_SAMPLES;
+
+            if (v1 - v0 == CPA_TILE_VECS) {
+                cpa_vec a0 = {0}, a1 = {0}, a2 = {0}, a3 = {0};
+                cpa_vec a4 = {0}, a5 = {0}, a6 = {0}, a7 = {0};
+
+                for (n = 0; n < cpa->chunk_len; ++n) {
+                    xn  = (cpa_vec) {0} + x[n];
+                    y_n = y + n * vecs + v0;
+                    a0 += xn * y_n[0];
+                    a1 += xn * y_n[1];
+                    a2 += xn * y_n[2];
+                    a3 += xn * y_n[3];
+                    a4 += xn * y_n[4];
+                    a5 += xn * y_n[5];
+                    a6 += xn * y_n[6];
+                    a7 += xn * y_n[7];
+                }
+
+                acc[0] = a0;
+                acc[1] = a1;
+                acc[2] = a2;
+                acc[3] = a3;
+                acc[4] = a4;
+                acc[5] = a5;
+                acc[6] = a6;
+                acc[7] = a7;
+            }
+            else {
+                memset(acc, 0, sizeof(acc));
+                for (n = 0; n < cpa->chunk_len; ++n) {
+                    xn = (cpa_vec) {0} + x[n];
+                    for (j = 0; j < v1 - v0; ++j)
+                        acc[j] += xn * y[n * vecs + v0 + j];
+                }
+            }
+
+            sum_xy = cpa->sum_xy + (uint64_t) h * cpa->sets_pad;
+            for (j = 0; j < v1 - v0; ++j) {
+                for (l = 0; l < CPA_VEC_LEN; ++l)
+                    sum_xy[(v0 + j) * CPA_VEC_LEN + l] += acc[j][l];
+            }
+        }
+    }
+}
+
+/*
+ * Split the model evaluation by hypotheses and the accumulation into a grid
+ * of hypothesis and set ranges, one cell per thread
+ */
+void partition_cpa_work(cpa_engine *cpa) {
+    uint32_t t, h_part, s_part, h_parts, s_parts;
+    cpa_worker *w;
+    uint32_t vecs = cpa->sets_pad / CPA_VEC_LEN;
+
+    h_parts = (cpa->hyps < cpa->thread_cnt) ? cpa->hyps : cpa->thread_cnt;
+    s_parts = cpa->thread_cnt / h_parts;
+    if (s_parts > vecs)
+        s_parts = vecs;
+
+    for (t = 0; t < cpa->thread_cnt; ++t) {
+        w = &cpa->workers[t];
+        w->cpa = cpa;
+
+        w->model_start  = (uint64_t) cpa->hyps * t / cpa->thread_cnt;
+        w->model_end    = (uint64_t) cpa->hyps * (t + 1) / cpa->thread_cnt;
+
+        h_part = t % h_parts;
+        s_part = t / h_parts;
+        if (s_part >= s_parts)
+            continue;
+
+        w->hyp_start    = (uint64_t) cpa->hyps * h_part / h_parts;
+        w->hyp_end      = (uint64_t) cpa->hyps * (h_part + 1) / h_parts;
+        w->vec_start    = vecs * s_part / s_parts;
+        w->vec_end      = vecs * (s_part + 1) / s_parts;
+    }
+}
+
+int cmp_cpa_rank_entries(const void *a, const void *b) {
+    double sa = ((const cpa_rank_entry *) a)->score;
+    double sb = ((const cpa_rank_entry *) b)->score;
+
+    if (sa != sb)
+        return (sa < sb) ? 1 : -1;
+
+    return (int) ((const cpa_rank_entry *) a)->hyp
+           - (int) ((const cpa_rank_entry *) b)->hyp;
+}
@@ -0,0 +1,150 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Generic correlation analysis (CPA) on cache traces. For every hypothesis
+ * (e.g. a key byte), a leakage model predicts a value per sample and the
+ * engine computes the Pearson correlation between the prediction and the
+ * probe time of every set over all samples. Samples are processed in chunks
+ * that fit the cache: the measurements are converted to centred floats, the
+ * model is evaluated per hypothesis for the whole chunk and the sufficient
+ * statistics are accumulated with SIMD vectors. A pool of threads splits the
+ * work by hypotheses and, if there are fewer hypotheses than threads, by sets.
+ */
+
+#ifndef HEADER_CPA_H
+#define HEADER_CPA_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "trace.h"
+
+// Samples per chunk, such that the measurements of a tile of sets stay in
+// the cache while all hypotheses are processed
+#define CPA_CHUNK_SAMPLES 256
+// Floats per SIMD vector (SSE, available on every x86-64 CPU)
+#define CPA_VEC_LEN 4
+// Vectors of sets that are accumulated in registers at once (the full tile
+// path of accumulate_cpa_tiles is unrolled for 8)
+#define CPA_TILE_VECS 8
+
+typedef float cpa_vec __attribute__ ((vector_size (CPA_VEC_LEN * sizeof(float))));
+
+/*
+ * Leakage model: store the predicted leakage of hypothesis `hyp` for `cnt`
+ * samples with `input_len` bytes of input each in `out`. It is called from
+ * several threads at once.
+ */
+typedef void (*cpa_model)(const uint8_t *inputs, uint32_t cnt, uint32_t input_len,
+    uint32_t hyp, float *out, void *arg);
+
+typedef struct cpa_byte_model cpa_byte_model;
+typedef struct cpa_worker cpa_worker;
+typedef struct cpa_engine cpa_engine;
+
+// Argument of the built-in models for a single input byte xored with the
+// hypothesis, e.g. a first-round AES table index
+struct cpa_byte_model {
+    uint32_t byte;
+    // For cpa_model_xor_line: table entries per cache line and target line
+    uint32_t entries_per_line;
+    uint32_t line;
+};
+
+struct cpa_worker {
+    cpa_engine *cpa;
+    pthread_t thread;
+
+    // Hypotheses whose model values this worker computes
+    uint32_t model_start, model_end;
+    // Hypotheses and set vectors whose statistics this worker accumulates
+    uint32_t hyp_start, hyp_end;
+    uint32_t vec_start, vec_end;
+};
+
+struct cpa_engine {
+    uint32_t hyps;
+    uint32_t sets;
+    // Sets rounded up to full vectors
+    uint32_t sets_pad;
+    uint32_t input_len;
+
+    cpa_model model;
+    void *model_arg;
+
+    uint64_t samples;
+
+    // Current chunk: raw inputs and measurements, centred measurements
+    // (CPA_CHUNK_SAMPLES x sets_pad) and model values (hyps x
+    // CPA_CHUNK_SAMPLES)
+    uint32_t chunk_len;
+    uint8_t *inputs;
+    time_type *raw;
+    float *y;
+    float *x;
+
+    // All sums are over centred values, the references are the means of the
+    // first chunk
+    bool has_ref;
+    double *ref_x;
+    double *ref_y;
+    double *sum_x;
+    double *sum_xx;
+    double *sum_y;
+    double *sum_yy;
+    double *sum_xy;
+
+    uint32_t thread_cnt;
+    cpa_worker *workers;
+    pthread_barrier_t start;
+    pthread_barrier_t model_done;
+    pthread_barrier_t done;
+    bool stop;
+};
+
+cpa_engine *prepare_cpa(uint32_t hyps, uint32_t sets, uint32_t input_len,
+    cpa_model model, void *model_arg, uint32_t thread_cnt);
+void release_cpa(cpa_engine *cpa);
+void update_cpa(cpa_engine *cpa, const uint8_t *inputs, const time_type *res,
+    uint32_t cnt);
+int update_cpa_from_trace(cpa_engine *cpa, const char *path);
+void get_cpa_correlations(cpa_engine *cpa, double *corr);
+void rank_cpa_hypotheses(cpa_engine *cpa, const uint32_t *sets, uint32_t sets_len,
+    uint32_t *ranking, double *scores, uint32_t *peak_sets);
+
+void cpa_model_xor_hw(const uint8_t *inputs, uint32_t cnt, uint32_t input_len,
+    uint32_t hyp, float *out, void *arg);
+void cpa_model_xor_line(const uint8_t *inputs, uint32_t cnt, uint32_t input_len,
+    uint32_t hyp, float *out, void *arg);
+
+#endif // HEADER_CPA_H
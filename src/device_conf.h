@@ -40,15 +40,21 @@
 // Addressing:
 // - virtual:   0
 // - physical:  1
+//
+// Probe kernel (see gen_cache_asm_files.py and cachesc-probe-kernels):
+// - fully unrolled:            0
+// - loop with n loads per set: n
 #define L1_ADDRESSING 0
 #define L1_SETS 64
 #define L1_ASSOCIATIVITY 8
 #define L1_ACCESS_TIME 4
+#define L1_PROBE_UNROLL 0
 
 #define L2_ADDRESSING 1
 #define L2_SETS 512
 #define L2_ASSOCIATIVITY 8
 #define L2_ACCESS_TIME 12
+#define L2_PROBE_UNROLL 0
 
 #define L3_ADDRESSING 1
 #define L3_SETS 4096
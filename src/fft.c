@@ -0,0 +1,372 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the radix-2 FFT, trace alignment and periodicity
+ * detection.
+ */
+
+#include "fft.h"
+
+#include <math.h>
+#include <string.h>
+
+// local functions
+void correlate_fft_traces(fft_aligner *a, const float *t1, const float *t2,
+    int32_t *shifts, float *corrs);
+double center_trace(const float *trace, uint32_t len, double *norm);
+
+
+/*
+ * Returns the smallest power of two that is at least `min_len`
+ */
+uint32_t get_fft_len(uint32_t min_len) {
+    uint32_t len = 1;
+
+    while (len < min_len)
+        len <<= 1;
+
+    return len;
+}
+
+fft_plan *prepare_fft(uint32_t len) {
+    uint32_t i, b;
+    fft_plan *plan;
+
+    assert(len >= 2 && (len & (len - 1)) == 0);
+
+    plan = (fft_plan *) malloc(sizeof(fft_plan));
+    assert(plan);
+
+    plan->len       = len;
+    plan->log_len   = 0;
+    while ((1U << plan->log_len) < len)
+        ++plan->log_len;
+
+    plan->bitrev    = (uint32_t *) malloc(len * sizeof(uint32_t));
+    plan->twiddle   = (double complex *) malloc(len / 2 * sizeof(double complex));
+    plan->buf       = (double complex *) malloc(len * sizeof(double complex));
+    assert(plan->bitrev && plan->twiddle && plan->buf);
+
+    for (i = 0; i < len; ++i) {
+        plan->bitrev[i] = 0;
+        for (b = 0; b < plan->log_len; ++b)
+            plan->bitrev[i] |= ((i >> b) & 1) << (plan->log_len - 1 - b);
+    }
+
+    for (i = 0; i < len / 2; ++i)
+        plan->twiddle[i] = cexp(-2 * M_PI * I * i / len);
+
+    return plan;
+}
+
+void release_fft(fft_plan *plan) {
+    free(plan->bitrev);
+    free(plan->twiddle);
+    free(plan->buf);
+    free(plan);
+}
+
+/*
+ * In-place iterative radix-2 FFT of plan->len entries. The inverse
+ * transform is scaled by 1 / len.
+ */
+void run_fft(fft_plan *plan, double complex *data, bool inverse) {
+    uint32_t i, j, k, half, step;
+    double complex tmp, w;
+    uint32_t len = plan->len;
+
+    for (i = 0; i < len; ++i) {
+        j = plan->bitrev[i];
+        if (i < j) {
+            tmp     = data[i];
+            data[i] = data[j];
+            data[j] = tmp;
+        }
+    }
+
+    for (half = 1, step = len / 2; half < len; half <<= 1, step >>= 1) {
+        for (i = 0; i < len; i += 2 * half) {
+            for (k = 0; k < half; ++k) {
+                w = plan->twiddle[k * step];
+                if (inverse)
+                    w = conj(w);
+
+                tmp                 = data[i + k + half] * w;
+                data[i + k + half]  = data[i + k] - tmp;
+                data[i + k]        += tmp;
+            }
+        }
+    }
+
+    if (inverse) {
+        for (i = 0; i < len; ++i)
+            data[i] /= len;
+    }
+}
+
+/*
+ * Prepare the alignment of traces of `len` samples to the reference `ref`,
+ * searching shifts of up to `max_shift` samples in both directions.
+ * Returns NULL if the traces are empty or not longer than `max_shift`.
+ */
+fft_aligner *prepare_fft_aligner(const float *ref, uint32_t len,
+    uint32_t max_shift)
+{
+    uint32_t i;
+    double mean;
+    fft_aligner *a;
+
+    if (len == 0 || max_shift >= len)
+        return NULL;
+
+    a = (fft_aligner *) malloc(sizeof(fft_aligner));
+    assert(a);
+
+    a->len          = len;
+    a->max_shift    = max_shift;
+    a->plan         = prepare_fft(get_fft_len(2 * len));
+    a->ref_spec     = (double complex *) calloc(a->plan->len, sizeof(double complex));
+    a->buf          = (double complex *) malloc(a->plan->len * sizeof(double complex));
+    assert(a->ref_spec && a->buf);
+
+    mean = center_trace(ref, len, &a->ref_norm);
+    for (i = 0; i < len; ++i)
+        a->ref_spec[i] = ref[i] - mean;
+
+    run_fft(a->plan, a->ref_spec, false);
+    for (i = 0; i < a->plan->len; ++i)
+        a->ref_spec[i] = conj(a->ref_spec[i]);
+
+    return a;
+}
+
+void release_fft_aligner(fft_aligner *a) {
+    release_fft(a->plan);
+    free(a->ref_spec);
+    free(a->buf);
+    free(a);
+}
+
+/*
+ * Returns the shift s that maximises the cross-correlation
+ * sum_i ref[i] * trace[i + s], i.e. the trace is aligned to the reference by
+ * moving it s samples to the left. The normalised correlation at the peak
+ * is stored in `corr` (if not NULL).
+ */
+int32_t get_fft_shift(fft_aligner *a, const float *trace, float *corr) {
+    int32_t shift;
+    float peak;
+
+    correlate_fft_traces(a, trace, NULL, &shift, &peak);
+    if (corr)
+        *corr = peak;
+
+    return shift;
+}
+
+/*
+ * Align `cnt` consecutive traces of a->len samples. The shifts and
+ * correlations are stored per trace (`corrs` may be NULL), the aligned
+ * traces in `aligned` (may be NULL to only get the shifts).
+ */
+void align_fft_traces(fft_aligner *a, const float *traces, uint32_t cnt,
+    float *aligned, int32_t *shifts, float *corrs)
+{
+    uint32_t i;
+    float peaks[2];
+
+    for (i = 0; i < cnt; i += 2) {
+        correlate_fft_traces(a, traces + (uint64_t) i * a->len,
+                             (i + 1 < cnt) ? traces + (uint64_t) (i + 1) * a->len
+                                           : NULL,
+                             shifts + i, peaks);
+        if (corrs) {
+            corrs[i] = peaks[0];
+            if (i + 1 < cnt)
+                corrs[i + 1] = peaks[1];
+        }
+    }
+
+    if (!aligned)
+        return;
+
+    for (i = 0; i < cnt; ++i) {
+        shift_fft_trace(traces + (uint64_t) i * a->len, a->len, shifts[i],
+                        aligned + (uint64_t) i * a->len);
+    }
+}
+
+/*
+ * out[i] = trace[i + shift], samples outside of the trace are replaced by
+ * its mean
+ */
+void shift_fft_trace(const float *trace, uint32_t len, int32_t shift,
+    float *out)
+{
+    uint32_t i;
+    int64_t src;
+    double norm;
+    float mean = center_trace(trace, len, &norm);
+
+    for (i = 0; i < len; ++i) {
+        src     = (int64_t) i + shift;
+        out[i]  = (src >= 0 && src < len) ? trace[src] : mean;
+    }
+}
+
+/*
+ * Add the power spectrum of the centred, Hann windowed signal to `power`
+ * (plan->len / 2 + 1 bins), e.g. to accumulate the spectra of several sets
+ * or traces. The signal is zero padded to plan->len >= len samples.
+ */
+void get_fft_power_spectrum(fft_plan *plan, const float *signal, uint32_t len,
+    double *power)
+{
+    uint32_t i;
+    double norm, window;
+    double mean = center_trace(signal, len, &norm);
+
+    assert(len <= plan->len);
+
+    for (i = 0; i < len; ++i) {
+        window          = (len > 1) ? 0.5 * (1 - cos(2 * M_PI * i / (len - 1))) : 1;
+        plan->buf[i]    = (signal[i] - mean) * window;
+    }
+    for (; i < plan->len; ++i)
+        plan->buf[i] = 0;
+
+    run_fft(plan, plan->buf, false);
+
+    for (i = 0; i <= plan->len / 2; ++i)
+        power[i] += creal(plan->buf[i]) * creal(plan->buf[i])
+                    + cimag(plan->buf[i]) * cimag(plan->buf[i]);
+}
+
+/*
+ * Store the periods (in samples, at least FFT_MIN_PERIOD) of the
+ * `max_periods` strongest peaks of a power spectrum of an FFT with `fft_len`
+ * entries, strongest first, and their share of the total power.
+ * Returns the number of periods found, 0 if `max_periods` is 0.
+ */
+uint32_t find_fft_periods(const double *power, uint32_t fft_len,
+    uint32_t max_periods, double *periods, double *strengths)
+{
+    uint32_t k, j, cnt = 0;
+    double total = 0, denom, delta, strength;
+
+    if (max_periods == 0)
+        return 0;
+
+    for (k = 1; k <= fft_len / 2; ++k)
+        total += power[k];
+    if (total == 0)
+        return 0;
+
+    for (k = 1; k < fft_len / 2; ++k) {
+        if (power[k] <= power[k - 1] || power[k] < power[k + 1]
+            || fft_len < FFT_MIN_PERIOD * k)
+        {
+            continue;
+        }
+
+        strength = power[k] / total;
+        if (cnt == max_periods && strength <= strengths[cnt - 1])
+            continue;
+
+        denom = power[k - 1] - 2 * power[k] + power[k + 1];
+        delta = (denom != 0) ? 0.5 * (power[k - 1] - power[k + 1]) / denom : 0;
+
+        j = (cnt < max_periods) ? cnt++ : cnt - 1;
+        for (; j > 0 && strength > strengths[j - 1]; --j) {
+            periods[j]      = periods[j - 1];
+            strengths[j]    = strengths[j - 1];
+        }
+        periods[j]      = fft_len / (k + delta);
+        strengths[j]    = strength;
+    }
+
+    return cnt;
+}
+
+/*
+ * Cross-correlate one or two traces (t2 may be NULL) with the reference.
+ * Both real traces are packed into one complex signal z = t1 + i t2; as the
+ * correlations are real, the inverse transform of Z * conj(R) holds the
+ * correlation of t1 in its real and the one of t2 in its imaginary part.
+ */
+void correlate_fft_traces(fft_aligner *a, const float *t1, const float *t2,
+    int32_t *shifts, float *corrs)
+{
+    uint32_t i, t, cnt = t2 ? 2 : 1;
+    int32_t s;
+    double c, best[2], norm[2], mean[2];
+    uint32_t fft_len = a->plan->len;
+
+    mean[0] = center_trace(t1, a->len, norm);
+    mean[1] = t2 ? center_trace(t2, a->len, norm + 1) : 0;
+
+    for (i = 0; i < a->len; ++i)
+        a->buf[i] = (t1[i] - mean[0]) + I * (t2 ? t2[i] - mean[1] : 0);
+    for (; i < fft_len; ++i)
+        a->buf[i] = 0;
+
+    run_fft(a->plan, a->buf, false);
+    for (i = 0; i < fft_len; ++i)
+        a->buf[i] *= a->ref_spec[i];
+    run_fft(a->plan, a->buf, true);
+
+    for (t = 0; t < cnt; ++t) {
+        best[t]     = -INFINITY;
+        shifts[t]   = 0;
+
+        for (s = -(int32_t) a->max_shift; s <= (int32_t) a->max_shift; ++s) {
+            i = (s < 0) ? fft_len + s : (uint32_t) s;
+            c = (t == 0) ? creal(a->buf[i]) : cimag(a->buf[i]);
+            if (c > best[t]) {
+                best[t]     = c;
+                shifts[t]   = s;
+            }
+        }
+
+        corrs[t] = (norm[t] > 0 && a->ref_norm > 0)
+                   ? best[t] / (norm[t] * a->ref_norm) : 0;
+    }
+}
+
+/*
+ * Returns the mean of a trace and stores the norm of the centred trace
+ */
+double center_trace(const float *trace, uint32_t len, double *norm) {
+    uint32_t i;
+    double mean = 0, sum_sq = 0;
+
+    for (i = 0; i < len; ++i)
+        mean += trace[i];
+    mean /= len;
+
+    for (i = 0; i < len; ++i)
+        sum_sq += (trace[i] - mean) * (trace[i] - mean);
+    *norm = sqrt(sum_sq);
+
+    return mean;
+}
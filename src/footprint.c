@@ -0,0 +1,303 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the self-footprint profiling and the storage of noise
+ * profiles.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "footprint.h"
+
+#define PROFILE_KEY_LEN 64
+
+// Scale of the median absolute deviation to estimate the standard deviation
+#define MAD_SCALE 1.4826
+// Lower bound of the robust standard deviation in cycles
+#define MIN_ROBUST_STD 0.5
+
+// local functions
+int cmp_doubles(const void *d1, const void *d2);
+double get_median(double *arr, uint32_t arr_len);
+double get_robust_std(double *arr, uint32_t arr_len, double median);
+void classify_sets(noise_profile *prof);
+
+
+/*
+ * Allocate an empty noise profile (nothing excluded) for the given cache
+ */
+noise_profile *get_noise_profile(cache_ctx *ctx) {
+    noise_profile *prof = (noise_profile *) malloc(sizeof(noise_profile));
+    assert(prof);
+
+    prof->cache_level   = ctx->cache_level;
+    prof->sets          = ctx->sets;
+    prof->mean          = (double *) calloc(ctx->sets, sizeof(double));
+    prof->std           = (double *) calloc(ctx->sets, sizeof(double));
+    prof->offset        = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    prof->exclude       = (bool *) calloc(ctx->sets, sizeof(bool));
+    prof->excluded_cnt  = 0;
+    assert(prof->mean && prof->std && prof->offset && prof->exclude);
+
+    return prof;
+}
+
+void release_noise_profile(noise_profile *prof) {
+    free(prof->mean);
+    free(prof->std);
+    free(prof->offset);
+    free(prof->exclude);
+    free(prof);
+}
+
+/*
+ * Run the full sampling loop (prime, null victim, probe, result write) for
+ * `samples` rounds and derive the noise profile from the per-set probe time
+ * distributions. If `conf` is NULL, the default configuration is used.
+ */
+void profile_self_footprint(cache_ctx *ctx, pp_conf *conf, cacheline *cache_ds,
+    uint32_t samples, noise_profile *prof)
+{
+    uint32_t i, j;
+    double delta;
+    pp_conf default_conf;
+
+    if (!conf) {
+        get_default_pp_conf(ctx, &default_conf);
+        conf = &default_conf;
+    }
+
+    size_t res_size = samples * ctx->sets * sizeof(time_type);
+    time_type *res  = (time_type *) malloc(res_size);
+    assert(res);
+    memset(res, 0, res_size);
+
+    time_type *curr_res     = res;
+    cacheline *curr_head    = cache_ds;
+    cacheline *next_head;
+
+    prepare_measurement();
+
+    // Same loop as the attacks, but without a victim
+    for (i = 0; i < samples; ++i) {
+        curr_head = prime_conf(conf, curr_head);
+        next_head = probe_conf(conf, ctx->cache_level, curr_head);
+
+        get_msrmts_for_all_set(curr_head, curr_res);
+        curr_head = next_head;
+        curr_res += ctx->sets;
+    }
+
+    // Welford's online mean and variance per set
+    memset(prof->mean, 0, ctx->sets * sizeof(double));
+    memset(prof->std, 0, ctx->sets * sizeof(double));
+
+    for (i = 0; i < samples; ++i) {
+        for (j = 0; j < ctx->sets; ++j) {
+            delta            = res[i * ctx->sets + j] - prof->mean[j];
+            prof->mean[j]   += delta / (i + 1);
+            prof->std[j]    += delta * (res[i * ctx->sets + j] - prof->mean[j]);
+        }
+    }
+
+    for (j = 0; j < ctx->sets; ++j)
+        prof->std[j] = sqrt(prof->std[j] / samples);
+
+    classify_sets(prof);
+
+    free(res);
+}
+
+/*
+ * Store the sets that are not excluded in `sets` (with space for prof->sets
+ * entries), e.g. to build a data structure with prepare_cache_set_ds.
+ * Returns the number of sets.
+ */
+uint32_t get_included_sets(noise_profile *prof, uint32_t *sets) {
+    uint32_t i, sets_len = 0;
+
+    for (i = 0; i < prof->sets; ++i) {
+        if (!prof->exclude[i]) {
+            sets[sets_len] = i;
+            ++sets_len;
+        }
+    }
+
+    return sets_len;
+}
+
+/*
+ * Store a noise profile as text, one line per set.
+ * Returns 0 on success, 1 on failure.
+ */
+int save_noise_profile(const char *path, noise_profile *prof) {
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return 1;
+
+    fprintf(fp, "# CacheSC self-footprint noise profile\n");
+    fprintf(fp, "cache_level = %u\n", prof->cache_level);
+    fprintf(fp, "sets = %u\n", prof->sets);
+    fprintf(fp, "# set mean std offset excluded\n");
+
+    for (uint32_t i = 0; i < prof->sets; ++i) {
+        fprintf(fp, "set %u %.3f %.3f %u %u\n", i, prof->mean[i], prof->std[i],
+                prof->offset[i], prof->exclude[i]);
+    }
+
+    return fclose(fp) != 0;
+}
+
+/*
+ * Load a profile stored by save_noise_profile.
+ * Returns 0 on success, 1 on failure or if the profile was recorded for
+ * another cache geometry.
+ */
+int load_noise_profile(const char *path, cache_ctx *ctx, noise_profile *prof) {
+    char line[BUFSIZ];
+    char key[PROFILE_KEY_LEN];
+    uint32_t val, set, offset, exclude;
+    double mean, std;
+    int ret = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return 1;
+
+    prof->excluded_cnt = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#')
+            continue;
+
+        if (sscanf(line, "set %u %lf %lf %u %u", &set, &mean, &std, &offset,
+                   &exclude) == 5)
+        {
+            if (set >= prof->sets) {
+                ret = 1;
+                continue;
+            }
+
+            prof->mean[set]     = mean;
+            prof->std[set]      = std;
+            prof->offset[set]   = offset;
+            prof->exclude[set]  = exclude;
+            prof->excluded_cnt += !!exclude;
+        }
+        else if (sscanf(line, "%63s = %u", key, &val) == 2) {
+            if ((!strcmp(key, "cache_level") && val != ctx->cache_level)
+                || (!strcmp(key, "sets") && val != ctx->sets))
+            {
+                ret = 1;
+            }
+        }
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+/*
+ * Fancy print the excluded sets and the largest offsets of a profile
+ */
+void print_noise_profile(noise_profile *prof) {
+    uint32_t i;
+
+    printf("noise_profile = {\n\texcluded (%u):", prof->excluded_cnt);
+    for (i = 0; i < prof->sets; ++i) {
+        if (prof->exclude[i])
+            printf(" %u", i);
+    }
+
+    printf(",\n\toffsets:");
+    for (i = 0; i < prof->sets; ++i) {
+        if (!prof->exclude[i] && prof->offset[i])
+            printf(" %u:%u", i, prof->offset[i]);
+    }
+    printf("\n}\n");
+}
+
+int cmp_doubles(const void *d1, const void *d2) {
+    double diff = *((double *) d1) - *((double *) d2);
+
+    return (diff > 0) - (diff < 0);
+}
+
+double get_median(double *arr, uint32_t arr_len) {
+    double median;
+    double *sorted = (double *) malloc(arr_len * sizeof(double));
+    assert(sorted);
+
+    memcpy(sorted, arr, arr_len * sizeof(double));
+    qsort(sorted, arr_len, sizeof(double), cmp_doubles);
+
+    median = (arr_len % 2) ? sorted[arr_len / 2]
+                           : (sorted[arr_len / 2 - 1] + sorted[arr_len / 2]) / 2;
+
+    free(sorted);
+    return median;
+}
+
+/*
+ * Standard deviation estimated from the median absolute deviation, which is
+ * not affected by the (few) perturbed sets.
+ */
+double get_robust_std(double *arr, uint32_t arr_len, double median) {
+    double mad;
+    double *dev = (double *) malloc(arr_len * sizeof(double));
+    assert(dev);
+
+    for (uint32_t i = 0; i < arr_len; ++i)
+        dev[i] = fabs(arr[i] - median);
+
+    mad = get_median(dev, arr_len);
+
+    free(dev);
+    return fmax(MAD_SCALE * mad, MIN_ROBUST_STD);
+}
+
+/*
+ * Exclude sets that are outliers in their mean (the attacker evicts them in
+ * most samples) or their standard deviation (the attacker evicts them in
+ * some samples) and compute the offsets of the remaining sets.
+ */
+void classify_sets(noise_profile *prof) {
+    double mean_median  = get_median(prof->mean, prof->sets);
+    double std_median   = get_median(prof->std, prof->sets);
+    double mean_std     = get_robust_std(prof->mean, prof->sets, mean_median);
+    double std_std      = get_robust_std(prof->std, prof->sets, std_median);
+
+    prof->excluded_cnt = 0;
+
+    for (uint32_t i = 0; i < prof->sets; ++i) {
+        prof->exclude[i] = (prof->mean[i] - mean_median) / mean_std > FOOTPRINT_THRESHOLD
+                           || (prof->std[i] - std_median) / std_std > FOOTPRINT_THRESHOLD;
+        prof->excluded_cnt += prof->exclude[i];
+
+        prof->offset[i] = (prof->mean[i] > mean_median)
+                          ? (time_type) round(prof->mean[i] - mean_median) : 0;
+    }
+}
@@ -38,8 +38,23 @@ CACHE_LEVELS    = ["L1", "L2"]
 
 CONF_FNAME          = "device_conf.h"
 CACHE_TYPES_FNAME   = "cache_types.h"
-START_TIMER_FN      = "start_timer"
-STOP_TIMER_FN       = "stop_timer"
+
+# (function name suffix, start timer function, stop timer function)
+TIMER_BACKENDS      = [
+    ("",        "start_timer",          "stop_timer"),
+    ("_lfence", "start_timer_lfence",   "stop_timer_lfence"),
+]
+
+# Loads per loop iteration of the partially unrolled kernel, emitted as
+# PROBE_KERNEL_PARTIAL_UNROLL for probe_kernel.c
+PARTIAL_UNROLL      = 4
+
+# (function name suffix, loads per loop iteration, 0 for fully unrolled)
+PROBE_KERNELS       = [
+    ("_rolled",     1),
+    ("_partial",    PARTIAL_UNROLL),
+    ("_unrolled",   0),
+]
 
 def extract_macro(macro_name, lines, type_conv=int):
     pattern = f"#define\s+{macro_name}\s+(.*)\n"
@@ -49,6 +64,64 @@ def extract_macro(macro_name, lines, type_conv=int):
         if match:
             return type_conv(match.groups()[0])
 
+#
+# Generate the probe of a set: it follows the prev pointers through all
+# `associativity` lines, starting from the last line of the set, stores the
+# time in the first line and returns the last line of the previous set.
+# The associativity - 1 loads up to the first line are fully unrolled if
+# `unroll` is at least that many, otherwise they are done in a loop with
+# `unroll` loads per iteration, which keeps the code small for large
+# associativities.
+#
+def gen_probe_cacheset(fn_name, start_timer_fn, stop_timer_fn, associativity,
+                       unroll):
+    loads   = associativity - 1
+    regs    = ["%%rax", "%%rcx"]
+    instrs  = []
+
+    if unroll >= loads:
+        if loads == 0:
+            instrs.append("mov %[curr_cl], %[curr_cl_out]")
+        for i in range(loads):
+            src = "%[curr_cl]" if i == 0 else regs[(i - 1) % 2]
+            dst = "%[curr_cl_out]" if i == loads - 1 else regs[i % 2]
+            instrs.append(f"mov {CL_PREV_OFFSET}({src}), {dst}")
+        instrs.append(f"mov {CL_PREV_OFFSET}(%[curr_cl_out]), %[next_cl_out]")
+        outputs     = '[next_cl_out] "=rm" (next_cl), [curr_cl_out] "=rm" (curr_cl)'
+        clobbers    = '"%rax", "%rcx"'
+    else:
+        instrs.append("mov %[curr_cl], %%rax")
+        instrs.append(f"mov ${loads // unroll}, %%ecx")
+        instrs.append("1:")
+        instrs += [f"mov {CL_PREV_OFFSET}(%%rax), %%rax"] * unroll
+        instrs.append("dec %%ecx")
+        instrs.append("jnz 1b")
+        instrs += [f"mov {CL_PREV_OFFSET}(%%rax), %%rax"] * (loads % unroll)
+        instrs.append("mov %%rax, %[curr_cl_out]")
+        instrs.append(f"mov {CL_PREV_OFFSET}(%%rax), %[next_cl_out]")
+        outputs     = '[next_cl_out] "=r" (next_cl), [curr_cl_out] "=r" (curr_cl)'
+        clobbers    = '"%rax", "%rcx", "cc"'
+
+    asm_lines = "".join(f'        "{instr} \\n\\t"\n' for instr in instrs)
+
+    return dedent(f"""
+        // Traverse cache sets in reverse order for minimal cache impact
+        static inline cacheline *{fn_name}(cacheline *curr_cl) {{
+            cacheline *next_cl;
+
+            {start_timer_fn}();
+            asm volatile(
+        """) + asm_lines + dedent(f"""\
+                : {outputs}
+                : [curr_cl] "r" (curr_cl)
+                : {clobbers}
+            );
+            {stop_timer_fn}(&(curr_cl->time_msrmt));
+
+            return next_cl;
+        }}
+        """)
+
 #
 # Parse general config file
 #
@@ -69,8 +142,14 @@ for cache_level in CACHE_LEVELS:
 
         SETS            = extract_macro(f"{cache_level}_SETS", lines)
         ASSOCIATIVITY   = extract_macro(f"{cache_level}_ASSOCIATIVITY", lines)
+        PROBE_UNROLL    = extract_macro(f"{cache_level}_PROBE_UNROLL", lines)
+
+    assert(ASSOCIATIVITY >= 1)
 
-    assert(ASSOCIATIVITY >= 4 and ASSOCIATIVITY % 2 == 0)
+    # The default probe kernel is configured per level, fully unrolled unless
+    # set otherwise
+    if not PROBE_UNROLL:
+        PROBE_UNROLL = ASSOCIATIVITY
 
     #
     # Generate C file with repetitive inlined assembly code
@@ -88,43 +167,30 @@ for cache_level in CACHE_LEVELS:
         #include "cache.h"
         #include "{CONF_FNAME}"
 
-        """
-    )
-
-    footer = f"\n#endif // HEADER_{cache_level}_ASM_H"
+        #ifndef PROBE_KERNEL_PARTIAL_UNROLL
+            #define PROBE_KERNEL_PARTIAL_UNROLL {PARTIAL_UNROLL}
+        #endif
 
-    probe_cacheset = dedent(f"""
-        // Traverse cache sets in reverse order for minimal cache impact
-        static inline cacheline *asm_{cache_level_lowercase}_probe_cacheset(cacheline *curr_cl) {{
-            cacheline *next_cl;
-
-            {START_TIMER_FN}();
-            asm volatile(
-                "mov {CL_PREV_OFFSET}(%[curr_cl]), %%rax \\n\\t"
-                "mov {CL_PREV_OFFSET}(%%rax), %%rcx \\n\\t"
         """
     )
 
-    # The following weird indentation is necessary that the generated C file
-    # is correctly indented
-    probe_cacheset += f"""\
-        "mov {CL_PREV_OFFSET}(%%rcx), %%rax \\n\\t"
-        "mov {CL_PREV_OFFSET}(%%rax), %%rcx \\n\\t"
-""" * ((ASSOCIATIVITY - 4) // 2)
-
-    probe_cacheset += dedent(f"""\
-                "mov {CL_PREV_OFFSET}(%%rcx), %[curr_cl_out] \\n\\t"
-                "mov {CL_PREV_OFFSET}(%[curr_cl_out]), %[next_cl_out] \\n\\t"
-                : [next_cl_out] "=rm" (next_cl), [curr_cl_out] "=rm" (curr_cl)
-                : [curr_cl] "r" (curr_cl)
-                : "%rax", "%rcx"
-            );
-            {STOP_TIMER_FN}(&(curr_cl->time_msrmt));
+    footer = f"\n#endif // HEADER_{cache_level}_ASM_H"
 
-            return next_cl;
-        }}
-        """
-    )
+    # One probe variant per timer backend (see asm.h) with the configured
+    # kernel, and the alternative kernels with the default timer to compare
+    # them (see cachesc-probe-kernels)
+    probe_cacheset = ""
+    for fn_suffix, start_timer_fn, stop_timer_fn in TIMER_BACKENDS:
+        probe_cacheset += gen_probe_cacheset(
+            f"asm_{cache_level_lowercase}_probe_cacheset{fn_suffix}",
+            start_timer_fn, stop_timer_fn, ASSOCIATIVITY, PROBE_UNROLL)
+
+    start_timer_fn, stop_timer_fn = TIMER_BACKENDS[0][1:]
+    for kernel_suffix, unroll in PROBE_KERNELS:
+        probe_cacheset += gen_probe_cacheset(
+            f"asm_{cache_level_lowercase}_probe_cacheset{kernel_suffix}",
+            start_timer_fn, stop_timer_fn, ASSOCIATIVITY,
+            unroll if unroll else ASSOCIATIVITY)
 
     prime = dedent(f"""\
         static inline cacheline *asm_{cache_level_lowercase}_prime(cacheline *curr_cl) {{
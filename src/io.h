@@ -28,9 +28,13 @@
 #ifndef HEADER_IO_H
 #define HEADER_IO_H
 
+#include <assert.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #define PRINT_FLUSH(fmt, ...) \
     printf(fmt, ## __VA_ARGS__); \
@@ -42,6 +46,18 @@
 #define BANNER "################################################################\n"
 #define INDENT(msg) "#### " msg
 
+// Size of the buffer of write_results, it is flushed with a single write
+// whenever the next sample may not fit
+#define RESULTS_BUF_SIZE (1 << 20)
+// Maximal characters of a formatted measurement, i.e. "-2147483648 "
+#define RESULT_MAX_LEN 12
+#define SAMPLE_LINE INDENT("Sample number ")
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
 /*
  * Prints a message in a banner.
  * The `msg` should be <= 60 characters long and without line breaks.
@@ -67,21 +83,114 @@ static void print_hex(const char *str, uint16_t str_len) {
 }
 
 /*
- * Print the results of the cache attack measurements in the format
- * that is expected by the post-processing parsing scripts.
+ * Format `val` in decimal at the end of the RESULT_MAX_LEN bytes before `end`,
+ * two digits at a time. Returns the start of the number.
  */
-static void print_results(uint32_t *res, uint32_t sample_cnt,
+static inline char *format_uint_rev(char *end, uint32_t val) {
+    while (val >= 100) {
+        end -= 2;
+        memcpy(end, digit_pairs + 2 * (val % 100), 2);
+        val /= 100;
+    }
+    if (val >= 10) {
+        end -= 2;
+        memcpy(end, digit_pairs + 2 * val, 2);
+    }
+    else {
+        *--end = '0' + val;
+    }
+
+    return end;
+}
+
+/*
+ * Append `val` like printf("%*d", width, val) and return the new end.
+ */
+static inline char *format_int(char *out, int32_t val, int width) {
+    char tmp[RESULT_MAX_LEN];
+    char *start = format_uint_rev(tmp + RESULT_MAX_LEN,
+                                  val < 0 ? -(uint32_t) val : (uint32_t) val);
+    int len;
+
+    if (val < 0)
+        *--start = '-';
+    len = tmp + RESULT_MAX_LEN - start;
+
+    for (; len < width; --width)
+        *out++ = ' ';
+    memcpy(out, start, len);
+
+    return out + len;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return 1;
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/*
+ * Write the results to `fd` in the format of print_results. Samples are
+ * formatted into a large buffer that is emitted with one write per block of
+ * samples. Returns 0 on success.
+ */
+static int write_results(int fd, uint32_t *res, uint32_t sample_cnt,
                          uint32_t sets_per_sample)
 {
-   for (uint32_t i = 0; i < sample_cnt; ++i) {
-        PRINT_LINE("Sample number %d:\n", i);
+    int err = 0;
+    size_t sample_max_len = sizeof(SAMPLE_LINE) + RESULT_MAX_LEN + 2
+                            + (size_t) sets_per_sample * RESULT_MAX_LEN + 1;
+    size_t buf_size = sample_max_len > RESULTS_BUF_SIZE ? sample_max_len
+                                                        : RESULTS_BUF_SIZE;
+    char *buf = (char *) malloc(buf_size);
+    char *p = buf;
+    assert(buf);
+
+    for (uint32_t i = 0; i < sample_cnt && !err; ++i) {
+        if ((size_t) (buf + buf_size - p) < sample_max_len) {
+            err = write_all(fd, buf, p - buf);
+            p   = buf;
+        }
+
+        memcpy(p, SAMPLE_LINE, sizeof(SAMPLE_LINE) - 1);
+        p       = format_int(p + sizeof(SAMPLE_LINE) - 1, i, 0);
+        *p++    = ':';
+        *p++    = '\n';
 
         for (uint32_t j = 0; j < sets_per_sample; ++j) {
-            printf("%3d ", res[i * sets_per_sample + j]);
+            p       = format_int(p, res[i * sets_per_sample + j], 3);
+            *p++    = ' ';
         }
-        putchar('\n');
+        *p++ = '\n';
     }
+    if (!err)
+        err = write_all(fd, buf, p - buf);
+
+    free(buf);
+
+    return err;
+}
+
+/*
+ * Print the results of the cache attack measurements in the format
+ * that is expected by the post-processing parsing scripts.
+ */
+static void print_results(uint32_t *res, uint32_t sample_cnt,
+                         uint32_t sets_per_sample)
+{
+    // Keep the order with previous output on stdout
     fflush(stdout);
+    write_results(STDOUT_FILENO, res, sample_cnt, sets_per_sample);
 }
 
 #endif // HEADER_IO_H
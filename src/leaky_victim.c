@@ -0,0 +1,466 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the synthetic leaky victims. Every victim is written
+ * once and either runs plainly (for measurements) or with a leak recorder
+ * that logs its secret-dependent memory accesses (for the ground truth).
+ */
+
+#include "leaky_victim.h"
+
+#define GETU32(pt) (((uint32_t)(pt)[0] << 24) ^ ((uint32_t)(pt)[1] << 16) \
+                    ^ ((uint32_t)(pt)[2] << 8) ^ ((uint32_t)(pt)[3]))
+#define PUTU32(ct, st) { (ct)[0] = (uint8_t)((st) >> 24); \
+                         (ct)[1] = (uint8_t)((st) >> 16); \
+                         (ct)[2] = (uint8_t)((st) >> 8); \
+                         (ct)[3] = (uint8_t)(st); }
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+// Largest prime below 2^64
+#define MODEXP_MODULUS 0xffffffffffffffc5ULL
+
+#define MEMHARD_WORDS (LEAKY_MEMHARD_BLOCK_SIZE / sizeof(uint64_t))
+#define WORDS_PER_LINE (CACHELINE_SIZE / sizeof(uint64_t))
+
+// local functions
+void record_access(leak_recorder *rec, const void *p);
+uint8_t gf_mul(uint8_t a, uint8_t b);
+void init_aes_tables(leaky_victim *v);
+void aes_expand_key(leaky_victim *v);
+void aes_encrypt(leaky_victim *v, const uint8_t *in, uint8_t *out,
+    leak_recorder *rec);
+void modexp(leaky_victim *v, const uint8_t *in, uint8_t *out, leak_recorder *rec);
+void lookup(leaky_victim *v, const uint8_t *in, uint8_t *out, leak_recorder *rec);
+void memhard(leaky_victim *v, const uint8_t *in, uint8_t *out, leak_recorder *rec);
+void run_leaky_victim_internal(leaky_victim *v, const uint8_t *input,
+    uint8_t *output, leak_recorder *rec);
+
+
+/*
+ * Allocate a victim of the given type. The secret-dependent memory starts
+ * `line_offset` cache lines after a page boundary, which determines the
+ * cache sets it maps to. The secret is initially zero.
+ * `param` configures the lookup footprint (in bytes) or the number of blocks
+ * of the memory-hard hash, 0 selects the default.
+ */
+leaky_victim *prepare_leaky_victim(leaky_victim_type type, uint32_t param,
+    uint32_t line_offset)
+{
+    uint64_t alloc_size;
+    uint32_t i;
+
+    leaky_victim *v = (leaky_victim *) calloc(1, sizeof(leaky_victim));
+    assert(v);
+
+    v->type         = type;
+    v->line_offset  = line_offset;
+
+    switch (type) {
+        case LEAKY_AES_TTABLE:
+            v->secret_len   = LEAKY_AES_KEY_LEN;
+            v->input_len    = LEAKY_AES_BLOCK_LEN;
+            v->mem_size     = LEAKY_AES_TABLES * LEAKY_AES_TABLE_SIZE;
+            break;
+        case LEAKY_MODEXP:
+            v->secret_len   = LEAKY_MODEXP_LEN;
+            v->input_len    = LEAKY_MODEXP_LEN;
+            v->mem_size     = CACHELINE_SIZE;
+            break;
+        case LEAKY_LOOKUP:
+            v->param        = param ? param : LEAKY_LOOKUP_DEFAULT_FOOTPRINT;
+            v->secret_len   = LEAKY_LOOKUP_LEN;
+            v->input_len    = LEAKY_LOOKUP_LEN;
+            v->mem_size     = v->param;
+            break;
+        case LEAKY_MEMHARD:
+            v->param        = param ? param : LEAKY_MEMHARD_DEFAULT_BLOCKS;
+            assert(v->param >= 2);
+            v->secret_len   = LEAKY_MEMHARD_LEN;
+            v->input_len    = LEAKY_MEMHARD_LEN;
+            v->mem_size     = (uint64_t) v->param * LEAKY_MEMHARD_BLOCK_SIZE;
+            break;
+        default:
+            free(v);
+            return NULL;
+    }
+    v->output_len = v->input_len;
+
+    alloc_size  = line_offset * CACHELINE_SIZE + v->mem_size;
+    alloc_size  = (alloc_size + PAGE_SIZE - 1) & ~((uint64_t) PAGE_MASK);
+    v->mem_base = (uint8_t *) aligned_alloc(PAGE_SIZE, alloc_size);
+    v->secret   = (uint8_t *) calloc(v->secret_len, 1);
+    assert(v->mem_base);
+    assert(v->secret);
+
+    memset(v->mem_base, 0, alloc_size);
+    v->mem = v->mem_base + line_offset * CACHELINE_SIZE;
+
+    if (type == LEAKY_AES_TTABLE) {
+        init_aes_tables(v);
+        aes_expand_key(v);
+    }
+    else if (type == LEAKY_LOOKUP) {
+        for (i = 0; i < v->mem_size; ++i)
+            v->mem[i] = (uint8_t) (i * 167 + 13);
+    }
+
+    return v;
+}
+
+void release_leaky_victim(leaky_victim *v) {
+    free(v->mem_base);
+    free(v->secret);
+    free(v);
+}
+
+/*
+ * Set the secret (key, exponent or password) of length v->secret_len
+ */
+void set_leaky_victim_secret(leaky_victim *v, const uint8_t *secret) {
+    memcpy(v->secret, secret, v->secret_len);
+
+    if (v->type == LEAKY_AES_TTABLE)
+        aes_expand_key(v);
+}
+
+/*
+ * Run the victim on an input of length v->input_len, the output has length
+ * v->output_len.
+ */
+void run_leaky_victim(leaky_victim *v, const uint8_t *input, uint8_t *output) {
+    run_leaky_victim_internal(v, input, output, NULL);
+}
+
+/*
+ * Upper bound on the number of secret-dependent accesses of a single run
+ */
+uint32_t get_leaky_victim_max_trace_len(leaky_victim *v) {
+    switch (v->type) {
+        case LEAKY_AES_TTABLE:
+            return 10 * LEAKY_AES_BLOCK_LEN;
+        case LEAKY_MODEXP:
+            return 8 * LEAKY_MODEXP_LEN;
+        case LEAKY_LOOKUP:
+            return LEAKY_LOOKUP_LEN;
+        default:
+            return (v->param - 2) * (LEAKY_MEMHARD_BLOCK_SIZE / CACHELINE_SIZE);
+    }
+}
+
+/*
+ * Ground truth: run the victim and record the addresses of its
+ * secret-dependent accesses in order.
+ * Returns the number of recorded addresses (at most max_addrs).
+ */
+uint32_t trace_leaky_victim(leaky_victim *v, const uint8_t *input,
+    uintptr_t *addrs, uint32_t max_addrs)
+{
+    leak_recorder rec = {addrs, 0, max_addrs};
+
+    uint8_t *output = (uint8_t *) malloc(v->output_len);
+    assert(output);
+
+    run_leaky_victim_internal(v, input, output, &rec);
+
+    free(output);
+    return rec.len;
+}
+
+/*
+ * Ground truth per cache set: add the number of secret-dependent accesses
+ * of a run on the given input to each set in `set_hits` (ctx->sets entries).
+ * Physically indexed caches require the privileges to translate addresses.
+ */
+void get_leaky_victim_sets(cache_ctx *ctx, leaky_victim *v, const uint8_t *input,
+    uint32_t *set_hits)
+{
+    uint32_t i, len;
+    uint32_t max_len    = get_leaky_victim_max_trace_len(v);
+    uintptr_t *addrs    = (uintptr_t *) malloc(max_len * sizeof(uintptr_t));
+    assert(addrs);
+
+    len = trace_leaky_victim(v, input, addrs, max_len);
+
+    for (i = 0; i < len; ++i)
+        set_hits[get_cache_set(ctx, (void *) addrs[i])] += 1;
+
+    free(addrs);
+}
+
+/*
+ * Address of the T-table Te0, ..., Te4 (e.g. to validate table discovery)
+ */
+void *get_leaky_aes_table(leaky_victim *v, uint32_t table) {
+    assert(v->type == LEAKY_AES_TTABLE && table < LEAKY_AES_TABLES);
+    return v->mem + table * LEAKY_AES_TABLE_SIZE;
+}
+
+const char *get_leaky_victim_name(leaky_victim_type type) {
+    switch (type) {
+        case LEAKY_AES_TTABLE:  return "aes-ttable";
+        case LEAKY_MODEXP:      return "modexp";
+        case LEAKY_LOOKUP:      return "lookup";
+        case LEAKY_MEMHARD:     return "memhard";
+        default:                return "unknown";
+    }
+}
+
+void run_leaky_victim_internal(leaky_victim *v, const uint8_t *input,
+    uint8_t *output, leak_recorder *rec)
+{
+    switch (v->type) {
+        case LEAKY_AES_TTABLE:
+            aes_encrypt(v, input, output, rec);
+            break;
+        case LEAKY_MODEXP:
+            modexp(v, input, output, rec);
+            break;
+        case LEAKY_LOOKUP:
+            lookup(v, input, output, rec);
+            break;
+        case LEAKY_MEMHARD:
+            memhard(v, input, output, rec);
+            break;
+    }
+}
+
+void record_access(leak_recorder *rec, const void *p) {
+    if (rec && rec->len < rec->max_len) {
+        rec->addrs[rec->len] = (uintptr_t) p;
+        rec->len++;
+    }
+}
+
+/*
+ * Multiplication in GF(2^8) with the AES polynomial
+ */
+uint8_t gf_mul(uint8_t a, uint8_t b) {
+    uint8_t p = 0;
+
+    while (b) {
+        if (b & 1)
+            p ^= a;
+        a = (a << 1) ^ ((a & 0x80) ? 0x1b : 0);
+        b >>= 1;
+    }
+
+    return p;
+}
+
+/*
+ * Compute the S-box and the T-tables in the layout of OpenSSL's aes_core.c
+ */
+void init_aes_tables(leaky_victim *v) {
+    uint32_t x, y, te0;
+    uint8_t inv, s;
+    uint32_t *te[LEAKY_AES_TABLES];
+
+    for (x = 0; x < LEAKY_AES_TABLES; ++x)
+        te[x] = (uint32_t *) get_leaky_aes_table(v, x);
+
+    for (x = 0; x < 256; ++x) {
+        inv = 0;
+        for (y = 1; x && y < 256; ++y) {
+            if (gf_mul(x, y) == 1) {
+                inv = y;
+                break;
+            }
+        }
+
+        s = inv ^ 0x63;
+        for (y = 1; y <= 4; ++y)
+            s ^= (uint8_t) ((inv << y) | (inv >> (8 - y)));
+
+        te0 = ((uint32_t) gf_mul(s, 2) << 24) | ((uint32_t) s << 16)
+              | ((uint32_t) s << 8) | gf_mul(s, 3);
+
+        te[0][x] = te0;
+        te[1][x] = ROR32(te0, 8);
+        te[2][x] = ROR32(te0, 16);
+        te[3][x] = ROR32(te0, 24);
+        te[4][x] = s * 0x01010101U;
+    }
+}
+
+/*
+ * AES-128 key schedule (its table accesses are not recorded, since the
+ * demos assume the key is expanded once)
+ */
+void aes_expand_key(leaky_victim *v) {
+    static const uint32_t rcon[] = {
+        0x01000000, 0x02000000, 0x04000000, 0x08000000, 0x10000000,
+        0x20000000, 0x40000000, 0x80000000, 0x1b000000, 0x36000000,
+    };
+    const uint32_t *te4 = (const uint32_t *) get_leaky_aes_table(v, 4);
+    uint32_t *rk        = v->rk;
+    uint32_t temp;
+
+    for (uint32_t i = 0; i < 4; ++i)
+        rk[i] = GETU32(v->secret + 4 * i);
+
+    for (uint32_t i = 0; i < 10; ++i, rk += 4) {
+        temp  = rk[3];
+        rk[4] = rk[0] ^ (te4[(temp >> 16) & 0xff] & 0xff000000)
+                ^ (te4[(temp >> 8) & 0xff] & 0x00ff0000)
+                ^ (te4[temp & 0xff] & 0x0000ff00)
+                ^ (te4[temp >> 24] & 0x000000ff) ^ rcon[i];
+        rk[5] = rk[1] ^ rk[4];
+        rk[6] = rk[2] ^ rk[5];
+        rk[7] = rk[3] ^ rk[6];
+    }
+}
+
+#define TE(t, idx) (record_access(rec, te[t] + (idx)), te[t][idx])
+
+/*
+ * One block of T-table AES-128 encryption. In the first round, byte b of
+ * the plaintext indexes table Te(b % 4) with pt[b] ^ key[b].
+ */
+void aes_encrypt(leaky_victim *v, const uint8_t *in, uint8_t *out,
+    leak_recorder *rec)
+{
+    uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+    const uint32_t *rk = v->rk;
+    const uint32_t *te[LEAKY_AES_TABLES];
+
+    for (uint32_t i = 0; i < LEAKY_AES_TABLES; ++i)
+        te[i] = (const uint32_t *) get_leaky_aes_table(v, i);
+
+    s0 = GETU32(in     ) ^ rk[0];
+    s1 = GETU32(in +  4) ^ rk[1];
+    s2 = GETU32(in +  8) ^ rk[2];
+    s3 = GETU32(in + 12) ^ rk[3];
+
+    for (uint32_t r = 1; r < 10; ++r) {
+        rk += 4;
+        t0 = TE(0, s0 >> 24) ^ TE(1, (s1 >> 16) & 0xff)
+             ^ TE(2, (s2 >> 8) & 0xff) ^ TE(3, s3 & 0xff) ^ rk[0];
+        t1 = TE(0, s1 >> 24) ^ TE(1, (s2 >> 16) & 0xff)
+             ^ TE(2, (s3 >> 8) & 0xff) ^ TE(3, s0 & 0xff) ^ rk[1];
+        t2 = TE(0, s2 >> 24) ^ TE(1, (s3 >> 16) & 0xff)
+             ^ TE(2, (s0 >> 8) & 0xff) ^ TE(3, s1 & 0xff) ^ rk[2];
+        t3 = TE(0, s3 >> 24) ^ TE(1, (s0 >> 16) & 0xff)
+             ^ TE(2, (s1 >> 8) & 0xff) ^ TE(3, s2 & 0xff) ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    rk += 4;
+    t0 = (TE(4, s0 >> 24) & 0xff000000) ^ (TE(4, (s1 >> 16) & 0xff) & 0x00ff0000)
+         ^ (TE(4, (s2 >> 8) & 0xff) & 0x0000ff00) ^ (TE(4, s3 & 0xff) & 0x000000ff)
+         ^ rk[0];
+    t1 = (TE(4, s1 >> 24) & 0xff000000) ^ (TE(4, (s2 >> 16) & 0xff) & 0x00ff0000)
+         ^ (TE(4, (s3 >> 8) & 0xff) & 0x0000ff00) ^ (TE(4, s0 & 0xff) & 0x000000ff)
+         ^ rk[1];
+    t2 = (TE(4, s2 >> 24) & 0xff000000) ^ (TE(4, (s3 >> 16) & 0xff) & 0x00ff0000)
+         ^ (TE(4, (s0 >> 8) & 0xff) & 0x0000ff00) ^ (TE(4, s1 & 0xff) & 0x000000ff)
+         ^ rk[2];
+    t3 = (TE(4, s3 >> 24) & 0xff000000) ^ (TE(4, (s0 >> 16) & 0xff) & 0x00ff0000)
+         ^ (TE(4, (s1 >> 8) & 0xff) & 0x0000ff00) ^ (TE(4, s2 & 0xff) & 0x000000ff)
+         ^ rk[3];
+
+    PUTU32(out     , t0);
+    PUTU32(out +  4, t1);
+    PUTU32(out +  8, t2);
+    PUTU32(out + 12, t3);
+}
+
+/*
+ * Left-to-right square-and-multiply: base^secret mod p. The base is loaded
+ * from the victim memory for every multiplication, i.e. only for one bits
+ * of the exponent.
+ */
+void modexp(leaky_victim *v, const uint8_t *in, uint8_t *out, leak_recorder *rec) {
+    uint64_t base, exp, acc;
+    volatile uint64_t *base_ptr = (volatile uint64_t *) v->mem;
+
+    memcpy(&base, in, sizeof(uint64_t));
+    memcpy(&exp, v->secret, sizeof(uint64_t));
+    *base_ptr   = base % MODEXP_MODULUS;
+    acc         = 1;
+
+    for (int32_t i = 8 * LEAKY_MODEXP_LEN - 1; i >= 0; --i) {
+        acc = (unsigned __int128) acc * acc % MODEXP_MODULUS;
+
+        if ((exp >> i) & 1) {
+            record_access(rec, (const void *) base_ptr);
+            acc = (unsigned __int128) acc * *base_ptr % MODEXP_MODULUS;
+        }
+    }
+
+    memcpy(out, &acc, sizeof(uint64_t));
+}
+
+/*
+ * Table lookups indexed by input[i] ^ secret[i]. The entries are spread over
+ * the configured footprint, so small footprints leak less.
+ */
+void lookup(leaky_victim *v, const uint8_t *in, uint8_t *out, leak_recorder *rec) {
+    uint32_t entry_size = v->param / 256 ? v->param / 256 : 1;
+    const volatile uint8_t *table = v->mem;
+    uint32_t idx;
+
+    for (uint32_t i = 0; i < LEAKY_LOOKUP_LEN; ++i) {
+        idx = ((in[i] ^ v->secret[i]) * entry_size) % v->mem_size;
+        record_access(rec, (const void *) (table + idx));
+        out[i] = table[idx];
+    }
+}
+
+/*
+ * Memory-hard hashing stub: fill v->param blocks of 1 KiB, where each block
+ * depends on its predecessor and a reference block whose index depends on
+ * the previous block (and thus on the password), as in Argon2d.
+ */
+void memhard(leaky_victim *v, const uint8_t *in, uint8_t *out, leak_recorder *rec) {
+    uint64_t *blocks = (uint64_t *) v->mem;
+    uint64_t *prev, *curr, *ref;
+    uint64_t seed = 0x6a09e667f3bcc908ULL;
+    uint32_t i, j;
+
+    for (i = 0; i < LEAKY_MEMHARD_LEN; ++i)
+        seed = ROL64(seed ^ v->secret[i], 9) * 0x9e3779b97f4a7c15ULL ^ in[i];
+
+    // First two blocks only depend on password and salt
+    for (j = 0; j < 2 * MEMHARD_WORDS; ++j) {
+        seed     += 0x9e3779b97f4a7c15ULL;
+        blocks[j] = ROL64(seed, 31) * 0xbf58476d1ce4e5b9ULL;
+    }
+
+    for (i = 2; i < v->param; ++i) {
+        prev = blocks + (i - 1) * MEMHARD_WORDS;
+        curr = blocks + i * MEMHARD_WORDS;
+        ref  = blocks + (prev[0] % (i - 1)) * MEMHARD_WORDS;
+
+        for (j = 0; j < MEMHARD_WORDS; ++j) {
+            if (j % WORDS_PER_LINE == 0)
+                record_access(rec, ref + j);
+            curr[j] = ROL64(prev[j] ^ ref[j], 17) * 0x94d049bb133111ebULL + j;
+        }
+    }
+
+    memcpy(out, blocks + (v->param - 1) * MEMHARD_WORDS, LEAKY_MEMHARD_LEN);
+}
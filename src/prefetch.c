@@ -0,0 +1,374 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the characterisation of the hardware prefetchers.
+ */
+
+#include "prefetch.h"
+
+#include <cpuid.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+// Cycles to wait after training, such that prefetches can complete
+#define PREFETCH_WAIT 2000
+
+// local functions
+double get_pattern_hit_rate(uint8_t *buf, uint32_t threshold, uint32_t first,
+    int32_t stride, uint32_t train_len, int32_t target);
+void wait_cycles(uint64_t cycles);
+bool is_spread(uint32_t s1, uint32_t s2);
+
+
+/*
+ * Access time between a cached line and a line in memory. Prefetched lines
+ * that only reached L2 or L3 count as cached.
+ */
+uint32_t calibrate_prefetch_threshold(void) {
+    uint32_t i;
+    uint32_t hit[PREFETCH_REPS], miss[PREFETCH_REPS];
+    uint8_t *line = (uint8_t *) aligned_alloc(PAGE_SIZE, PAGE_SIZE);
+    assert(line);
+    memset(line, 0, PAGE_SIZE);
+
+    for (i = 0; i < PREFETCH_REPS; ++i) {
+        readq(line);
+        hit[i] = accesstime(line);
+
+        clflush(line);
+        mfence();
+        miss[i] = accesstime(line);
+    }
+
+    free(line);
+
+    return (get_avg(hit, PREFETCH_REPS) + get_avg(miss, PREFETCH_REPS)) / 2;
+}
+
+/*
+ * Measure the hit rates of the prefetcher patterns, the masking rates of the
+ * default and the spread order on a new data structure (with `rounds`
+ * evictions each) and which prefetchers could be disabled.
+ */
+void characterize_prefetchers(cache_ctx *ctx, uint32_t rounds,
+    prefetch_report *rep)
+{
+    int32_t s;
+    uint8_t *buf = (uint8_t *) aligned_alloc(PAGE_SIZE, PREFETCH_PAGES * PAGE_SIZE);
+    cacheline *cache_ds;
+    assert(buf);
+    memset(buf, 0, PREFETCH_PAGES * PAGE_SIZE);
+    memset(rep, 0, sizeof(prefetch_report));
+
+    rep->threshold = calibrate_prefetch_threshold();
+
+    // Line the prefetcher would fetch, relative to the first access. The
+    // trained lines are placed such that the target is not their 128-byte
+    // buddy, except for the adjacent line pattern.
+    rep->untouched  = get_pattern_hit_rate(buf, rep->threshold, 8, 0, 0, 32);
+    rep->adjacent   = get_pattern_hit_rate(buf, rep->threshold, 9, 0, 1, -1);
+    rep->ascending  = get_pattern_hit_rate(buf, rep->threshold, 8, 1,
+                          PREFETCH_TRAIN_LEN, PREFETCH_TRAIN_LEN);
+    rep->descending = get_pattern_hit_rate(buf, rep->threshold, 41, -1,
+                          PREFETCH_TRAIN_LEN, -PREFETCH_TRAIN_LEN);
+    for (s = 2; s <= PREFETCH_MAX_STRIDE; ++s) {
+        rep->stride[s] = get_pattern_hit_rate(buf, rep->threshold, 1, s,
+                             PREFETCH_TRAIN_LEN, s * PREFETCH_TRAIN_LEN);
+    }
+
+    if (rep->adjacent - rep->untouched >= PREFETCH_MIN_RATE)
+        rep->msr_mask |= MSR_PF_L2_ADJACENT;
+    if (fmax(rep->ascending, rep->descending) - rep->untouched >= PREFETCH_MIN_RATE)
+        rep->msr_mask |= MSR_PF_L2_STREAMER | MSR_PF_DCU_NEXT_LINE;
+    for (s = 2; s <= PREFETCH_MAX_STRIDE; ++s) {
+        if (rep->stride[s] - rep->untouched >= PREFETCH_MIN_RATE)
+            rep->msr_mask |= MSR_PF_DCU_IP | MSR_PF_L2_STREAMER;
+    }
+
+    cache_ds = prepare_cache_ds(ctx);
+    rep->masked_default = measure_prefetch_masking(ctx, cache_ds, rounds);
+    cache_ds = spread_cache_ds(ctx, cache_ds);
+    rep->masked_spread  = measure_prefetch_masking(ctx, cache_ds, rounds);
+    release_cache_ds(ctx, cache_ds);
+
+    rep->msr_readable = is_intel_cpu()
+                        && !read_prefetch_msr(sched_getcpu(), &rep->msr_value);
+
+    free(buf);
+}
+
+/*
+ * Rate of evicted sets that the probe measures as cached. In every round,
+ * PREFETCH_MASK_RUN consecutive sets (of one page group) are evicted after
+ * the prime by flushing their lines, like a victim that accesses a buffer.
+ * The threshold lies between the probe time of a cached set and of a single
+ * evicted set, which the prefetchers cannot hide.
+ */
+double measure_prefetch_masking(cache_ctx *ctx, cacheline *cache_ds,
+    uint32_t rounds)
+{
+    uint32_t i, r, w, first, set, masked = 0, evicted = 0;
+    uint32_t group = (CACHE_GROUP_SIZE < ctx->sets) ? CACHE_GROUP_SIZE : ctx->sets;
+    double threshold;
+    uint64_t hit_sum = 0, miss_sum = 0;
+    uint32_t run = (PREFETCH_MASK_RUN < group) ? PREFETCH_MASK_RUN : group;
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+    evset *es;
+    set_index *idx = prepare_set_index(ctx, cache_ds);
+    time_type *res = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(res);
+
+    // Calibration with a single evicted set
+    for (r = 0; r < rounds; ++r) {
+        es = idx->evset_arr + rand() % idx->sets_len;
+
+        curr_head = prime(curr_head);
+        for (w = 0; w < ctx->associativity; ++w)
+            clflush(es->ways[w]);
+        mfence();
+        next_head = probe(ctx->cache_level, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        miss_sum    += res[es->set];
+        hit_sum     += res[idx->evset_arr[(es - idx->evset_arr + 1)
+                                          % idx->sets_len].set];
+    }
+    threshold = ((double) hit_sum + miss_sum) / (2 * rounds);
+
+    for (r = 0; r < rounds; ++r) {
+        first = rand() % (ctx->sets / group) * group + rand() % (group - run + 1);
+
+        curr_head = prime(curr_head);
+        for (i = 0; i < run; ++i) {
+            es = get_evset(idx, first + i);
+            for (w = 0; es && w < ctx->associativity; ++w)
+                clflush(es->ways[w]);
+        }
+        mfence();
+        next_head = probe(ctx->cache_level, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        for (i = 0; i < run; ++i) {
+            set = first + i;
+            if (get_evset(idx, set)) {
+                masked += res[set] < threshold;
+                ++evicted;
+            }
+        }
+    }
+
+    free(res);
+    release_set_index(idx);
+
+    return evicted ? (double) masked / evicted : 0;
+}
+
+/*
+ * Relink the sets of `cache_ds` in a random order where sets that follow each
+ * other are not within PREFETCH_SPREAD_DIST lines of a page and do not
+ * continue a constant stride. Returns the new head.
+ */
+cacheline *spread_cache_ds(cache_ctx *ctx, cacheline *cache_ds) {
+    uint32_t i, j, cnt;
+    int64_t prev_stride;
+    set_index *idx = prepare_set_index(ctx, cache_ds);
+    uint32_t *sets  = (uint32_t *) malloc(idx->sets_len * sizeof(uint32_t));
+    uint32_t *order = (uint32_t *) malloc(idx->sets_len * sizeof(uint32_t));
+    evset *curr, *next;
+    assert(sets && order);
+
+    for (i = 0; i < idx->sets_len; ++i)
+        sets[i] = idx->evset_arr[i].set;
+    random_perm(sets, idx->sets_len);
+
+    // Greedily take the first remaining set that is far enough, or any set if
+    // there is none (only at the end)
+    order[0]    = sets[0];
+    cnt         = idx->sets_len - 1;
+    memmove(sets, sets + 1, cnt * sizeof(uint32_t));
+    for (i = 1; i < idx->sets_len; ++i) {
+        prev_stride = (i > 1) ? (int64_t) order[i - 1] - order[i - 2] : 0;
+        for (j = 0; j < cnt; ++j) {
+            if (is_spread(order[i - 1], sets[j])
+                && (int64_t) sets[j] - order[i - 1] != prev_stride)
+            {
+                break;
+            }
+        }
+        if (j == cnt)
+            j = 0;
+
+        order[i] = sets[j];
+        sets[j]  = sets[--cnt];
+    }
+
+    for (i = 0; i < idx->sets_len; ++i) {
+        curr = get_evset(idx, order[i]);
+        next = get_evset(idx, order[(i + 1) % idx->sets_len]);
+
+        curr->last->next = next->first;
+        next->first->prev = curr->last;
+    }
+    cache_ds = get_evset(idx, order[0])->first;
+
+    free(sets);
+    free(order);
+    release_set_index(idx);
+
+    return cache_ds;
+}
+
+bool is_intel_cpu(void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    // "GenuineIntel"
+    return ebx == 0x756e6547 && edx == 0x49656e69 && ecx == 0x6c65746e;
+}
+
+/*
+ * Read MSR_MISC_FEATURE_CONTROL of the given CPU, which needs root and the
+ * msr kernel module.
+ * Returns 0 on success, 1 on failure.
+ */
+int read_prefetch_msr(uint32_t cpu, uint64_t *val) {
+    char path[BUFSIZ];
+    int fd;
+    ssize_t len;
+
+    snprintf(path, sizeof(path), "/dev/cpu/%u/msr", cpu);
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 1;
+
+    len = pread(fd, val, sizeof(uint64_t), MSR_MISC_FEATURE_CONTROL);
+    close(fd);
+
+    return len != sizeof(uint64_t);
+}
+
+/*
+ * Whether the spread order hides at least PREFETCH_SPREAD_MIN_GAIN fewer
+ * evictions than the default order
+ */
+bool select_spread_order(prefetch_report *rep) {
+    return rep->masked_spread < rep->masked_default - PREFETCH_SPREAD_MIN_GAIN;
+}
+
+/*
+ * Fancy print the characterisation and the recommendations
+ */
+void print_prefetch_report(prefetch_report *rep) {
+    uint32_t s;
+
+    printf("prefetch_report = {\n\tthreshold: %u,\n\tuntouched: %.3f,\n\t"
+           "adjacent: %.3f,\n\tascending: %.3f,\n\tdescending: %.3f,\n",
+           rep->threshold, rep->untouched, rep->adjacent, rep->ascending,
+           rep->descending);
+    for (s = 2; s <= PREFETCH_MAX_STRIDE; ++s)
+        printf("\tstride %u: %.3f,\n", s, rep->stride[s]);
+    printf("\tmasked_default: %.3f,\n\tmasked_spread: %.3f\n}\n",
+           rep->masked_default, rep->masked_spread);
+
+    if (select_spread_order(rep))
+        printf("The spread order hides fewer evictions, use spread_order = 1\n");
+    else
+        printf("The spread order does not hide clearly fewer evictions\n");
+
+    if (!rep->msr_mask) {
+        printf("No prefetcher patterns observed\n");
+    }
+    else if (!is_intel_cpu()) {
+        printf("Prefetcher patterns observed, disabling them by MSR is only "
+               "known for Intel\n");
+    }
+    else if (rep->msr_readable) {
+        printf("MSR 0x%x = 0x%lx, disable the observed prefetchers with "
+               "wrmsr 0x%x 0x%lx\n", MSR_MISC_FEATURE_CONTROL, rep->msr_value,
+               MSR_MISC_FEATURE_CONTROL, rep->msr_value | rep->msr_mask);
+    }
+    else {
+        printf("With privileges, set the bits 0x%lx of MSR 0x%x to disable the "
+               "observed prefetchers\n", rep->msr_mask, MSR_MISC_FEATURE_CONTROL);
+    }
+}
+
+
+/*
+ * Hit rate of line `target` (relative to `first`) after accessing
+ * `train_len` lines starting at `first` with the given stride in lines, each
+ * trial on a freshly flushed page
+ */
+double get_pattern_hit_rate(uint8_t *buf, uint32_t threshold, uint32_t first,
+    int32_t stride, uint32_t train_len, int32_t target)
+{
+    uint32_t i, l, hits = 0;
+    uint8_t *page;
+
+    for (i = 0; i < PREFETCH_REPS; ++i) {
+        page = buf + (i % PREFETCH_PAGES) * PAGE_SIZE;
+        for (l = 0; l < CACHE_GROUP_SIZE; ++l)
+            clflush(page + l * CACHELINE_SIZE);
+        mfence();
+
+        // All accesses from the same instruction, for the IP-based prefetcher
+        for (l = 0; l < train_len; ++l) {
+            readq(page + (first + (int32_t) l * stride) * CACHELINE_SIZE);
+            mfence();
+        }
+        wait_cycles(PREFETCH_WAIT);
+
+        hits += accesstime(page + (first + target) * CACHELINE_SIZE) < threshold;
+    }
+
+    return (double) hits / PREFETCH_REPS;
+}
+
+void wait_cycles(uint64_t cycles) {
+    uint64_t start = __rdtsc();
+
+    while (__rdtsc() - start < cycles)
+        ;
+}
+
+/*
+ * Lines of sets in different page groups are in different pages
+ */
+bool is_spread(uint32_t s1, uint32_t s2) {
+    uint32_t o1 = s1 % CACHE_GROUP_SIZE;
+    uint32_t o2 = s2 % CACHE_GROUP_SIZE;
+
+    return s1 / CACHE_GROUP_SIZE != s2 / CACHE_GROUP_SIZE
+           || (o1 > o2 ? o1 - o2 : o2 - o1) >= PREFETCH_SPREAD_DIST;
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Characterisation of the hardware prefetchers and their effect on
+ * Prime+Probe. Each prefetcher is triggered with a controlled pattern of
+ * accesses to a flushed page (a line and its 128-byte buddy, ascending and
+ * descending lines, constant strides from the same instruction) and the hit
+ * rate of the line it would fetch is compared to that of an untouched line.
+ * On the attack data structure, a victim that evicts consecutive sets lets
+ * the attacker miss on consecutive lines of its pages during the probe, which
+ * can make the prefetchers fetch the lines of the next evicted sets before
+ * they are probed and thus hide their eviction. The masking rate measures
+ * this for a given order of the sets. The spread order relinks the sets such
+ * that sets traversed one after the other are never close in a page, which
+ * breaks these patterns. Intel cores can disable their prefetchers in
+ * MSR_MISC_FEATURE_CONTROL, which is only reported, never written.
+ */
+
+#ifndef HEADER_PREFETCH_H
+#define HEADER_PREFETCH_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "set_index.h"
+
+// Trials per pattern
+#define PREFETCH_REPS 500
+// Accesses that train a prefetcher
+#define PREFETCH_TRAIN_LEN 4
+// Largest stride in lines that is tested
+#define PREFETCH_MAX_STRIDE 8
+// Pages of the buffer for the patterns, a fresh one is used per trial
+#define PREFETCH_PAGES 64
+// Consecutive sets that are evicted in the masking measurement
+#define PREFETCH_MASK_RUN 8
+// Minimal distance in lines between sets traversed one after the other in
+// the spread order, i.e. more than a 128-byte pair and the next line
+#define PREFETCH_SPREAD_DIST 4
+// Hit rate above the untouched line from which a prefetcher counts as active
+#define PREFETCH_MIN_RATE 0.1
+// The spread order must hide this much lower a rate of evictions than the
+// default order, which is already a random order of the sets, to be
+// recommended (well above the noise of the rates for the default rounds)
+#define PREFETCH_SPREAD_MIN_GAIN 0.02
+
+// Intel MSR_MISC_FEATURE_CONTROL, a set bit disables the prefetcher
+#define MSR_MISC_FEATURE_CONTROL 0x1a4
+#define MSR_PF_L2_STREAMER (1 << 0)
+#define MSR_PF_L2_ADJACENT (1 << 1)
+#define MSR_PF_DCU_NEXT_LINE (1 << 2)
+#define MSR_PF_DCU_IP (1 << 3)
+
+typedef struct prefetch_report prefetch_report;
+
+// Hit rates of the line a prefetcher would fetch
+struct prefetch_report {
+    uint32_t threshold;
+
+    double untouched;
+    double adjacent;
+    double ascending;
+    double descending;
+    // Index is the stride in lines, from 2
+    double stride[PREFETCH_MAX_STRIDE + 1];
+
+    // Rates of evicted sets that were measured as cached
+    double masked_default;
+    double masked_spread;
+
+    // Prefetchers of MSR_MISC_FEATURE_CONTROL whose patterns were observed
+    uint64_t msr_mask;
+    bool msr_readable;
+    uint64_t msr_value;
+};
+
+uint32_t calibrate_prefetch_threshold(void);
+void characterize_prefetchers(cache_ctx *ctx, uint32_t rounds,
+    prefetch_report *rep);
+double measure_prefetch_masking(cache_ctx *ctx, cacheline *cache_ds,
+    uint32_t rounds);
+cacheline *spread_cache_ds(cache_ctx *ctx, cacheline *cache_ds);
+bool select_spread_order(prefetch_report *rep);
+bool is_intel_cpu(void);
+int read_prefetch_msr(uint32_t cpu, uint64_t *val);
+void print_prefetch_report(prefetch_report *rep);
+
+#endif // HEADER_PREFETCH_H
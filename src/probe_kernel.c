@@ -0,0 +1,302 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the measurement of the probe kernels.
+ */
+
+#include "probe_kernel.h"
+
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <x86intrin.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+// Fallback if the generic front-end stall event is not supported (as on many
+// Intel cores): IDQ_UOPS_NOT_DELIVERED.CORE, uop slots the front-end did not
+// deliver to the back-end
+#define RAW_FRONTEND_EVENT 0x019c
+
+#define REPEAT_2(x) x x
+#define REPEAT_CALL_SITES(x) REPEAT_2(REPEAT_2(REPEAT_2(x)))
+_Static_assert(PROBE_KERNEL_CALL_SITES == 8, "update REPEAT_CALL_SITES");
+
+typedef struct kernel_counters kernel_counters;
+typedef struct kernel_run kernel_run;
+
+struct kernel_counters {
+    int frontend_fd;
+    int instructions_fd;
+};
+
+struct kernel_run {
+    uint64_t cycles;
+    uint64_t frontend_stalls;
+    uint64_t instructions;
+    uint64_t set_time_sum;
+    uint64_t set_time_sum_sq;
+};
+
+// local functions
+int open_perf_counter(uint32_t type, uint64_t config);
+void open_kernel_counters(kernel_counters *kc);
+void close_kernel_counters(kernel_counters *kc);
+void start_kernel_counters(kernel_counters *kc);
+void stop_kernel_counters(kernel_counters *kc, kernel_run *run);
+void run_probe_kernel(cache_ctx *ctx, probe_kernel kernel, bool do_probe,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run);
+void probe_kernel_run_l1_unrolled(bool do_probe, uint32_t sets,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run);
+void probe_kernel_run_l1_partial(bool do_probe, uint32_t sets,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run);
+void probe_kernel_run_l1_rolled(bool do_probe, uint32_t sets,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run);
+void probe_kernel_run_l2_unrolled(bool do_probe, uint32_t sets,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run);
+void probe_kernel_run_l2_partial(bool do_probe, uint32_t sets,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run);
+void probe_kernel_run_l2_rolled(bool do_probe, uint32_t sets,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run);
+__attribute__((always_inline))
+static inline void run_probe_kernel_sites(cache_level cl, probe_kernel kernel,
+    bool do_probe, uint32_t sets, cacheline *cache_ds, uint32_t rounds,
+    time_type *msrmts, kernel_run *run);
+
+
+const char *get_probe_kernel_name(probe_kernel kernel) {
+    if (kernel == PROBE_ROLLED)
+        return "rolled";
+    else if (kernel == PROBE_PARTIAL)
+        return "partial";
+    else
+        return "unrolled";
+}
+
+/*
+ * Value of Lx_PROBE_UNROLL in device_conf.h that selects the kernel
+ */
+uint32_t get_probe_kernel_unroll(cache_ctx *ctx, probe_kernel kernel) {
+    if (kernel == PROBE_ROLLED)
+        return 1;
+    else if (kernel == PROBE_PARTIAL && PROBE_KERNEL_PARTIAL_UNROLL
+                                        < ctx->associativity - 1)
+        return PROBE_KERNEL_PARTIAL_UNROLL;
+    else
+        return 0;
+}
+
+/*
+ * Prime and probe the data structure `rounds` times at each of the
+ * PROBE_KERNEL_CALL_SITES call sites with the given kernel. The front-end
+ * stalls and instructions of priming and extracting the measurements are
+ * measured separately (in the same code without probe) and subtracted.
+ */
+void evaluate_probe_kernel(cache_ctx *ctx, probe_kernel kernel,
+    cacheline *cache_ds, uint32_t rounds, probe_kernel_score *score)
+{
+    double probes = (double) rounds * PROBE_KERNEL_CALL_SITES;
+    double set_times = probes * ctx->sets;
+    kernel_counters kc;
+    kernel_run base, run;
+    time_type *msrmts = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(msrmts);
+
+    open_kernel_counters(&kc);
+
+    // Warm up
+    run_probe_kernel(ctx, kernel, true, cache_ds, 1, msrmts, &run);
+
+    start_kernel_counters(&kc);
+    run_probe_kernel(ctx, kernel, false, cache_ds, rounds, msrmts, &base);
+    stop_kernel_counters(&kc, &base);
+
+    start_kernel_counters(&kc);
+    run_probe_kernel(ctx, kernel, true, cache_ds, rounds, msrmts, &run);
+    stop_kernel_counters(&kc, &run);
+
+    score->cycles           = run.cycles / probes;
+    score->frontend_stalls  = (kc.frontend_fd < 0) ? -1
+        : ((double) run.frontend_stalls - base.frontend_stalls) / probes;
+    score->instructions     = (kc.instructions_fd < 0) ? -1
+        : ((double) run.instructions - base.instructions) / probes;
+    score->set_time_mean    = run.set_time_sum / set_times;
+    score->set_time_std     = sqrt(fmax(run.set_time_sum_sq / set_times
+                                        - score->set_time_mean
+                                          * score->set_time_mean, 0));
+
+    close_kernel_counters(&kc);
+    free(msrmts);
+}
+
+/*
+ * The fastest kernel, where the fully unrolled kernel wins ties within
+ * PROBE_KERNEL_MIN_GAIN. `scores` is indexed by probe_kernel.
+ */
+probe_kernel select_probe_kernel(probe_kernel_score *scores) {
+    probe_kernel k, best = PROBE_UNROLLED;
+
+    for (k = PROBE_PARTIAL; k <= PROBE_ROLLED; ++k) {
+        if (scores[k].cycles < scores[best].cycles
+            && scores[k].cycles < scores[PROBE_UNROLLED].cycles
+                                  * (1 - PROBE_KERNEL_MIN_GAIN))
+        {
+            best = k;
+        }
+    }
+
+    return best;
+}
+
+
+/*
+ * Count an event of the calling thread in user space.
+ * Returns the file descriptor, negative if the event is not available.
+ */
+int open_perf_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void open_kernel_counters(kernel_counters *kc) {
+    kc->frontend_fd = open_perf_counter(PERF_TYPE_HARDWARE,
+                                        PERF_COUNT_HW_STALLED_CYCLES_FRONTEND);
+    if (kc->frontend_fd < 0)
+        kc->frontend_fd = open_perf_counter(PERF_TYPE_RAW, RAW_FRONTEND_EVENT);
+
+    kc->instructions_fd = open_perf_counter(PERF_TYPE_HARDWARE,
+                                            PERF_COUNT_HW_INSTRUCTIONS);
+}
+
+void close_kernel_counters(kernel_counters *kc) {
+    if (kc->frontend_fd >= 0)
+        close(kc->frontend_fd);
+    if (kc->instructions_fd >= 0)
+        close(kc->instructions_fd);
+}
+
+void start_kernel_counters(kernel_counters *kc) {
+    int fds[] = {kc->frontend_fd, kc->instructions_fd};
+
+    for (uint32_t i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+        if (fds[i] >= 0) {
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void stop_kernel_counters(kernel_counters *kc, kernel_run *run) {
+    if (kc->frontend_fd >= 0) {
+        ioctl(kc->frontend_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(kc->frontend_fd, &run->frontend_stalls, sizeof(uint64_t))
+            != sizeof(uint64_t))
+        {
+            run->frontend_stalls = 0;
+        }
+    }
+
+    if (kc->instructions_fd >= 0) {
+        ioctl(kc->instructions_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(kc->instructions_fd, &run->instructions, sizeof(uint64_t))
+            != sizeof(uint64_t))
+        {
+            run->instructions = 0;
+        }
+    }
+}
+
+/*
+ * One instance of the measurement loop per cache level and kernel, such that
+ * the kernel is inlined at every call site. They are separate functions to
+ * stay within the inlining limits of the compiler.
+ */
+#define DEFINE_RUN_SITES(name, cl, kernel) \
+    void name(bool do_probe, uint32_t sets, cacheline *cache_ds, \
+        uint32_t rounds, time_type *msrmts, kernel_run *run) \
+    { \
+        run_probe_kernel_sites(cl, kernel, do_probe, sets, cache_ds, rounds, \
+                               msrmts, run); \
+    }
+
+DEFINE_RUN_SITES(probe_kernel_run_l1_unrolled, L1, PROBE_UNROLLED)
+DEFINE_RUN_SITES(probe_kernel_run_l1_partial, L1, PROBE_PARTIAL)
+DEFINE_RUN_SITES(probe_kernel_run_l1_rolled, L1, PROBE_ROLLED)
+DEFINE_RUN_SITES(probe_kernel_run_l2_unrolled, L2, PROBE_UNROLLED)
+DEFINE_RUN_SITES(probe_kernel_run_l2_partial, L2, PROBE_PARTIAL)
+DEFINE_RUN_SITES(probe_kernel_run_l2_rolled, L2, PROBE_ROLLED)
+
+void run_probe_kernel(cache_ctx *ctx, probe_kernel kernel, bool do_probe,
+    cacheline *cache_ds, uint32_t rounds, time_type *msrmts, kernel_run *run)
+{
+    void (*run_sites[2][PROBE_ROLLED + 1])(bool, uint32_t, cacheline *,
+        uint32_t, time_type *, kernel_run *) = {
+        {probe_kernel_run_l1_unrolled, probe_kernel_run_l1_partial,
+         probe_kernel_run_l1_rolled},
+        {probe_kernel_run_l2_unrolled, probe_kernel_run_l2_partial,
+         probe_kernel_run_l2_rolled},
+    };
+
+    memset(run, 0, sizeof(kernel_run));
+    run_sites[ctx->cache_level][kernel](do_probe, ctx->sets, cache_ds, rounds,
+                                        msrmts, run);
+}
+
+static inline void run_probe_kernel_sites(cache_level cl, probe_kernel kernel,
+    bool do_probe, uint32_t sets, cacheline *cache_ds, uint32_t rounds,
+    time_type *msrmts, kernel_run *run)
+{
+    uint32_t r, s;
+    uint64_t start;
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+
+    for (r = 0; r < rounds; ++r) {
+        REPEAT_CALL_SITES({
+            curr_head = prime(curr_head);
+
+            start = __rdtsc();
+            next_head = do_probe ? probe_kernel_ds(cl, kernel, curr_head)
+                                 : curr_head;
+            run->cycles += __rdtsc() - start;
+
+            get_msrmts_for_all_set(curr_head, msrmts);
+            curr_head = next_head;
+
+            for (s = 0; s < sets; ++s) {
+                run->set_time_sum       += msrmts[s];
+                run->set_time_sum_sq    += (uint64_t) msrmts[s] * msrmts[s];
+            }
+        })
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Comparison of the probe kernels generated by gen_cache_asm_files.py. The
+ * fully unrolled kernel has no branches in the timed code, but probe is
+ * inlined at every call site, so for wide sets the copies can exceed the uop
+ * cache and stall the front-end. The rolled and partially unrolled kernels
+ * are small but add a loop to the timed code. Each kernel is timed when
+ * inlined at PROBE_KERNEL_CALL_SITES call sites, and front-end stalls and
+ * instructions are counted with perf events where available. The kernel of
+ * an attack is selected per cache level with Lx_PROBE_UNROLL in
+ * device_conf.h.
+ */
+
+#ifndef HEADER_PROBE_KERNEL_H
+#define HEADER_PROBE_KERNEL_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cache.h"
+
+// Copies of the probe that are inlined in the measurement, like in an attack
+// that probes at several places
+#define PROBE_KERNEL_CALL_SITES 8
+// The loads per loop iteration of the partially unrolled kernel,
+// PROBE_KERNEL_PARTIAL_UNROLL, are generated in l1_asm.h and l2_asm.h
+// A kernel must be this much faster than the fully unrolled one to be
+// recommended, which is preferred for its branch-free timed code
+#define PROBE_KERNEL_MIN_GAIN 0.02
+
+typedef enum probe_kernel probe_kernel;
+typedef struct probe_kernel_score probe_kernel_score;
+
+enum probe_kernel {PROBE_UNROLLED, PROBE_PARTIAL, PROBE_ROLLED};
+
+struct probe_kernel_score {
+    // Per probe of the complete data structure
+    double cycles;
+    // Counted with perf events, negative if not available
+    double frontend_stalls;
+    double instructions;
+
+    // Probe time of a set
+    double set_time_mean;
+    double set_time_std;
+};
+
+const char *get_probe_kernel_name(probe_kernel kernel);
+uint32_t get_probe_kernel_unroll(cache_ctx *ctx, probe_kernel kernel);
+void evaluate_probe_kernel(cache_ctx *ctx, probe_kernel kernel,
+    cacheline *cache_ds, uint32_t rounds, probe_kernel_score *score);
+probe_kernel select_probe_kernel(probe_kernel_score *scores);
+
+__attribute__((always_inline))
+static inline cacheline *probe_cacheset_kernel(cache_level cl,
+    probe_kernel kernel, cacheline *curr_cl);
+__attribute__((always_inline))
+static inline cacheline *probe_kernel_ds(cache_level cl, probe_kernel kernel,
+    cacheline *head);
+
+/*
+ * Same as probe_cacheset with the given kernel instead of the configured one
+ */
+static inline cacheline *probe_cacheset_kernel(cache_level cl,
+    probe_kernel kernel, cacheline *curr_cl)
+{
+    if (cl == L1) {
+        if (kernel == PROBE_ROLLED)
+            return asm_l1_probe_cacheset_rolled(curr_cl);
+        else if (kernel == PROBE_PARTIAL)
+            return asm_l1_probe_cacheset_partial(curr_cl);
+        else
+            return asm_l1_probe_cacheset_unrolled(curr_cl);
+    }
+    else if (cl == L2) {
+        if (kernel == PROBE_ROLLED)
+            return asm_l2_probe_cacheset_rolled(curr_cl);
+        else if (kernel == PROBE_PARTIAL)
+            return asm_l2_probe_cacheset_partial(curr_cl);
+        else
+            return asm_l2_probe_cacheset_unrolled(curr_cl);
+    }
+    else {
+        return NULL;
+    }
+}
+
+/*
+ * Same as probe with the given kernel, which is expected to be a constant
+ */
+static inline cacheline *probe_kernel_ds(cache_level cl, probe_kernel kernel,
+    cacheline *head)
+{
+    cacheline *curr_cs = head;
+
+    do {
+        curr_cs = probe_cacheset_kernel(cl, kernel, curr_cs);
+    } while(__builtin_expect(curr_cs != head, 1));
+
+    return curr_cs->next;
+}
+
+#endif // HEADER_PROBE_KERNEL_H
@@ -0,0 +1,244 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the per-set signal-quality metrics.
+ */
+
+#include "quality.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// local functions
+int cmp_quality_sets(const void *a, const void *b, void *arg);
+
+
+signal_quality *prepare_signal_quality(uint32_t classes, uint32_t sets) {
+    signal_quality *q = (signal_quality *) calloc(1, sizeof(signal_quality));
+    assert(q);
+    assert(classes > 0 && sets > 0);
+
+    q->classes  = classes;
+    q->sets     = sets;
+
+    q->cnt          = (uint64_t *) calloc(classes, sizeof(uint64_t));
+    q->mean         = (double *) calloc((uint64_t) classes * sets, sizeof(double));
+    q->m2           = (double *) calloc((uint64_t) classes * sets, sizeof(double));
+    q->snr          = (double *) calloc(sets, sizeof(double));
+    q->separability = (double *) calloc(sets, sizeof(double));
+    q->info         = (double *) calloc(sets, sizeof(double));
+    q->noise        = (double *) calloc(sets, sizeof(double));
+    assert(q->cnt && q->mean && q->m2 && q->snr && q->separability && q->info
+           && q->noise);
+
+    return q;
+}
+
+void release_signal_quality(signal_quality *q) {
+    free(q->cnt);
+    free(q->mean);
+    free(q->m2);
+    free(q->snr);
+    free(q->separability);
+    free(q->info);
+    free(q->noise);
+    free(q);
+}
+
+/*
+ * Add the accumulators to the state of a checkpoint
+ */
+void add_signal_quality_checkpoint(checkpoint *cp, signal_quality *q) {
+    uint64_t len = (uint64_t) q->classes * q->sets;
+
+    add_checkpoint_region(cp, &q->samples, sizeof(q->samples));
+    add_checkpoint_region(cp, q->cnt, q->classes * sizeof(uint64_t));
+    add_checkpoint_region(cp, q->mean, len * sizeof(double));
+    add_checkpoint_region(cp, q->m2, len * sizeof(double));
+}
+
+void update_signal_quality(signal_quality *q, uint32_t cls, const time_type *res) {
+    uint32_t s;
+    double delta;
+    double *mean    = q->mean + (uint64_t) cls * q->sets;
+    double *m2      = q->m2 + (uint64_t) cls * q->sets;
+
+    assert(cls < q->classes);
+
+    ++q->cnt[cls];
+    ++q->samples;
+
+    for (s = 0; s < q->sets; ++s) {
+        delta    = res[s] - mean[s];
+        mean[s] += delta / q->cnt[cls];
+        m2[s]   += delta * (res[s] - mean[s]);
+    }
+}
+
+/*
+ * Compute the metrics of all sets from the accumulators. Classes without
+ * samples are ignored.
+ */
+void compute_signal_quality(signal_quality *q) {
+    uint32_t c, s, used = 0;
+    uint64_t idx;
+    double total_mean, within, between, min_mean, max_mean;
+
+    for (c = 0; c < q->classes; ++c)
+        used += q->cnt[c] > 0;
+
+    q->best_set = 0;
+
+    for (s = 0; s < q->sets; ++s) {
+        total_mean  = 0;
+        within      = 0;
+        min_mean    = INFINITY;
+        max_mean    = -INFINITY;
+
+        for (c = 0; c < q->classes; ++c) {
+            if (!q->cnt[c])
+                continue;
+            idx         = (uint64_t) c * q->sets + s;
+            total_mean += q->cnt[c] * q->mean[idx];
+            within     += q->m2[idx];
+            min_mean    = fmin(min_mean, q->mean[idx]);
+            max_mean    = fmax(max_mean, q->mean[idx]);
+        }
+
+        q->snr[s]           = 0;
+        q->separability[s]  = 0;
+        q->info[s]          = 0;
+        q->noise[s]         = 0;
+        if (q->samples <= used)
+            continue;
+
+        total_mean /= q->samples;
+        within     /= q->samples - used;
+        q->noise[s] = sqrt(within);
+
+        between = 0;
+        for (c = 0; c < q->classes; ++c) {
+            if (!q->cnt[c])
+                continue;
+            idx      = (uint64_t) c * q->sets + s;
+            between += q->cnt[c] * (q->mean[idx] - total_mean)
+                       * (q->mean[idx] - total_mean);
+        }
+        // The estimation noise of the class means adds (used - 1) / samples
+        // times the noise variance to the variance of the means
+        between = fmax(between / q->samples - (used - 1) * within / q->samples, 0);
+
+        if (within > 0) {
+            q->snr[s]           = between / within;
+            q->separability[s]  = (max_mean - min_mean) / sqrt(within);
+        }
+        q->info[s] = 0.5 * log2(1 + q->snr[s]);
+
+        if (q->info[s] > q->info[q->best_set])
+            q->best_set = s;
+    }
+}
+
+/*
+ * Returns the number of samples after which the best set carries `bits` bits
+ * (UINT64_MAX if it carries no information). This is a lower bound, as the
+ * capacity assumes an optimal use of every sample.
+ */
+uint64_t get_quality_samples_needed(signal_quality *q, double bits) {
+    double info = q->info[q->best_set];
+
+    if (info <= 0)
+        return UINT64_MAX;
+
+    return (uint64_t) ceil(bits / info);
+}
+
+/*
+ * Recompute the metrics and check whether the samples so far carry `bits`
+ * bits in the best set
+ */
+bool is_signal_quality_sufficient(signal_quality *q, double bits) {
+    compute_signal_quality(q);
+    return q->samples >= get_quality_samples_needed(q, bits);
+}
+
+void print_signal_quality(signal_quality *q) {
+    uint32_t i, s, top;
+    uint32_t *order = (uint32_t *) malloc(q->sets * sizeof(uint32_t));
+    assert(order);
+
+    for (s = 0; s < q->sets; ++s)
+        order[s] = s;
+    qsort_r(order, q->sets, sizeof(uint32_t), cmp_quality_sets, q);
+
+    top = (q->sets < QUALITY_PRINT_TOP) ? q->sets : QUALITY_PRINT_TOP;
+    printf("signal_quality = {\n\tsamples: %lu,\n\tclasses: %u,\n"
+           "\tsets (set: snr, separability, bits per sample, noise):\n",
+           q->samples, q->classes);
+    for (i = 0; i < top; ++i) {
+        s = order[i];
+        printf("\t\t%4u: %9.5f, %7.3f, %9.6f, %8.2f\n", s, q->snr[s],
+               q->separability[s], q->info[s], q->noise[s]);
+    }
+    printf("}\n");
+
+    free(order);
+}
+
+/*
+ * Store the metrics of all sets, e.g. next to a trace file.
+ * Returns 0 on success, 1 on failure.
+ */
+int save_signal_quality(const char *path, signal_quality *q) {
+    uint32_t s;
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return 1;
+
+    fprintf(fp, "# CacheSC signal quality\n");
+    fprintf(fp, "samples = %lu\n", q->samples);
+    fprintf(fp, "classes = %u\n", q->classes);
+    fprintf(fp, "best_set = %u\n", q->best_set);
+    fprintf(fp, "# set snr separability bits_per_sample noise\n");
+    for (s = 0; s < q->sets; ++s) {
+        fprintf(fp, "%u %.9g %.9g %.9g %.9g\n", s, q->snr[s],
+                q->separability[s], q->info[s], q->noise[s]);
+    }
+
+    return fclose(fp) != 0;
+}
+
+/*
+ * Order sets by decreasing information, then by index
+ */
+int cmp_quality_sets(const void *a, const void *b, void *arg) {
+    signal_quality *q = (signal_quality *) arg;
+    uint32_t sa = *(const uint32_t *) a;
+    uint32_t sb = *(const uint32_t *) b;
+
+    if (q->info[sa] != q->info[sb])
+        return (q->info[sa] < q->info[sb]) ? 1 : -1;
+
+    return (int) sa - (int) sb;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Per-set signal-quality metrics from streaming accumulators. Samples are
+ * accumulated per class (e.g. the accessed table line or the nibble of a
+ * known input, a single class for unlabeled runs) with Welford's algorithm.
+ * The metrics per set are the signal-to-noise ratio (variance of the class
+ * means, corrected for their estimation noise, over the pooled noise
+ * variance), the separability (range of the class means in pooled standard
+ * deviations) and the information per sample in bits, estimated as the
+ * capacity 0.5 * log2(1 + SNR) of a Gaussian channel. The information of the
+ * best set bounds the samples needed to learn a given number of bits.
+ */
+
+#ifndef HEADER_QUALITY_H
+#define HEADER_QUALITY_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "cache_types.h"
+#include "checkpoint.h"
+
+// Sets that are listed by print_signal_quality
+#define QUALITY_PRINT_TOP 8
+
+typedef struct signal_quality signal_quality;
+
+struct signal_quality {
+    uint32_t classes;
+    uint32_t sets;
+    uint64_t samples;
+
+    // Per class: sample count, mean and sum of squared deviations per set
+    // (index class * sets + set)
+    uint64_t *cnt;
+    double *mean;
+    double *m2;
+
+    // Metrics per set of the last compute_signal_quality
+    double *snr;
+    double *separability;
+    double *info;
+    double *noise;
+    uint32_t best_set;
+};
+
+signal_quality *prepare_signal_quality(uint32_t classes, uint32_t sets);
+void release_signal_quality(signal_quality *q);
+void add_signal_quality_checkpoint(checkpoint *cp, signal_quality *q);
+void update_signal_quality(signal_quality *q, uint32_t cls, const time_type *res);
+void compute_signal_quality(signal_quality *q);
+uint64_t get_quality_samples_needed(signal_quality *q, double bits);
+bool is_signal_quality_sufficient(signal_quality *q, double bits);
+void print_signal_quality(signal_quality *q);
+int save_signal_quality(const char *path, signal_quality *q);
+
+#endif // HEADER_QUALITY_H
@@ -0,0 +1,251 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the scheduler for multiplexed chosen-input queries.
+ */
+
+#include "query_sched.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "color_alloc.h"
+
+// local functions
+bool is_sched_query_compatible(query_sched *s, sched_query *q,
+    const uint8_t *input);
+
+
+/*
+ * Prepare a scheduler for a victim with `input_len` input bytes. At most
+ * `max_queries` queries are pending at a time, each with a footprint of at
+ * most `max_query_sets` sets, and at most `max_batch` queries are packed into
+ * one invocation (1 disables multiplexing).
+ */
+query_sched *prepare_query_sched(cache_ctx *ctx, uint32_t input_len,
+    uint32_t max_queries, uint32_t max_query_sets, uint32_t max_batch)
+{
+    uint32_t i, slots;
+    query_sched *s = (query_sched *) calloc(1, sizeof(query_sched));
+    assert(s);
+    assert(max_queries > 0 && max_batch > 0);
+
+    // The queries of the current batch keep their slots until the next
+    // invocation, such that new queries can be added while decoding
+    slots = max_queries + max_batch;
+
+    s->sets             = ctx->sets;
+    s->input_len        = input_len;
+    s->max_query_sets   = max_query_sets;
+    s->max_batch        = max_batch;
+    s->max_queries      = max_queries;
+    s->slots            = slots;
+
+    s->queries      = (sched_query *) calloc(slots, sizeof(sched_query));
+    s->pending      = (uint32_t *) malloc(max_queries * sizeof(uint32_t));
+    s->free_slots   = (uint32_t *) malloc(slots * sizeof(uint32_t));
+    s->batch        = (uint32_t *) malloc(max_batch * sizeof(uint32_t));
+    s->used_sets    = get_set_bitmap(ctx);
+    s->used_input   = (uint8_t *) malloc(input_len ? input_len : 1);
+    assert(s->queries && s->pending && s->free_slots && s->batch
+           && s->used_input);
+
+    for (i = 0; i < slots; ++i) {
+        s->queries[i].input         = (uint8_t *) malloc(input_len ? input_len : 1);
+        s->queries[i].input_mask    = (uint8_t *) malloc(input_len ? input_len : 1);
+        s->queries[i].sets          = (uint32_t *) malloc(max_query_sets
+                                                          * sizeof(uint32_t));
+        assert(s->queries[i].input && s->queries[i].input_mask
+               && s->queries[i].sets);
+
+        // Hand out the slots in ascending order
+        s->free_slots[i] = slots - 1 - i;
+    }
+    s->free_len = slots;
+
+    return s;
+}
+
+void release_query_sched(query_sched *s) {
+    for (uint32_t i = 0; i < s->slots; ++i) {
+        free(s->queries[i].input);
+        free(s->queries[i].input_mask);
+        free(s->queries[i].sets);
+    }
+
+    free(s->queries);
+    free(s->pending);
+    free(s->free_slots);
+    free(s->batch);
+    free(s->used_sets);
+    free(s->used_input);
+    free(s);
+}
+
+/*
+ * Append a query to the FIFO. The query fixes the input bytes with a non-zero
+ * mask entry to the values in `input` and is answered by the probe times of
+ * `sets`.
+ * Returns false if `max_queries` queries are pending.
+ */
+bool add_sched_query(query_sched *s, uint32_t id, const uint8_t *input,
+    const uint8_t *input_mask, const uint32_t *sets, uint32_t sets_len)
+{
+    sched_query *q;
+
+    assert(sets_len <= s->max_query_sets);
+
+    if (s->pending_len == s->max_queries)
+        return false;
+
+    --s->free_len;
+    q = &s->queries[s->free_slots[s->free_len]];
+
+    q->id       = id;
+    q->sets_len = sets_len;
+    memcpy(q->input, input, s->input_len);
+    memcpy(q->input_mask, input_mask, s->input_len);
+    memcpy(q->sets, sets, sets_len * sizeof(uint32_t));
+
+    s->pending[s->pending_len] = s->free_slots[s->free_len];
+    ++s->pending_len;
+
+    return true;
+}
+
+/*
+ * Start the next invocation: release the queries of the previous one and pack
+ * pending queries first-fit (in FIFO order, among the first
+ * QUERY_SCHED_LOOKAHEAD) whose footprints are disjoint from the footprints of
+ * the queries packed so far and whose fixed input bytes agree with them. The
+ * fixed bytes are written to `input`, all other bytes are left as they are
+ * (e.g. random filler chosen by the caller).
+ * Returns the number of packed queries, the victim should then be run on
+ * `input` between prime and probe.
+ */
+uint32_t pack_sched_queries(query_sched *s, uint8_t *input) {
+    uint32_t i, j, k, scanned;
+    sched_query *q;
+
+    for (k = 0; k < s->batch_len; ++k) {
+        s->free_slots[s->free_len] = s->batch[k];
+        ++s->free_len;
+    }
+
+    s->batch_len = 0;
+    memset(s->used_sets, 0, SET_BITMAP_WORDS(s->sets) * sizeof(uint64_t));
+    memset(s->used_input, 0, s->input_len);
+
+    // Move packed queries to the batch and compact the FIFO in place
+    j       = 0;
+    scanned = 0;
+    for (i = 0; i < s->pending_len; ++i) {
+        q = &s->queries[s->pending[i]];
+
+        if (s->batch_len < s->max_batch && scanned < QUERY_SCHED_LOOKAHEAD
+            && is_sched_query_compatible(s, q, input))
+        {
+            for (k = 0; k < q->sets_len; ++k)
+                add_to_set_bitmap(s->used_sets, q->sets[k]);
+
+            for (k = 0; k < s->input_len; ++k) {
+                if (q->input_mask[k]) {
+                    input[k]            = q->input[k];
+                    s->used_input[k]    = 1;
+                }
+            }
+
+            s->batch[s->batch_len] = s->pending[i];
+            ++s->batch_len;
+        }
+        else {
+            s->pending[j] = s->pending[i];
+            ++j;
+        }
+
+        ++scanned;
+    }
+    s->pending_len = j;
+
+    if (s->batch_len) {
+        ++s->invocations;
+        s->answered += s->batch_len;
+    }
+
+    return s->batch_len;
+}
+
+/*
+ * Decode the response of the k-th packed query of the current invocation from
+ * the probe times `res` (indexed by cache set, as returned by
+ * get_msrmts_for_all_set). Stores its id and the probe times of its
+ * footprint in `msrmts`.
+ * Returns the number of measurements.
+ */
+uint32_t decode_sched_query(query_sched *s, uint32_t k, const time_type *res,
+    uint32_t *id, time_type *msrmts)
+{
+    sched_query *q;
+
+    assert(k < s->batch_len);
+    q = &s->queries[s->batch[k]];
+
+    *id = q->id;
+    for (uint32_t i = 0; i < q->sets_len; ++i)
+        msrmts[i] = res[q->sets[i]];
+
+    return q->sets_len;
+}
+
+/*
+ * Fancy print the throughput of the scheduler
+ */
+void print_query_sched(query_sched *s) {
+    printf("query_sched = {\n\tinvocations: %lu,\n\tanswered: %lu,\n\t"
+           "queries per invocation: %.2f,\n\tpending: %u\n}\n",
+           s->invocations, s->answered,
+           s->invocations ? (double) s->answered / s->invocations : 0,
+           s->pending_len);
+}
+
+/*
+ * A query fits into the current invocation if none of its sets is used yet
+ * and its fixed input bytes are either unused or fixed to the same value.
+ */
+bool is_sched_query_compatible(query_sched *s, sched_query *q,
+    const uint8_t *input)
+{
+    uint32_t i;
+
+    for (i = 0; i < q->sets_len; ++i) {
+        if (is_in_set_bitmap(s->used_sets, q->sets[i]))
+            return false;
+    }
+
+    for (i = 0; i < s->input_len; ++i) {
+        if (q->input_mask[i] && s->used_input[i] && input[i] != q->input[i])
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,44 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Adapter ABI of cachesc-scan. A shared library exports the scanned function
+ * with the signature cachesc_scan_fn; the harness calls it once per sample
+ * with a generated input. An optional function of the same name with the
+ * suffix CACHESC_SCAN_INIT_SUFFIX is called once before sampling, e.g. to set
+ * up keys or allocate buffers, such that this work is not measured.
+ */
+
+#ifndef HEADER_SCAN_H
+#define HEADER_SCAN_H
+
+#include <stdint.h>
+
+#define CACHESC_SCAN_INIT_SUFFIX "_init"
+
+// Scanned function, called with `input_len` bytes of input per sample
+typedef void (*cachesc_scan_fn)(const uint8_t *input, uint32_t input_len);
+
+// Optional setup, returns 0 on success
+typedef int (*cachesc_scan_init_fn)(uint32_t input_len);
+
+#endif // HEADER_SCAN_H
@@ -0,0 +1,302 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the online change-point segmentation of captures.
+ */
+
+#include "segment.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// local functions
+time_type get_median_time(time_type *vals, uint32_t cnt);
+void open_segment(segmenter *seg, uint64_t start);
+
+
+segmenter *prepare_segmenter(uint32_t sets, uint32_t input_len) {
+    segmenter *seg = (segmenter *) calloc(1, sizeof(segmenter));
+    assert(seg);
+
+    seg->sets       = sets;
+    seg->input_len  = input_len;
+    seg->seg_max    = 16;
+
+    seg->set_threshold  = (time_type *) calloc(sets, sizeof(time_type));
+    seg->seg_start      = (uint64_t *) malloc(seg->seg_max * sizeof(uint64_t));
+    seg->seg_len        = (uint64_t *) malloc(seg->seg_max * sizeof(uint64_t));
+    seg->ring_inputs    = (uint8_t *) malloc(SEGMENT_LOOKBACK * (input_len ? input_len : 1));
+    seg->ring_res       = (time_type *) malloc((uint64_t) SEGMENT_LOOKBACK * sets
+                                               * sizeof(time_type));
+    assert(seg->set_threshold && seg->seg_start && seg->seg_len
+           && seg->ring_inputs && seg->ring_res);
+
+    return seg;
+}
+
+void release_segmenter(segmenter *seg) {
+    free(seg->set_threshold);
+    free(seg->seg_start);
+    free(seg->seg_len);
+    free(seg->ring_inputs);
+    free(seg->ring_res);
+    free(seg);
+}
+
+/*
+ * Learn the idle thresholds of the sets and the idle distribution of the
+ * occupancy from `cnt` samples (e.g. SEGMENT_CALIB_SAMPLES). Medians and
+ * MADs are used to reject outliers, so less than half of the samples may
+ * contain activity.
+ */
+void calibrate_segmenter(segmenter *seg, const time_type *res, uint32_t cnt) {
+    uint32_t i, s, occupancy, inliers;
+    time_type median, mad, limit;
+    double sum, sum_sq;
+    time_type *vals = (time_type *) malloc(cnt * sizeof(time_type));
+    assert(vals);
+    assert(cnt > 0);
+
+    for (s = 0; s < seg->sets; ++s) {
+        for (i = 0; i < cnt; ++i)
+            vals[i] = res[(uint64_t) i * seg->sets + s];
+        median = get_median_time(vals, cnt);
+
+        for (i = 0; i < cnt; ++i) {
+            vals[i] = res[(uint64_t) i * seg->sets + s];
+            vals[i] = (vals[i] > median) ? vals[i] - median : median - vals[i];
+        }
+        mad = get_median_time(vals, cnt);
+
+        seg->set_threshold[s] = median + SEGMENT_SET_MADS * (mad ? mad : 1);
+    }
+
+    for (i = 0; i < cnt; ++i)
+        vals[i] = get_occupancy(seg, res + (uint64_t) i * seg->sets);
+    median = get_median_time(vals, cnt);
+
+    for (i = 0; i < cnt; ++i)
+        vals[i] = (vals[i] > median) ? vals[i] - median : median - vals[i];
+    mad = get_median_time(vals, cnt);
+
+    // Mean and standard deviation of the occupancy without outliers (the
+    // occupancy is a small count, its MAD is often 0)
+    limit   = median + SEGMENT_SET_MADS * (mad ? mad : 1);
+    sum     = 0;
+    sum_sq  = 0;
+    inliers = 0;
+    for (i = 0; i < cnt; ++i) {
+        occupancy = get_occupancy(seg, res + (uint64_t) i * seg->sets);
+        if (occupancy > limit)
+            continue;
+        sum     += occupancy;
+        sum_sq  += (double) occupancy * occupancy;
+        ++inliers;
+    }
+
+    seg->idle_mean  = sum / inliers;
+    seg->idle_std   = fmax(sqrt(fmax(sum_sq / inliers - seg->idle_mean * seg->idle_mean, 0)),
+                           SEGMENT_MIN_STD);
+
+    free(vals);
+}
+
+/*
+ * Add the idle calibration to the state of a checkpoint. The detection state
+ * and the segments are not saved: a resumed capture continues idle, with
+ * samples and segments counted from the resume.
+ */
+void add_segmenter_checkpoint(checkpoint *cp, segmenter *seg) {
+    add_checkpoint_region(cp, seg->set_threshold, seg->sets * sizeof(time_type));
+    add_checkpoint_region(cp, &seg->idle_mean, sizeof(seg->idle_mean));
+    add_checkpoint_region(cp, &seg->idle_std, sizeof(seg->idle_std));
+}
+
+/*
+ * Returns the number of sets of a sample above their idle threshold
+ */
+uint32_t get_occupancy(segmenter *seg, const time_type *res) {
+    uint32_t s, occupancy = 0;
+
+    for (s = 0; s < seg->sets; ++s)
+        occupancy += res[s] > seg->set_threshold[s];
+
+    return occupancy;
+}
+
+/*
+ * Feed the next sample to the detector. `input` may be NULL if the
+ * segmenter was prepared without inputs. On SEGMENT_START, the new segment
+ * starts at seg->seg_start[seg->seg_cnt - 1], which can precede the current
+ * sample by the detection delay. On SEGMENT_END, seg->seg_len of this
+ * segment is set.
+ */
+segment_event update_segmenter(segmenter *seg, const uint8_t *input,
+    const time_type *res)
+{
+    double z;
+    uint64_t idx = seg->samples;
+    uint32_t slot = idx % SEGMENT_LOOKBACK;
+    segment_event event = SEGMENT_NONE;
+
+    assert(seg->idle_std > 0 && "calibrate_segmenter is required first");
+
+    if (seg->input_len)
+        memcpy(seg->ring_inputs + slot * seg->input_len, input, seg->input_len);
+    memcpy(seg->ring_res + (uint64_t) slot * seg->sets, res,
+           seg->sets * sizeof(time_type));
+
+    z = (get_occupancy(seg, res) - seg->idle_mean) / seg->idle_std;
+
+    if (!seg->active) {
+        seg->cusum_up = fmax(0, seg->cusum_up + z - SEGMENT_SHIFT / 2);
+        if (seg->cusum_up == 0)
+            seg->last_zero = idx + 1;
+
+        if (seg->cusum_up > SEGMENT_THRESHOLD) {
+            open_segment(seg, seg->last_zero);
+            seg->active     = true;
+            seg->cusum_up   = 0;
+            seg->cusum_down = 0;
+            seg->last_zero  = idx + 1;
+            event           = SEGMENT_START;
+        }
+    }
+    else {
+        seg->cusum_down = fmax(0, seg->cusum_down + SEGMENT_SHIFT / 2 - z);
+        if (seg->cusum_down == 0)
+            seg->last_zero = idx + 1;
+
+        if (seg->cusum_down > SEGMENT_THRESHOLD) {
+            seg->seg_len[seg->seg_cnt - 1] = seg->last_zero
+                                             - seg->seg_start[seg->seg_cnt - 1];
+            seg->active_samples += seg->seg_len[seg->seg_cnt - 1];
+            seg->active     = false;
+            seg->cusum_up   = 0;
+            seg->cusum_down = 0;
+            seg->last_zero  = idx + 1;
+            event           = SEGMENT_END;
+        }
+    }
+
+    ++seg->samples;
+    return event;
+}
+
+/*
+ * Feed the next sample to the detector and write it to the trace if it
+ * belongs to a segment. At the start of a segment, the samples since the
+ * change point are written from the lookback (at most SEGMENT_LOOKBACK). The
+ * samples of the detection delay at the end of a segment are kept as well.
+ */
+segment_event write_segmented_trace(segmenter *seg, trace_file *tf,
+    const uint8_t *input, const time_type *res)
+{
+    uint64_t idx, first;
+    uint32_t slot;
+    segment_event event = update_segmenter(seg, input, res);
+
+    assert(tf->hdr.msrmts_per_sample == seg->sets
+           && tf->hdr.input_len == seg->input_len);
+
+    if (event == SEGMENT_START) {
+        first = seg->seg_start[seg->seg_cnt - 1];
+        if (seg->samples - first > SEGMENT_LOOKBACK)
+            first = seg->samples - SEGMENT_LOOKBACK;
+
+        for (idx = first; idx < seg->samples; ++idx) {
+            slot = idx % SEGMENT_LOOKBACK;
+            write_trace_samples(tf, seg->ring_inputs + slot * seg->input_len,
+                                seg->ring_res + (uint64_t) slot * seg->sets, 1);
+        }
+    }
+    else if (seg->active) {
+        write_trace_samples(tf, input, res, 1);
+    }
+
+    return event;
+}
+
+void print_segments(segmenter *seg) {
+    uint32_t i;
+    uint64_t len, active = seg->active_samples;
+
+    if (seg->active)
+        active += seg->samples - seg->seg_start[seg->seg_cnt - 1];
+
+    printf("segments = {\n\tsamples: %lu,\n\tactive samples: %lu (%.2f%%),\n"
+           "\tidle occupancy: %.2f +- %.2f,\n\tsegments (start, length):\n",
+           seg->samples, active, seg->samples ? 100.0 * active / seg->samples : 0,
+           seg->idle_mean, seg->idle_std);
+
+    for (i = 0; i < seg->seg_cnt; ++i) {
+        len = (seg->active && i == seg->seg_cnt - 1)
+              ? seg->samples - seg->seg_start[i] : seg->seg_len[i];
+        printf("\t\t%lu, %lu%s\n", seg->seg_start[i], len,
+               (seg->active && i == seg->seg_cnt - 1) ? " (open)" : "");
+    }
+    printf("}\n");
+}
+
+/*
+ * Store the segments as lines of first sample and length (an open segment
+ * extends to the last sample).
+ * Returns 0 on success, 1 on failure.
+ */
+int save_segments(const char *path, segmenter *seg) {
+    uint32_t i;
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return 1;
+
+    fprintf(fp, "# CacheSC segments of %lu samples\n# start length\n",
+            seg->samples);
+    for (i = 0; i < seg->seg_cnt; ++i) {
+        fprintf(fp, "%lu %lu\n", seg->seg_start[i],
+                (seg->active && i == seg->seg_cnt - 1)
+                ? seg->samples - seg->seg_start[i] : seg->seg_len[i]);
+    }
+
+    return fclose(fp) != 0;
+}
+
+time_type get_median_time(time_type *vals, uint32_t cnt) {
+    qsort(vals, cnt, sizeof(time_type), cmp_uint32);
+    return vals[cnt / 2];
+}
+
+void open_segment(segmenter *seg, uint64_t start) {
+    if (seg->seg_cnt == seg->seg_max) {
+        seg->seg_max *= 2;
+        seg->seg_start  = (uint64_t *) realloc(seg->seg_start,
+                                               seg->seg_max * sizeof(uint64_t));
+        seg->seg_len    = (uint64_t *) realloc(seg->seg_len,
+                                               seg->seg_max * sizeof(uint64_t));
+        assert(seg->seg_start && seg->seg_len);
+    }
+
+    seg->seg_start[seg->seg_cnt]    = start;
+    seg->seg_len[seg->seg_cnt]      = 0;
+    ++seg->seg_cnt;
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Online change-point segmentation of asynchronous captures. Every sample is
+ * reduced to its occupancy, the number of sets whose probe time exceeds the
+ * idle threshold of the set. A two-sided CUSUM on the occupancy, normalised
+ * with its idle distribution, detects the start of victim activity (mean
+ * shift of SEGMENT_SHIFT idle standard deviations) and the return to idle.
+ * Boundaries are reported at the estimated change point, i.e. the last
+ * sample where the CUSUM statistic was zero. A lookback of the latest samples
+ * allows writers to store only the active segments of a capture.
+ */
+
+#ifndef HEADER_SEGMENT_H
+#define HEADER_SEGMENT_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "cache_types.h"
+#include "checkpoint.h"
+#include "trace.h"
+
+// Idle samples for the calibration of the set thresholds and the occupancy
+#define SEGMENT_CALIB_SAMPLES 1024
+// A set is occupied if its probe time exceeds the idle median by this many
+// MADs
+#define SEGMENT_SET_MADS 3
+// Lower bound of the idle standard deviation of the occupancy
+#define SEGMENT_MIN_STD 0.5
+// Detected mean shift and decision threshold of the CUSUM in idle standard
+// deviations
+#define SEGMENT_SHIFT 2.0
+#define SEGMENT_THRESHOLD 10.0
+// Latest samples kept for writers, bounds how far back a start is written
+#define SEGMENT_LOOKBACK 256
+
+typedef enum segment_event segment_event;
+typedef struct segmenter segmenter;
+
+enum segment_event {SEGMENT_NONE, SEGMENT_START, SEGMENT_END};
+
+struct segmenter {
+    uint32_t sets;
+    uint32_t input_len;
+    uint64_t samples;
+
+    // Idle calibration: occupancy threshold per set and occupancy statistics
+    time_type *set_threshold;
+    double idle_mean;
+    double idle_std;
+
+    // CUSUM statistics for the start (up) and end (down) of activity and the
+    // last sample where the statistic in use was zero
+    double cusum_up;
+    double cusum_down;
+    uint64_t last_zero;
+    bool active;
+
+    // Segments detected so far: first sample and number of samples (end
+    // exclusive, 0 while the segment is open)
+    uint64_t *seg_start;
+    uint64_t *seg_len;
+    uint32_t seg_cnt;
+    uint32_t seg_max;
+    uint64_t active_samples;
+
+    // Ring buffer of the latest SEGMENT_LOOKBACK samples
+    uint8_t *ring_inputs;
+    time_type *ring_res;
+};
+
+segmenter *prepare_segmenter(uint32_t sets, uint32_t input_len);
+void release_segmenter(segmenter *seg);
+void calibrate_segmenter(segmenter *seg, const time_type *res, uint32_t cnt);
+void add_segmenter_checkpoint(checkpoint *cp, segmenter *seg);
+uint32_t get_occupancy(segmenter *seg, const time_type *res);
+segment_event update_segmenter(segmenter *seg, const uint8_t *input,
+    const time_type *res);
+segment_event write_segmented_trace(segmenter *seg, trace_file *tf,
+    const uint8_t *input, const time_type *res);
+void print_segments(segmenter *seg);
+int save_segments(const char *path, segmenter *seg);
+
+#endif // HEADER_SEGMENT_H
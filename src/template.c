@@ -0,0 +1,571 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements template building and matching.
+ */
+
+#include "template.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEMPLATE_KEY_LEN 64
+// Whitened mean of classes without profiling samples, never matches
+#define TEMPLATE_EMPTY_MEAN 1e18f
+
+// local functions
+templates *alloc_templates(uint32_t classes, uint32_t sets, uint32_t pois);
+bool cholesky(double *a, uint32_t n);
+void invert_lower(const double *l, double *inv, uint32_t n);
+bool parse_template_values(const char *str, uint32_t cnt, uint32_t *ints,
+    float *floats);
+float hsum_template_vec(template_vec v);
+
+
+template_profile *prepare_template_profile(uint32_t classes, uint32_t sets) {
+    template_profile *prof = (template_profile *) calloc(1, sizeof(template_profile));
+    assert(prof);
+    assert(classes > 1);
+
+    prof->classes   = classes;
+    prof->sets      = sets;
+    prof->cnt       = (uint64_t *) calloc(classes, sizeof(uint64_t));
+    prof->sum       = (double *) calloc(classes * sets, sizeof(double));
+    prof->sum_sq    = (double *) calloc(classes * sets, sizeof(double));
+    assert(prof->cnt && prof->sum && prof->sum_sq);
+
+    return prof;
+}
+
+void release_template_profile(template_profile *prof) {
+    free(prof->cnt);
+    free(prof->sum);
+    free(prof->sum_sq);
+    free(prof->poi_sets);
+    free(prof->poi_snr);
+    free(prof->poi_mean);
+    free(prof->cov_sum);
+    free(prof);
+}
+
+/*
+ * First profiling pass: add a sample of a known class
+ */
+void update_template_profile(template_profile *prof, uint32_t cls,
+    const time_type *res)
+{
+    uint32_t s;
+    double *sum     = prof->sum + cls * prof->sets;
+    double *sum_sq  = prof->sum_sq + cls * prof->sets;
+
+    assert(cls < prof->classes);
+
+    for (s = 0; s < prof->sets; ++s) {
+        sum[s]      += res[s];
+        sum_sq[s]   += (double) res[s] * res[s];
+    }
+    ++prof->cnt[cls];
+    ++prof->samples;
+}
+
+/*
+ * Signal-to-noise ratio of every set: variance of the class means over the
+ * mean of the class variances. Classes without samples are ignored.
+ */
+void get_template_snr(template_profile *prof, double *snr) {
+    uint32_t c, s, used;
+    double mean, sum_mean, sum_mean_sq, sum_var;
+
+    for (s = 0; s < prof->sets; ++s) {
+        used = 0;
+        sum_mean = sum_mean_sq = sum_var = 0;
+
+        for (c = 0; c < prof->classes; ++c) {
+            if (!prof->cnt[c])
+                continue;
+
+            mean        = prof->sum[c * prof->sets + s] / prof->cnt[c];
+            sum_mean    += mean;
+            sum_mean_sq += mean * mean;
+            sum_var     += prof->sum_sq[c * prof->sets + s] / prof->cnt[c] - mean * mean;
+            ++used;
+        }
+
+        if (used < 2 || sum_var <= 0) {
+            snr[s] = 0;
+            continue;
+        }
+
+        snr[s] = (sum_mean_sq / used - (sum_mean / used) * (sum_mean / used))
+                 / (sum_var / used);
+    }
+}
+
+/*
+ * Select the `pois` sets with the highest SNR as points of interest after
+ * the first pass and prepare the second pass
+ */
+void select_template_pois(template_profile *prof, uint32_t pois) {
+    uint32_t i, j, c, best;
+    double *snr = (double *) malloc(prof->sets * sizeof(double));
+    bool *used  = (bool *) calloc(prof->sets, sizeof(bool));
+    assert(snr && used);
+    assert(pois > 0 && pois <= prof->sets && pois <= TEMPLATE_MAX_POIS);
+
+    prof->pois      = pois;
+    prof->poi_sets  = (uint32_t *) realloc(prof->poi_sets, pois * sizeof(uint32_t));
+    prof->poi_snr   = (double *) realloc(prof->poi_snr, pois * sizeof(double));
+    prof->poi_mean  = (double *) realloc(prof->poi_mean,
+                                         prof->classes * pois * sizeof(double));
+    free(prof->cov_sum);
+    prof->cov_sum   = (double *) calloc(pois * pois, sizeof(double));
+    prof->cov_cnt   = 0;
+    assert(prof->poi_sets && prof->poi_snr && prof->poi_mean && prof->cov_sum);
+
+    get_template_snr(prof, snr);
+
+    for (i = 0; i < pois; ++i) {
+        best = prof->sets;
+        for (j = 0; j < prof->sets; ++j) {
+            if (!used[j] && (best == prof->sets || snr[j] > snr[best]))
+                best = j;
+        }
+
+        used[best]          = true;
+        prof->poi_sets[i]   = best;
+        prof->poi_snr[i]    = snr[best];
+
+        for (c = 0; c < prof->classes; ++c) {
+            prof->poi_mean[c * pois + i] = prof->cnt[c]
+                ? prof->sum[c * prof->sets + best] / prof->cnt[c] : 0;
+        }
+    }
+
+    free(snr);
+    free(used);
+}
+
+/*
+ * Second profiling pass: add a sample of a known class to the pooled
+ * covariance. The deviations are taken from the exact class means of the
+ * first pass, which avoids the cancellation of the textbook formula.
+ */
+void update_template_covariance(template_profile *prof, uint32_t cls,
+    const time_type *res)
+{
+    uint32_t i, j;
+    double dev[TEMPLATE_MAX_POIS];
+
+    assert(cls < prof->classes && prof->cov_sum);
+
+    for (i = 0; i < prof->pois; ++i)
+        dev[i] = res[prof->poi_sets[i]] - prof->poi_mean[cls * prof->pois + i];
+
+    for (i = 0; i < prof->pois; ++i) {
+        for (j = 0; j <= i; ++j)
+            prof->cov_sum[i * prof->pois + j] += dev[i] * dev[j];
+    }
+    ++prof->cov_cnt;
+}
+
+/*
+ * Build the templates after both passes
+ */
+templates *build_templates(template_profile *prof) {
+    uint32_t c, i, j, used;
+    uint32_t p = prof->pois;
+    double ridge, diag_mean, dof;
+    double *cov, *chol, *inv, *centred;
+    templates *t;
+
+    assert(prof->cov_sum && prof->cov_cnt > 0);
+
+    cov     = (double *) calloc(p * p, sizeof(double));
+    chol    = (double *) malloc(p * p * sizeof(double));
+    inv     = (double *) calloc(p * p, sizeof(double));
+    centred = (double *) malloc(p * sizeof(double));
+    assert(cov && chol && inv && centred);
+
+    // Pooled covariance, every class with samples costs a degree of freedom
+    used = 0;
+    for (c = 0; c < prof->classes; ++c)
+        used += prof->cnt[c] > 0;
+    dof = (prof->cov_cnt > used) ? prof->cov_cnt - used : 1;
+
+    diag_mean = 0;
+    for (i = 0; i < p; ++i) {
+        for (j = 0; j <= i; ++j) {
+            cov[i * p + j] = cov[j * p + i] = prof->cov_sum[i * p + j] / dof;
+        }
+        diag_mean += cov[i * p + i] / p;
+    }
+
+    // Regularise until the covariance is positive definite
+    ridge = (diag_mean > 0) ? diag_mean * TEMPLATE_RIDGE : 1;
+    memcpy(chol, cov, p * p * sizeof(double));
+    while (!cholesky(chol, p)) {
+        memcpy(chol, cov, p * p * sizeof(double));
+        for (i = 0; i < p; ++i)
+            chol[i * p + i] += ridge;
+        ridge *= 10;
+    }
+    invert_lower(chol, inv, p);
+
+    t = alloc_templates(prof->classes, prof->sets, p);
+    memcpy(t->poi_sets, prof->poi_sets, p * sizeof(uint32_t));
+
+    for (i = 0; i < p; ++i) {
+        t->offset[i] = 0;
+        for (c = 0; c < prof->classes; ++c) {
+            t->offset[i] += prof->poi_mean[c * p + i] * prof->cnt[c]
+                            / (double) prof->samples;
+        }
+
+        for (j = 0; j <= i; ++j)
+            t->whitening[j * t->pois_pad + i] = inv[i * p + j];
+    }
+
+    for (c = 0; c < prof->classes; ++c) {
+        for (i = 0; i < p; ++i) {
+            centred[i] = prof->poi_mean[c * p + i] - t->offset[i];
+
+            t->means[c * t->pois_pad + i] = 0;
+            for (j = 0; j <= i; ++j)
+                t->means[c * t->pois_pad + i] += inv[i * p + j] * centred[j];
+
+            if (!prof->cnt[c])
+                t->means[c * t->pois_pad + i] = TEMPLATE_EMPTY_MEAN;
+        }
+    }
+
+    free(cov);
+    free(chol);
+    free(inv);
+    free(centred);
+
+    return t;
+}
+
+void release_templates(templates *t) {
+    free(t->poi_sets);
+    free(t->offset);
+    free(t->whitening);
+    free(t->means);
+    free(t);
+}
+
+/*
+ * Store templates, e.g. to match traces of another device.
+ * Returns 0 on success, 1 on failure.
+ */
+int save_templates(const char *path, templates *t) {
+    uint32_t c, i, j;
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return 1;
+
+    fprintf(fp, "# CacheSC templates\n");
+    fprintf(fp, "classes = %u\n", t->classes);
+    fprintf(fp, "sets = %u\n", t->sets);
+    fprintf(fp, "pois = %u\n", t->pois);
+
+    fprintf(fp, "poi_sets =");
+    for (i = 0; i < t->pois; ++i)
+        fprintf(fp, " %u", t->poi_sets[i]);
+
+    fprintf(fp, "\noffset =");
+    for (i = 0; i < t->pois; ++i)
+        fprintf(fp, " %.9g", t->offset[i]);
+    fprintf(fp, "\n");
+
+    for (j = 0; j < t->pois; ++j) {
+        fprintf(fp, "whitening %u =", j);
+        for (i = 0; i < t->pois; ++i)
+            fprintf(fp, " %.9g", t->whitening[j * t->pois_pad + i]);
+        fprintf(fp, "\n");
+    }
+
+    for (c = 0; c < t->classes; ++c) {
+        fprintf(fp, "mean %u =", c);
+        for (i = 0; i < t->pois; ++i)
+            fprintf(fp, " %.9g", t->means[c * t->pois_pad + i]);
+        fprintf(fp, "\n");
+    }
+
+    return fclose(fp) != 0;
+}
+
+/*
+ * Load templates stored by save_templates.
+ * Returns NULL if the file cannot be read, is incomplete, or defines a line
+ * twice.
+ */
+templates *load_templates(const char *path) {
+    char line[BUFSIZ];
+    char key[TEMPLATE_KEY_LEN];
+    uint32_t val, idx, rows = 0;
+    uint32_t classes = 0, sets = 0, pois = 0;
+    int pos = 0;
+    bool ok = true, has_poi_sets = false, has_offset = false;
+    bool *seen = NULL;
+    templates *t = NULL;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return NULL;
+
+    while (ok && fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#')
+            continue;
+
+        // Dimensions precede the values
+        if (!t && sscanf(line, "%63s = %u", key, &val) == 2) {
+            if (!strcmp(key, "classes")) {
+                classes = val;
+                continue;
+            }
+            else if (!strcmp(key, "sets")) {
+                sets = val;
+                continue;
+            }
+            else if (!strcmp(key, "pois")) {
+                pois = val;
+                continue;
+            }
+        }
+
+        if (!t) {
+            ok = classes > 1 && sets > 0 && pois > 0 && pois <= TEMPLATE_MAX_POIS;
+            if (!ok)
+                break;
+            t = alloc_templates(classes, sets, pois);
+
+            // Whitening rows first, then the class means
+            seen = (bool *) calloc(pois + classes, sizeof(bool));
+            assert(seen);
+        }
+
+        if (sscanf(line, "poi_sets =%n", &pos) == 0 && pos > 0) {
+            ok = !has_poi_sets
+                 && parse_template_values(line + pos, pois, t->poi_sets, NULL);
+            for (idx = 0; ok && idx < pois; ++idx)
+                ok = t->poi_sets[idx] < sets;
+            has_poi_sets = true;
+        }
+        else if (sscanf(line, "offset =%n", &pos) == 0 && pos > 0) {
+            ok = !has_offset
+                 && parse_template_values(line + pos, pois, NULL, t->offset);
+            has_offset = true;
+        }
+        else if (sscanf(line, "whitening %u =%n", &idx, &pos) == 1 && pos > 0) {
+            ok = idx < pois && !seen[idx]
+                 && parse_template_values(line + pos, pois, NULL,
+                                          t->whitening + idx * t->pois_pad);
+            if (ok) {
+                seen[idx] = true;
+                ++rows;
+            }
+        }
+        else if (sscanf(line, "mean %u =%n", &idx, &pos) == 1 && pos > 0) {
+            ok = idx < classes && !seen[pois + idx]
+                 && parse_template_values(line + pos, pois, NULL,
+                                          t->means + idx * t->pois_pad);
+            if (ok) {
+                seen[pois + idx] = true;
+                ++rows;
+            }
+        }
+        pos = 0;
+    }
+
+    fclose(fp);
+    free(seen);
+
+    if (!t)
+        return NULL;
+
+    // Every row is seen exactly once if all of them are counted
+    if (!ok || !has_poi_sets || !has_offset || rows != pois + classes) {
+        release_templates(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+/*
+ * Store the log-likelihood (up to a constant) of every class for `cnt`
+ * traces of `sets` measurements in `loglik` (cnt x classes).
+ */
+void match_templates(templates *t, const time_type *res, uint32_t cnt,
+    float *loglik)
+{
+    uint32_t n, c, i, v;
+    uint32_t vecs = t->pois_pad / TEMPLATE_VEC_LEN;
+    template_vec x[TEMPLATE_MAX_POIS / TEMPLATE_VEC_LEN];
+    template_vec z[TEMPLATE_MAX_POIS / TEMPLATE_VEC_LEN];
+    template_vec d, acc, xi;
+    float *xf = (float *) x;
+    template_vec *w     = (template_vec *) t->whitening;
+    template_vec *means = (template_vec *) t->means;
+
+    memset(x, 0, sizeof(x));
+
+    for (n = 0; n < cnt; ++n, res += t->sets, loglik += t->classes) {
+        for (i = 0; i < t->pois; ++i)
+            xf[i] = res[t->poi_sets[i]] - t->offset[i];
+
+        // z = L^-1 x, accumulated column by column
+        memset(z, 0, vecs * sizeof(template_vec));
+        for (i = 0; i < t->pois; ++i) {
+            xi = (template_vec) {0} + xf[i];
+            for (v = i / TEMPLATE_VEC_LEN; v < vecs; ++v)
+                z[v] += xi * w[i * vecs + v];
+        }
+
+        for (c = 0; c < t->classes; ++c) {
+            acc = (template_vec) {0};
+            for (v = 0; v < vecs; ++v) {
+                d   = z[v] - means[c * vecs + v];
+                acc += d * d;
+            }
+            loglik[c] = -0.5f * hsum_template_vec(acc);
+        }
+    }
+}
+
+/*
+ * Most likely class of one trace, given its log-likelihoods
+ */
+uint32_t get_best_template_class(templates *t, const float *loglik) {
+    uint32_t c, best = 0;
+
+    for (c = 1; c < t->classes; ++c) {
+        if (loglik[c] > loglik[best])
+            best = c;
+    }
+
+    return best;
+}
+
+templates *alloc_templates(uint32_t classes, uint32_t sets, uint32_t pois) {
+    templates *t = (templates *) calloc(1, sizeof(templates));
+    assert(t);
+
+    t->classes  = classes;
+    t->sets     = sets;
+    t->pois     = pois;
+    t->pois_pad = (pois + TEMPLATE_VEC_LEN - 1) / TEMPLATE_VEC_LEN * TEMPLATE_VEC_LEN;
+
+    t->poi_sets     = (uint32_t *) calloc(pois, sizeof(uint32_t));
+    t->offset       = (float *) calloc(t->pois_pad, sizeof(float));
+    t->whitening    = (float *) aligned_alloc(sizeof(template_vec),
+                          t->pois_pad * t->pois_pad * sizeof(float));
+    t->means        = (float *) aligned_alloc(sizeof(template_vec),
+                          classes * t->pois_pad * sizeof(float));
+    assert(t->poi_sets && t->offset && t->whitening && t->means);
+
+    // Padding stays zero
+    memset(t->whitening, 0, t->pois_pad * t->pois_pad * sizeof(float));
+    memset(t->means, 0, classes * t->pois_pad * sizeof(float));
+
+    return t;
+}
+
+/*
+ * In-place Cholesky decomposition a = L L^T of a symmetric n x n matrix,
+ * L is stored in the lower triangle (the upper one is cleared).
+ * Returns false if the matrix is not positive definite.
+ */
+bool cholesky(double *a, uint32_t n) {
+    uint32_t i, j, k;
+    double s;
+
+    for (j = 0; j < n; ++j) {
+        s = a[j * n + j];
+        for (k = 0; k < j; ++k)
+            s -= a[j * n + k] * a[j * n + k];
+        if (s <= 0)
+            return false;
+        a[j * n + j] = sqrt(s);
+
+        for (i = j + 1; i < n; ++i) {
+            s = a[i * n + j];
+            for (k = 0; k < j; ++k)
+                s -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = s / a[j * n + j];
+            a[j * n + i] = 0;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Inverse of a lower triangular n x n matrix by forward substitution
+ */
+void invert_lower(const double *l, double *inv, uint32_t n) {
+    uint32_t i, j, k;
+    double s;
+
+    for (j = 0; j < n; ++j) {
+        inv[j * n + j] = 1 / l[j * n + j];
+        for (i = j + 1; i < n; ++i) {
+            s = 0;
+            for (k = j; k < i; ++k)
+                s -= l[i * n + k] * inv[k * n + j];
+            inv[i * n + j] = s / l[i * n + i];
+        }
+    }
+}
+
+/*
+ * Parse `cnt` whitespace separated values into `ints` or `floats`
+ */
+bool parse_template_values(const char *str, uint32_t cnt, uint32_t *ints,
+    float *floats)
+{
+    uint32_t i;
+    int len;
+
+    for (i = 0; i < cnt; ++i) {
+        if (ints && sscanf(str, "%u%n", ints + i, &len) != 1)
+            return false;
+        if (floats && sscanf(str, "%f%n", floats + i, &len) != 1)
+            return false;
+        str += len;
+    }
+
+    return true;
+}
+
+float hsum_template_vec(template_vec v) {
+    uint32_t i;
+    float sum = 0;
+
+    for (i = 0; i < TEMPLATE_VEC_LEN; ++i)
+        sum += v[i];
+
+    return sum;
+}
@@ -0,0 +1,532 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements reading and writing of binary trace files.
+ */
+
+#include "trace.h"
+
+#include <unistd.h>
+
+// local functions
+trace_file *init_trace(const char *path, uint32_t msrmts_per_sample,
+    uint32_t input_len, uint32_t flags);
+void alloc_trace_blocks(trace_file *tf);
+int flush_trace_block(trace_file *tf);
+void add_trace_block_offset(trace_file *tf, off_t offset);
+int load_trace_block(trace_file *tf);
+void load_trace_block_index(trace_file *tf);
+int find_trace_block(trace_file *tf, uint64_t block, off_t *offset);
+
+
+/*
+ * Create a trace file for samples of `msrmts_per_sample` measurements and
+ * `input_len` input bytes. Returns NULL if the file cannot be created.
+ */
+trace_file *create_trace(const char *path, uint32_t msrmts_per_sample,
+    uint32_t input_len)
+{
+    return init_trace(path, msrmts_per_sample, input_len, 0);
+}
+
+/*
+ * Like create_trace, but the measurements are compressed in blocks (see
+ * trace_codec.h).
+ */
+trace_file *create_compressed_trace(const char *path, uint32_t msrmts_per_sample,
+    uint32_t input_len)
+{
+    trace_file *tf = init_trace(path, msrmts_per_sample, input_len,
+                                TRACE_FLAG_COMPRESSED);
+    if (tf)
+        alloc_trace_blocks(tf);
+
+    return tf;
+}
+
+/*
+ * Open a trace file for reading. Returns NULL if the file cannot be opened or
+ * is not a trace of a supported version.
+ */
+trace_file *open_trace(const char *path) {
+    trace_file *tf;
+    trace_header hdr;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+
+    if (fread(&hdr, sizeof(trace_header), 1, fp) != 1
+        || memcmp(hdr.magic, TRACE_MAGIC, TRACE_MAGIC_LEN)
+        || hdr.version != TRACE_VERSION
+        || (hdr.flags & ~TRACE_FLAG_COMPRESSED))
+    {
+        fclose(fp);
+        return NULL;
+    }
+
+    tf = (trace_file *) calloc(1, sizeof(trace_file));
+    assert(tf);
+
+    tf->fp  = fp;
+    tf->hdr = hdr;
+
+    if (hdr.flags & TRACE_FLAG_COMPRESSED) {
+        alloc_trace_blocks(tf);
+        load_trace_block_index(tf);
+    }
+
+    return tf;
+}
+
+/*
+ * Reopen a trace for writing after its first `samples` samples, e.g. those of
+ * a checkpoint (see checkpoint.h). Later samples and the block index of
+ * compressed traces are discarded. For compressed traces, `samples` must be a
+ * multiple of TRACE_BLOCK_SAMPLES. Returns NULL if the trace cannot be opened
+ * or holds fewer samples.
+ */
+trace_file *resume_trace(const char *path, uint64_t samples) {
+    off_t end, size;
+    uint64_t b;
+    trace_block_header bh;
+    trace_file *tf = open_trace(path);
+    if (!tf)
+        return NULL;
+
+    // Reopen for writing at the end of the kept samples
+    if (!freopen(path, "r+b", tf->fp)) {
+        tf->fp = NULL;
+        goto fail;
+    }
+    if (fseeko(tf->fp, 0, SEEK_END) || (size = ftello(tf->fp)) < 0)
+        goto fail;
+
+    if (tf->hdr.flags & TRACE_FLAG_COMPRESSED) {
+        if (samples % TRACE_BLOCK_SAMPLES)
+            goto fail;
+
+        // The index of a closed trace is replaced, rebuild it from the
+        // block headers
+        tf->blocks  = 0;
+        end         = sizeof(trace_header);
+        for (b = 0; b < samples / TRACE_BLOCK_SAMPLES; ++b) {
+            if (fseeko(tf->fp, end, SEEK_SET)
+                || fread(&bh, sizeof(trace_block_header), 1, tf->fp) != 1
+                || bh.cnt != TRACE_BLOCK_SAMPLES)
+            {
+                goto fail;
+            }
+            add_trace_block_offset(tf, end);
+            end += sizeof(trace_block_header) + bh.len;
+        }
+    }
+    else {
+        end = sizeof(trace_header) + samples * (tf->hdr.input_len
+              + (uint64_t) tf->hdr.msrmts_per_sample * sizeof(time_type));
+    }
+
+    if (end > size || ftruncate(fileno(tf->fp), end)
+        || fseeko(tf->fp, end, SEEK_SET))
+    {
+        goto fail;
+    }
+
+    tf->hdr.samples = samples;
+    tf->pos         = 0;
+    tf->writing     = true;
+
+    return tf;
+
+fail:
+    if (tf->fp)
+        fclose(tf->fp);
+    free(tf->blk_inputs);
+    free(tf->blk_res);
+    free(tf->blk_buf);
+    free(tf->blk_offsets);
+    free(tf);
+    return NULL;
+}
+
+/*
+ * Append `cnt` samples. `inputs` holds input_len bytes and `res`
+ * msrmts_per_sample measurements per sample. Returns 0 on success and 1 if
+ * this or an earlier write failed (e.g. the disk is full). After a failure,
+ * no more samples are written and the trace keeps the samples before it.
+ */
+int write_trace_samples(trace_file *tf, const uint8_t *inputs,
+    const time_type *res, uint32_t cnt)
+{
+    uint32_t i, n;
+    size_t written;
+
+    assert(tf->writing);
+
+    if (tf->write_failed)
+        return 1;
+
+    if (tf->hdr.flags & TRACE_FLAG_COMPRESSED) {
+        for (i = 0; i < cnt; i += n) {
+            n = TRACE_BLOCK_SAMPLES - tf->blk_cnt;
+            if (n > cnt - i)
+                n = cnt - i;
+
+            memcpy(tf->blk_inputs + (uint64_t) tf->blk_cnt * tf->hdr.input_len,
+                   inputs + (uint64_t) i * tf->hdr.input_len,
+                   (uint64_t) n * tf->hdr.input_len);
+            memcpy(tf->blk_res + (uint64_t) tf->blk_cnt * tf->hdr.msrmts_per_sample,
+                   res + (uint64_t) i * tf->hdr.msrmts_per_sample,
+                   (uint64_t) n * tf->hdr.msrmts_per_sample * sizeof(time_type));
+            tf->blk_cnt += n;
+            tf->hdr.samples += n;
+
+            if (tf->blk_cnt == TRACE_BLOCK_SAMPLES && flush_trace_block(tf))
+                return 1;
+        }
+
+        return 0;
+    }
+
+    for (i = 0; i < cnt; ++i) {
+        written = fwrite(inputs + (uint64_t) i * tf->hdr.input_len, 1,
+                         tf->hdr.input_len, tf->fp);
+        written += fwrite(res + (uint64_t) i * tf->hdr.msrmts_per_sample,
+                          sizeof(time_type), tf->hdr.msrmts_per_sample, tf->fp);
+        if (written != tf->hdr.input_len + tf->hdr.msrmts_per_sample) {
+            tf->write_failed = true;
+            return 1;
+        }
+        ++tf->hdr.samples;
+    }
+
+    return 0;
+}
+
+/*
+ * Read up to `max_cnt` samples into `inputs` and `res` (same layout as for
+ * writing). `inputs` may be NULL if the inputs are not needed.
+ * Returns the number of samples read, 0 at the end of the trace.
+ */
+uint32_t read_trace_samples(trace_file *tf, uint8_t *inputs, time_type *res,
+    uint32_t max_cnt)
+{
+    uint32_t i, n;
+
+    assert(!tf->writing);
+
+    if (tf->hdr.flags & TRACE_FLAG_COMPRESSED) {
+        for (i = 0; i < max_cnt && tf->pos < tf->hdr.samples; i += n) {
+            if (tf->blk_pos == tf->blk_cnt && load_trace_block(tf))
+                break;
+
+            n = tf->blk_cnt - tf->blk_pos;
+            if (n > max_cnt - i)
+                n = max_cnt - i;
+
+            if (inputs) {
+                memcpy(inputs + (uint64_t) i * tf->hdr.input_len,
+                       tf->blk_inputs + (uint64_t) tf->blk_pos * tf->hdr.input_len,
+                       (uint64_t) n * tf->hdr.input_len);
+            }
+            memcpy(res + (uint64_t) i * tf->hdr.msrmts_per_sample,
+                   tf->blk_res + (uint64_t) tf->blk_pos * tf->hdr.msrmts_per_sample,
+                   (uint64_t) n * tf->hdr.msrmts_per_sample * sizeof(time_type));
+
+            tf->blk_pos += n;
+            tf->pos     += n;
+        }
+
+        return i;
+    }
+
+    for (i = 0; i < max_cnt && tf->pos < tf->hdr.samples; ++i, ++tf->pos) {
+        if (inputs) {
+            if (fread(inputs + (uint64_t) i * tf->hdr.input_len, 1,
+                      tf->hdr.input_len, tf->fp) != tf->hdr.input_len)
+            {
+                break;
+            }
+        }
+        else if (fseek(tf->fp, tf->hdr.input_len, SEEK_CUR)) {
+            break;
+        }
+
+        if (fread(res + (uint64_t) i * tf->hdr.msrmts_per_sample,
+                  sizeof(time_type), tf->hdr.msrmts_per_sample, tf->fp)
+            != tf->hdr.msrmts_per_sample)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*
+ * Continue reading at `sample`. Compressed traces decode only the block of
+ * the sample. Returns 1 if the sample is out of range or cannot be reached.
+ */
+int seek_trace(trace_file *tf, uint64_t sample) {
+    off_t offset;
+    uint64_t sample_size;
+
+    assert(!tf->writing);
+
+    if (sample > tf->hdr.samples)
+        return 1;
+
+    if (!(tf->hdr.flags & TRACE_FLAG_COMPRESSED)) {
+        sample_size = tf->hdr.input_len
+                      + (uint64_t) tf->hdr.msrmts_per_sample * sizeof(time_type);
+        if (fseeko(tf->fp, sizeof(trace_header) + sample * sample_size, SEEK_SET))
+            return 1;
+        tf->pos = sample;
+        return 0;
+    }
+
+    tf->blk_cnt = tf->blk_pos = 0;
+    if (sample < tf->hdr.samples) {
+        if (find_trace_block(tf, sample / TRACE_BLOCK_SAMPLES, &offset)
+            || fseeko(tf->fp, offset, SEEK_SET) || load_trace_block(tf))
+        {
+            return 1;
+        }
+        tf->blk_pos = sample % TRACE_BLOCK_SAMPLES;
+    }
+    tf->pos = sample;
+
+    return 0;
+}
+
+/*
+ * Store the current sample count in the header and flush the trace to disk,
+ * such that the samples written so far survive a crash. Samples of a
+ * compressed trace that do not fill a block yet are not written.
+ * Returns 0 on success, 1 if a write to the trace failed.
+ */
+int sync_trace(trace_file *tf) {
+    trace_header hdr = tf->hdr;
+    off_t end;
+
+    assert(tf->writing);
+
+    if (tf->write_failed)
+        return 1;
+
+    hdr.samples -= tf->blk_cnt;
+    end = ftello(tf->fp);
+
+    return end < 0 || fseeko(tf->fp, 0, SEEK_SET)
+           || fwrite(&hdr, sizeof(trace_header), 1, tf->fp) != 1
+           || fseeko(tf->fp, end, SEEK_SET) || fflush(tf->fp)
+           || fsync(fileno(tf->fp));
+}
+
+/*
+ * Close a trace. For written traces, the final sample count is stored in the
+ * header. Returns 0 on success, 1 if any write to the trace failed.
+ */
+int close_trace(trace_file *tf) {
+    int err = tf->write_failed;
+
+    if (tf->writing && (tf->hdr.flags & TRACE_FLAG_COMPRESSED)) {
+        if (tf->blk_cnt && !tf->write_failed)
+            err |= flush_trace_block(tf);
+
+        // Block index at the end of the file
+        err |= fwrite(tf->blk_offsets, sizeof(uint64_t), tf->blocks, tf->fp)
+                != tf->blocks
+              || fwrite(&tf->blocks, sizeof(uint64_t), 1, tf->fp) != 1;
+    }
+
+    if (tf->writing) {
+        err |= fseek(tf->fp, 0, SEEK_SET)
+               || fwrite(&tf->hdr, sizeof(trace_header), 1, tf->fp) != 1;
+    }
+
+    err |= fclose(tf->fp) != 0;
+    free(tf->blk_inputs);
+    free(tf->blk_res);
+    free(tf->blk_buf);
+    free(tf->blk_offsets);
+    free(tf);
+
+    return err;
+}
+
+
+trace_file *init_trace(const char *path, uint32_t msrmts_per_sample,
+    uint32_t input_len, uint32_t flags)
+{
+    trace_file *tf;
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return NULL;
+
+    tf = (trace_file *) calloc(1, sizeof(trace_file));
+    assert(tf);
+
+    memcpy(tf->hdr.magic, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    tf->hdr.version             = TRACE_VERSION;
+    tf->hdr.flags               = flags;
+    tf->hdr.msrmts_per_sample   = msrmts_per_sample;
+    tf->hdr.input_len           = input_len;
+    tf->fp                      = fp;
+    tf->writing                 = true;
+
+    // The sample count is updated when the trace is closed
+    if (fwrite(&tf->hdr, sizeof(trace_header), 1, fp) != 1) {
+        fclose(fp);
+        free(tf);
+        return NULL;
+    }
+
+    return tf;
+}
+
+void alloc_trace_blocks(trace_file *tf) {
+    tf->blk_inputs  = (uint8_t *) malloc((uint64_t) TRACE_BLOCK_SAMPLES
+                                         * tf->hdr.input_len + 1);
+    tf->blk_res     = (time_type *) malloc((uint64_t) TRACE_BLOCK_SAMPLES
+                          * tf->hdr.msrmts_per_sample * sizeof(time_type));
+    tf->blk_buf     = (uint8_t *) malloc(get_trace_block_max_size(
+                          tf->hdr.msrmts_per_sample, tf->hdr.input_len));
+    assert(tf->blk_inputs && tf->blk_res && tf->blk_buf);
+}
+
+/*
+ * Encode and write the buffered samples as one block. On failure, they are
+ * dropped and the trace is marked as failed. Returns 0 on success.
+ */
+int flush_trace_block(trace_file *tf) {
+    trace_block_header bh;
+    off_t offset = ftello(tf->fp);
+
+    bh.cnt = tf->blk_cnt;
+    bh.len = encode_trace_block(tf->blk_inputs, tf->blk_res, tf->blk_cnt,
+                                tf->hdr.msrmts_per_sample, tf->hdr.input_len,
+                                tf->blk_buf);
+
+    if (offset < 0 || fwrite(&bh, sizeof(trace_block_header), 1, tf->fp) != 1
+        || fwrite(tf->blk_buf, 1, bh.len, tf->fp) != bh.len)
+    {
+        tf->hdr.samples -= tf->blk_cnt;
+        tf->blk_cnt = 0;
+        tf->write_failed = true;
+        return 1;
+    }
+
+    add_trace_block_offset(tf, offset);
+    tf->blk_cnt = 0;
+
+    return 0;
+}
+
+void add_trace_block_offset(trace_file *tf, off_t offset) {
+    if (tf->blocks == tf->blk_offsets_cap) {
+        tf->blk_offsets_cap = tf->blk_offsets_cap ? 2 * tf->blk_offsets_cap : 1024;
+        tf->blk_offsets     = (uint64_t *) realloc(tf->blk_offsets,
+                                  tf->blk_offsets_cap * sizeof(uint64_t));
+        assert(tf->blk_offsets);
+    }
+    tf->blk_offsets[tf->blocks++] = offset;
+}
+
+/*
+ * Read and decode the block at the current file position. Returns 1 at the
+ * end of the trace or if the block is corrupt.
+ */
+int load_trace_block(trace_file *tf) {
+    trace_block_header bh;
+
+    if (fread(&bh, sizeof(trace_block_header), 1, tf->fp) != 1
+        || bh.cnt == 0 || bh.cnt > TRACE_BLOCK_SAMPLES
+        || bh.len > get_trace_block_max_size(tf->hdr.msrmts_per_sample,
+                                             tf->hdr.input_len)
+        || fread(tf->blk_buf, 1, bh.len, tf->fp) != bh.len
+        || decode_trace_block(tf->blk_buf, bh.len, bh.cnt,
+                              tf->hdr.msrmts_per_sample, tf->hdr.input_len,
+                              tf->blk_inputs, tf->blk_res))
+    {
+        tf->blk_cnt = tf->blk_pos = 0;
+        return 1;
+    }
+
+    tf->blk_cnt = bh.cnt;
+    tf->blk_pos = 0;
+
+    return 0;
+}
+
+/*
+ * Load the block offsets from the end of a closed compressed trace. Without
+ * a valid index, seek_trace walks the block headers instead.
+ */
+void load_trace_block_index(trace_file *tf) {
+    uint64_t blocks;
+    uint64_t expected = (tf->hdr.samples + TRACE_BLOCK_SAMPLES - 1)
+                        / TRACE_BLOCK_SAMPLES;
+
+    if (!expected || fseeko(tf->fp, -(off_t) sizeof(uint64_t), SEEK_END)
+        || fread(&blocks, sizeof(uint64_t), 1, tf->fp) != 1
+        || blocks != expected
+        || fseeko(tf->fp, -(off_t) ((blocks + 1) * sizeof(uint64_t)), SEEK_END))
+    {
+        goto out;
+    }
+
+    tf->blk_offsets = (uint64_t *) malloc(blocks * sizeof(uint64_t));
+    assert(tf->blk_offsets);
+    if (fread(tf->blk_offsets, sizeof(uint64_t), blocks, tf->fp) != blocks) {
+        free(tf->blk_offsets);
+        tf->blk_offsets = NULL;
+        goto out;
+    }
+    tf->blocks          = blocks;
+    tf->blk_offsets_cap = blocks;
+
+out:
+    fseeko(tf->fp, sizeof(trace_header), SEEK_SET);
+}
+
+int find_trace_block(trace_file *tf, uint64_t block, off_t *offset) {
+    uint64_t b;
+    trace_block_header bh;
+
+    if (tf->blk_offsets) {
+        *offset = tf->blk_offsets[block];
+        return 0;
+    }
+
+    *offset = sizeof(trace_header);
+    for (b = 0; b < block; ++b) {
+        if (fseeko(tf->fp, *offset, SEEK_SET)
+            || fread(&bh, sizeof(trace_block_header), 1, tf->fp) != 1)
+        {
+            return 1;
+        }
+        *offset += sizeof(trace_block_header) + bh.len;
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Binary trace files. A trace stores the input (e.g. plaintext) of every
+ * sample together with its measurements, such that captures can be analysed
+ * offline without parsing text logs. The file starts with a fixed size header
+ * followed by the samples, each consisting of `input_len` bytes of input and
+ * `msrmts_per_sample` measurements (time_type, native byte order).
+ * Compressed traces (TRACE_FLAG_COMPRESSED) store the samples in blocks of
+ * TRACE_BLOCK_SAMPLES samples (see trace_codec.h), each preceded by its
+ * sample count and encoded size. Closing the trace appends the file offset
+ * of every block and the block count, such that readers can seek to any
+ * sample by decoding a single block.
+ */
+
+#ifndef HEADER_TRACE_H
+#define HEADER_TRACE_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "trace_codec.h"
+
+#define TRACE_MAGIC "CSCTRACE"
+#define TRACE_MAGIC_LEN 8
+#define TRACE_VERSION 1
+
+// Header flags
+#define TRACE_FLAG_COMPRESSED 0x1
+
+typedef struct trace_header trace_header;
+typedef struct trace_block_header trace_block_header;
+typedef struct trace_file trace_file;
+
+struct trace_header {
+    char magic[TRACE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t msrmts_per_sample;
+    uint32_t input_len;
+    uint64_t samples;
+};
+
+struct trace_block_header {
+    uint32_t cnt;
+    uint32_t len;
+};
+
+struct trace_file {
+    FILE *fp;
+    trace_header hdr;
+    bool writing;
+    // A write failed, later samples are dropped and closing reports it
+    bool write_failed;
+    // Samples read so far
+    uint64_t pos;
+
+    // Compressed traces: samples of the current block, which are buffered
+    // for writing respectively decoded for reading, and the encoded block
+    uint8_t *blk_inputs;
+    time_type *blk_res;
+    uint32_t blk_cnt;
+    uint32_t blk_pos;
+    uint8_t *blk_buf;
+    // File offsets of the blocks
+    uint64_t *blk_offsets;
+    uint64_t blocks;
+    uint64_t blk_offsets_cap;
+};
+
+trace_file *create_trace(const char *path, uint32_t msrmts_per_sample,
+    uint32_t input_len);
+trace_file *create_compressed_trace(const char *path, uint32_t msrmts_per_sample,
+    uint32_t input_len);
+trace_file *open_trace(const char *path);
+trace_file *resume_trace(const char *path, uint64_t samples);
+int write_trace_samples(trace_file *tf, const uint8_t *inputs,
+    const time_type *res, uint32_t cnt);
+uint32_t read_trace_samples(trace_file *tf, uint8_t *inputs, time_type *res,
+    uint32_t max_cnt);
+int seek_trace(trace_file *tf, uint64_t sample);
+int sync_trace(trace_file *tf);
+int close_trace(trace_file *tf);
+
+#endif // HEADER_TRACE_H
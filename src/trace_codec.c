@@ -0,0 +1,294 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the block codec of compressed trace files.
+ */
+
+#include "trace_codec.h"
+
+// Exception indices are stored in one byte
+#if TRACE_BLOCK_SAMPLES > 256 || TRACE_BLOCK_SAMPLES % TRACE_PACK_GROUP
+    #error "Unsupported TRACE_BLOCK_SAMPLES"
+#endif
+
+// Maximal bytes of a varint of 32 bits
+#define VARINT_MAX_LEN 5
+
+// local functions
+uint32_t select_trace_pack_width(const uint32_t *res, uint32_t cnt);
+void pack_trace_group(const uint32_t *in, uint32_t width, uint8_t *out);
+void unpack_trace_group(const uint8_t *in, uint32_t width, uint32_t *out);
+uint8_t *put_trace_varint(uint8_t *out, uint32_t val);
+const uint8_t *get_trace_varint(const uint8_t *in, const uint8_t *end,
+    uint32_t *val);
+
+static inline uint32_t zigzag_encode(int32_t val) {
+    return ((uint32_t) val << 1) ^ (uint32_t) (val >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t val) {
+    return (int32_t) (val >> 1) ^ -(int32_t) (val & 1);
+}
+
+static inline uint32_t get_bit_len(uint32_t val) {
+    return val ? 32 - __builtin_clz(val) : 0;
+}
+
+
+/*
+ * Upper bound on the encoded size of a block
+ */
+uint64_t get_trace_block_max_size(uint32_t msrmts_per_sample, uint32_t input_len) {
+    uint64_t per_set = 2 * VARINT_MAX_LEN + 1
+                       + TRACE_BLOCK_SAMPLES * sizeof(uint32_t)
+                       + TRACE_BLOCK_SAMPLES * (1 + VARINT_MAX_LEN);
+
+    return (uint64_t) TRACE_BLOCK_SAMPLES * input_len + msrmts_per_sample * per_set;
+}
+
+/*
+ * Encode `cnt` (at most TRACE_BLOCK_SAMPLES) samples in the layout of
+ * write_trace_samples into `out`, which must hold get_trace_block_max_size
+ * bytes. Returns the encoded size.
+ */
+uint64_t encode_trace_block(const uint8_t *inputs, const time_type *res,
+    uint32_t cnt, uint32_t msrmts_per_sample, uint32_t input_len, uint8_t *out)
+{
+    uint32_t s, i, width, exc_cnt, base, prev_base = 0;
+    uint32_t padded = (cnt + TRACE_PACK_GROUP - 1) / TRACE_PACK_GROUP
+                      * TRACE_PACK_GROUP;
+    uint32_t col[TRACE_BLOCK_SAMPLES] __attribute__ ((aligned (16)));
+    uint32_t low[TRACE_BLOCK_SAMPLES] __attribute__ ((aligned (16)));
+    uint8_t *p = out;
+    assert(sizeof(time_type) == sizeof(uint32_t));
+    assert(cnt > 0 && cnt <= TRACE_BLOCK_SAMPLES);
+
+    memcpy(p, inputs, (uint64_t) cnt * input_len);
+    p += (uint64_t) cnt * input_len;
+
+    for (s = 0; s < msrmts_per_sample; ++s) {
+        base = res[s];
+        for (i = 0; i < cnt; ++i) {
+            col[i] = res[(uint64_t) i * msrmts_per_sample + s];
+            if (col[i] < base)
+                base = col[i];
+        }
+        for (i = 0; i < cnt; ++i)
+            col[i] -= base;
+        // Padding of the last group costs no exceptions
+        memset(col + cnt, 0, (padded - cnt) * sizeof(uint32_t));
+
+        width = select_trace_pack_width(col, cnt);
+        exc_cnt = 0;
+        for (i = 0; i < cnt; ++i) {
+            if (width < 32 && (col[i] >> width))
+                ++exc_cnt;
+            low[i] = width < 32 ? col[i] & ((1u << width) - 1) : col[i];
+        }
+        memset(low + cnt, 0, (padded - cnt) * sizeof(uint32_t));
+
+        p = put_trace_varint(p, zigzag_encode((int32_t) (base - prev_base)));
+        *p++ = width;
+        p = put_trace_varint(p, exc_cnt);
+        prev_base = base;
+
+        for (i = 0; i < padded; i += TRACE_PACK_GROUP) {
+            pack_trace_group(low + i, width, p);
+            p += TRACE_PACK_GROUP / 8 * width;
+        }
+
+        for (i = 0; exc_cnt && i < cnt; ++i) {
+            if (col[i] >> width) {
+                *p++ = i;
+                p = put_trace_varint(p, col[i] >> width);
+            }
+        }
+    }
+
+    return p - out;
+}
+
+/*
+ * Decode a block of `cnt` samples from `len` bytes at `in`. Returns 1 if the
+ * block is corrupt.
+ */
+int decode_trace_block(const uint8_t *in, uint64_t len, uint32_t cnt,
+    uint32_t msrmts_per_sample, uint32_t input_len, uint8_t *inputs,
+    time_type *res)
+{
+    uint32_t s, i, width, exc_cnt, zz, high, base = 0;
+    uint32_t padded = (cnt + TRACE_PACK_GROUP - 1) / TRACE_PACK_GROUP
+                      * TRACE_PACK_GROUP;
+    uint32_t col[TRACE_BLOCK_SAMPLES] __attribute__ ((aligned (16)));
+    const uint8_t *p = in, *end = in + len;
+
+    if (cnt == 0 || cnt > TRACE_BLOCK_SAMPLES || len < (uint64_t) cnt * input_len)
+        return 1;
+
+    if (inputs)
+        memcpy(inputs, p, (uint64_t) cnt * input_len);
+    p += (uint64_t) cnt * input_len;
+
+    for (s = 0; s < msrmts_per_sample; ++s) {
+        if (!(p = get_trace_varint(p, end, &zz)) || p == end)
+            return 1;
+        base += zigzag_decode(zz);
+        width = *p++;
+        if (width > 32 || !(p = get_trace_varint(p, end, &exc_cnt))
+            || (uint64_t) (end - p) < padded / 8 * width)
+        {
+            return 1;
+        }
+
+        for (i = 0; i < padded; i += TRACE_PACK_GROUP) {
+            unpack_trace_group(p, width, col + i);
+            p += TRACE_PACK_GROUP / 8 * width;
+        }
+
+        for (i = 0; i < exc_cnt; ++i) {
+            if (p == end || *p >= cnt || width == 32)
+                return 1;
+            uint8_t idx = *p++;
+            if (!(p = get_trace_varint(p, end, &high)))
+                return 1;
+            col[idx] |= high << width;
+        }
+
+        for (i = 0; i < cnt; ++i)
+            res[(uint64_t) i * msrmts_per_sample + s] = base + col[i];
+    }
+
+    return p != end;
+}
+
+
+/*
+ * Select the width that minimises the packed size plus the exceptions of the
+ * values that do not fit
+ */
+uint32_t select_trace_pack_width(const uint32_t *res, uint32_t cnt) {
+    uint32_t i, w, best_w = 32, exc = 0;
+    uint32_t hist[33] = {0};
+    uint64_t cost, best_cost = ~0ul;
+    uint32_t padded = (cnt + TRACE_PACK_GROUP - 1) / TRACE_PACK_GROUP
+                      * TRACE_PACK_GROUP;
+
+    for (i = 0; i < cnt; ++i)
+        ++hist[get_bit_len(res[i])];
+
+    // exc is the number of values longer than w
+    for (w = 32; w <= 32; --w) {
+        cost = (uint64_t) w * padded + (uint64_t) exc * TRACE_EXCEPTION_BITS;
+        if (cost < best_cost) {
+            best_cost   = cost;
+            best_w      = w;
+        }
+        exc += hist[w];
+    }
+
+    return best_w;
+}
+
+/*
+ * Pack TRACE_PACK_GROUP values of at most `width` bits into width * 16 bytes.
+ * Each lane packs every fourth value into consecutive 32 bit words.
+ */
+void pack_trace_group(const uint32_t *in, uint32_t width, uint8_t *out) {
+    uint32_t k, shift = 0;
+    tc_vec x, acc = {0};
+
+    if (width == 0)
+        return;
+
+    for (k = 0; k < TRACE_PACK_GROUP / TRACE_PACK_VEC_LEN; ++k) {
+        x = *(const tc_vec *) (in + k * TRACE_PACK_VEC_LEN);
+        acc |= x << shift;
+        shift += width;
+        if (shift >= 32) {
+            memcpy(out, &acc, sizeof(tc_vec));
+            out += sizeof(tc_vec);
+            shift -= 32;
+            // Carry the high bits of values that straddle two words
+            acc = shift ? x >> (width - shift) : (tc_vec) {0};
+        }
+    }
+}
+
+void unpack_trace_group(const uint8_t *in, uint32_t width, uint32_t *out) {
+    uint32_t k, shift = 0;
+    uint32_t mask = width < 32 ? (1u << width) - 1 : ~0u;
+    tc_vec x, cur;
+
+    if (width == 0) {
+        memset(out, 0, TRACE_PACK_GROUP * sizeof(uint32_t));
+        return;
+    }
+
+    memcpy(&cur, in, sizeof(tc_vec));
+    in += sizeof(tc_vec);
+
+    for (k = 0; k < TRACE_PACK_GROUP / TRACE_PACK_VEC_LEN; ++k) {
+        x = cur >> shift;
+        shift += width;
+        if (shift >= 32) {
+            shift -= 32;
+            // The last word of the group is not followed by another one
+            if (k + 1 < TRACE_PACK_GROUP / TRACE_PACK_VEC_LEN || shift) {
+                memcpy(&cur, in, sizeof(tc_vec));
+                in += sizeof(tc_vec);
+            }
+            if (shift)
+                x |= cur << (width - shift);
+        }
+        *(tc_vec *) (out + k * TRACE_PACK_VEC_LEN) = x & mask;
+    }
+}
+
+uint8_t *put_trace_varint(uint8_t *out, uint32_t val) {
+    while (val >= 0x80) {
+        *out++ = (val & 0x7f) | 0x80;
+        val >>= 7;
+    }
+    *out++ = val;
+
+    return out;
+}
+
+/*
+ * Read a varint, returns NULL if it exceeds `end`
+ */
+const uint8_t *get_trace_varint(const uint8_t *in, const uint8_t *end,
+    uint32_t *val)
+{
+    uint32_t shift = 0;
+
+    *val = 0;
+    while (in < end && shift < 7 * VARINT_MAX_LEN) {
+        *val |= (uint32_t) (*in & 0x7f) << shift;
+        if (!(*in++ & 0x80))
+            return in;
+        shift += 7;
+    }
+
+    return NULL;
+}
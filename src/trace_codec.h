@@ -0,0 +1,70 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Lossless codec for blocks of trace samples (see trace.h). Probe times are
+ * small, have a strong per-set baseline and drift slowly, so each block of
+ * TRACE_BLOCK_SAMPLES samples is encoded independently, one set after the
+ * other: the minimum of the set in the block is its baseline and the
+ * residuals to it are bit-packed with the smallest width that pays off.
+ * Residuals that do not fit the width (e.g. interrupts) keep their low bits
+ * in the packed data and store the high bits as exceptions. The baselines are
+ * stored as zigzag encoded varints of the difference to the baseline of the
+ * previous set, as neighbouring sets have similar baselines. Packing uses
+ * SIMD vectors in a lane-interleaved layout: value i of a group of 128 values
+ * goes to lane i % 4. The inputs are stored unmodified.
+ */
+
+#ifndef HEADER_TRACE_CODEC_H
+#define HEADER_TRACE_CODEC_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+// Samples per block, a multiple of TRACE_PACK_GROUP
+#define TRACE_BLOCK_SAMPLES 256
+// Values that are packed at once by the SIMD kernels
+#define TRACE_PACK_GROUP 128
+// Lanes per SIMD vector (SSE, available on every x86-64 CPU)
+#define TRACE_PACK_VEC_LEN 4
+// Estimated bits of one exception (index and varint of the high bits), used
+// to select the packing width
+#define TRACE_EXCEPTION_BITS 24
+
+typedef uint32_t tc_vec __attribute__ ((vector_size (TRACE_PACK_VEC_LEN * sizeof(uint32_t))));
+
+uint64_t get_trace_block_max_size(uint32_t msrmts_per_sample, uint32_t input_len);
+uint64_t encode_trace_block(const uint8_t *inputs, const time_type *res,
+    uint32_t cnt, uint32_t msrmts_per_sample, uint32_t input_len, uint8_t *out);
+int decode_trace_block(const uint8_t *in, uint64_t len, uint32_t cnt,
+    uint32_t msrmts_per_sample, uint32_t input_len, uint8_t *inputs,
+    time_type *res);
+
+#endif // HEADER_TRACE_CODEC_H
@@ -0,0 +1,613 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements merging of many trace files and text logs.
+ */
+
+#include "trace_merge.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+
+typedef struct merge_pool merge_pool;
+typedef struct merge_worker merge_worker;
+
+// Sources that are shared by the threads, each takes the next unprocessed one
+struct merge_pool {
+    char **paths;
+    uint32_t path_cnt;
+    uint32_t next;
+    pthread_mutex_t lock;
+    uint32_t msrmts_per_sample;
+    uint32_t input_len;
+    bool failed;
+
+    // Statistics: samples per source
+    uint64_t *file_samples;
+
+    // Concatenation: output file and first sample of every source
+    int out_fd;
+    uint64_t *first_samples;
+};
+
+struct merge_worker {
+    pthread_t thread;
+    merge_pool *pool;
+    uint8_t *inputs;
+    time_type *res;
+
+    // Statistics of the processed sources
+    uint64_t cnt;
+    uint64_t *sum;
+    uint64_t *sum_sq;
+    time_type *min;
+    time_type *max;
+};
+
+// local functions
+int parse_text_source_header(trace_source *src);
+bool take_merge_source(merge_pool *pool, uint32_t *idx);
+void fail_merge_pool(merge_pool *pool);
+void run_merge_workers(merge_pool *pool, merge_worker *workers,
+    uint32_t thread_cnt, void *(*fn)(void *));
+void *merge_stats_worker(void *arg);
+void *merge_copy_worker(void *arg);
+int merge_traces_sequential(char **paths, uint32_t path_cnt, const char *out_path,
+    bool compress, uint32_t msrmts_per_sample, uint32_t input_len);
+
+
+/*
+ * Open a binary trace or a text log. Returns NULL if the file cannot be
+ * opened or has no attack data.
+ */
+trace_source *open_trace_source(const char *path) {
+    char magic[TRACE_MAGIC_LEN];
+    trace_source *src;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+
+    src = (trace_source *) calloc(1, sizeof(trace_source));
+    assert(src);
+
+    if (fread(magic, 1, TRACE_MAGIC_LEN, fp) == TRACE_MAGIC_LEN
+        && !memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_LEN))
+    {
+        fclose(fp);
+        src->tf = open_trace(path);
+        if (!src->tf) {
+            free(src);
+            return NULL;
+        }
+        src->msrmts_per_sample  = src->tf->hdr.msrmts_per_sample;
+        src->input_len          = src->tf->hdr.input_len;
+        src->samples            = src->tf->hdr.samples;
+        return src;
+    }
+
+    rewind(fp);
+    src->text   = true;
+    src->fp     = fp;
+    if (parse_text_source_header(src)) {
+        close_trace_source(src);
+        return NULL;
+    }
+
+    return src;
+}
+
+/*
+ * Read up to `max_cnt` samples (same layout as read_trace_samples). Text logs
+ * have no inputs. Returns the number of samples read, 0 at the end.
+ */
+uint32_t read_trace_source_samples(trace_source *src, uint8_t *inputs,
+    time_type *res, uint32_t max_cnt)
+{
+    uint32_t i, j;
+    char *p, *end;
+
+    if (!src->text)
+        return read_trace_samples(src->tf, inputs, res, max_cnt);
+
+    for (i = 0; i < max_cnt; ++i) {
+        // Sample line, followed by the measurements
+        if (getline(&src->line, &src->line_cap, src->fp) < 0
+            || !strstr(src->line, "Sample number")
+            || getline(&src->line, &src->line_cap, src->fp) < 0)
+        {
+            break;
+        }
+
+        p = src->line;
+        for (j = 0; j < src->msrmts_per_sample; ++j) {
+            res[(uint64_t) i * src->msrmts_per_sample + j] = strtol(p, &end, 10);
+            if (end == p)
+                return i;
+            p = end;
+        }
+    }
+
+    return i;
+}
+
+void close_trace_source(trace_source *src) {
+    if (src->tf)
+        close_trace(src->tf);
+    if (src->fp)
+        fclose(src->fp);
+    free(src->line);
+    free(src);
+}
+
+/*
+ * Check that all sources have the same number of measurements per sample
+ * and, if `same_inputs`, the same input length. The geometry is stored in
+ * `msrmts_per_sample` and `input_len`. Returns the index of the first source
+ * that cannot be opened or does not match, path_cnt if all match.
+ */
+uint32_t check_trace_sources(char **paths, uint32_t path_cnt, bool same_inputs,
+    uint32_t *msrmts_per_sample, uint32_t *input_len)
+{
+    uint32_t i;
+    trace_source *src;
+
+    for (i = 0; i < path_cnt; ++i) {
+        src = open_trace_source(paths[i]);
+        if (!src)
+            return i;
+
+        if (i == 0) {
+            *msrmts_per_sample  = src->msrmts_per_sample;
+            *input_len          = src->input_len;
+        }
+        else if (src->msrmts_per_sample != *msrmts_per_sample
+                 || (same_inputs && src->input_len != *input_len))
+        {
+            close_trace_source(src);
+            return i;
+        }
+        close_trace_source(src);
+    }
+
+    return path_cnt;
+}
+
+/*
+ * Combine the samples of all sources into count, mean, standard deviation,
+ * minimum and maximum per set, with `thread_cnt` threads (0 uses all online
+ * CPUs). If `file_samples` is not NULL, it receives the number of samples
+ * per source. Returns NULL if a source cannot be read or has another
+ * geometry.
+ */
+trace_agg *merge_trace_stats(char **paths, uint32_t path_cnt,
+    uint32_t thread_cnt, uint64_t *file_samples)
+{
+    uint32_t t, s, input_len;
+    uint64_t sum, sum_sq;
+    double mean, var;
+    merge_pool pool;
+    merge_worker *w, *workers;
+    trace_agg *agg;
+
+    memset(&pool, 0, sizeof(merge_pool));
+    if (check_trace_sources(paths, path_cnt, false, &pool.msrmts_per_sample,
+                            &input_len) != path_cnt)
+    {
+        return NULL;
+    }
+
+    if (thread_cnt == 0)
+        thread_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_cnt > path_cnt)
+        thread_cnt = path_cnt;
+
+    pool.paths          = paths;
+    pool.path_cnt       = path_cnt;
+    pool.file_samples   = (uint64_t *) calloc(path_cnt, sizeof(uint64_t));
+    assert(pool.file_samples);
+
+    workers = (merge_worker *) calloc(thread_cnt, sizeof(merge_worker));
+    assert(workers);
+    for (t = 0; t < thread_cnt; ++t) {
+        w = workers + t;
+        w->sum      = (uint64_t *) calloc(pool.msrmts_per_sample, sizeof(uint64_t));
+        w->sum_sq   = (uint64_t *) calloc(pool.msrmts_per_sample, sizeof(uint64_t));
+        w->min      = (time_type *) malloc(pool.msrmts_per_sample * sizeof(time_type));
+        w->max      = (time_type *) calloc(pool.msrmts_per_sample, sizeof(time_type));
+        assert(w->sum && w->sum_sq && w->min && w->max);
+        memset(w->min, 0xff, pool.msrmts_per_sample * sizeof(time_type));
+    }
+
+    run_merge_workers(&pool, workers, thread_cnt, merge_stats_worker);
+
+    agg = NULL;
+    if (!pool.failed) {
+        agg         = (trace_agg *) calloc(1, sizeof(trace_agg));
+        assert(agg);
+        agg->mean   = (double *) calloc(pool.msrmts_per_sample, sizeof(double));
+        agg->std    = (double *) calloc(pool.msrmts_per_sample, sizeof(double));
+        agg->min    = (time_type *) malloc(pool.msrmts_per_sample * sizeof(time_type));
+        agg->max    = (time_type *) calloc(pool.msrmts_per_sample, sizeof(time_type));
+        assert(agg->mean && agg->std && agg->min && agg->max);
+        memset(agg->min, 0xff, pool.msrmts_per_sample * sizeof(time_type));
+
+        for (t = 0; t < thread_cnt; ++t)
+            agg->cnt += workers[t].cnt;
+
+        for (s = 0; s < pool.msrmts_per_sample; ++s) {
+            sum = sum_sq = 0;
+            for (t = 0; t < thread_cnt; ++t) {
+                w = workers + t;
+                sum     += w->sum[s];
+                sum_sq  += w->sum_sq[s];
+                if (w->min[s] < agg->min[s])
+                    agg->min[s] = w->min[s];
+                if (w->max[s] > agg->max[s])
+                    agg->max[s] = w->max[s];
+            }
+
+            if (agg->cnt) {
+                mean            = (double) sum / agg->cnt;
+                var             = (double) sum_sq / agg->cnt - mean * mean;
+                agg->mean[s]    = mean;
+                agg->std[s]     = var > 0 ? sqrt(var) : 0;
+            }
+            else {
+                agg->min[s] = 0;
+            }
+        }
+
+        if (file_samples)
+            memcpy(file_samples, pool.file_samples, path_cnt * sizeof(uint64_t));
+    }
+
+    for (t = 0; t < thread_cnt; ++t) {
+        free(workers[t].sum);
+        free(workers[t].sum_sq);
+        free(workers[t].min);
+        free(workers[t].max);
+    }
+    free(workers);
+    free(pool.file_samples);
+
+    return agg;
+}
+
+/*
+ * Concatenate the samples of all sources into the trace at `out_path`, in the
+ * order of the sources. Uncompressed binary traces are copied by
+ * `thread_cnt` threads (0 uses all online CPUs) into their final place in
+ * the output. Text logs (whose sample count is unknown in advance) and
+ * compressed output are processed sequentially. Returns 1 if a source cannot
+ * be read, the geometries differ or the output cannot be written.
+ */
+int merge_traces(char **paths, uint32_t path_cnt, const char *out_path,
+    bool compress, uint32_t thread_cnt)
+{
+    uint32_t i, msrmts_per_sample, input_len;
+    uint64_t total = 0;
+    bool parallel = !compress;
+    merge_pool pool;
+    merge_worker *workers;
+    trace_source *src;
+    trace_file *tf;
+
+    if (check_trace_sources(paths, path_cnt, true, &msrmts_per_sample,
+                            &input_len) != path_cnt)
+    {
+        return 1;
+    }
+
+    memset(&pool, 0, sizeof(merge_pool));
+    pool.first_samples = (uint64_t *) malloc(path_cnt * sizeof(uint64_t));
+    assert(pool.first_samples);
+    pool.out_fd = -1;
+
+    for (i = 0; i < path_cnt && parallel; ++i) {
+        src = open_trace_source(paths[i]);
+        if (!src)
+            goto fail;
+        parallel &= !src->text;
+        pool.first_samples[i] = total;
+        total += src->samples;
+        close_trace_source(src);
+    }
+
+    if (!parallel) {
+        free(pool.first_samples);
+        return merge_traces_sequential(paths, path_cnt, out_path, compress,
+                                       msrmts_per_sample, input_len);
+    }
+
+    // The header with the final sample count is written first, the threads
+    // fill in the samples
+    tf = create_trace(out_path, msrmts_per_sample, input_len);
+    if (!tf)
+        goto fail;
+    tf->hdr.samples = total;
+    if (close_trace(tf))
+        goto fail;
+
+    pool.out_fd = open(out_path, O_WRONLY);
+    if (pool.out_fd < 0
+        || ftruncate(pool.out_fd, sizeof(trace_header) + total * (input_len
+                     + (uint64_t) msrmts_per_sample * sizeof(time_type))))
+    {
+        goto fail;
+    }
+
+    if (thread_cnt == 0)
+        thread_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_cnt > path_cnt)
+        thread_cnt = path_cnt;
+
+    pool.paths              = paths;
+    pool.path_cnt           = path_cnt;
+    pool.msrmts_per_sample  = msrmts_per_sample;
+    pool.input_len          = input_len;
+
+    workers = (merge_worker *) calloc(thread_cnt, sizeof(merge_worker));
+    assert(workers);
+    run_merge_workers(&pool, workers, thread_cnt, merge_copy_worker);
+    free(workers);
+
+    pool.failed |= fsync(pool.out_fd) != 0;
+    pool.failed |= close(pool.out_fd) != 0;
+    free(pool.first_samples);
+
+    return pool.failed;
+
+fail:
+    if (pool.out_fd >= 0)
+        close(pool.out_fd);
+    free(pool.first_samples);
+    return 1;
+}
+
+
+/*
+ * Read the geometry of a text log and skip to its attack data
+ */
+int parse_text_source_header(trace_source *src) {
+    uint32_t msrmts = 0;
+    char *p, *end;
+    bool data = false;
+
+    while (getline(&src->line, &src->line_cap, src->fp) >= 0) {
+        if ((p = strstr(src->line, MERGE_TEXT_MSRMTS)))
+            msrmts = strtoul(p + strlen(MERGE_TEXT_MSRMTS), NULL, 10);
+        if (strstr(src->line, MERGE_TEXT_DATA)) {
+            data = true;
+            break;
+        }
+    }
+    if (!data)
+        return 1;
+
+    // Without metadata, the first sample determines the geometry
+    if (!msrmts) {
+        off_t pos = ftello(src->fp);
+        if (getline(&src->line, &src->line_cap, src->fp) < 0
+            || getline(&src->line, &src->line_cap, src->fp) < 0)
+        {
+            return 1;
+        }
+        for (p = src->line; strtol(p, &end, 10), end != p; p = end)
+            ++msrmts;
+        fseeko(src->fp, pos, SEEK_SET);
+    }
+
+    src->msrmts_per_sample = msrmts;
+
+    return msrmts == 0;
+}
+
+bool take_merge_source(merge_pool *pool, uint32_t *idx) {
+    bool ok;
+
+    pthread_mutex_lock(&pool->lock);
+    ok      = pool->next < pool->path_cnt && !pool->failed;
+    *idx    = pool->next++;
+    pthread_mutex_unlock(&pool->lock);
+
+    return ok;
+}
+
+/*
+ * Stop the workers after the sources they are processing
+ */
+void fail_merge_pool(merge_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->failed = true;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Run `fn` on every worker, the caller acts as worker 0
+ */
+void run_merge_workers(merge_pool *pool, merge_worker *workers,
+    uint32_t thread_cnt, void *(*fn)(void *))
+{
+    int err;
+    uint32_t t;
+
+    err = pthread_mutex_init(&pool->lock, NULL);
+    assert(!err);
+
+    for (t = 0; t < thread_cnt; ++t) {
+        workers[t].pool     = pool;
+        workers[t].inputs   = (uint8_t *) malloc(MERGE_BATCH * pool->input_len + 1);
+        workers[t].res      = (time_type *) malloc((uint64_t) MERGE_BATCH
+                                  * pool->msrmts_per_sample * sizeof(time_type));
+        assert(workers[t].inputs && workers[t].res);
+    }
+
+    for (t = 1; t < thread_cnt; ++t) {
+        err = pthread_create(&workers[t].thread, NULL, fn, workers + t);
+        assert(!err);
+    }
+    fn(workers);
+    for (t = 1; t < thread_cnt; ++t)
+        pthread_join(workers[t].thread, NULL);
+
+    for (t = 0; t < thread_cnt; ++t) {
+        free(workers[t].inputs);
+        free(workers[t].res);
+    }
+    pthread_mutex_destroy(&pool->lock);
+}
+
+void *merge_stats_worker(void *arg) {
+    uint32_t f, i, s, cnt;
+    time_type x;
+    const time_type *r;
+    merge_worker *w = (merge_worker *) arg;
+    merge_pool *pool = w->pool;
+    trace_source *src;
+
+    while (take_merge_source(pool, &f)) {
+        src = open_trace_source(pool->paths[f]);
+        if (!src) {
+            fail_merge_pool(pool);
+            break;
+        }
+
+        // Inputs are not needed
+        while ((cnt = read_trace_source_samples(src, NULL, w->res, MERGE_BATCH)) > 0) {
+            for (i = 0; i < cnt; ++i) {
+                r = w->res + (uint64_t) i * pool->msrmts_per_sample;
+                for (s = 0; s < pool->msrmts_per_sample; ++s) {
+                    x = r[s];
+                    w->sum[s]       += x;
+                    w->sum_sq[s]    += (uint64_t) x * x;
+                    if (x < w->min[s])
+                        w->min[s] = x;
+                    if (x > w->max[s])
+                        w->max[s] = x;
+                }
+            }
+            w->cnt                  += cnt;
+            pool->file_samples[f]   += cnt;
+        }
+
+        if (src->samples && pool->file_samples[f] != src->samples)
+            fail_merge_pool(pool);
+        close_trace_source(src);
+    }
+
+    return NULL;
+}
+
+void *merge_copy_worker(void *arg) {
+    uint32_t f, i, cnt;
+    uint64_t done;
+    merge_worker *w = (merge_worker *) arg;
+    merge_pool *pool = w->pool;
+    uint64_t sample_size = pool->input_len
+                           + (uint64_t) pool->msrmts_per_sample * sizeof(time_type);
+    uint8_t *buf = (uint8_t *) malloc(MERGE_BATCH * sample_size);
+    trace_source *src;
+    assert(buf);
+
+    while (take_merge_source(pool, &f)) {
+        src = open_trace_source(pool->paths[f]);
+        if (!src) {
+            fail_merge_pool(pool);
+            break;
+        }
+
+        done = 0;
+        while ((cnt = read_trace_source_samples(src, w->inputs, w->res,
+                                                MERGE_BATCH)) > 0)
+        {
+            // Interleave inputs and measurements as in the trace
+            for (i = 0; i < cnt; ++i) {
+                memcpy(buf + i * sample_size, w->inputs + i * pool->input_len,
+                       pool->input_len);
+                memcpy(buf + i * sample_size + pool->input_len,
+                       w->res + (uint64_t) i * pool->msrmts_per_sample,
+                       pool->msrmts_per_sample * sizeof(time_type));
+            }
+            if (pwrite(pool->out_fd, buf, cnt * sample_size, sizeof(trace_header)
+                       + (pool->first_samples[f] + done) * sample_size)
+                != (ssize_t) (cnt * sample_size))
+            {
+                fail_merge_pool(pool);
+                break;
+            }
+            done += cnt;
+        }
+
+        if (done != src->samples)
+            fail_merge_pool(pool);
+        close_trace_source(src);
+    }
+
+    free(buf);
+
+    return NULL;
+}
+
+int merge_traces_sequential(char **paths, uint32_t path_cnt, const char *out_path,
+    bool compress, uint32_t msrmts_per_sample, uint32_t input_len)
+{
+    uint32_t i, cnt;
+    int err = 0;
+    uint8_t *inputs = (uint8_t *) malloc(MERGE_BATCH * input_len + 1);
+    time_type *res = (time_type *) malloc((uint64_t) MERGE_BATCH
+                                          * msrmts_per_sample * sizeof(time_type));
+    trace_source *src;
+    trace_file *tf;
+    assert(inputs && res);
+
+    if (compress)
+        tf = create_compressed_trace(out_path, msrmts_per_sample, input_len);
+    else
+        tf = create_trace(out_path, msrmts_per_sample, input_len);
+    if (!tf) {
+        free(inputs);
+        free(res);
+        return 1;
+    }
+
+    for (i = 0; i < path_cnt && !err; ++i) {
+        src = open_trace_source(paths[i]);
+        if (!src) {
+            err = 1;
+            break;
+        }
+        while (!err
+               && (cnt = read_trace_source_samples(src, inputs, res, MERGE_BATCH)) > 0)
+        {
+            err = write_trace_samples(tf, inputs, res, cnt);
+        }
+        close_trace_source(src);
+    }
+
+    err |= close_trace(tf);
+    free(inputs);
+    free(res);
+
+    return err;
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Merging of many captures, e.g. of the same experiment on several hosts.
+ * A source is either a binary trace (see trace.h) or a text log in the format
+ * of print_results, of which only the attack data is used (not the baseline
+ * of normalised logs). All sources must have the same geometry. A pool of
+ * threads processes one source at a time each, streaming it in batches of
+ * MERGE_BATCH samples, such that the memory does not depend on the size or
+ * number of the sources. The sources are either combined into per-set
+ * statistics, or concatenated into one trace in the order of the sources.
+ */
+
+#ifndef HEADER_TRACE_MERGE_H
+#define HEADER_TRACE_MERGE_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "trace.h"
+#include "trace_query.h"
+
+// Samples per batch of a thread
+#define MERGE_BATCH 4096
+// Marker of the attack data in text logs
+#define MERGE_TEXT_DATA "Output cache attack data"
+#define MERGE_TEXT_MSRMTS "Measurements per sample: "
+
+typedef struct trace_source trace_source;
+
+struct trace_source {
+    bool text;
+    uint32_t msrmts_per_sample;
+    uint32_t input_len;
+    // Number of samples, unknown (0) for text logs
+    uint64_t samples;
+
+    trace_file *tf;
+
+    // Text logs
+    FILE *fp;
+    char *line;
+    size_t line_cap;
+};
+
+trace_source *open_trace_source(const char *path);
+uint32_t read_trace_source_samples(trace_source *src, uint8_t *inputs,
+    time_type *res, uint32_t max_cnt);
+void close_trace_source(trace_source *src);
+uint32_t check_trace_sources(char **paths, uint32_t path_cnt, bool same_inputs,
+    uint32_t *msrmts_per_sample, uint32_t *input_len);
+trace_agg *merge_trace_stats(char **paths, uint32_t path_cnt,
+    uint32_t thread_cnt, uint64_t *file_samples);
+int merge_traces(char **paths, uint32_t path_cnt, const char *out_path,
+    bool compress, uint32_t thread_cnt);
+
+#endif // HEADER_TRACE_MERGE_H
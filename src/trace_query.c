@@ -0,0 +1,581 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements queries over memory mapped binary trace files.
+ */
+
+#include "trace_query.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef enum trace_query_job trace_query_job;
+typedef struct trace_query_worker trace_query_worker;
+
+enum trace_query_job {TQ_FILTER, TQ_AGGREGATE, TQ_HISTOGRAM};
+
+// State of one thread, which processes the samples [first, last)
+struct trace_query_worker {
+    pthread_t thread;
+    trace_query *q;
+    trace_query_job job;
+    uint64_t first;
+    uint64_t last;
+    uint64_t cnt;
+
+    // TQ_FILTER: indices of the matching samples
+    uint64_t *matches;
+    uint64_t matches_cap;
+
+    // TQ_AGGREGATE: one vector per TRACE_QUERY_VEC_LEN selected sets
+    tq_wide_vec *sum;
+    tq_wide_vec *sum_sq;
+    tq_vec *min;
+    tq_vec *max;
+
+    // TQ_HISTOGRAM: bins per selected set
+    time_type hist_min;
+    time_type hist_width;
+    uint32_t bins;
+    uint64_t *hist;
+};
+
+// local functions
+int parse_trace_query_uint(const char **s, uint32_t *val);
+void run_trace_query_workers(trace_query *q, trace_query_worker *workers);
+void *trace_query_worker_loop(void *arg);
+void filter_trace_query_chunk(trace_query_worker *w);
+void aggregate_trace_query_chunk(trace_query_worker *w);
+void histogram_trace_query_chunk(trace_query_worker *w);
+tq_vec gather_trace_query_vec(trace_query *q, const uint8_t *sample, uint32_t v);
+
+
+/*
+ * Map the trace at `path` for queries with `thread_cnt` threads (including
+ * the caller, 0 uses all online CPUs). All samples and sets are selected.
+ * Returns NULL if the file is not a valid uncompressed trace.
+ */
+trace_query *prepare_trace_query(const char *path, uint32_t thread_cnt) {
+    struct stat st;
+    uint64_t avail;
+    uint32_t i;
+    trace_query *q = (trace_query *) calloc(1, sizeof(trace_query));
+    assert(q);
+
+    q->fd = open(path, O_RDONLY);
+    if (q->fd < 0 || fstat(q->fd, &st) || (uint64_t) st.st_size < sizeof(trace_header))
+        goto fail;
+
+    q->map_len  = st.st_size;
+    q->map      = (uint8_t *) mmap(NULL, q->map_len, PROT_READ, MAP_SHARED,
+                                   q->fd, 0);
+    if (q->map == MAP_FAILED) {
+        q->map = NULL;
+        goto fail;
+    }
+    // Queries scan the chunks of each thread sequentially
+    madvise(q->map, q->map_len, MADV_SEQUENTIAL);
+
+    memcpy(&q->hdr, q->map, sizeof(trace_header));
+    if (memcmp(q->hdr.magic, TRACE_MAGIC, TRACE_MAGIC_LEN)
+        || q->hdr.version != TRACE_VERSION || q->hdr.msrmts_per_sample == 0
+        || q->hdr.flags)
+    {
+        goto fail;
+    }
+
+    // A trace that was not closed has no sample count in its header, use the
+    // complete samples in the file instead
+    q->sample_size  = q->hdr.input_len
+                      + (uint64_t) q->hdr.msrmts_per_sample * sizeof(time_type);
+    avail           = (q->map_len - sizeof(trace_header)) / q->sample_size;
+    q->samples      = (q->hdr.samples && q->hdr.samples < avail) ? q->hdr.samples
+                                                                 : avail;
+
+    q->first        = 0;
+    q->last         = q->samples;
+    q->sets_len     = q->hdr.msrmts_per_sample;
+    q->sets         = (uint32_t *) malloc(q->sets_len * sizeof(uint32_t));
+    assert(q->sets);
+    for (i = 0; i < q->sets_len; ++i)
+        q->sets[i] = i;
+
+    q->thread_cnt   = thread_cnt ? thread_cnt : sysconf(_SC_NPROCESSORS_ONLN);
+
+    return q;
+
+fail:
+    if (q->map)
+        munmap(q->map, q->map_len);
+    if (q->fd >= 0)
+        close(q->fd);
+    free(q);
+    return NULL;
+}
+
+void release_trace_query(trace_query *q) {
+    munmap(q->map, q->map_len);
+    close(q->fd);
+    free(q->sets);
+    free(q);
+}
+
+/*
+ * Restrict the query to the samples [first, last). Returns 1 if the range is
+ * empty or exceeds the trace.
+ */
+int set_trace_query_range(trace_query *q, uint64_t first, uint64_t last) {
+    if (first >= last || last > q->samples)
+        return 1;
+
+    q->first    = first;
+    q->last     = last;
+
+    return 0;
+}
+
+/*
+ * Restrict the query to `sets_len` sets, in the given order. Returns 1 if a
+ * set is out of range.
+ */
+int set_trace_query_sets(trace_query *q, const uint32_t *sets, uint32_t sets_len) {
+    uint32_t i;
+
+    if (sets_len == 0)
+        return 1;
+    for (i = 0; i < sets_len; ++i) {
+        if (sets[i] >= q->hdr.msrmts_per_sample)
+            return 1;
+    }
+
+    q->sets = (uint32_t *) realloc(q->sets, sets_len * sizeof(uint32_t));
+    assert(q->sets);
+    memcpy(q->sets, sets, sets_len * sizeof(uint32_t));
+    q->sets_len = sets_len;
+
+    return 0;
+}
+
+/*
+ * Add a filter condition, all conditions must hold for a sample to match.
+ * The condition has the form <s|i><index><op><value>, where `s` refers to the
+ * probe time of a set and `i` to an input byte, op is one of <, <=, >, >=,
+ * == and != and numbers may be decimal or hexadecimal (0x prefix).
+ * E.g. "s12>=120" or "i0==0x3f". Returns 1 if the condition is invalid.
+ */
+int add_trace_query_cond(trace_query *q, const char *expr) {
+    trace_cond c;
+    uint32_t limit;
+
+    if (q->cond_cnt == TRACE_QUERY_MAX_CONDS)
+        return 1;
+
+    if (*expr == 's') {
+        c.on_input  = false;
+        limit       = q->hdr.msrmts_per_sample;
+    }
+    else if (*expr == 'i') {
+        c.on_input  = true;
+        limit       = q->hdr.input_len;
+    }
+    else {
+        return 1;
+    }
+    ++expr;
+
+    if (parse_trace_query_uint(&expr, &c.idx) || c.idx >= limit)
+        return 1;
+
+    if (!strncmp(expr, "<=", 2))
+        c.op = TRACE_LE;
+    else if (!strncmp(expr, ">=", 2))
+        c.op = TRACE_GE;
+    else if (!strncmp(expr, "==", 2))
+        c.op = TRACE_EQ;
+    else if (!strncmp(expr, "!=", 2))
+        c.op = TRACE_NE;
+    else if (*expr == '<')
+        c.op = TRACE_LT;
+    else if (*expr == '>')
+        c.op = TRACE_GT;
+    else
+        return 1;
+    expr += (c.op == TRACE_LT || c.op == TRACE_GT) ? 1 : 2;
+
+    if (parse_trace_query_uint(&expr, &c.value) || *expr != '\0')
+        return 1;
+
+    q->conds[q->cond_cnt++] = c;
+
+    return 0;
+}
+
+const uint8_t *get_trace_query_input(trace_query *q, uint64_t sample) {
+    return q->map + sizeof(trace_header) + sample * q->sample_size;
+}
+
+time_type get_trace_query_msrmt(trace_query *q, uint64_t sample, uint32_t set) {
+    time_type t;
+
+    // Measurements are unaligned if the input length is no multiple of 4
+    memcpy(&t, get_trace_query_input(q, sample) + q->hdr.input_len
+                + set * sizeof(time_type), sizeof(time_type));
+
+    return t;
+}
+
+/*
+ * Check whether `sample` satisfies all conditions of the query.
+ */
+bool is_trace_query_match(trace_query *q, uint64_t sample) {
+    uint32_t i, val;
+    trace_cond *c;
+
+    for (i = 0; i < q->cond_cnt; ++i) {
+        c = q->conds + i;
+        if (c->on_input)
+            val = get_trace_query_input(q, sample)[c->idx];
+        else
+            val = get_trace_query_msrmt(q, sample, c->idx);
+
+        switch (c->op) {
+            case TRACE_LT: if (!(val <  c->value)) return false; break;
+            case TRACE_LE: if (!(val <= c->value)) return false; break;
+            case TRACE_GT: if (!(val >  c->value)) return false; break;
+            case TRACE_GE: if (!(val >= c->value)) return false; break;
+            case TRACE_EQ: if (!(val == c->value)) return false; break;
+            case TRACE_NE: if (!(val != c->value)) return false; break;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Count the matching samples in the range. If `matches` is not NULL, it
+ * receives their indices in ascending order and must hold at least
+ * last - first entries.
+ */
+uint64_t filter_trace_query(trace_query *q, uint64_t *matches) {
+    uint32_t t;
+    uint64_t cnt = 0;
+    trace_query_worker *workers = (trace_query_worker *)
+        calloc(q->thread_cnt, sizeof(trace_query_worker));
+    assert(workers);
+
+    for (t = 0; t < q->thread_cnt; ++t) {
+        workers[t].job = TQ_FILTER;
+        if (matches) {
+            // The matches of a thread are stored in place and moved together
+            // afterwards
+            workers[t].matches = matches;
+        }
+    }
+    run_trace_query_workers(q, workers);
+
+    for (t = 0; t < q->thread_cnt; ++t) {
+        if (matches && workers[t].cnt) {
+            memmove(matches + cnt, matches + (workers[t].first - q->first),
+                    workers[t].cnt * sizeof(uint64_t));
+        }
+        cnt += workers[t].cnt;
+    }
+    free(workers);
+
+    return cnt;
+}
+
+/*
+ * Compute count, mean, standard deviation, minimum and maximum of the
+ * selected sets over the matching samples. The entries of the result are in
+ * the order of the selected sets.
+ */
+trace_agg *aggregate_trace_query(trace_query *q) {
+    uint32_t t, v, j, k;
+    uint32_t vecs = (q->sets_len + TRACE_QUERY_VEC_LEN - 1) / TRACE_QUERY_VEC_LEN;
+    double mean, var;
+    trace_query_worker *w, *workers = (trace_query_worker *)
+        calloc(q->thread_cnt, sizeof(trace_query_worker));
+    trace_agg *agg = (trace_agg *) calloc(1, sizeof(trace_agg));
+    assert(workers && agg);
+
+    for (t = 0; t < q->thread_cnt; ++t) {
+        w = workers + t;
+        w->job      = TQ_AGGREGATE;
+        w->sum      = (tq_wide_vec *) aligned_alloc(sizeof(tq_wide_vec),
+                                                   vecs * sizeof(tq_wide_vec));
+        w->sum_sq   = (tq_wide_vec *) aligned_alloc(sizeof(tq_wide_vec),
+                                                   vecs * sizeof(tq_wide_vec));
+        w->min      = (tq_vec *) aligned_alloc(sizeof(tq_vec), vecs * sizeof(tq_vec));
+        w->max      = (tq_vec *) aligned_alloc(sizeof(tq_vec), vecs * sizeof(tq_vec));
+        assert(w->sum && w->sum_sq && w->min && w->max);
+
+        memset(w->sum, 0, vecs * sizeof(tq_wide_vec));
+        memset(w->sum_sq, 0, vecs * sizeof(tq_wide_vec));
+        memset(w->min, 0xff, vecs * sizeof(tq_vec));
+        memset(w->max, 0, vecs * sizeof(tq_vec));
+    }
+    run_trace_query_workers(q, workers);
+
+    agg->mean   = (double *) calloc(q->sets_len, sizeof(double));
+    agg->std    = (double *) calloc(q->sets_len, sizeof(double));
+    agg->min    = (time_type *) malloc(q->sets_len * sizeof(time_type));
+    agg->max    = (time_type *) calloc(q->sets_len, sizeof(time_type));
+    assert(agg->mean && agg->std && agg->min && agg->max);
+    memset(agg->min, 0xff, q->sets_len * sizeof(time_type));
+
+    for (t = 0; t < q->thread_cnt; ++t)
+        agg->cnt += workers[t].cnt;
+
+    for (j = 0; j < q->sets_len; ++j) {
+        uint64_t sum = 0, sum_sq = 0;
+        v = j / TRACE_QUERY_VEC_LEN;
+        k = j % TRACE_QUERY_VEC_LEN;
+
+        for (t = 0; t < q->thread_cnt; ++t) {
+            w = workers + t;
+            if (!w->cnt)
+                continue;
+            sum     += w->sum[v][k];
+            sum_sq  += w->sum_sq[v][k];
+            if (w->min[v][k] < agg->min[j])
+                agg->min[j] = w->min[v][k];
+            if (w->max[v][k] > agg->max[j])
+                agg->max[j] = w->max[v][k];
+        }
+
+        if (agg->cnt) {
+            mean            = (double) sum / agg->cnt;
+            var             = (double) sum_sq / agg->cnt - mean * mean;
+            agg->mean[j]    = mean;
+            agg->std[j]     = var > 0 ? sqrt(var) : 0;
+        }
+        else {
+            agg->min[j] = 0;
+        }
+    }
+
+    for (t = 0; t < q->thread_cnt; ++t) {
+        free(workers[t].sum);
+        free(workers[t].sum_sq);
+        free(workers[t].min);
+        free(workers[t].max);
+    }
+    free(workers);
+
+    return agg;
+}
+
+void release_trace_agg(trace_agg *agg) {
+    free(agg->mean);
+    free(agg->std);
+    free(agg->min);
+    free(agg->max);
+    free(agg);
+}
+
+/*
+ * Bin the probe times of the selected sets over the matching samples into
+ * `bins` bins of `width` cycles starting at `min`. Times outside the range
+ * are counted in the first respectively last bin. `hist` receives the bins of
+ * every selected set one after another (sets_len * bins entries).
+ * Returns the number of matching samples.
+ */
+uint64_t histogram_trace_query(trace_query *q, time_type min, time_type width,
+    uint32_t bins, uint64_t *hist)
+{
+    uint32_t t;
+    uint64_t i, len = (uint64_t) q->sets_len * bins, cnt = 0;
+    trace_query_worker *w, *workers = (trace_query_worker *)
+        calloc(q->thread_cnt, sizeof(trace_query_worker));
+    assert(workers);
+    assert(width > 0 && bins > 0);
+
+    for (t = 0; t < q->thread_cnt; ++t) {
+        w = workers + t;
+        w->job          = TQ_HISTOGRAM;
+        w->hist_min     = min;
+        w->hist_width   = width;
+        w->bins         = bins;
+        w->hist         = (uint64_t *) calloc(len, sizeof(uint64_t));
+        assert(w->hist);
+    }
+    run_trace_query_workers(q, workers);
+
+    memset(hist, 0, len * sizeof(uint64_t));
+    for (t = 0; t < q->thread_cnt; ++t) {
+        w = workers + t;
+        for (i = 0; i < len; ++i)
+            hist[i] += w->hist[i];
+        cnt += w->cnt;
+        free(w->hist);
+    }
+    free(workers);
+
+    return cnt;
+}
+
+
+/*
+ * Split the range into one contiguous chunk per thread and process the
+ * chunks in parallel. The caller processes the first chunk.
+ */
+void run_trace_query_workers(trace_query *q, trace_query_worker *workers) {
+    int err;
+    uint32_t t;
+    uint64_t len = q->last - q->first;
+
+    for (t = 0; t < q->thread_cnt; ++t) {
+        workers[t].q        = q;
+        workers[t].first    = q->first + len * t / q->thread_cnt;
+        workers[t].last     = q->first + len * (t + 1) / q->thread_cnt;
+    }
+
+    for (t = 1; t < q->thread_cnt; ++t) {
+        err = pthread_create(&workers[t].thread, NULL, trace_query_worker_loop,
+                             workers + t);
+        assert(!err);
+    }
+
+    trace_query_worker_loop(workers);
+
+    for (t = 1; t < q->thread_cnt; ++t)
+        pthread_join(workers[t].thread, NULL);
+}
+
+void *trace_query_worker_loop(void *arg) {
+    trace_query_worker *w = (trace_query_worker *) arg;
+
+    switch (w->job) {
+        case TQ_FILTER:
+            filter_trace_query_chunk(w);
+            break;
+        case TQ_AGGREGATE:
+            aggregate_trace_query_chunk(w);
+            break;
+        case TQ_HISTOGRAM:
+            histogram_trace_query_chunk(w);
+            break;
+    }
+
+    return NULL;
+}
+
+void filter_trace_query_chunk(trace_query_worker *w) {
+    uint64_t s;
+    // Matches of this chunk start at the index of its first sample
+    uint64_t *out = w->matches ? w->matches + (w->first - w->q->first) : NULL;
+
+    for (s = w->first; s < w->last; ++s) {
+        if (!is_trace_query_match(w->q, s))
+            continue;
+        if (out)
+            out[w->cnt] = s;
+        ++w->cnt;
+    }
+}
+
+void aggregate_trace_query_chunk(trace_query_worker *w) {
+    uint32_t v;
+    uint64_t s;
+    trace_query *q = w->q;
+    uint32_t vecs = (q->sets_len + TRACE_QUERY_VEC_LEN - 1) / TRACE_QUERY_VEC_LEN;
+    tq_vec x, lt, gt;
+    tq_wide_vec x_wide;
+
+    for (s = w->first; s < w->last; ++s) {
+        if (!is_trace_query_match(q, s))
+            continue;
+        ++w->cnt;
+
+        for (v = 0; v < vecs; ++v) {
+            x       = gather_trace_query_vec(q, get_trace_query_input(q, s), v);
+            x_wide  = __builtin_convertvector(x, tq_wide_vec);
+
+            w->sum[v]       += x_wide;
+            w->sum_sq[v]    += x_wide * x_wide;
+
+            // Comparisons yield all-ones masks for true lanes
+            lt          = (tq_vec) (x < w->min[v]);
+            gt          = (tq_vec) (x > w->max[v]);
+            w->min[v]   = (x & lt) | (w->min[v] & ~lt);
+            w->max[v]   = (x & gt) | (w->max[v] & ~gt);
+        }
+    }
+}
+
+void histogram_trace_query_chunk(trace_query_worker *w) {
+    uint32_t j;
+    uint64_t s, bin;
+    time_type t;
+    trace_query *q = w->q;
+
+    for (s = w->first; s < w->last; ++s) {
+        if (!is_trace_query_match(q, s))
+            continue;
+        ++w->cnt;
+
+        for (j = 0; j < q->sets_len; ++j) {
+            t   = get_trace_query_msrmt(q, s, q->sets[j]);
+            bin = t < w->hist_min ? 0 : (t - w->hist_min) / w->hist_width;
+            if (bin >= w->bins)
+                bin = w->bins - 1;
+            ++w->hist[(uint64_t) j * w->bins + bin];
+        }
+    }
+}
+
+/*
+ * Load the probe times of the v-th vector of selected sets of a sample.
+ * Lanes beyond the last selected set repeat the last set.
+ */
+tq_vec gather_trace_query_vec(trace_query *q, const uint8_t *sample, uint32_t v) {
+    uint32_t k, j;
+    tq_vec x;
+    const uint8_t *msrmts = sample + q->hdr.input_len;
+
+    for (k = 0; k < TRACE_QUERY_VEC_LEN; ++k) {
+        j = v * TRACE_QUERY_VEC_LEN + k;
+        if (j >= q->sets_len)
+            j = q->sets_len - 1;
+        memcpy(&x[k], msrmts + q->sets[j] * sizeof(time_type), sizeof(time_type));
+    }
+
+    return x;
+}
+
+int parse_trace_query_uint(const char **s, uint32_t *val) {
+    char *end;
+    unsigned long n = strtoul(*s, &end, 0);
+
+    if (end == *s || n > UINT32_MAX)
+        return 1;
+
+    *val    = n;
+    *s      = end;
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Queries over binary trace files (see trace.h). The trace is mapped into
+ * memory and a query selects a range of samples and a subset of sets, and
+ * filters samples by conditions on probe times or input bytes (e.g. "set 12
+ * was evicted": s12>=120). Matching samples are counted, aggregated per set
+ * (count, mean, standard deviation, minimum and maximum) or binned into
+ * histograms. The sample range is split into one contiguous chunk per thread;
+ * each thread reduces its chunk with SIMD vectors over the selected sets and
+ * the partial results are merged at the end.
+ */
+
+#ifndef HEADER_TRACE_QUERY_H
+#define HEADER_TRACE_QUERY_H
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "trace.h"
+
+// Maximal number of filter conditions of a query
+#define TRACE_QUERY_MAX_CONDS 16
+// Sets per SIMD vector
+#define TRACE_QUERY_VEC_LEN 4
+
+typedef uint32_t tq_vec __attribute__ ((vector_size (TRACE_QUERY_VEC_LEN * sizeof(uint32_t))));
+typedef uint64_t tq_wide_vec __attribute__ ((vector_size (TRACE_QUERY_VEC_LEN * sizeof(uint64_t))));
+
+typedef enum trace_cond_op trace_cond_op;
+typedef struct trace_cond trace_cond;
+typedef struct trace_agg trace_agg;
+typedef struct trace_query trace_query;
+
+enum trace_cond_op {TRACE_LT, TRACE_LE, TRACE_GT, TRACE_GE, TRACE_EQ, TRACE_NE};
+
+// Condition on the probe time of a set or on an input byte
+struct trace_cond {
+    bool on_input;
+    uint32_t idx;
+    trace_cond_op op;
+    uint32_t value;
+};
+
+// Aggregates of the selected sets over the matching samples
+struct trace_agg {
+    uint64_t cnt;
+    double *mean;
+    double *std;
+    time_type *min;
+    time_type *max;
+};
+
+struct trace_query {
+    // Mapped trace
+    int fd;
+    uint8_t *map;
+    uint64_t map_len;
+    trace_header hdr;
+    uint64_t sample_size;
+    uint64_t samples;
+
+    // Sample range [first, last), selected sets and filter conditions
+    uint64_t first;
+    uint64_t last;
+    uint32_t *sets;
+    uint32_t sets_len;
+    trace_cond conds[TRACE_QUERY_MAX_CONDS];
+    uint32_t cond_cnt;
+
+    uint32_t thread_cnt;
+};
+
+trace_query *prepare_trace_query(const char *path, uint32_t thread_cnt);
+void release_trace_query(trace_query *q);
+int set_trace_query_range(trace_query *q, uint64_t first, uint64_t last);
+int set_trace_query_sets(trace_query *q, const uint32_t *sets, uint32_t sets_len);
+int add_trace_query_cond(trace_query *q, const char *expr);
+const uint8_t *get_trace_query_input(trace_query *q, uint64_t sample);
+time_type get_trace_query_msrmt(trace_query *q, uint64_t sample, uint32_t set);
+bool is_trace_query_match(trace_query *q, uint64_t sample);
+uint64_t filter_trace_query(trace_query *q, uint64_t *matches);
+trace_agg *aggregate_trace_query(trace_query *q);
+void release_trace_agg(trace_agg *agg);
+uint64_t histogram_trace_query(trace_query *q, time_type min, time_type width,
+    uint32_t bins, uint64_t *hist);
+
+#endif // HEADER_TRACE_QUERY_H
@@ -0,0 +1,365 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This file implements the streaming Welch t-test leakage assessment.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tvla.h"
+
+typedef struct tvla_rank_entry tvla_rank_entry;
+
+// Binomial coefficients up to 2 * TVLA_MAX_ORDER
+static const double tvla_binomial[2 * TVLA_MAX_ORDER + 1][2 * TVLA_MAX_ORDER + 1] = {
+    {1},
+    {1, 1},
+    {1, 2, 1},
+    {1, 3, 3, 1},
+    {1, 4, 6, 4, 1},
+    {1, 5, 10, 10, 5, 1},
+    {1, 6, 15, 20, 15, 6, 1},
+};
+
+struct tvla_rank_entry {
+    double effect_size;
+    uint32_t set;
+};
+
+// local functions
+int cmp_tvla_rank_entries(const void *a, const void *b);
+void get_tvla_class_stats(tvla *a, uint32_t cls, uint32_t order, uint32_t set,
+    double *stat_mean, double *stat_var);
+
+
+/*
+ * Prepare a leakage assessment of `sets` measurements per sample with
+ * t-tests up to the given order (at most TVLA_MAX_ORDER)
+ */
+tvla *prepare_tvla(uint32_t sets, uint32_t order) {
+    uint32_t c;
+    tvla *a = (tvla *) calloc(1, sizeof(tvla));
+    assert(a);
+    assert(order >= 1 && order <= TVLA_MAX_ORDER);
+
+    a->sets     = sets;
+    a->order    = order;
+
+    for (c = 0; c < TVLA_CLASSES; ++c) {
+        a->mean[c]  = (double *) calloc(sets, sizeof(double));
+        a->m[c]     = (double *) calloc((2 * order + 1) * sets, sizeof(double));
+        assert(a->mean[c] && a->m[c]);
+    }
+
+    a->t = (double *) calloc(order * sets, sizeof(double));
+    assert(a->t);
+
+    return a;
+}
+
+void release_tvla(tvla *a) {
+    uint32_t c;
+
+    for (c = 0; c < TVLA_CLASSES; ++c) {
+        free(a->mean[c]);
+        free(a->m[c]);
+    }
+    free(a->t);
+    free(a);
+}
+
+/*
+ * Random class for the next sample, such that both classes are interleaved
+ * and affected by drifts in the same way
+ */
+uint32_t get_tvla_class(void) {
+    return rand() & 1;
+}
+
+/*
+ * Add the measurements of one sample of class `cls` (TVLA_FIXED or
+ * TVLA_RANDOM)
+ */
+void update_tvla(tvla *a, uint32_t cls, const time_type *res) {
+    uint32_t s, p, k;
+    double n, delta, delta_n, term;
+    double *mean, *m;
+    uint32_t max_p = 2 * a->order;
+    // Powers of -delta / n and of (n - 1) * delta / n, and the factor
+    // 1 - (-1 / (n - 1))^(p - 1) per power p
+    double neg_pow[2 * TVLA_MAX_ORDER + 1], pos_pow[2 * TVLA_MAX_ORDER + 1];
+    double factor[2 * TVLA_MAX_ORDER + 1];
+
+    assert(cls < TVLA_CLASSES);
+
+    n       = ++a->cnt[cls];
+    mean    = a->mean[cls];
+    m       = a->m[cls];
+    ++a->samples;
+
+    if (n >= 2) {
+        term = 1;
+        for (p = 2; p <= max_p; ++p) {
+            term        *= -1 / (n - 1);
+            factor[p]   = 1 - term;
+        }
+    }
+
+    for (s = 0; s < a->sets; ++s) {
+        delta   = res[s] - mean[s];
+        delta_n = delta / n;
+        mean[s] += delta_n;
+
+        if (n < 2)
+            continue;
+
+        neg_pow[0] = pos_pow[0] = 1;
+        for (p = 1; p <= max_p; ++p) {
+            neg_pow[p] = neg_pow[p - 1] * -delta_n;
+            pos_pow[p] = pos_pow[p - 1] * (n - 1) * delta_n;
+        }
+
+        // Higher powers first, they depend on the old lower ones
+        for (p = max_p; p >= 2; --p) {
+            term = pos_pow[p] * factor[p];
+            for (k = 1; k <= p - 2; ++k)
+                term += tvla_binomial[p][k] * m[(p - k) * a->sets + s] * neg_pow[k];
+
+            m[p * a->sets + s] += term;
+        }
+    }
+}
+
+/*
+ * Compute the t-statistics of all orders and sets
+ */
+void compute_tvla(tvla *a) {
+    uint32_t o, s;
+    double m0, v0, m1, v1, denom, t;
+
+    for (o = 1; o <= a->order; ++o) {
+        a->max_abs_t[o - 1] = 0;
+        a->max_set[o - 1]   = 0;
+
+        for (s = 0; s < a->sets; ++s) {
+            t = 0;
+            if (a->cnt[TVLA_FIXED] > 1 && a->cnt[TVLA_RANDOM] > 1) {
+                get_tvla_class_stats(a, TVLA_FIXED, o, s, &m0, &v0);
+                get_tvla_class_stats(a, TVLA_RANDOM, o, s, &m1, &v1);
+
+                denom = sqrt(v0 / a->cnt[TVLA_FIXED] + v1 / a->cnt[TVLA_RANDOM]);
+                if (denom > 0)
+                    t = (m0 - m1) / denom;
+            }
+
+            a->t[(o - 1) * a->sets + s] = t;
+            if (fabs(t) > a->max_abs_t[o - 1]) {
+                a->max_abs_t[o - 1] = fabs(t);
+                a->max_set[o - 1]   = s;
+            }
+        }
+    }
+}
+
+/*
+ * Check every TVLA_CHECK_INTERVAL samples whether a leak was confirmed.
+ * Returns true if the assessment can stop.
+ */
+bool is_tvla_done(tvla *a) {
+    uint32_t o;
+    bool leaky = false;
+
+    if (a->cnt[TVLA_FIXED] < TVLA_MIN_SAMPLES || a->cnt[TVLA_RANDOM] < TVLA_MIN_SAMPLES
+        || a->samples % TVLA_CHECK_INTERVAL)
+    {
+        return false;
+    }
+
+    compute_tvla(a);
+
+    for (o = 0; o < a->order; ++o)
+        leaky |= a->max_abs_t[o] > TVLA_THRESHOLD;
+
+    a->leaky_checks = leaky ? a->leaky_checks + 1 : 0;
+
+    return is_tvla_leaky(a);
+}
+
+bool is_tvla_leaky(tvla *a) {
+    return a->leaky_checks >= TVLA_CONFIRM_CHECKS;
+}
+
+/*
+ * Store the sets whose |t| of the given order exceeds the threshold in the
+ * last check in `sets`. Returns the number of sets.
+ */
+uint32_t get_tvla_leaky_sets(tvla *a, uint32_t order, uint32_t *sets) {
+    uint32_t s, len = 0;
+
+    assert(order >= 1 && order <= a->order);
+
+    for (s = 0; s < a->sets; ++s) {
+        if (fabs(a->t[(order - 1) * a->sets + s]) > TVLA_THRESHOLD)
+            sets[len++] = s;
+    }
+
+    return len;
+}
+
+/*
+ * Effect size (Cohen's d) of the difference between the classes in the
+ * statistic of the given order, i.e. in units of the pooled standard
+ * deviation. Unlike t, it does not grow with the number of samples.
+ */
+double get_tvla_effect_size(tvla *a, uint32_t order, uint32_t set) {
+    double m0, v0, m1, v1;
+
+    assert(order >= 1 && order <= a->order);
+
+    if (a->cnt[TVLA_FIXED] < 2 || a->cnt[TVLA_RANDOM] < 2)
+        return 0;
+
+    get_tvla_class_stats(a, TVLA_FIXED, order, set, &m0, &v0);
+    get_tvla_class_stats(a, TVLA_RANDOM, order, set, &m1, &v1);
+
+    if (v0 + v1 <= 0)
+        return 0;
+
+    return (m0 - m1) / sqrt((v0 + v1) / 2);
+}
+
+/*
+ * Store the sets that leak in any order in the last check in `sets`, ranked
+ * by the highest absolute effect size over the leaking orders, which is
+ * stored in `effect_sizes` (optional). Returns the number of sets.
+ */
+uint32_t rank_tvla_leaky_sets(tvla *a, uint32_t *sets, double *effect_sizes) {
+    uint32_t o, s, len = 0;
+    double d;
+    tvla_rank_entry *entries = (tvla_rank_entry *) malloc(a->sets * sizeof(tvla_rank_entry));
+    assert(entries);
+
+    for (s = 0; s < a->sets; ++s) {
+        d = -1;
+        for (o = 1; o <= a->order; ++o) {
+            if (fabs(a->t[(o - 1) * a->sets + s]) > TVLA_THRESHOLD)
+                d = fmax(d, fabs(get_tvla_effect_size(a, o, s)));
+        }
+
+        if (d >= 0) {
+            entries[len].effect_size    = d;
+            entries[len].set            = s;
+            ++len;
+        }
+    }
+
+    qsort(entries, len, sizeof(tvla_rank_entry), cmp_tvla_rank_entries);
+
+    for (s = 0; s < len; ++s) {
+        sets[s] = entries[s].set;
+        if (effect_sizes)
+            effect_sizes[s] = entries[s].effect_size;
+    }
+
+    free(entries);
+    return len;
+}
+
+/*
+ * Print the highest |t| of every order on one line, e.g. after each check
+ */
+void print_tvla_progress(tvla *a) {
+    uint32_t o;
+
+    printf("samples: %lu (fixed %lu, random %lu), max |t|:", a->samples,
+           a->cnt[TVLA_FIXED], a->cnt[TVLA_RANDOM]);
+    for (o = 0; o < a->order; ++o)
+        printf(" order %u: %.2f (set %u)", o + 1, a->max_abs_t[o], a->max_set[o]);
+    printf("\n");
+    fflush(stdout);
+}
+
+/*
+ * Print the t-statistics of all sets, values above the threshold are marked
+ */
+void print_tvla(tvla *a) {
+    uint32_t o, s;
+    double t;
+
+    printf("tvla = {\n\tsamples: %lu,\n\tresult: %s,\n\tt (order 1..%u):\n",
+           a->samples, is_tvla_leaky(a) ? "leaky" : "no leak detected", a->order);
+    for (s = 0; s < a->sets; ++s) {
+        printf("\t\tset %3u:", s);
+        for (o = 0; o < a->order; ++o) {
+            t = a->t[o * a->sets + s];
+            printf(" %8.2f%c", t, (fabs(t) > TVLA_THRESHOLD) ? '*' : ' ');
+        }
+        printf("\n");
+    }
+    printf("}\n");
+}
+
+int cmp_tvla_rank_entries(const void *a, const void *b) {
+    double da = ((const tvla_rank_entry *) a)->effect_size;
+    double db = ((const tvla_rank_entry *) b)->effect_size;
+
+    if (da != db)
+        return (da < db) ? 1 : -1;
+
+    return (int) ((const tvla_rank_entry *) a)->set
+           - (int) ((const tvla_rank_entry *) b)->set;
+}
+
+/*
+ * Mean and variance of the statistic that the t-test of the given order
+ * compares: the samples (order 1), their squared deviations (order 2) or
+ * their standardised deviations to the power of the order (order > 2)
+ */
+void get_tvla_class_stats(tvla *a, uint32_t cls, uint32_t order, uint32_t set,
+    double *stat_mean, double *stat_var)
+{
+    double n    = a->cnt[cls];
+    double *m   = a->m[cls];
+    double cm2  = m[2 * a->sets + set] / n;
+
+    if (order == 1) {
+        *stat_mean  = a->mean[cls][set];
+        *stat_var   = cm2;
+    }
+    else if (order == 2) {
+        *stat_mean  = cm2;
+        *stat_var   = m[4 * a->sets + set] / n - cm2 * cm2;
+    }
+    else if (cm2 <= 0) {
+        *stat_mean  = 0;
+        *stat_var   = 0;
+    }
+    else {
+        *stat_mean  = m[order * a->sets + set] / n / pow(cm2, order / 2.0);
+        *stat_var   = (m[2 * order * a->sets + set] / n
+                       - pow(m[order * a->sets + set] / n, 2)) / pow(cm2, order);
+    }
+}
@@ -28,6 +28,9 @@
 
 #include "util.h"
 
+// State of rand(), owned by the library such that it can be checkpointed
+static char rand_state[RAND_STATE_LEN];
+static bool rand_state_init = false;
 
 // local functions
 void swap(uint32_t *e1, uint32_t *e2);
@@ -44,7 +47,34 @@ void pin_to_cpu(int cpu) {
 }
 
 void set_seed() {
-    srand(time(NULL));
+    initstate(time(NULL), rand_state, RAND_STATE_LEN);
+    rand_state_init = true;
+}
+
+/*
+ * Copy the state of rand() (RAND_STATE_LEN bytes) to `state`. Requires that
+ * set_seed was called.
+ */
+void get_rand_state(uint8_t *state) {
+    assert(rand_state_init);
+
+    // Switching to the active state stores its position in the state buffer
+    setstate(rand_state);
+    memcpy(state, rand_state, RAND_STATE_LEN);
+}
+
+/*
+ * Continue rand() from a state of get_rand_state
+ */
+void set_rand_state(const uint8_t *state) {
+    char tmp[RAND_STATE_LEN];
+
+    // Leave the active state first, otherwise setstate overwrites the
+    // position of the restored state with the current one
+    initstate(1, tmp, RAND_STATE_LEN);
+    memcpy(rand_state, state, RAND_STATE_LEN);
+    setstate(rand_state);
+    rand_state_init = true;
 }
 
 /*
@@ -145,3 +175,21 @@ uint32_t get_min(uint32_t *arr, uint32_t arr_len) {
 
     return min;
 }
+
+/*
+ * qsort comparator for uint32_t elements, e.g. probe times
+ */
+int cmp_uint32(const void *a, const void *b) {
+    uint32_t ua = *(const uint32_t *) a;
+    uint32_t ub = *(const uint32_t *) b;
+
+    return (ua > ub) - (ua < ub);
+}
+
+/*
+ * Return the seconds elapsed between two timestamps
+ */
+double get_elapsed_sec(struct timespec *start, struct timespec *stop) {
+    return (stop->tv_sec - start->tv_sec)
+           + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
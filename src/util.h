@@ -38,11 +38,17 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+// Bytes of the state of rand()
+#define RAND_STATE_LEN 256
+
 void pin_to_cpu(int cpu);
 
 void set_seed(void);
+void get_rand_state(uint8_t *state);
+void set_rand_state(const uint8_t *state);
 void gen_rand_bytes(unsigned char *arr, uint32_t arr_len);
 void random_perm(uint32_t *arr, uint32_t arr_len);
 void gen_random_indices(uint32_t *arr, uint32_t arr_len);
@@ -52,5 +58,8 @@ bool is_in_arr(uint32_t elem, uint32_t *arr, uint32_t arr_len);
 double get_avg(uint32_t *arr, uint32_t arr_len);
 uint32_t get_max(uint32_t *arr, uint32_t arr_len);
 uint32_t get_min(uint32_t *arr, uint32_t arr_len);
+int cmp_uint32(const void *a, const void *b);
+
+double get_elapsed_sec(struct timespec *start, struct timespec *stop);
 
 #endif // HEADER_UTIL_H
@@ -0,0 +1,207 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool reconstructs the data-dependent reference blocks of Argon2d
+ * hashes (see argon2_analysis.h) from a trace of the argon2d-attacker demo
+ * and the hash markers that argon2d-victim prints. For every hash, it learns
+ * the block colors, prints a summary per segment and optionally stores the
+ * reconstruction of every position.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure analysis, the parameters of argon2d-victim.c
+ */
+
+// Memory in 1 KiB blocks (m_cost) and passes (t_cost) of the hash
+#define M_COST (1 << 16)
+#define T_COST 2
+
+#define COLORS (L2_SETS / ARGON2_SETS_PER_BLOCK)
+#define READ_BATCH 4096
+
+// local functions
+void usage(const char *prog);
+uint32_t read_markers(const char *path, uint64_t **starts, uint64_t **stops);
+
+int main(int argc, char **argv) {
+    uint32_t h, i, c, cnt, hashes;
+    uint64_t n, max_n, first, last;
+    uint64_t *starts, *stops;
+    char out_path[BUFSIZ];
+    clock_t begin;
+
+    if (argc < 3 || argc > 4)
+        usage(argv[0]);
+
+    hashes = read_markers(argv[2], &starts, &stops);
+    if (!hashes) {
+        fprintf(stderr, "No hash markers found in %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    trace_file *tf = open_trace(argv[1]);
+    if (!tf) {
+        fprintf(stderr, "Failed to open trace %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t msrmts = tf->hdr.msrmts_per_sample;
+    if (tf->hdr.input_len != 2 * sizeof(uint64_t)
+        || (msrmts != COLORS && msrmts != COLORS * ARGON2_SETS_PER_BLOCK))
+    {
+        fprintf(stderr, "%s is no trace of argon2d-attacker\n", argv[1]);
+        close_trace(tf);
+        return EXIT_FAILURE;
+    }
+
+
+    /*
+     * Read the trace, keeping only the monitored sets
+     */
+    max_n = tf->hdr.samples;
+    uint64_t *tsc       = (uint64_t *) malloc(READ_BATCH * 2 * sizeof(uint64_t));
+    time_type *res      = (time_type *) malloc(READ_BATCH * msrmts * sizeof(time_type));
+    time_type *colors   = (time_type *) malloc(max_n * COLORS * sizeof(time_type));
+    argon2_sample *samples = (argon2_sample *) malloc(max_n * sizeof(argon2_sample));
+    assert(tsc && res && colors && samples);
+
+    n = 0;
+    while (n < max_n
+           && (cnt = read_trace_samples(tf, (uint8_t *) tsc, res, READ_BATCH)) > 0)
+    {
+        for (i = 0; i < cnt && n < max_n; ++i, ++n) {
+            samples[n].start    = tsc[2 * i];
+            samples[n].stop     = tsc[2 * i + 1];
+            for (c = 0; c < COLORS; ++c) {
+                colors[n * COLORS + c] = (msrmts == COLORS)
+                    ? res[i * msrmts + c]
+                    : res[i * msrmts + c * ARGON2_SETS_PER_BLOCK + ARGON2_MONITORED_SET];
+            }
+        }
+    }
+    close_trace(tf);
+
+    get_argon2_activity(COLORS, colors, COLORS, n, samples);
+    PRINT_LINE("Read %lu samples, %u hashes\n", n, hashes);
+
+
+    /*
+     * Reconstruct every hash from the samples between its markers
+     */
+    argon2_recon *r = prepare_argon2_recon(M_COST, T_COST, COLORS);
+
+    first = 0;
+    for (h = 0; h < hashes; ++h) {
+        while (first < n && samples[first].stop <= starts[h])
+            ++first;
+        for (last = first; last < n && samples[last].start < stops[h]; ++last);
+
+        if (last == first) {
+            PRINT_LINE("Hash %u: no samples\n", h);
+            continue;
+        }
+
+        begin = clock();
+        map_argon2_samples(r, samples + first, last - first, starts[h], stops[h]);
+        learn_argon2_block_colors(r, samples + first, last - first);
+        reconstruct_argon2_refs(r, samples + first, last - first);
+
+        PRINT_LINE("Hash %u: %lu samples, %.2f blocks per sample, analysed in "
+                   "%.2f s\n", h, last - first,
+                   (double) r->positions / (last - first),
+                   (double) (clock() - begin) / CLOCKS_PER_SEC);
+        print_argon2_recon(r);
+
+        if (argc == 4) {
+            snprintf(out_path, sizeof(out_path), "%s-%u.txt", argv[3], h);
+            if (save_argon2_recon(out_path, r))
+                fprintf(stderr, "Failed to write %s\n", out_path);
+            else
+                PRINT_LINE("Reconstruction written to %s\n", out_path);
+        }
+    }
+
+    release_argon2_recon(r);
+    free(starts);
+    free(stops);
+    free(tsc);
+    free(res);
+    free(colors);
+    free(samples);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <attacker trace> <victim log> [output prefix]\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Parse the "hash start" and "hash done" markers of argon2d-victim.
+ * Returns the number of complete hashes.
+ */
+uint32_t read_markers(const char *path, uint64_t **starts, uint64_t **stops) {
+    char line[BUFSIZ];
+    uint64_t tsc, start = 0;
+    bool started = false;
+    uint32_t len = 0, max_len = 16;
+    FILE *fp = fopen(path, "r");
+
+    if (!fp)
+        return 0;
+
+    *starts = (uint64_t *) malloc(max_len * sizeof(uint64_t));
+    *stops  = (uint64_t *) malloc(max_len * sizeof(uint64_t));
+    assert(*starts && *stops);
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "hash start: %lu", &tsc) == 1) {
+            start   = tsc;
+            started = true;
+        }
+        else if (started && sscanf(line, "hash done: %lu", &tsc) == 1) {
+            if (len == max_len) {
+                max_len *= 2;
+                *starts = (uint64_t *) realloc(*starts, max_len * sizeof(uint64_t));
+                *stops  = (uint64_t *) realloc(*stops, max_len * sizeof(uint64_t));
+                assert(*starts && *stops);
+            }
+            (*starts)[len]  = start;
+            (*stops)[len]   = tsc;
+            started         = false;
+            ++len;
+        }
+    }
+
+    fclose(fp);
+    return len;
+}
@@ -0,0 +1,243 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Receiver of the cache covert channel benchmark. It runs Prime+Probe on the
+ * channel sets during every symbol slot, decodes the frames and reports the
+ * raw and error-corrected bandwidth and bit error rate.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure receiver
+ */
+
+// Pin process to a CPU. For L1, this must be the CPU (or a hyperthread of the
+// core) of the sender.
+#define CPU_NUMBER 1
+
+// local functions
+double binary_entropy(double p);
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    uint64_t symbol_cycles, first_frame, slot;
+    uint32_t sets_len, frames, f, j, sym, probes;
+    uint64_t raw_errs, data_errs, corrections, short_slots;
+    double hi, lo, thr;
+    pp_conf conf;
+
+    if (argc != 5 && argc != 6)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    symbol_cycles   = strtoull(argv[2], NULL, 10);
+    sets_len        = atoi(argv[3]);
+    frames          = atoi(argv[4]);
+
+    cache_ctx *ctx = get_cache_ctx(target_cache);
+    if (symbol_cycles == 0 || sets_len == 0 || sets_len > ctx->sets || frames == 0)
+        usage(argv[0]);
+
+    // Use a tuned Prime+Probe configuration if available
+    if (argc == 6) {
+        if (load_pp_profile(argv[5], ctx, &conf)) {
+            fprintf(stderr, "Cannot load profile %s\n", argv[5]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    else {
+        get_default_pp_conf(ctx, &conf);
+    }
+
+
+    /*
+     * Initial preparation
+     */
+    PRINT_LINE("Covert channel receiver on %s\n", argv[1]);
+    PRINT_LINE("Symbol time: %lu cycles\n", symbol_cycles);
+    PRINT_LINE("Parallel channels: %u\n", sets_len);
+    PRINT_LINE("Frames: %u\n", frames);
+
+    uint32_t *sets = (uint32_t *) malloc(sets_len * sizeof(uint32_t));
+    assert(sets);
+    get_covert_sets(ctx, sets, sets_len);
+
+    srand(conf.layout_seed);
+    cacheline *set_ds = prepare_cache_set_ds(ctx, sets, sets_len);
+
+    time_type *msrmts   = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    uint64_t *sums      = (uint64_t *) malloc(sets_len * sizeof(uint64_t));
+    // Average probe time per frame, channel and symbol
+    double *sym_avgs    = (double *) malloc((uint64_t) frames * sets_len
+                                            * COVERT_FRAME_LEN * sizeof(double));
+    assert(msrmts);
+    assert(sums);
+    assert(sym_avgs);
+
+    cacheline *curr_head = set_ds;
+    cacheline *next_head;
+
+    pin_to_cpu(CPU_NUMBER);
+
+    prepare_measurement();
+
+
+    /*
+     * Receive frames, aligned to the frame boundaries of the TSC
+     */
+    print_banner("Start reception");
+
+    first_frame = get_covert_slot(symbol_cycles) / COVERT_FRAME_LEN + 1;
+    short_slots = 0;
+
+    for (f = 0; f < frames; ++f) {
+        for (sym = 0; sym < COVERT_FRAME_LEN; ++sym) {
+            slot = (first_frame + f) * COVERT_FRAME_LEN + sym;
+            while (get_covert_slot(symbol_cycles) < slot);
+
+            memset(sums, 0, sets_len * sizeof(uint64_t));
+            probes = 0;
+
+            while (get_covert_slot(symbol_cycles) == slot) {
+                curr_head = prime_conf(&conf, curr_head);
+                next_head = probe_conf(&conf, ctx->cache_level, curr_head);
+                get_msrmts_for_all_set(curr_head, msrmts);
+                curr_head = next_head;
+
+                for (j = 0; j < sets_len; ++j)
+                    sums[j] += msrmts[sets[j]];
+                ++probes;
+            }
+
+            if (!probes)
+                ++short_slots;
+
+            for (j = 0; j < sets_len; ++j) {
+                sym_avgs[((uint64_t) f * sets_len + j) * COVERT_FRAME_LEN + sym] =
+                    probes ? (double) sums[j] / probes : 0;
+            }
+        }
+    }
+
+    print_banner("Stop reception");
+
+
+    /*
+     * Decode frames and compare them to the expected payload
+     */
+    uint8_t rx_symbols[COVERT_FRAME_LEN];
+    uint8_t tx_symbols[COVERT_FRAME_LEN];
+    uint8_t rx_bits[COVERT_DATA_BITS];
+    uint8_t tx_bits[COVERT_DATA_BITS];
+    double *avgs;
+
+    raw_errs = data_errs = corrections = 0;
+
+    for (f = 0; f < frames; ++f) {
+        for (j = 0; j < sets_len; ++j) {
+            avgs = sym_avgs + ((uint64_t) f * sets_len + j) * COVERT_FRAME_LEN;
+
+            // The alternating preamble calibrates the threshold of this channel
+            hi = lo = 0;
+            for (sym = 0; sym < COVERT_PREAMBLE_LEN; ++sym) {
+                if (sym & 1)
+                    lo += avgs[sym];
+                else
+                    hi += avgs[sym];
+            }
+            thr = (hi + lo) / COVERT_PREAMBLE_LEN;
+
+            for (sym = 0; sym < COVERT_FRAME_LEN; ++sym)
+                rx_symbols[sym] = avgs[sym] > thr;
+
+            gen_covert_payload(COVERT_DEFAULT_SEED, first_frame + f, j, tx_bits);
+            encode_covert_frame(tx_bits, tx_symbols);
+            corrections += decode_covert_frame(rx_symbols, rx_bits);
+
+            for (sym = COVERT_PREAMBLE_LEN; sym < COVERT_FRAME_LEN; ++sym)
+                raw_errs += rx_symbols[sym] != tx_symbols[sym];
+            for (sym = 0; sym < COVERT_DATA_BITS; ++sym)
+                data_errs += rx_bits[sym] != tx_bits[sym];
+        }
+    }
+
+
+    /*
+     * Report figures of merit
+     */
+    double duration     = (double) frames * COVERT_FRAME_LEN * symbol_cycles
+                          / PROCESSOR_FREQ;
+    double raw_bits     = (double) frames * sets_len * COVERT_CODE_BITS;
+    double data_bits    = (double) frames * sets_len * COVERT_DATA_BITS;
+    double raw_ber      = raw_errs / raw_bits;
+    double data_ber     = data_errs / data_bits;
+    double raw_bw       = (double) sets_len * PROCESSOR_FREQ / symbol_cycles;
+
+    PRINT_LINE("Slots without a probe: %lu\n", short_slots);
+    PRINT_LINE("Corrected codewords: %lu\n", corrections);
+    PRINT_LINE("Raw bandwidth: %.1f bit/s\n", raw_bw);
+    PRINT_LINE("Raw bit error rate: %.5f\n", raw_ber);
+    PRINT_LINE("Error-corrected bandwidth: %.1f bit/s\n", data_bits / duration);
+    PRINT_LINE("Error-corrected bit error rate: %.5f\n", data_ber);
+    // Capacity of a binary symmetric channel with the raw error rate
+    PRINT_LINE("Capacity: %.1f bit/s\n", raw_bw * (1 - binary_entropy(raw_ber)));
+
+
+    /*
+     * Cleanup
+     */
+    free(sym_avgs);
+    free(sums);
+    free(msrmts);
+    free(sets);
+    release_cache_set_ds(ctx, set_ds);
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+double binary_entropy(double p) {
+    if (p <= 0 || p >= 1)
+        return 0;
+
+    return -p * log2(p) - (1 - p) * log2(1 - p);
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> <symbol cycles> <sets> <frames> "
+                    "[profile]\n", prog);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,165 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * Sender of the cache covert channel benchmark. For every symbol slot, it
+ * evicts the sets of all channels that transmit a 1 (see covert.h).
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure sender
+ */
+
+// Pin process to a CPU. For L1, this must be the CPU (or a hyperthread of the
+// core) of the receiver.
+#define CPU_NUMBER 1
+
+
+// local functions and global variables
+static volatile int user_abort = 0;
+
+void abortHandler(int unused);
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    uint64_t symbol_cycles, frame, slot;
+    uint32_t sets_len, frames, i, j, sym;
+    cacheline *curr_cl;
+
+    if (argc != 4 && argc != 5)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    symbol_cycles   = strtoull(argv[2], NULL, 10);
+    sets_len        = atoi(argv[3]);
+    frames          = (argc == 5) ? atoi(argv[4]) : 0;
+
+    cache_ctx *ctx = get_cache_ctx(target_cache);
+    if (symbol_cycles == 0 || sets_len == 0 || sets_len > ctx->sets)
+        usage(argv[0]);
+
+
+    /*
+     * Initial preparation
+     */
+    PRINT_LINE("Covert channel sender on %s\n", argv[1]);
+    PRINT_LINE("Symbol time: %lu cycles\n", symbol_cycles);
+    PRINT_LINE("Parallel channels: %u\n", sets_len);
+
+    uint32_t *sets = (uint32_t *) malloc(sets_len * sizeof(uint32_t));
+    assert(sets);
+    get_covert_sets(ctx, sets, sets_len);
+
+    // Lines the sender accesses to evict the receiver's lines of a set
+    cacheline *set_ds       = prepare_cache_set_ds(ctx, sets, sets_len);
+    cacheline **set_heads   = (cacheline **) calloc(sets_len, sizeof(cacheline *));
+    assert(set_heads);
+
+    curr_cl = set_ds;
+    do {
+        if (IS_FIRST(curr_cl->flags)) {
+            for (j = 0; j < sets_len; ++j) {
+                if (sets[j] == curr_cl->cache_set)
+                    set_heads[j] = curr_cl;
+            }
+        }
+        curr_cl = curr_cl->next;
+    } while (curr_cl != set_ds);
+
+    uint8_t data_bits[COVERT_DATA_BITS];
+    uint8_t *symbols = (uint8_t *) malloc(sets_len * COVERT_FRAME_LEN);
+    assert(symbols);
+
+    pin_to_cpu(CPU_NUMBER);
+
+    // Register handler to catch CTRL+C and exit gracefully
+    signal(SIGINT, abortHandler);
+
+    prepare_measurement();
+
+
+    /*
+     * Transmit frames, aligned to the frame boundaries of the TSC
+     */
+    print_banner("Start transmission");
+
+    frame = get_covert_slot(symbol_cycles) / COVERT_FRAME_LEN + 1;
+
+    for (i = 0; !user_abort && (frames == 0 || i < frames); ++i, ++frame) {
+        // Encoding is short compared to a symbol, it only shortens the first
+        // preamble symbol slightly.
+        for (j = 0; j < sets_len; ++j) {
+            gen_covert_payload(COVERT_DEFAULT_SEED, frame, j, data_bits);
+            encode_covert_frame(data_bits, symbols + j * COVERT_FRAME_LEN);
+        }
+
+        for (sym = 0; sym < COVERT_FRAME_LEN; ++sym) {
+            slot = frame * COVERT_FRAME_LEN + sym;
+            while (get_covert_slot(symbol_cycles) < slot);
+
+            while (get_covert_slot(symbol_cycles) == slot) {
+                for (j = 0; j < sets_len; ++j) {
+                    if (symbols[j * COVERT_FRAME_LEN + sym])
+                        prime_cacheset(set_heads[j]);
+                }
+            }
+        }
+    }
+
+    print_banner("Stop transmission");
+    PRINT_LINE("Sent frames: %u\n", i);
+
+
+    /*
+     * Cleanup
+     */
+    free(symbols);
+    free(set_heads);
+    free(sets);
+    release_cache_set_ds(ctx, set_ds);
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void abortHandler(int unused) {
+    user_abort = 1;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> <symbol cycles> <sets> [frames]\n", prog);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,176 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool runs the correlation analysis engine (see cpa.h) on a binary
+ * trace file: it ranks the 256 hypotheses for one input byte by the
+ * correlation of a leakage model of input[byte] ^ hypothesis with the probe
+ * times of a target set (e.g. the set of the first table line) or of all
+ * sets. It also reports the signal quality of the sets with the line of the
+ * input byte as class.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure analysis
+ */
+
+// Hypotheses that are printed
+#define PRINT_TOP 8
+
+// Entries per cache line and target line of the line model, i.e. entries of
+// four bytes (like AES T-tables) and the first table line
+#define LINE_MODEL_ENTRIES 16
+#define LINE_MODEL_LINE 0
+
+#define QUALITY_BATCH 4096
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    uint32_t i, cnt, target_set, threads = 0;
+    bool all_sets = true;
+    cpa_model model;
+    cpa_byte_model model_arg;
+    struct timespec start, stop;
+
+    if (argc < 4 || argc > 6)
+        usage(argv[0]);
+
+    model_arg.byte              = atoi(argv[2]);
+    model_arg.entries_per_line  = LINE_MODEL_ENTRIES;
+    model_arg.line              = LINE_MODEL_LINE;
+
+    if (!strcmp(argv[3], "hw"))
+        model = cpa_model_xor_hw;
+    else if (!strcmp(argv[3], "line"))
+        model = cpa_model_xor_line;
+    else
+        usage(argv[0]);
+
+    if (argc >= 5 && strcmp(argv[4], "all")) {
+        target_set  = atoi(argv[4]);
+        all_sets    = false;
+    }
+    if (argc == 6)
+        threads = atoi(argv[5]);
+
+    trace_file *tf = open_trace(argv[1]);
+    if (!tf) {
+        fprintf(stderr, "Failed to open trace %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    uint32_t sets       = tf->hdr.msrmts_per_sample;
+    uint32_t input_len  = tf->hdr.input_len;
+    close_trace(tf);
+
+    if (!all_sets && target_set >= sets) {
+        fprintf(stderr, "Target set %u out of range, samples have %u sets\n",
+                target_set, sets);
+        return EXIT_FAILURE;
+    }
+
+    if (model_arg.byte >= input_len) {
+        fprintf(stderr, "Input byte %u out of range, inputs have %u bytes\n",
+                model_arg.byte, input_len);
+        return EXIT_FAILURE;
+    }
+
+
+    /*
+     * Analyse the trace
+     */
+    cpa_engine *cpa = prepare_cpa(256, sets, input_len, model, &model_arg, threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (update_cpa_from_trace(cpa, argv[1])) {
+        fprintf(stderr, "Failed to read trace %s\n", argv[1]);
+        release_cpa(cpa);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t ranking[256], peak_sets[256];
+    double scores[256];
+    if (all_sets)
+        rank_cpa_hypotheses(cpa, NULL, 0, ranking, scores, peak_sets);
+    else
+        rank_cpa_hypotheses(cpa, &target_set, 1, ranking, scores, peak_sets);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+
+    /*
+     * Print output
+     */
+    PRINT_LINE("Samples: %lu, sets: %u, threads: %u, time: %.3f s\n",
+               cpa->samples, sets, cpa->thread_cnt, get_elapsed_sec(&start, &stop));
+    PRINT_LINE("Best hypotheses for input byte %u (%s model):\n",
+               model_arg.byte, argv[3]);
+    for (i = 0; i < PRINT_TOP; ++i) {
+        PRINT_LINE("  0x%02x: |r| = %.4f at set %u\n", ranking[i],
+                   scores[ranking[i]], peak_sets[ranking[i]]);
+    }
+
+
+    /*
+     * Signal quality per set, with the line of the input byte as class
+     */
+    signal_quality *quality = prepare_signal_quality(256 / LINE_MODEL_ENTRIES, sets);
+    uint8_t *inputs = (uint8_t *) malloc(QUALITY_BATCH * input_len);
+    time_type *res  = (time_type *) malloc(QUALITY_BATCH * sets * sizeof(time_type));
+    assert(inputs && res);
+
+    tf = open_trace(argv[1]);
+    assert(tf);
+    while ((cnt = read_trace_samples(tf, inputs, res, QUALITY_BATCH)) > 0) {
+        for (i = 0; i < cnt; ++i) {
+            update_signal_quality(quality,
+                                  inputs[i * input_len + model_arg.byte] / LINE_MODEL_ENTRIES,
+                                  res + i * sets);
+        }
+    }
+    close_trace(tf);
+
+    compute_signal_quality(quality);
+    PRINT_LINE("Signal quality with the line of input byte %u as class:\n",
+               model_arg.byte);
+    print_signal_quality(quality);
+
+    release_signal_quality(quality);
+    free(inputs);
+    free(res);
+    release_cpa(cpa);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <trace file> <input byte> <hw|line> "
+                    "[target set|all] [threads]\n", prog);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ *
+ * Short description of this file:
+ * This tool profiles the cache footprint of the attacker's own sampling loop
+ * with a null victim and stores the per-set noise profile together with the
+ * recommended exclusion mask (see footprint.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure profiling
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    uint32_t samples = FOOTPRINT_SAMPLES;
+    pp_conf conf;
+
+    if (argc < 3 || argc > 5)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    if (argc >= 4)
+        samples = atoi(argv[3]);
+    if (samples == 0)
+        usage(argv[0]);
+
+    cache_ctx *ctx = get_cache_ctx(target_cache);
+
+    // Profile with the tuned configuration if available
+    if (argc == 5 && load_pp_profile(argv[4], ctx, &conf)) {
+        fprintf(stderr, "Failed to load Prime+Probe profile %s\n", argv[4]);
+        release_cache_ctx(ctx);
+        return EXIT_FAILURE;
+    }
+    else if (argc < 5) {
+        get_default_pp_conf(ctx, &conf);
+    }
+
+    PRINT_LINE("Profile %s self-footprint with %u samples\n", argv[1], samples);
+
+    cacheline *cache_ds = prepare_cache_ds_conf(ctx, &conf);
+    noise_profile *prof = get_noise_profile(ctx);
+    pin_to_cpu(CPU_NUMBER);
+
+    profile_self_footprint(ctx, &conf, cache_ds, samples, prof);
+    print_noise_profile(prof);
+
+    int ret = EXIT_SUCCESS;
+    if (save_noise_profile(argv[2], prof)) {
+        fprintf(stderr, "Failed to write noise profile to %s\n", argv[2]);
+        ret = EXIT_FAILURE;
+    }
+    else {
+        PRINT_LINE("Noise profile written to %s\n", argv[2]);
+    }
+
+    release_noise_profile(prof);
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+
+    return ret;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> <noise profile> [samples] [pp profile]\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
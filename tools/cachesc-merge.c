@@ -0,0 +1,157 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool merges many captures (binary traces or text logs, see
+ * trace_merge.h) in parallel: `stats` writes the per-set statistics of all
+ * samples as CSV, `cat` concatenates the samples into one trace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cachesc.h>
+
+
+// local functions
+void usage(const char *prog);
+int stats(char **paths, uint32_t path_cnt, uint32_t sets, uint32_t threads,
+    FILE *out);
+
+int main(int argc, char **argv) {
+    int opt, ret = EXIT_FAILURE;
+    uint32_t bad, msrmts, input_len, path_cnt, threads = 0;
+    bool compress = false;
+    char *out_path = NULL, **paths;
+    const char *cmd;
+    FILE *out = stdout;
+    struct timespec start, stop;
+
+    if (argc < 3)
+        usage(argv[0]);
+    cmd = argv[1];
+
+    optind = 2;
+    while ((opt = getopt(argc, argv, "t:o:c")) != -1) {
+        switch (opt) {
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'c':
+                compress = true;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind == argc)
+        usage(argv[0]);
+    paths       = argv + optind;
+    path_cnt    = argc - optind;
+
+    // Report the offending source, the library only reports failure
+    bad = check_trace_sources(paths, path_cnt, !strcmp(cmd, "cat"), &msrmts,
+                              &input_len);
+    if (bad != path_cnt) {
+        fprintf(stderr, "Cannot read %s or its geometry differs from %s\n",
+                paths[bad], paths[0]);
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!strcmp(cmd, "stats")) {
+        if (out_path) {
+            out = fopen(out_path, "w");
+            if (!out) {
+                fprintf(stderr, "Failed to open %s\n", out_path);
+                return EXIT_FAILURE;
+            }
+        }
+        ret = stats(paths, path_cnt, msrmts, threads, out);
+        if (out != stdout)
+            fclose(out);
+    }
+    else if (!strcmp(cmd, "cat") && out_path) {
+        ret = merge_traces(paths, path_cnt, out_path, compress, threads)
+              ? EXIT_FAILURE : EXIT_SUCCESS;
+        if (ret != EXIT_SUCCESS)
+            fprintf(stderr, "Failed to merge into %s\n", out_path);
+    }
+    else {
+        usage(argv[0]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    fprintf(stderr, "Files: %u, sets: %u, time: %.3f s\n", path_cnt, msrmts,
+            get_elapsed_sec(&start, &stop));
+
+    return ret;
+}
+
+/*
+ * Per-set statistics as CSV, the samples per file are reported on stderr
+ */
+int stats(char **paths, uint32_t path_cnt, uint32_t sets, uint32_t threads,
+    FILE *out)
+{
+    uint32_t i, j;
+    uint64_t *file_samples = (uint64_t *) malloc(path_cnt * sizeof(uint64_t));
+    trace_agg *agg;
+    assert(file_samples);
+
+    agg = merge_trace_stats(paths, path_cnt, threads, file_samples);
+    if (!agg) {
+        fprintf(stderr, "Failed to read the sources\n");
+        free(file_samples);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < path_cnt; ++i)
+        fprintf(stderr, "%s: %lu samples\n", paths[i], file_samples[i]);
+
+    fprintf(out, "set,count,mean,std,min,max\n");
+    for (j = 0; j < sets; ++j) {
+        fprintf(out, "%u,%lu,%.3f,%.3f,%u,%u\n", j, agg->cnt, agg->mean[j],
+                agg->std[j], agg->min[j], agg->max[j]);
+    }
+
+    release_trace_agg(agg);
+    free(file_samples);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s stats [options] <files...>\n"
+                    "       %s cat -o <output trace> [options] <files...>\n"
+                    "  -t threads     number of threads (all CPUs by default)\n"
+                    "  -o file        CSV output (stats, stdout by default) or "
+                    "merged trace (cat)\n"
+                    "  -c             compress the merged trace (cat)\n",
+            prog, prog);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,103 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool characterises the hardware prefetchers of this machine and their
+ * effect on the attack data structure (see prefetch.h). If a profile is
+ * given, the spread order of the sets is enabled in it when it hides clearly
+ * fewer evictions than the default order (see select_spread_order).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure characterisation
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// Default evictions per order in the masking measurement
+#define DEFAULT_ROUNDS 2000
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    uint32_t rounds = DEFAULT_ROUNDS;
+    pp_conf conf;
+    prefetch_report rep;
+
+    if (argc < 2 || argc > 4)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    if (argc >= 3)
+        rounds = atoi(argv[2]);
+    if (rounds == 0)
+        usage(argv[0]);
+
+    cache_ctx *ctx = get_cache_ctx(target_cache);
+
+    // A missing profile is created from the defaults
+    if (argc == 4 && load_pp_profile(argv[3], ctx, &conf))
+        get_default_pp_conf(ctx, &conf);
+
+    PRINT_LINE("Characterise prefetchers for %s with %u evictions per order\n",
+               argv[1], rounds);
+
+    set_seed();
+    pin_to_cpu(CPU_NUMBER);
+    prepare_measurement();
+
+    characterize_prefetchers(ctx, rounds, &rep);
+    print_prefetch_report(&rep);
+
+    if (argc == 4) {
+        conf.spread_order = select_spread_order(&rep);
+        if (save_pp_profile(argv[3], ctx, &conf, NULL)) {
+            fprintf(stderr, "Failed to write profile %s\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+        PRINT_LINE("Stored spread_order = %d in %s\n", conf.spread_order, argv[3]);
+    }
+
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> [rounds] [profile]\n", prog);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool compares the fully unrolled, partially unrolled and rolled probe
+ * kernels (see probe_kernel.h) for the geometry of a cache level on this
+ * machine and prints the configuration of the fastest one for device_conf.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure measurement
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// Default rounds of PROBE_KERNEL_CALL_SITES probes per kernel
+#define DEFAULT_ROUNDS 2000
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    uint32_t rounds = DEFAULT_ROUNDS;
+    probe_kernel k, best;
+    probe_kernel_score scores[PROBE_ROLLED + 1];
+
+    if (argc != 2 && argc != 3)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    if (argc == 3)
+        rounds = atoi(argv[2]);
+    if (rounds == 0)
+        usage(argv[0]);
+
+    cache_ctx *ctx = get_cache_ctx(target_cache);
+
+    PRINT_LINE("Compare %s probe kernels for %u sets with %u ways, %u rounds at "
+               "%u call sites\n", argv[1], ctx->sets, ctx->associativity, rounds,
+               PROBE_KERNEL_CALL_SITES);
+
+    set_seed();
+    pin_to_cpu(CPU_NUMBER);
+
+    cacheline *cache_ds = prepare_cache_ds(ctx);
+
+    prepare_measurement();
+
+    for (k = PROBE_UNROLLED; k <= PROBE_ROLLED; ++k)
+        evaluate_probe_kernel(ctx, k, cache_ds, rounds, scores + k);
+    best = select_probe_kernel(scores);
+
+    printf("%-10s %12s %14s %14s %12s %12s\n", "kernel", "cycles", "fe stalls",
+           "instructions", "set mean", "set std");
+    for (k = PROBE_UNROLLED; k <= PROBE_ROLLED; ++k) {
+        printf("%-10s %12.1f ", get_probe_kernel_name(k), scores[k].cycles);
+        if (scores[k].frontend_stalls < 0)
+            printf("%14s ", "n/a");
+        else
+            printf("%14.1f ", scores[k].frontend_stalls);
+        if (scores[k].instructions < 0)
+            printf("%14s ", "n/a");
+        else
+            printf("%14.1f ", scores[k].instructions);
+        printf("%12.1f %12.1f\n", scores[k].set_time_mean, scores[k].set_time_std);
+    }
+    if (scores[PROBE_UNROLLED].frontend_stalls < 0)
+        PRINT_LINE("Front-end stalls are not available (perf_event_paranoid?)\n");
+
+    PRINT_LINE("Fastest kernel: %s, set in device_conf.h:\n",
+               get_probe_kernel_name(best));
+    printf("#define %s_PROBE_UNROLL %u\n", argv[1],
+           get_probe_kernel_unroll(ctx, best));
+
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> [rounds]\n", prog);
+    exit(EXIT_FAILURE);
+}
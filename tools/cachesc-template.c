@@ -0,0 +1,220 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool builds templates from a profiling trace and matches attack traces
+ * against them (see template.h). The class of a sample is the upper part of
+ * one input byte, e.g. the table line of a first-round AES lookup with a
+ * known (zero) key on the profiling device. For attack traces, the
+ * log-likelihoods are combined over all traces for every hypothesis k that
+ * maps input class x to template class x ^ k, e.g. the upper key nibble.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure templates
+ */
+
+// Classes of the profiling samples: input[byte] >> CLASS_SHIFT
+#define CLASS_SHIFT 4
+#define CLASSES (256 >> CLASS_SHIFT)
+
+// Traces that are read and matched at once
+#define MATCH_BATCH 1024
+// Hypotheses that are printed
+#define PRINT_TOP 4
+
+// local functions
+void usage(const char *prog);
+int build(const char *trace_path, uint32_t byte, uint32_t pois,
+    const char *templates_path);
+int match(const char *trace_path, uint32_t byte, const char *templates_path);
+
+int main(int argc, char **argv) {
+    if (argc == 6 && !strcmp(argv[1], "build"))
+        return build(argv[2], atoi(argv[3]), atoi(argv[4]), argv[5]);
+    else if (argc == 5 && !strcmp(argv[1], "match"))
+        return match(argv[2], atoi(argv[3]), argv[4]);
+
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
+
+/*
+ * Profile in two passes over the trace and store the templates
+ */
+int build(const char *trace_path, uint32_t byte, uint32_t pois,
+    const char *templates_path)
+{
+    uint32_t pass, i, cnt;
+    trace_file *tf;
+
+    tf = open_trace(trace_path);
+    if (!tf) {
+        fprintf(stderr, "Failed to open trace %s\n", trace_path);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t sets       = tf->hdr.msrmts_per_sample;
+    uint32_t input_len  = tf->hdr.input_len;
+    close_trace(tf);
+
+    if (byte >= input_len || pois == 0 || pois > sets || pois > TEMPLATE_MAX_POIS) {
+        fprintf(stderr, "Invalid input byte or number of POIs (at most %u)\n",
+                TEMPLATE_MAX_POIS);
+        return EXIT_FAILURE;
+    }
+
+    uint8_t *inputs = (uint8_t *) malloc(MATCH_BATCH * input_len);
+    time_type *res  = (time_type *) malloc(MATCH_BATCH * sets * sizeof(time_type));
+    assert(inputs && res);
+
+    template_profile *prof = prepare_template_profile(CLASSES, sets);
+
+    for (pass = 0; pass < 2; ++pass) {
+        tf = open_trace(trace_path);
+        assert(tf);
+
+        while ((cnt = read_trace_samples(tf, inputs, res, MATCH_BATCH)) > 0) {
+            for (i = 0; i < cnt; ++i) {
+                if (pass == 0) {
+                    update_template_profile(prof, inputs[i * input_len + byte] >> CLASS_SHIFT,
+                                            res + i * sets);
+                }
+                else {
+                    update_template_covariance(prof, inputs[i * input_len + byte] >> CLASS_SHIFT,
+                                               res + i * sets);
+                }
+            }
+        }
+        close_trace(tf);
+
+        if (pass == 0)
+            select_template_pois(prof, pois);
+    }
+
+    PRINT_LINE("Profiled %lu samples, POIs (set: SNR):", prof->samples);
+    for (i = 0; i < pois; ++i)
+        printf(" %u: %.4f", prof->poi_sets[i], prof->poi_snr[i]);
+    PRINT_FLUSH("\n");
+
+    templates *t = build_templates(prof);
+
+    int ret = EXIT_SUCCESS;
+    if (save_templates(templates_path, t)) {
+        fprintf(stderr, "Failed to write templates to %s\n", templates_path);
+        ret = EXIT_FAILURE;
+    }
+    else {
+        PRINT_LINE("Templates written to %s\n", templates_path);
+    }
+
+    release_templates(t);
+    release_template_profile(prof);
+    free(inputs);
+    free(res);
+
+    return ret;
+}
+
+/*
+ * Match the attack traces and rank the hypotheses by their combined
+ * log-likelihood
+ */
+int match(const char *trace_path, uint32_t byte, const char *templates_path) {
+    uint32_t i, k, x, cnt, correct = 0;
+    double scores[CLASSES] = {0};
+    uint32_t ranking[CLASSES];
+    struct timespec start, stop;
+
+    templates *t = load_templates(templates_path);
+    if (!t || t->classes != CLASSES) {
+        fprintf(stderr, "Failed to load templates %s\n", templates_path);
+        return EXIT_FAILURE;
+    }
+
+    trace_file *tf = open_trace(trace_path);
+    if (!tf || tf->hdr.msrmts_per_sample != t->sets || byte >= tf->hdr.input_len) {
+        fprintf(stderr, "Trace %s does not match the templates\n", trace_path);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t input_len  = tf->hdr.input_len;
+    uint8_t *inputs     = (uint8_t *) malloc(MATCH_BATCH * input_len);
+    time_type *res      = (time_type *) malloc(MATCH_BATCH * t->sets * sizeof(time_type));
+    float *loglik       = (float *) malloc(MATCH_BATCH * CLASSES * sizeof(float));
+    assert(inputs && res && loglik);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while ((cnt = read_trace_samples(tf, inputs, res, MATCH_BATCH)) > 0) {
+        match_templates(t, res, cnt, loglik);
+
+        for (i = 0; i < cnt; ++i) {
+            x = inputs[i * input_len + byte] >> CLASS_SHIFT;
+            for (k = 0; k < CLASSES; ++k)
+                scores[k] += loglik[i * CLASSES + (x ^ k)];
+
+            correct += get_best_template_class(t, loglik + i * CLASSES) == x;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    // Rank the hypotheses
+    for (k = 0; k < CLASSES; ++k) {
+        for (i = k; i > 0 && scores[ranking[i - 1]] < scores[k]; --i)
+            ranking[i] = ranking[i - 1];
+        ranking[i] = k;
+    }
+
+    PRINT_LINE("Matched %lu traces in %.3f s (%.0f traces/s)\n", tf->pos,
+               get_elapsed_sec(&start, &stop),
+               tf->pos / get_elapsed_sec(&start, &stop));
+    PRINT_LINE("Single trace accuracy for hypothesis 0: %.3f\n",
+               tf->pos ? (double) correct / tf->pos : 0);
+    PRINT_LINE("Best hypotheses (log-likelihood):");
+    for (i = 0; i < PRINT_TOP; ++i)
+        printf(" 0x%x (%.1f)", ranking[i], scores[ranking[i]]);
+    PRINT_FLUSH("\n");
+
+    close_trace(tf);
+    release_templates(t);
+    free(inputs);
+    free(res);
+    free(loglik);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s build <profiling trace> <input byte> <pois> <templates>\n"
+                    "       %s match <attack trace> <input byte> <templates>\n",
+            prog, prog);
+    exit(EXIT_FAILURE);
+}
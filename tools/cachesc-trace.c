@@ -0,0 +1,475 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool answers queries over binary trace files (see trace_query.h)
+ * from the command line: it prints the header of a trace, selects matching
+ * samples as CSV or as a new trace, and computes per-set aggregates and
+ * histograms as CSV. Queries need uncompressed traces, `pack` and `unpack`
+ * convert traces to and from the compressed format.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure output
+ */
+
+// Matching samples that are written at once
+#define SELECT_BATCH 4096
+// Samples that are filtered at once by select, bounds its match buffer
+#define SELECT_WINDOW (1 << 20)
+// Samples that are converted at once
+#define CONVERT_BATCH 4096
+
+// local functions
+void usage(const char *prog);
+int parse_sets(const char *arg, uint32_t **sets, uint32_t *sets_len);
+int parse_sample(const char *arg, char **end, uint64_t *sample);
+int parse_range(const char *arg, uint64_t samples, uint64_t *first,
+    uint64_t *last);
+int info(trace_query *q);
+int select_samples(trace_query *q, FILE *out, const char *trace_out);
+int aggregate(trace_query *q, FILE *out);
+int histogram(trace_query *q, FILE *out, const char *arg);
+int convert(const char *in_path, const char *out_path, bool compress);
+
+int main(int argc, char **argv) {
+    int opt, ret = EXIT_FAILURE;
+    uint32_t threads = 0, sets_len = 0, *sets = NULL;
+    uint64_t first, last;
+    char *range = NULL, *hist_arg = NULL, *out_path = NULL, *trace_out = NULL;
+    const char *cmd, *path;
+    FILE *out = stdout;
+    struct timespec start, stop;
+    trace_query *q;
+
+    if (argc < 3)
+        usage(argv[0]);
+    cmd     = argv[1];
+    path    = argv[2];
+
+    if (argc == 4 && !strcmp(cmd, "pack"))
+        return convert(path, argv[3], true);
+    else if (argc == 4 && !strcmp(cmd, "unpack"))
+        return convert(path, argv[3], false);
+
+    q = prepare_trace_query(path, 0);
+    if (!q) {
+        fprintf(stderr, "Failed to open trace %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    optind = 3;
+    while ((opt = getopt(argc, argv, "r:s:w:t:H:o:b:")) != -1) {
+        switch (opt) {
+            case 'r':
+                range = optarg;
+                break;
+            case 's':
+                if (parse_sets(optarg, &sets, &sets_len)
+                    || set_trace_query_sets(q, sets, sets_len))
+                {
+                    fprintf(stderr, "Invalid sets %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'w':
+                if (add_trace_query_cond(q, optarg)) {
+                    fprintf(stderr, "Invalid condition %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'H':
+                hist_arg = optarg;
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'b':
+                trace_out = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc)
+        usage(argv[0]);
+
+    if (threads)
+        q->thread_cnt = threads;
+
+    if (range) {
+        if (parse_range(range, q->samples, &first, &last))
+            usage(argv[0]);
+        if (set_trace_query_range(q, first, last)) {
+            fprintf(stderr, "Invalid range, trace has %lu samples\n", q->samples);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            fprintf(stderr, "Failed to open %s\n", out_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!strcmp(cmd, "info"))
+        ret = info(q);
+    else if (!strcmp(cmd, "select"))
+        ret = select_samples(q, out, trace_out);
+    else if (!strcmp(cmd, "agg"))
+        ret = aggregate(q, out);
+    else if (!strcmp(cmd, "hist") && hist_arg)
+        ret = histogram(q, out, hist_arg);
+    else
+        usage(argv[0]);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    fprintf(stderr, "Samples: %lu-%lu, sets: %u, conditions: %u, threads: %u, "
+                    "time: %.3f s\n", q->first, q->last, q->sets_len,
+            q->cond_cnt, q->thread_cnt, get_elapsed_sec(&start, &stop));
+
+    if (out != stdout)
+        fclose(out);
+    free(sets);
+    release_trace_query(q);
+
+    return ret;
+}
+
+int info(trace_query *q) {
+    printf("Version: %u\n", q->hdr.version);
+    printf("Samples: %lu\n", q->samples);
+    printf("Sets: %u\n", q->hdr.msrmts_per_sample);
+    printf("Input bytes: %u\n", q->hdr.input_len);
+    printf("Sample size: %lu bytes\n", q->sample_size);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Write the matching samples with their inputs and the selected sets, either
+ * as CSV or as a trace file
+ */
+int select_samples(trace_query *q, FILE *out, const char *trace_out) {
+    uint32_t i, j, cnt = 0;
+    uint64_t m, matched, total = 0, window;
+    uint64_t first = q->first, last = q->last;
+    uint64_t *matches = (uint64_t *) malloc(SELECT_WINDOW * sizeof(uint64_t));
+    uint8_t *inputs = (uint8_t *) malloc(SELECT_BATCH * q->hdr.input_len + 1);
+    time_type *res = (time_type *) malloc(SELECT_BATCH * q->sets_len * sizeof(time_type));
+    trace_file *tf = NULL;
+    assert(matches && inputs && res);
+
+    if (trace_out) {
+        tf = create_trace(trace_out, q->sets_len, q->hdr.input_len);
+        if (!tf) {
+            fprintf(stderr, "Failed to create trace %s\n", trace_out);
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        fprintf(out, "sample");
+        for (i = 0; i < q->hdr.input_len; ++i)
+            fprintf(out, ",i%u", i);
+        for (j = 0; j < q->sets_len; ++j)
+            fprintf(out, ",s%u", q->sets[j]);
+        fprintf(out, "\n");
+    }
+
+    // Filter the range window by window, such that the matches of a window
+    // fit into the buffer
+    for (window = first; window < last; window += SELECT_WINDOW) {
+        set_trace_query_range(q, window, (last - window > SELECT_WINDOW)
+                                         ? window + SELECT_WINDOW : last);
+        matched = filter_trace_query(q, matches);
+        total   += matched;
+
+        for (m = 0; m < matched; ++m) {
+            if (tf) {
+                memcpy(inputs + cnt * q->hdr.input_len,
+                       get_trace_query_input(q, matches[m]), q->hdr.input_len);
+                for (j = 0; j < q->sets_len; ++j) {
+                    res[cnt * q->sets_len + j] = get_trace_query_msrmt(q,
+                                                     matches[m], q->sets[j]);
+                }
+                if (++cnt == SELECT_BATCH) {
+                    write_trace_samples(tf, inputs, res, cnt);
+                    cnt = 0;
+                }
+                continue;
+            }
+
+            fprintf(out, "%lu", matches[m]);
+            for (i = 0; i < q->hdr.input_len; ++i)
+                fprintf(out, ",%u", get_trace_query_input(q, matches[m])[i]);
+            for (j = 0; j < q->sets_len; ++j)
+                fprintf(out, ",%u", get_trace_query_msrmt(q, matches[m], q->sets[j]));
+            fprintf(out, "\n");
+        }
+    }
+    set_trace_query_range(q, first, last);
+
+    if (tf) {
+        write_trace_samples(tf, inputs, res, cnt);
+        if (close_trace(tf)) {
+            fprintf(stderr, "Failed to write trace %s\n", trace_out);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(stderr, "Matching samples: %lu\n", total);
+
+    free(matches);
+    free(inputs);
+    free(res);
+
+    return EXIT_SUCCESS;
+}
+
+int aggregate(trace_query *q, FILE *out) {
+    uint32_t j;
+    trace_agg *agg = aggregate_trace_query(q);
+
+    fprintf(out, "set,count,mean,std,min,max\n");
+    for (j = 0; j < q->sets_len; ++j) {
+        fprintf(out, "%u,%lu,%.3f,%.3f,%u,%u\n", q->sets[j], agg->cnt,
+                agg->mean[j], agg->std[j], agg->min[j], agg->max[j]);
+    }
+
+    release_trace_agg(agg);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Histogram with the bins given as min:width:bins
+ */
+int histogram(trace_query *q, FILE *out, const char *arg) {
+    uint32_t j, b, min, width, bins;
+    uint64_t *hist;
+
+    if (sscanf(arg, "%u:%u:%u", &min, &width, &bins) != 3 || !width || !bins) {
+        fprintf(stderr, "Invalid histogram %s, expected min:width:bins\n", arg);
+        return EXIT_FAILURE;
+    }
+
+    hist = (uint64_t *) malloc((uint64_t) q->sets_len * bins * sizeof(uint64_t));
+    assert(hist);
+    histogram_trace_query(q, min, width, bins, hist);
+
+    fprintf(out, "set");
+    for (b = 0; b < bins; ++b)
+        fprintf(out, ",%u", min + b * width);
+    fprintf(out, "\n");
+    for (j = 0; j < q->sets_len; ++j) {
+        fprintf(out, "%u", q->sets[j]);
+        for (b = 0; b < bins; ++b)
+            fprintf(out, ",%lu", hist[(uint64_t) j * bins + b]);
+        fprintf(out, "\n");
+    }
+
+    free(hist);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Copy a trace, compressed or uncompressed
+ */
+int convert(const char *in_path, const char *out_path, bool compress) {
+    uint32_t cnt;
+    uint64_t in_size, out_size;
+    uint8_t *inputs;
+    time_type *res;
+    trace_file *in, *out;
+    struct stat st;
+
+    in = open_trace(in_path);
+    if (!in) {
+        fprintf(stderr, "Failed to open trace %s\n", in_path);
+        return EXIT_FAILURE;
+    }
+
+    if (compress)
+        out = create_compressed_trace(out_path, in->hdr.msrmts_per_sample,
+                                      in->hdr.input_len);
+    else
+        out = create_trace(out_path, in->hdr.msrmts_per_sample, in->hdr.input_len);
+    if (!out) {
+        fprintf(stderr, "Failed to create trace %s\n", out_path);
+        return EXIT_FAILURE;
+    }
+
+    inputs  = (uint8_t *) malloc(CONVERT_BATCH * in->hdr.input_len + 1);
+    res     = (time_type *) malloc((uint64_t) CONVERT_BATCH
+                                   * in->hdr.msrmts_per_sample * sizeof(time_type));
+    assert(inputs && res);
+
+    while ((cnt = read_trace_samples(in, inputs, res, CONVERT_BATCH)) > 0) {
+        if (write_trace_samples(out, inputs, res, cnt))
+            break;
+    }
+
+    if (!out->write_failed && out->hdr.samples != in->hdr.samples) {
+        fprintf(stderr, "Failed to read trace %s after %lu samples\n", in_path,
+                out->hdr.samples);
+        return EXIT_FAILURE;
+    }
+
+    close_trace(in);
+    if (close_trace(out)) {
+        fprintf(stderr, "Failed to write trace %s\n", out_path);
+        return EXIT_FAILURE;
+    }
+
+    stat(in_path, &st);
+    in_size = st.st_size;
+    stat(out_path, &st);
+    out_size = st.st_size;
+    printf("%lu -> %lu bytes (ratio %.2f)\n", in_size, out_size,
+           (double) in_size / out_size);
+
+    free(inputs);
+    free(res);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Parse a comma separated list of sets and ranges, e.g. 3,12,40-47
+ */
+/*
+ * Parse a sample index, optionally in scientific notation with an integer
+ * exponent (e.g. 1e6). Returns 1 if `arg` does not start with a valid index.
+ */
+int parse_sample(const char *arg, char **end, uint64_t *sample) {
+    uint64_t exp;
+
+    if (!isdigit((unsigned char) *arg))
+        return 1;
+
+    errno   = 0;
+    *sample = strtoull(arg, end, 10);
+    if (errno)
+        return 1;
+
+    if (**end == 'e' && isdigit((unsigned char) (*end)[1])) {
+        exp = strtoull(*end + 1, end, 10);
+        for (; exp > 0; --exp) {
+            if (*sample > UINT64_MAX / 10)
+                return 1;
+            *sample *= 10;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Parse a range first:last or first (up to the last sample).
+ * Returns 1 if the range is malformed or empty.
+ */
+int parse_range(const char *arg, uint64_t samples, uint64_t *first,
+    uint64_t *last)
+{
+    char *end;
+
+    if (parse_sample(arg, &end, first))
+        return 1;
+
+    if (*end == ':') {
+        if (parse_sample(end + 1, &end, last))
+            return 1;
+    }
+    else {
+        *last = samples;
+    }
+
+    return *end != '\0' || *first >= *last;
+}
+
+int parse_sets(const char *arg, uint32_t **sets, uint32_t *sets_len) {
+    uint32_t lo, hi, s, cap = 0;
+    char *end;
+
+    *sets_len = 0;
+    while (*arg) {
+        lo = hi = strtoul(arg, &end, 0);
+        if (end == arg)
+            return 1;
+        if (*end == '-') {
+            arg = end + 1;
+            hi  = strtoul(arg, &end, 0);
+            if (end == arg || hi < lo)
+                return 1;
+        }
+
+        for (s = lo; s <= hi; ++s) {
+            if (*sets_len == cap) {
+                cap     = cap ? 2 * cap : 64;
+                *sets   = (uint32_t *) realloc(*sets, cap * sizeof(uint32_t));
+                assert(*sets);
+            }
+            (*sets)[(*sets_len)++] = s;
+        }
+
+        if (*end == ',')
+            ++end;
+        else if (*end != '\0')
+            return 1;
+        arg = end;
+    }
+
+    return *sets_len == 0;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <info|select|agg|hist> <trace file> [options]\n"
+                    "       %s <pack|unpack> <trace file> <output trace>\n"
+                    "  -r first:last  sample range, e.g. 1e6:2e6 or 1000\n"
+                    "  -s sets        selected sets, e.g. 3,12,40-47\n"
+                    "  -w condition   filter, e.g. s12>=120 or i0==0x3f "
+                    "(repeatable)\n"
+                    "  -t threads     number of threads (all CPUs by default)\n"
+                    "  -H min:w:n     histogram of n bins of w cycles (hist)\n"
+                    "  -b trace       write the selection as trace (select)\n"
+                    "  -o file        CSV output file (stdout by default)\n",
+            prog, prog);
+    exit(EXIT_FAILURE);
+}
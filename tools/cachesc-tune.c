@@ -0,0 +1,118 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool tunes the Prime+Probe configuration for the current machine
+ * against a victim accessing a single line in a chosen cache set, and stores
+ * the best configuration in a profile (see autotune.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure autotuner
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    uint32_t target_set;
+    uint32_t layouts = AUTOTUNE_LAYOUTS;
+    pp_conf conf, default_conf;
+    pp_conf_score score, default_score;
+
+    if (argc != 4 && argc != 5)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    target_set = atoi(argv[2]);
+    if (argc == 5)
+        layouts = atoi(argv[4]);
+
+    cache_ctx *ctx = get_cache_ctx(target_cache);
+    if (target_set >= ctx->sets || layouts == 0)
+        usage(argv[0]);
+
+    PRINT_LINE("Autotune %s Prime+Probe on set %u with %u layouts\n",
+               argv[1], target_set, layouts);
+
+    set_seed();
+    pin_to_cpu(CPU_NUMBER);
+
+    /*
+     * Reference: default configuration of the demos
+     */
+    get_default_pp_conf(ctx, &default_conf);
+    cacheline *cache_ds     = prepare_cache_ds(ctx);
+    cacheline *victim_cl    = prepare_victim(ctx, target_set);
+
+    prepare_measurement();
+    evaluate_pp_conf(ctx, &default_conf, cache_ds, victim_cl, target_set,
+                     AUTOTUNE_MIN_SAMPLES << 4, &default_score);
+
+    release_victim(ctx, victim_cl);
+    release_cache_ds(ctx, cache_ds);
+
+    PRINT_LINE("Default configuration:\n");
+    print_pp_conf(&default_conf, &default_score);
+
+    /*
+     * Search the best configuration
+     */
+    print_banner("Start autotuning");
+    autotune_pp_conf(ctx, target_set, layouts, &conf, &score);
+    print_banner("Stop autotuning");
+
+    PRINT_LINE("Best configuration:\n");
+    print_pp_conf(&conf, &score);
+
+    if (save_pp_profile(argv[3], ctx, &conf, &score)) {
+        fprintf(stderr, "Failed to write profile to %s\n", argv[3]);
+        release_cache_ctx(ctx);
+        return EXIT_FAILURE;
+    }
+    PRINT_LINE("Profile written to %s\n", argv[3]);
+
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> <target set> <profile> [layouts]\n", prog);
+    exit(EXIT_FAILURE);
+}
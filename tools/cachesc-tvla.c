@@ -0,0 +1,200 @@
+/*
+ * This file is part of the CacheSC library (https://github.com/Miro-H/CacheSC),
+ * which implements Prime+Probe attacks on virtually and physically indexed
+ * caches.
+ *
+ * Copyright (C) 2020  Miro Haller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: miro.haller@alumni.ethz.ch
+ *
+ * Short description of this file:
+ * This tool checks whether a victim leaks through the cache with a
+ * fixed-vs-random Welch t-test (see tvla.h): samples with a fixed input and
+ * with random inputs are interleaved randomly and the per-set t-statistics
+ * are updated online. It stops as soon as a leak is confirmed or after the
+ * maximal number of samples. The victims are the synthetic leaky victims of
+ * leaky_victim.h with a fixed random secret.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cachesc.h>
+
+
+/*
+ * Configure leakage assessment
+ */
+
+// Pin process to a CPU. To reduce noise, this CPU can be isolated.
+#define CPU_NUMBER 1
+
+#define DEFAULT_MAX_SAMPLES 1000000
+// Samples between two progress reports
+#define REPORT_INTERVAL (16 * TVLA_CHECK_INTERVAL)
+
+// local functions
+void usage(const char *prog);
+
+int main(int argc, char **argv) {
+    cache_level target_cache;
+    leaky_victim_type type;
+    uint32_t i, cls, order = 1;
+    uint32_t max_samples = DEFAULT_MAX_SAMPLES;
+
+    if (argc < 3 || argc > 5)
+        usage(argv[0]);
+
+    if (!strcmp(argv[1], "L1"))
+        target_cache = L1;
+    else if (!strcmp(argv[1], "L2"))
+        target_cache = L2;
+    else
+        usage(argv[0]);
+
+    for (type = LEAKY_AES_TTABLE; type <= LEAKY_MEMHARD; ++type) {
+        if (!strcmp(argv[2], get_leaky_victim_name(type)))
+            break;
+    }
+    if (type > LEAKY_MEMHARD)
+        usage(argv[0]);
+
+    if (argc >= 4)
+        max_samples = atoi(argv[3]);
+    if (argc == 5)
+        order = atoi(argv[4]);
+    if (max_samples == 0 || order < 1 || order > TVLA_MAX_ORDER)
+        usage(argv[0]);
+
+    PRINT_LINE("Fixed-vs-random t-test of the %s victim on %s, at most %u "
+               "samples, order %u\n", argv[2], argv[1], max_samples, order);
+
+    set_seed();
+
+    cache_ctx *ctx      = get_cache_ctx(target_cache);
+    cacheline *cache_ds = prepare_cache_ds(ctx);
+
+    time_type *res = (time_type *) calloc(ctx->sets, sizeof(time_type));
+    assert(res);
+
+    leaky_victim *v = prepare_leaky_victim(type, 0, 0);
+    assert(v);
+
+    uint8_t *secret         = (uint8_t *) malloc(v->secret_len);
+    uint8_t *fixed_input    = (uint8_t *) malloc(v->input_len);
+    uint8_t *random_input   = (uint8_t *) malloc(v->input_len);
+    uint8_t *output         = (uint8_t *) malloc(v->output_len);
+    assert(secret && fixed_input && random_input && output);
+
+    gen_rand_bytes(secret, v->secret_len);
+    gen_rand_bytes(fixed_input, v->input_len);
+    set_leaky_victim_secret(v, secret);
+
+    tvla *a = prepare_tvla(ctx->sets, order);
+    signal_quality *quality = prepare_signal_quality(TVLA_CLASSES, ctx->sets);
+
+    pin_to_cpu(CPU_NUMBER);
+
+    // Forward prime for L1, reverse prime for L2
+    pp_conf conf;
+    get_default_pp_conf(ctx, &conf);
+
+    cacheline *curr_head = cache_ds;
+    cacheline *next_head;
+
+
+    /*
+     * Assess the victim
+     */
+    print_banner("Start leakage assessment");
+
+    prepare_measurement();
+
+    for (i = 0; i < max_samples; ++i) {
+        cls = get_tvla_class();
+        if (cls == TVLA_RANDOM)
+            gen_rand_bytes(random_input, v->input_len);
+
+        curr_head = prime_conf(&conf, curr_head);
+        run_leaky_victim(v, (cls == TVLA_FIXED) ? fixed_input : random_input,
+                         output);
+        next_head = probe_conf(&conf, target_cache, curr_head);
+
+        get_msrmts_for_all_set(curr_head, res);
+        curr_head = next_head;
+
+        update_tvla(a, cls, res);
+        update_signal_quality(quality, cls, res);
+        if (is_tvla_done(a))
+            break;
+
+        if (a->samples % REPORT_INTERVAL == 0) {
+            compute_tvla(a);
+            print_tvla_progress(a);
+        }
+    }
+
+    print_banner("Stop leakage assessment");
+
+
+    /*
+     * Print output
+     */
+    compute_tvla(a);
+    print_tvla(a);
+
+    uint32_t *leaky_sets = (uint32_t *) malloc(ctx->sets * sizeof(uint32_t));
+    assert(leaky_sets);
+
+    for (i = 1; i <= order; ++i) {
+        uint32_t len = get_tvla_leaky_sets(a, i, leaky_sets);
+
+        PRINT_LINE("Order %u leaky sets (%u):", i, len);
+        for (uint32_t j = 0; j < len; ++j)
+            printf(" %u", leaky_sets[j]);
+        PRINT_FLUSH("\n");
+    }
+    PRINT_LINE("%s after %lu samples\n", is_tvla_leaky(a) ? "Leak confirmed"
+               : "No leak detected", a->samples);
+
+    compute_signal_quality(quality);
+    PRINT_LINE("Signal quality with fixed and random inputs as classes:\n");
+    print_signal_quality(quality);
+
+
+    /*
+     * Cleanup
+     */
+    free(leaky_sets);
+    release_tvla(a);
+    release_signal_quality(quality);
+    free(secret);
+    free(fixed_input);
+    free(random_input);
+    free(output);
+    release_leaky_victim(v);
+    free(res);
+    release_cache_ds(ctx, cache_ds);
+    release_cache_ctx(ctx);
+
+    return EXIT_SUCCESS;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <L1|L2> <aes-ttable|modexp|lookup|memhard> "
+                    "[max samples] [order]\n", prog);
+    exit(EXIT_FAILURE);
+}